@@ -2,10 +2,149 @@ import sys
 import os
 import json
 import struct
+import time
 import logging
+import collections
+import queue
+import threading
 import requests
 from bluepy import btle
 
+# Status flags in byte 10 of manufacturer data
+STATUS_NO_DATA = 0x01
+STATUS_ALARM = 0x02
+STATUS_BATTERY_LOW = 0x04
+# Channels after channel 0 are in 16 bit service data of the scan response
+CHANNEL_SERVICE_UUID = 0x0001
+CHANNEL_DATA_LEN = 6
+# Payloads of neighbours relayed by an ENBLE are in 16 bit service data of its scan response
+RELAY_SERVICE_UUID = 0x0002
+RELAY_ENTRY_LEN = 11
+# Sample count and min, max and standard deviation of the reporting period are in 16 bit service data of the scan response
+AGGREGATE_SERVICE_UUID = 0x0004
+AGGREGATE_DATA_LEN = 20
+# Unix time (uint32 s + uint16 ms) is written to this characteristic to sync the clock of an ENBLE
+TIME_CHAR_UUID = 'bff20015-378e-4955-89d6-25948b941062'
+# A recommended TX power (int8 dBm) is written to this characteristic. The current one is in the scan response.
+# The characteristic is read back after a write, as the device clamps a level below its floor (TX_POWER_MIN).
+TX_POWER_CHAR_UUID = 'bff20017-378e-4955-89d6-25948b941062'
+TX_POWER_LEVELS = (-40, -30, -20, -16, -12, -8, -4, 0, 4)
+# A link is judged from the last scans. A device which loses more than this ratio of its packets is raised a level.
+TX_POWER_HISTORY_LEN = 10
+TX_POWER_LOSS_MAX = 0.1
+# Packets closer than this are an advertising packet and its scan response, not two advertising events
+ADV_GAP_MIN = 0.02
+# Mean of the random delay (0 - 10 ms) which the device adds to each advertising event
+ADV_DELAY_MEAN = 0.005
+# Weight of a new RSSI sample in the average
+TX_POWER_RSSI_WEIGHT = 0.1
+# What the scanner does with a measurement when the queue of its upload worker is full
+UPLOAD_QUEUE_FULL_POLICIES = ('drop_oldest', 'drop_newest', 'block')
+
+
+class UploadPool:
+    """Workers which post measurements to ThingsBoard, so that a slow server does not stall the scan.
+        A device is always posted by the same worker (device_id modulo the number of workers),
+        so the measurements of a device arrive in order.
+    """
+
+    def __init__(self, worker_cnt, queue_size, full_policy, block_timeout, post_timeout, logger):
+        self.full_policy = full_policy
+        self.block_timeout = block_timeout
+        self.post_timeout = post_timeout
+        self.logger = logger
+        self.lock = threading.Lock()
+        self.counts = collections.Counter()
+        self.queues = [queue.Queue(maxsize=max(queue_size // worker_cnt, 1)) for _ in range(worker_cnt)]
+        self.threads = [threading.Thread(target=self.run, args=(q,), daemon=True) for q in self.queues]
+        for thread in self.threads:
+            thread.start()
+
+
+    def count(self, name):
+        with self.lock:
+            self.counts[name] += 1
+
+
+    def put(self, device_id, post_url, measurement):
+        """Queue a measurement. This is called by the scanner and blocks only with the 'block' policy."""
+
+        upload_queue = self.queues[device_id % len(self.queues)]
+        item = (post_url, measurement)
+        if self.full_policy == 'block':
+            # Backpressure: the scanner waits for the worker, and the measurement is dropped after the timeout.
+            try:
+                upload_queue.put(item, timeout=self.block_timeout)
+                self.count('queued')
+            except queue.Full:
+                self.count('dropped')
+            return
+
+        while True:
+            try:
+                upload_queue.put_nowait(item)
+                self.count('queued')
+                return
+            except queue.Full:
+                if self.full_policy == 'drop_newest':
+                    self.count('dropped')
+                    return
+            # drop_oldest: the newest measurement of a device is the most useful one.
+            try:
+                upload_queue.get_nowait()
+                upload_queue.task_done()
+                self.count('dropped')
+            except queue.Empty:
+                pass
+
+
+    def run(self, upload_queue):
+        session = requests.Session()
+        while True:
+            item = upload_queue.get()
+            if item is None:
+                upload_queue.task_done()
+                return
+            post_url, measurement = item
+            try:
+                server_response = session.post(post_url, json=measurement, timeout=self.post_timeout)
+                if not server_response.ok:
+                    raise Exception('Failed to post ThingsBoard server({0}):{1}'.format(post_url, server_response.status_code))
+                self.count('posted')
+            except Exception as err:
+                self.count('failed')
+                self.logger.error(err)
+            finally:
+                upload_queue.task_done()
+
+
+    def report(self):
+        """Log the counts since the last report."""
+
+        with self.lock:
+            counts = self.counts
+            self.counts = collections.Counter()
+        waiting = sum(q.qsize() for q in self.queues)
+        message = 'Upload: {} queued, {} posted, {} failed, {} dropped, {} waiting'.format(
+            counts['queued'], counts['posted'], counts['failed'], counts['dropped'], waiting)
+        if counts['dropped'] > 0:
+            self.logger.warning(message + ' (the upload queue was full)')
+        else:
+            self.logger.info(message)
+
+
+    def close(self, timeout):
+        """Post the queued measurements and stop the workers, waiting up to timeout seconds."""
+
+        deadline = time.time() + timeout
+        for upload_queue in self.queues:
+            try:
+                upload_queue.put(None, timeout=max(deadline - time.time(), 0))
+            except queue.Full:
+                pass
+        for thread in self.threads:
+            thread.join(max(deadline - time.time(), 0))
+
 
 class EnbleBridge(btle.DefaultDelegate):
 
@@ -15,6 +154,23 @@ class EnbleBridge(btle.DefaultDelegate):
             self.config = json.load(config_file)
         self.validate_config()
         self.logger = logger
+        # the last relayed payload and the last payload received directly of each device to drop duplicates
+        self.relayed_payloads = {}
+        self.direct_payloads = {}
+        # the last time each device was synced and the devices waiting for a sync
+        self.time_synced_at = {}
+        self.time_sync_queue = set()
+        # RSSI and loss statistics of each device and the TX power waiting to be written
+        self.links = {}
+        self.tx_power_queue = {}
+        self.scan_started_at = time.time()
+        self.upload_pool = UploadPool(
+            self.config.get('upload_workers', 4),
+            self.config.get('upload_queue_size', 1000),
+            self.config.get('upload_queue_full', 'drop_oldest'),
+            self.config.get('upload_block_timeout', 1.0),
+            self.config.get('upload_timeout', 10.0),
+            logger)
 
 
     def validate_config(self):
@@ -35,20 +191,47 @@ class EnbleBridge(btle.DefaultDelegate):
             if not access_token.get('access_token'):
                 raise Exception('Config does not contain valid "access_token_set"')
 
+        if self.config.get('upload_queue_full', 'drop_oldest') not in UPLOAD_QUEUE_FULL_POLICIES:
+            raise Exception('"upload_queue_full" must be one of ' + ', '.join(UPLOAD_QUEUE_FULL_POLICIES))
+        if self.config.get('upload_workers', 4) < 1:
+            raise Exception('"upload_workers" must be 1 or more')
+
 
     def handleDiscovery(self, dev, isNewDev, isNewData):
         """This is a delegate function for a btle scanner. 
             When a scanner receives BLE advertise packet, this function is called.
+            It only parses the packet and queues the measurement, because packets arriving meanwhile are lost.
         """
 
-        if not isNewData or not self.is_enable(dev):
+        if not self.is_enable(dev):
+            return
+
+        # Every packet counts for the link statistics, even if its data is not new.
+        self.update_link(dev)
+
+        if not isNewData:
             return
 
         try:
             manufacturer_data = dev.scanData.get(btle.ScanEntry.MANUFACTURER)
             measurement = self.parse_manufacturer_data(manufacturer_data)
+            self.direct_payloads[measurement['device_id']] = manufacturer_data
+            service_data = dev.scanData.get(btle.ScanEntry.SERVICE_DATA_16B)
+            if service_data:
+                measurement.update(self.parse_channel_data(service_data))
+                measurement.update(self.parse_aggregate_data(service_data))
             self.logger.debug('Get measurement data:' + str(measurement))
-            self.send_measurement(measurement)
+            self.request_time_sync(dev)
+            # The device may have just booted and not measured yet.
+            if not measurement['status'] & STATUS_NO_DATA:
+                if measurement['status'] & STATUS_ALARM:
+                    self.logger.warning('Alarm of device_id={}: {}'.format(measurement['device_id'], measurement))
+                if measurement['status'] & STATUS_BATTERY_LOW:
+                    self.logger.warning('Battery of device_id={} will run out within 30 days'.format(measurement['device_id']))
+                self.send_measurement(measurement)
+            # The neighbours follow the data of the device, so their errors do not drop it.
+            if service_data:
+                self.handle_relay_data(service_data)
 
         except Exception as err:
             self.logger.error(err)
@@ -61,7 +244,7 @@ class EnbleBridge(btle.DefaultDelegate):
         is_match_local_name = dev.scanData.get(btle.ScanEntry.COMPLETE_LOCAL_NAME) == sensor_name 
         manufacturer_data = dev.scanData.get(btle.ScanEntry.MANUFACTURER)
         if manufacturer_data:
-            is_match_manufacturer_length = len(manufacturer_data) == 10
+            is_match_manufacturer_length = len(manufacturer_data) in (10, 11)
         else:
             is_match_manufacturer_length = False
         return is_match_local_name and is_match_manufacturer_length
@@ -71,20 +254,205 @@ class EnbleBridge(btle.DefaultDelegate):
         """Parse manufacturer data in an advertise packet and get measured data."""
 
         len_of_data = len(manufacturer_bin_data)
-        if len_of_data != 10:
-            raise Exception("Length of manufacturer data must be 10, but it is " + str(len_of_data))
+        if len_of_data not in (10, 11):
+            raise Exception("Length of manufacturer data must be 10 or 11, but it is " + str(len_of_data))
         
-        unpacked_binary = struct.unpack('HHhHH', manufacturer_bin_data)
+        unpacked_binary = struct.unpack('<HHhHH', manufacturer_bin_data[:10])
+        # older firmware does not have the status flags
+        status = manufacturer_bin_data[10] if len_of_data == 11 else 0
         measurement = {
             'device_id' : unpacked_binary[0],
             'battery' : float(unpacked_binary[1]) / 1000,
             'temperature' : float(unpacked_binary[2]) / 100,
             'humidity' : float(unpacked_binary[3]) / 10,
-            'pressure' : float(unpacked_binary[4]) / 10
+            'pressure' : float(unpacked_binary[4]) / 10,
+            'status' : status
         }
         return measurement
 
 
+    def parse_channel_data(self, service_bin_data):
+        """Parse service data in a scan response and get measured data of channel 1 and the followings."""
+
+        if len(service_bin_data) < 2 or struct.unpack('<H', service_bin_data[:2])[0] != CHANNEL_SERVICE_UUID:
+            return {}
+
+        channel_bin_data = service_bin_data[2:]
+        if len(channel_bin_data) % CHANNEL_DATA_LEN != 0:
+            raise Exception("Length of channel data must be a multiple of " + str(CHANNEL_DATA_LEN) + ", but it is " + str(len(channel_bin_data)))
+
+        measurement = {}
+        for i in range(len(channel_bin_data) // CHANNEL_DATA_LEN):
+            unpacked_binary = struct.unpack('<hHH', channel_bin_data[i * CHANNEL_DATA_LEN:(i + 1) * CHANNEL_DATA_LEN])
+            channel = str(i + 1)
+            measurement['temperature_' + channel] = float(unpacked_binary[0]) / 100
+            measurement['humidity_' + channel] = float(unpacked_binary[1]) / 10
+            measurement['pressure_' + channel] = float(unpacked_binary[2]) / 10
+        return measurement
+
+
+    def parse_aggregate_data(self, service_bin_data):
+        """Parse service data in a scan response and get the aggregate of the reporting period of channel 0."""
+
+        if len(service_bin_data) < 2 or struct.unpack('<H', service_bin_data[:2])[0] != AGGREGATE_SERVICE_UUID:
+            return {}
+
+        aggregate_bin_data = service_bin_data[2:]
+        if len(aggregate_bin_data) != AGGREGATE_DATA_LEN:
+            raise Exception("Length of aggregate data must be " + str(AGGREGATE_DATA_LEN) + ", but it is " + str(len(aggregate_bin_data)))
+
+        unpacked_binary = struct.unpack('<HhhHHHHHHH', aggregate_bin_data)
+        if unpacked_binary[0] == 0:
+            return {}
+
+        measurement = {'samples' : unpacked_binary[0]}
+        for i, (name, scale) in enumerate((('temperature', 100), ('humidity', 10), ('pressure', 10))):
+            measurement[name + '_min'] = float(unpacked_binary[1 + i * 3]) / scale
+            measurement[name + '_max'] = float(unpacked_binary[2 + i * 3]) / scale
+            measurement[name + '_sd'] = float(unpacked_binary[3 + i * 3]) / scale
+        return measurement
+
+
+    def handle_relay_data(self, service_bin_data):
+        """Send measured data of neighbours relayed in a scan response.
+            A neighbour which is also received directly is sent only from its own packet.
+            An error of an entry, e.g. a neighbour without an access token, is logged and the other entries are sent.
+        """
+
+        if len(service_bin_data) < 2 or struct.unpack('<H', service_bin_data[:2])[0] != RELAY_SERVICE_UUID:
+            return
+
+        relay_bin_data = service_bin_data[2:]
+        for i in range(len(relay_bin_data) // RELAY_ENTRY_LEN):
+            payload = relay_bin_data[i * RELAY_ENTRY_LEN:(i + 1) * RELAY_ENTRY_LEN]
+            measurement = self.parse_manufacturer_data(payload)
+            # The same payload is relayed until the neighbour measures again.
+            if self.relayed_payloads.get(measurement['device_id']) == payload:
+                continue
+            self.relayed_payloads[measurement['device_id']] = payload
+            if measurement['status'] & STATUS_NO_DATA or self.direct_payloads.get(measurement['device_id']) == payload:
+                continue
+            self.logger.debug('Get relayed measurement data:' + str(measurement))
+            try:
+                self.send_measurement(measurement)
+            except Exception as err:
+                self.logger.error(err)
+
+
+    def request_time_sync(self, dev):
+        """Queue a device whose clock has not been synced for "time_sync_interval" seconds."""
+
+        interval = self.config.get('time_sync_interval')
+        if not interval:
+            return
+        if time.time() - self.time_synced_at.get(dev.addr, 0) >= interval:
+            self.time_sync_queue.add((dev.addr, dev.addrType))
+
+
+    def update_link(self, dev):
+        """Average RSSI and record the advertised TX power of a device."""
+
+        if not self.config.get('tx_power_target_rssi'):
+            return
+        tx_power_data = dev.scanData.get(btle.ScanEntry.TX_POWER)
+        if not tx_power_data or len(tx_power_data) != 1:
+            # older firmware does not advertise the TX power
+            return
+
+        link = self.links.get(dev.addr)
+        if link is None:
+            link = {
+                'rssi' : float(dev.rssi),
+                'history' : collections.deque(maxlen=TX_POWER_HISTORY_LEN),
+                'written_at' : 0}
+            self.links[dev.addr] = link
+        link['addr_type'] = dev.addrType
+        link['tx_power'] = struct.unpack('<b', tx_power_data)[0]
+        link['rssi'] += (dev.rssi - link['rssi']) * TX_POWER_RSSI_WEIGHT
+
+        # Advertising events received in this scan, and the shortest gap between them for the interval
+        now = time.time()
+        scan = link.get('scan')
+        if scan is None:
+            link['scan'] = {'last' : now, 'packets' : 1, 'gap_min' : None}
+        elif now - scan['last'] >= ADV_GAP_MIN:
+            gap = now - scan['last']
+            scan['gap_min'] = gap if scan['gap_min'] is None else min(scan['gap_min'], gap)
+            scan['last'] = now
+            scan['packets'] += 1
+
+
+    def control_tx_power(self):
+        """Update the loss statistics after a scan and queue a TX power for the devices which need a new one.
+            The same level is written again every "tx_power_interval" seconds to feed the watchdog of the device.
+        """
+
+        target_rssi = self.config.get('tx_power_target_rssi')
+        if not target_rssi:
+            return
+
+        scan_time = time.time() - self.scan_started_at
+        for addr, link in self.links.items():
+            scan = link.pop('scan', None)
+            if scan and scan['gap_min'] is not None:
+                link['interval'] = scan['gap_min']
+            link['history'].append(packet_loss(scan, scan_time, link.get('interval')))
+            if len(link['history']) < TX_POWER_HISTORY_LEN:
+                continue
+            loss_ratio = sum(link['history']) / len(link['history'])
+            level = recommend_tx_power(link['tx_power'], link['rssi'], loss_ratio, target_rssi, link.get('floor'))
+            interval = self.config.get('tx_power_interval', 86400)
+            if level != link['tx_power'] or time.time() - link['written_at'] >= interval:
+                self.tx_power_queue[addr] = level
+
+
+    def write_queued(self):
+        """Connect to the queued devices and write the current Unix time and the recommended TX power.
+            This must be called while the scanner is stopped.
+        """
+
+        self.control_tx_power()
+
+        addr_types = dict(self.time_sync_queue)
+        addr_types.update((addr, self.links[addr]['addr_type']) for addr in self.tx_power_queue)
+        self.time_sync_queue.clear()
+
+        for addr, addr_type in addr_types.items():
+            tx_power = self.tx_power_queue.pop(addr, None)
+            try:
+                peripheral = btle.Peripheral(addr, addr_type)
+                try:
+                    if tx_power is not None:
+                        tx_power_char = peripheral.getCharacteristics(uuid=TX_POWER_CHAR_UUID)[0]
+                        tx_power_char.write(struct.pack('<b', tx_power), withResponse=True)
+                        applied = struct.unpack('<b', tx_power_char.read())[0]
+                    time_char = peripheral.getCharacteristics(uuid=TIME_CHAR_UUID)[0]
+                    now = time.time()
+                    time_char.write(struct.pack('<IH', int(now), int((now % 1) * 1000)), withResponse=True)
+                finally:
+                    peripheral.disconnect()
+                self.time_synced_at[addr] = time.time()
+                self.logger.info('Synced time of ' + addr)
+                if tx_power is not None:
+                    link = self.links[addr]
+                    link['written_at'] = time.time()
+                    if applied > tx_power:
+                        # Not recommended below the floor again, otherwise the same level is written at every scan.
+                        link['floor'] = applied
+                    if applied != link['tx_power']:
+                        self.logger.info('TX power of {}: {} -> {} dBm (RSSI {:.1f} dBm)'.format(
+                            addr, link['tx_power'], applied, link['rssi']))
+                        # The effect of the new level is judged from new statistics.
+                        link['history'].clear()
+                        link['rssi'] += applied - link['tx_power']
+                        link['tx_power'] = applied
+            except btle.BTLEException as err:
+                # Retry at the next scan.
+                self.logger.warning('Failed to connect to {}: {}'.format(addr, err))
+
+        self.scan_started_at = time.time()
+
+
     def get_access_token(self, device_id):
         """Find and get an access token corresponding with device_id."""
 
@@ -108,12 +476,48 @@ class EnbleBridge(btle.DefaultDelegate):
 
 
     def send_measurement(self, measurement):
-        """ Generate an appropreate url and post measured data."""
+        """ Generate an appropreate url and queue measured data to be posted by the upload workers."""
         device_id = measurement['device_id']
         post_url = self.get_post_url(device_id)
-        server_response = requests.post(post_url, json=measurement)
-        if not server_response.ok:
-            raise Exception('Failed to post ThingsBoard server({0}):{1}'.format(post_url, server_response.status_code))
+        self.upload_pool.put(device_id, post_url, measurement)
+
+
+
+def packet_loss(scan, scan_time, interval):
+    """Ratio of the advertising events of a device in a scan which were not received.
+        The events are counted from the scan time and the interval, which is the shortest gap between packets
+        in this scan or an earlier one. Without an interval yet, only a scan without any packet is a loss.
+    """
+
+    if scan is None:
+        return 1.0
+    if interval is None:
+        return 0.0
+    expected = scan_time / (interval + ADV_DELAY_MEAN)
+    return min(max(1.0 - scan['packets'] / expected, 0.0), 1.0) if expected >= 1 else 0.0
+
+
+def recommend_tx_power(tx_power, rssi, loss_ratio, target_rssi, floor=None):
+    """Get the lowest TX power level which keeps RSSI at the bridge above target_rssi.
+        The level goes up by one when packets are lost, and down by one level at a time
+        so that a loss at the new level is found before the next step.
+        A level below the floor found by a write is not recommended.
+    """
+
+    levels = [level for level in TX_POWER_LEVELS if floor is None or level >= floor]
+
+    if loss_ratio > TX_POWER_LOSS_MAX:
+        higher = [level for level in levels if level > tx_power]
+        return higher[0] if higher else tx_power
+
+    path_loss = tx_power - rssi
+    enough = [level for level in levels if level - path_loss >= target_rssi]
+    recommended = enough[0] if enough else levels[-1]
+
+    lower = [level for level in levels if level < tx_power]
+    if recommended < tx_power and lower:
+        recommended = max(recommended, lower[-1])
+    return recommended
 
 
 
@@ -136,9 +540,15 @@ if __name__ == '__main__':
 
     print('start BLE scan.')
 
+    # Scan for a shorter time when time sync or TX power control is enabled in order to connect to devices between scans.
+    is_downlink_enabled = enble_bridge.config.get('time_sync_interval') or enble_bridge.config.get('tx_power_target_rssi')
+    scan_time = 60 if is_downlink_enabled else 300
+
     while True:
         try:
-            devices = scanner.scan(300)
+            devices = scanner.scan(scan_time)
+            enble_bridge.upload_pool.report()
+            enble_bridge.write_queued()
         except btle.BTLEDisconnectError as err:
             # This exception offen occurs but this program works well.
             # So just log that the exception occure.
@@ -147,6 +557,7 @@ if __name__ == '__main__':
             logger.exception(err)
             sys.exit(1)
         except KeyboardInterrupt as e:
+            enble_bridge.upload_pool.close(10)
             sys.exit(0)
 
 
@@ -0,0 +1,86 @@
+"""Delivery ratio of slow advertising per fleet size, random delay vs time slots (make SLOTTED_ADV=1).
+
+An advertising event sends one packet on each of the channels 37, 38 and 39.
+The scanner listens to one channel at a time, and a packet is lost when another packet
+on the same channel overlaps it. Scan requests and responses are not modelled.
+"""
+import argparse
+import numpy as np
+
+ADV_CHANNELS = 3
+PACKET_TIME = 0.376e-3      # s, 47 bytes at 1 Mbps (31 bytes of advertising data)
+CHANNEL_GAP = 1.5e-3        # s, start of a packet to the start of the next channel's one
+ADV_DELAY_MAX = 10e-3       # s, random delay added by the stack to every event
+ADV_EVENT_TIME = 5e-3       # s, same as ADV_EVENT_TIME in adv_slot.c
+SYNC_ERROR_MAX = 2e-3       # s, error of a time sync over a connection
+
+
+def random_event_times(rng, n_devices, interval, duration):
+    n_events = int(duration / interval) + 1
+    steps = interval + rng.uniform(0, ADV_DELAY_MAX, (n_devices, n_events))
+    start = rng.uniform(0, interval, (n_devices, 1))
+    return start + np.cumsum(steps, axis=1) - steps[:, :1]
+
+
+def slotted_event_times(rng, n_devices, interval, duration, slot_width, sync_interval, drift_ppm):
+    n_events = int(duration / interval) + 1
+    slot_cnt = int(interval / slot_width)
+    slots = np.arange(n_devices) % slot_cnt
+    offset = slots * slot_width + (slot_width - ADV_EVENT_TIME) / 2
+    nominal = offset[:, None] + np.arange(n_events)[None, :] * interval
+
+    # The clock runs off by the residual drift after the estimation and is set again at every sync.
+    n_syncs = int(duration / sync_interval) + 2
+    phase = rng.uniform(0, sync_interval, (n_devices, 1))
+    drift = rng.uniform(-drift_ppm, drift_ppm, (n_devices, 1)) * 1e-6
+    sync_error = rng.uniform(-SYNC_ERROR_MAX, SYNC_ERROR_MAX, (n_devices, n_syncs))
+    since_sync = (nominal + phase) % sync_interval
+    sync_idx = ((nominal + phase) // sync_interval).astype(int)
+    return nominal + drift * since_sync + np.take_along_axis(sync_error, sync_idx, axis=1)
+
+
+def delivery_ratio(rng, event_times):
+    n_devices, n_events = event_times.shape
+    collided = np.zeros((n_devices, n_events, ADV_CHANNELS), dtype=bool)
+    for ch in range(ADV_CHANNELS):
+        t = (event_times + ch * CHANNEL_GAP).ravel()
+        order = np.argsort(t)
+        gap = np.diff(t[order])
+        overlap = np.zeros(t.size, dtype=bool)
+        overlap[:-1] |= gap < PACKET_TIME
+        overlap[1:] |= gap < PACKET_TIME
+        flags = np.empty(t.size, dtype=bool)
+        flags[order] = overlap
+        collided[:, :, ch] = flags.reshape(n_devices, n_events)
+
+    # The scanner is on a random channel at each event.
+    channel = rng.integers(0, ADV_CHANNELS, (n_devices, n_events))
+    lost = np.take_along_axis(collided, channel[:, :, None], axis=2)[:, :, 0]
+    return 1.0 - lost.mean()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--interval', type=float, default=6.0, help='slow advertising interval [s]')
+    parser.add_argument('--slot', type=float, default=40.0, help='slot width [ms] (SLOTTED_ADV_SLOT_MS)')
+    parser.add_argument('--sync-interval', type=float, default=3600.0, help='time sync interval of the bridge [s]')
+    parser.add_argument('--drift-ppm', type=float, default=5.0, help='residual drift after the estimation [ppm]')
+    parser.add_argument('--duration', type=float, default=3600.0, help='simulated time [s]')
+    parser.add_argument('--fleet', type=int, nargs='+', default=[10, 50, 100, 150, 200, 300])
+    parser.add_argument('--seed', type=int, default=0)
+    args = parser.parse_args()
+
+    rng = np.random.default_rng(args.seed)
+    slot_width = args.slot * 1e-3
+    print(f'interval {args.interval} s, {int(args.interval / slot_width)} slots of {args.slot} ms, '
+          f'sync every {args.sync_interval} s, drift {args.drift_ppm} ppm')
+    print('devices  random  slotted')
+    for n in args.fleet:
+        r = delivery_ratio(rng, random_event_times(rng, n, args.interval, args.duration))
+        s = delivery_ratio(rng, slotted_event_times(rng, n, args.interval, args.duration,
+                                                    slot_width, args.sync_interval, args.drift_ppm))
+        print(f'{n:7d}  {r:6.2%}  {s:7.2%}')
+
+
+if __name__ == '__main__':
+    main()
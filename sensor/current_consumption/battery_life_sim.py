@@ -0,0 +1,296 @@
+"""Battery lifetime of ENBLE for a configuration, or a sweep of configurations.
+
+The charge per event is built from the current waveforms in data/ (3.0 V, DC/DC off, 0 dBm):
+an advertising event from advertising.csv.gz and a measurement from sensor_measuring1.csv.gz
+and sensor_measuring2.csv.gz, each found above the baseline of its capture by current_capture.py.
+The parts depending on the configuration are scaled: the TX time of an advertising event by the
+TX current of the power level, and the BME280 conversion phases by the oversampling.
+A connection event is not captured and is built from the radio start and the post-processing of
+the advertising event and an exchange of empty packets at the TX and RX levels of the capture.
+A flash write and the sleeping current are the values in README and charge.c.
+
+The lifetime ends when the charge runs out or when the battery voltage under the peak current of
+a radio event falls below the minimum supply voltage, whichever comes first.
+Every parameter takes several values and all the combinations are computed at once.
+"""
+import argparse
+import csv
+import itertools
+import os
+import numpy as np
+
+import current_capture
+
+DATA_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'data')
+
+SLEEP_CURRENT = 3.8e-6      # A, README
+FLASH_WRITE_CHARGE = 20e-6  # C, CHARGE_FLASH_WRITE_NC in charge.c
+ADV_DELAY_MEAN = 5e-3       # s, mean of the random 0-10 ms delay added to every advertising event
+FAST_INTERVAL = 0.1         # s, APP_ADV_FAST_INTERVAL
+FAST_TIMEOUT = 10.0         # s, APP_ADV_FAST_TIMEOUT_IN_SECONDS
+LED_ON_TIME = 0.1           # s, led_blink() at a button push
+LED_CURRENT = (3.0 - 1.9) / 2.2e3  # A, R4 2.2 kOhm and the forward voltage of D1
+
+# Connection event: radio ramp-up, an empty packet each way and the inter frame space
+RADIO_RAMP_UP_TIME = 140e-6
+EMPTY_PACKET_TIME = 80e-6
+IFS_TIME = 150e-6
+
+# TX current of nRF51822 (DC/DC off) per level of S130, product specification
+TX_CURRENT = {4: 16e-3, 0: 10.5e-3, -4: 8e-3, -8: 7e-3, -12: 6.5e-3, -16: 6e-3, -20: 5.5e-3, -30: 5.5e-3, -40: 5.5e-3}
+
+# BME280 typical measurement time per phase (datasheet 9.1) is 2 ms per oversampling plus the overhead
+BME280_OVERHEAD = {'T': 0.0, 'P': 0.5e-3, 'H': 0.5e-3}
+
+# Typical cells. Open circuit voltage and internal resistance by depth of discharge.
+# The resistance rises steeply at the end, so the pulse current of the radio limits a coin cell.
+BATTERIES = {
+    'CR2032': dict(capacity_mah=225, self_discharge=0.01,
+                   dod=[0.0, 0.1, 0.5, 0.8, 0.9, 0.95, 1.0],
+                   ocv=[3.20, 3.05, 3.00, 2.95, 2.85, 2.70, 2.00],
+                   resistance=[10, 12, 18, 30, 60, 120, 400]),
+    '2xAA': dict(capacity_mah=2500, self_discharge=0.03,
+                 dod=[0.0, 0.1, 0.3, 0.5, 0.7, 0.85, 0.95, 1.0],
+                 ocv=[3.20, 2.90, 2.70, 2.50, 2.40, 2.25, 2.10, 1.80],
+                 resistance=[0.3, 0.3, 0.4, 0.5, 0.7, 1.0, 2.0, 5.0]),
+}
+MIN_SUPPLY_VOLTAGE = 1.8    # V, nRF51822 (BME280 works down to 1.71 V)
+DOD_STEPS = 1001
+
+# Defaults of the firmware profiles in app_config.h
+PROFILES = {
+    'FULL': dict(period=60, adv_interval=6.0, osrs_t=1, osrs_h=1, osrs_p=1),
+    'LOGGER': dict(period=300, adv_interval=5.0, osrs_t=1, osrs_h=1, osrs_p=0),
+    'MAINS': dict(period=30, adv_interval=1.0, osrs_t=4, osrs_h=4, osrs_p=4),
+}
+
+EVENTS = ['sleep', 'advertising', 'fast advertising', 'measurement', 'connection', 'LED', 'flash write',
+          'self-discharge']
+
+
+def captured_event(filename, event_class):
+    """The first event of the class in the capture, above the baseline"""
+    for event in current_capture.find_events(filename):
+        if current_capture.classify(event) == event_class:
+            return event
+    raise ValueError(f'no {event_class} event in {filename}')
+
+
+def sample_interval(filename):
+    """Sample interval of a capture from the span of its first block, as read_bins() of current_capture.py takes it.
+    The step between two samples is not used, as the time column has few digits."""
+    time, _ = next(current_capture.read_samples(filename))
+    return (time[-1] - time[0]) / (len(time) - 1)
+
+
+def build_templates(data_dir):
+    tpl = {}
+    tpl['sample_interval'] = sample_interval(os.path.join(data_dir, 'advertising.csv.gz'))
+
+    # Advertising: start of the radio, a TX and RX on each channel, and the post-processing.
+    event = captured_event(os.path.join(data_dir, 'advertising.csv.gz'), 'advertising')
+    adv, bin_time = event.bins, event.bin_time
+    radio = current_capture.radio_bursts(adv)
+    tx_level = np.median(adv[(adv > 9e-3) & (adv < 12e-3)])
+    tx_bins = (adv > 0.9 * tx_level) & (adv < 1.1 * tx_level)
+    rx_level = np.median(adv[adv > 12e-3])
+    tpl['adv_charge'] = adv.sum() * bin_time
+    tpl['adv_tx_time'] = tx_bins.sum() * bin_time
+    tpl['tx_level'] = tx_level
+    tpl['rx_level'] = rx_level
+    tpl['peak_current'] = adv.max()
+    radio_start_charge = adv[:radio[0][0]].sum() * bin_time
+    post_charge = adv[radio[-1][1]:].sum() * bin_time
+    tpl['conn_event_charge'] = (radio_start_charge + post_charge +
+                                (RADIO_RAMP_UP_TIME + EMPTY_PACKET_TIME) * tx_level +
+                                (IFS_TIME + EMPTY_PACKET_TIME) * rx_level)
+
+    # Measuring (start): the CPU starts BME280, which converts T, P and H in this order.
+    event = captured_event(os.path.join(data_dir, 'sensor_measuring1.csv.gz'), 'measuring_start')
+    start, bin_time = event.bins, event.bin_time
+    cpu_end = current_capture.runs(start > 1e-3)[0][1]
+    p_start, p_end = max(current_capture.runs(start > 0.5e-3), key=lambda r: r[1] - r[0])
+    t_start = cpu_end + np.flatnonzero(start[cpu_end:] > 0.28e-3)[0]
+    phases = {'T': start[t_start:p_start], 'P': start[p_start:p_end], 'H': start[p_end:]}
+    tpl['measurement_fixed_charge'] = start[:t_start].sum() * bin_time
+    for name, phase in phases.items():
+        tpl['bme280_' + name + '_time'] = len(phase) * bin_time
+        tpl['bme280_' + name + '_current'] = np.median(phase)
+
+    # Measuring (end): the CPU reads BME280 and updates the advertising data.
+    event = captured_event(os.path.join(data_dir, 'sensor_measuring2.csv.gz'), 'measuring_end')
+    tpl['measurement_fixed_charge'] += current_capture.event_charge(event)
+    return tpl
+
+
+def measurement_charge(tpl, osrs_t, osrs_h, osrs_p):
+    charge = tpl['measurement_fixed_charge']
+    for name, osrs in (('T', osrs_t), ('H', osrs_h), ('P', osrs_p)):
+        overhead = BME280_OVERHEAD[name]
+        scale = np.where(osrs > 0, (2e-3 * osrs + overhead) / (2e-3 + overhead), 0.0)
+        charge = charge + tpl['bme280_' + name + '_time'] * scale * tpl['bme280_' + name + '_current']
+    return charge
+
+
+def tx_current(tpl, tx_power):
+    ratio = np.vectorize(lambda dbm: TX_CURRENT[dbm] / TX_CURRENT[0])(tx_power)
+    return tpl['tx_level'] * ratio
+
+
+def simulate(tpl, cfg, battery):
+    """Charge per day of each event, the peak current and the lifetime for each configuration.
+    cfg has an array per parameter, all of the same shape."""
+    day = 86400.0
+    tx = tx_current(tpl, cfg['tx_power'])
+    adv_charge = tpl['adv_charge'] + tpl['adv_tx_time'] * (tx - tpl['tx_level'])
+    conn_event_charge = tpl['conn_event_charge'] + (RADIO_RAMP_UP_TIME + EMPTY_PACKET_TIME) * (tx - tpl['tx_level'])
+
+    fast_time = (cfg['button'] + cfg['alarms']) * FAST_TIMEOUT
+    connected_time = cfg['connections'] * cfg['connection_time']
+    slow_time = np.maximum(day - fast_time - connected_time, 0.0)
+
+    count = {
+        'sleep': np.ones_like(slow_time),
+        'advertising': slow_time / (cfg['adv_interval'] + ADV_DELAY_MEAN),
+        'fast advertising': fast_time / (FAST_INTERVAL + ADV_DELAY_MEAN),
+        'measurement': day / cfg['period'],
+        'connection': connected_time / (cfg['conn_interval'] * 1e-3),
+        'LED': cfg['button'],
+        'flash write': cfg['flash_writes'],
+        'self-discharge': np.ones_like(slow_time),
+    }
+    capacity = cfg['capacity'] * 3.6
+    charge = {
+        'sleep': SLEEP_CURRENT * day * count['sleep'],
+        'advertising': adv_charge * count['advertising'],
+        'fast advertising': adv_charge * count['fast advertising'],
+        'measurement': measurement_charge(tpl, cfg['osrs_t'], cfg['osrs_h'], cfg['osrs_p']) * count['measurement'],
+        'connection': conn_event_charge * count['connection'],
+        'LED': LED_CURRENT * LED_ON_TIME * count['LED'],
+        'flash write': FLASH_WRITE_CHARGE * count['flash write'],
+        'self-discharge': capacity * battery['self_discharge'] / 365.0 * count['self-discharge'],
+    }
+    total = sum(charge.values())
+
+    # Depth of discharge where the voltage under the peak current reaches the minimum supply voltage
+    peak = np.maximum(tpl['peak_current'], tx)
+    dod = np.linspace(0.0, 1.0, DOD_STEPS)
+    ocv = np.interp(dod, battery['dod'], battery['ocv'])
+    resistance = np.interp(dod, battery['dod'], battery['resistance'])
+    voltage = ocv - peak[..., None] * resistance
+    below = voltage < cfg['min_voltage'][..., None]
+    usable = np.where(below.any(axis=-1), dod[np.argmax(below, axis=-1)], 1.0)
+
+    lifetime_days = capacity * usable / total
+    return dict(count=count, charge=charge, total=total, peak=peak, usable=usable, lifetime_days=lifetime_days)
+
+
+def print_templates(tpl):
+    print(f'charge per event from the captures (0 dBm, a sample every {tpl["sample_interval"] * 1e9:.2f} ns):')
+    print(f'  advertising event     {tpl["adv_charge"] * 1e6:6.2f} uC, TX {tpl["adv_tx_time"] * 1e3:.2f} ms '
+          f'at {tpl["tx_level"] * 1e3:.1f} mA, RX {tpl["rx_level"] * 1e3:.1f} mA')
+    print(f'  connection event      {tpl["conn_event_charge"] * 1e6:6.2f} uC (built from the advertising event)')
+    one = np.array(1)
+    print(f'  measurement x1 T,H,P  {measurement_charge(tpl, one, one, one) * 1e6:6.2f} uC, BME280 ' +
+          ', '.join(f'{n} {tpl["bme280_" + n + "_time"] * 1e3:.2f} ms at {tpl["bme280_" + n + "_current"] * 1e3:.2f} mA'
+                    for n in 'TPH'))
+
+
+def print_breakdown(result):
+    total = float(result['total'])
+    print(f'{"event":18s} {"per day":>10s} {"mC/day":>8s} {"share":>7s}')
+    for event in EVENTS:
+        count = float(result['count'][event])
+        charge = float(result['charge'][event])
+        count_text = '' if event in ('sleep', 'self-discharge') else f'{count:10.1f}'
+        print(f'{event:18s} {count_text:>10s} {charge * 1e3:8.2f} {charge / total:7.1%}')
+    print(f'{"total":18s} {"":10s} {total * 1e3:8.2f}   average {total / 86400 * 1e6:.2f} uA')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--profile', choices=PROFILES, default='FULL', help='defaults of a firmware profile')
+    parser.add_argument('--period', type=float, nargs='+', help='measurement period [s]')
+    parser.add_argument('--adv-interval', type=float, nargs='+', help='slow advertising interval [s]')
+    parser.add_argument('--tx-power', type=int, nargs='+', default=[0], choices=sorted(TX_CURRENT), help='[dBm]')
+    parser.add_argument('--osrs-t', type=int, nargs='+', help='oversampling of temperature, 1-16')
+    parser.add_argument('--osrs-h', type=int, nargs='+', help='oversampling of humidity, 0 to skip')
+    parser.add_argument('--osrs-p', type=int, nargs='+', help='oversampling of pressure, 0 to skip')
+    parser.add_argument('--button', type=float, nargs='+', default=[0], help='button pushes per day')
+    parser.add_argument('--alarms', type=float, nargs='+', default=[0], help='alarms (fast advertising) per day')
+    parser.add_argument('--connections', type=float, nargs='+', default=[0], help='connections per day')
+    parser.add_argument('--connection-time', type=float, nargs='+', default=[2.0], help='time of a connection [s]')
+    parser.add_argument('--conn-interval', type=float, nargs='+', default=[100.0], help='connection interval [ms]')
+    parser.add_argument('--flash-writes', type=float, nargs='+', default=[1], help='record writes per day')
+    parser.add_argument('--battery', choices=BATTERIES, default='CR2032')
+    parser.add_argument('--capacity', type=float, nargs='+', help='battery capacity [mAh]')
+    parser.add_argument('--min-voltage', type=float, nargs='+', default=[MIN_SUPPLY_VOLTAGE], help='[V]')
+    parser.add_argument('--data', default=DATA_DIR, help='directory of the captures')
+    parser.add_argument('--csv', help='write every configuration and its lifetime to this file')
+    args = parser.parse_args()
+
+    battery = BATTERIES[args.battery]
+    profile = PROFILES[args.profile]
+    params = {
+        'period': args.period or [profile['period']],
+        'adv_interval': args.adv_interval or [profile['adv_interval']],
+        'tx_power': args.tx_power,
+        'osrs_t': args.osrs_t or [profile['osrs_t']],
+        'osrs_h': args.osrs_h if args.osrs_h is not None else [profile['osrs_h']],
+        'osrs_p': args.osrs_p if args.osrs_p is not None else [profile['osrs_p']],
+        'button': args.button,
+        'alarms': args.alarms,
+        'connections': args.connections,
+        'connection_time': args.connection_time,
+        'conn_interval': args.conn_interval,
+        'flash_writes': args.flash_writes,
+        'capacity': args.capacity or [battery['capacity_mah']],
+        'min_voltage': args.min_voltage,
+    }
+    names = list(params)
+    grid = np.array(list(itertools.product(*params.values())), dtype=float)
+    cfg = {name: grid[:, i] for i, name in enumerate(names)}
+    cfg['tx_power'] = cfg['tx_power'].astype(int)
+
+    tpl = build_templates(args.data)
+    result = simulate(tpl, cfg, battery)
+    years = result['lifetime_days'] / 365.0
+
+    if args.csv:
+        with open(args.csv, 'w', newline='') as f:
+            writer = csv.writer(f)
+            writer.writerow(names + ['average_ua', 'peak_ma', 'usable', 'lifetime_days'] +
+                            ['mc_per_day_' + e.replace(' ', '_').replace('-', '_') for e in EVENTS])
+            for k in range(len(grid)):
+                writer.writerow([f'{v:g}' for v in grid[k]] +
+                                [f'{result["total"][k] / 86400 * 1e6:.3f}', f'{result["peak"][k] * 1e3:.2f}',
+                                 f'{result["usable"][k]:.3f}', f'{result["lifetime_days"][k]:.1f}'] +
+                                [f'{result["charge"][e][k] * 1e3:.4f}' for e in EVENTS])
+
+    if len(grid) == 1:
+        print_templates(tpl)
+        print(f'profile {args.profile}, battery {args.battery} ' +
+              ', '.join(f'{n} {grid[0][i]:g}' for i, n in enumerate(names)))
+        print_breakdown({'count': {e: v[0] for e, v in result['count'].items()},
+                         'charge': {e: v[0] for e, v in result['charge'].items()},
+                         'total': result['total'][0]})
+        limit = 'voltage under the peak current' if result['usable'][0] < 1.0 else 'charge'
+        print(f'peak current {result["peak"][0] * 1e3:.1f} mA, {result["usable"][0]:.0%} of the capacity usable '
+              f'(limited by the {limit})')
+        print(f'lifetime {result["lifetime_days"][0]:.0f} days ({years[0]:.2f} years)')
+        return
+
+    # A sweep prints the configurations by the lifetime, the parameters with several values only
+    swept = [i for i, name in enumerate(names) if len(params[name]) > 1]
+    order = np.argsort(-result['lifetime_days'])
+    print(f'{len(grid)} configurations, profile {args.profile}, battery {args.battery}')
+    print(' '.join(f'{names[i]:>14s}' for i in swept) + f' {"average uA":>10s} {"years":>6s}')
+    for k in order[:50]:
+        print(' '.join(f'{grid[k][i]:14g}' for i in swept) +
+              f' {result["total"][k] / 86400 * 1e6:10.2f} {years[k]:6.2f}')
+    if len(grid) > 50:
+        print(f'... {len(grid) - 50} more' + (f' in {args.csv}' if args.csv else ', use --csv for all'))
+
+
+if __name__ == '__main__':
+    main()
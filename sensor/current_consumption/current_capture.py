@@ -0,0 +1,250 @@
+"""Events and their charge in current captures of ENBLE (CSV of time [s] and current [A], gzip or plain).
+
+A capture is read in blocks and reduced to the mean current of each bin, so a capture of any length
+is processed in bounded memory. An event is a run of bins above the baseline, and it ends after a
+quiet gap. Its charge is taken above the baseline, interpolated between both sides of the event,
+as the offset of the probe drifts more than the sleeping current.
+Each event is classified by its shape:
+  advertising      3 or more radio bursts, one per advertising channel
+  connection       1 or 2 radio bursts, a packet exchange in a connection event
+  measuring_start  CPU start of BME280 followed by the conversion (0.2 - 0.8 mA for several ms)
+  measuring_end    CPU only for 1 - 5 ms, reading BME280 and updating the advertising data
+  other            anything else, e.g. an advertising event overlapping a measurement
+
+Prints the count and the charge distribution of each class, or writes them and every event as CSV.
+"""
+import argparse
+import collections
+import csv
+import gzip
+import io
+import sys
+import numpy as np
+
+BIN_TIME = 50e-6          # s
+ACTIVE_CURRENT = 0.1e-3   # A above the baseline
+GAP_TIME = 1e-3           # s of quiet bins which ends an event
+BASELINE_TIME = 0.5e-3    # s of quiet bins on each side of an event to find the baseline
+BLOCK_SIZE = 1 << 22      # bytes read at once
+
+RADIO_CURRENT = 5e-3      # A, TX or RX
+CPU_CURRENT = 1e-3        # A, CPU running on HFCLK
+BME280_CURRENT = 0.2e-3   # A, BME280 converting with the CPU sleeping
+
+CLASSES = ['advertising', 'connection', 'measuring_start', 'measuring_end', 'other']
+
+# bins are the current above the baseline, for bin_time each
+Event = collections.namedtuple('Event', ['start', 'bin_time', 'bins', 'baseline'])
+
+
+def read_samples(filename, block_size=BLOCK_SIZE):
+    """Blocks of (time, current)"""
+    opener = gzip.open if filename.endswith('.gz') else open
+    with opener(filename, 'rb') as f:
+        f.readline()  # header
+        rest = b''
+        while True:
+            block = f.read(block_size)
+            if not block:
+                break
+            block = rest + block
+            end = block.rfind(b'\n') + 1
+            rest = block[end:]
+            if end > 0:
+                data = np.loadtxt(io.BytesIO(block[:end]), delimiter=',', ndmin=2)
+                yield data[:, 0], data[:, 1]
+        if rest.strip():
+            data = np.loadtxt(io.BytesIO(rest), delimiter=',', ndmin=2)
+            yield data[:, 0], data[:, 1]
+
+
+def read_bins(filename, bin_time=BIN_TIME):
+    """Blocks of (start time, bin width, mean current of each bin).
+    The bin is a whole number of samples, so its width is near bin_time.
+    The sample interval is taken from the span of the first block, as the time column has few digits."""
+    samples_per_bin = None
+    rest = np.empty(0)
+    start = None
+    for time, current in read_samples(filename):
+        if samples_per_bin is None:
+            interval = (time[-1] - time[0]) / (len(time) - 1)
+            samples_per_bin = max(int(round(bin_time / interval)), 1)
+            bin_time = samples_per_bin * interval
+            start = time[0]
+        current = np.concatenate((rest, current))
+        m = len(current) // samples_per_bin
+        rest = current[m * samples_per_bin:]
+        if m > 0:
+            yield start, bin_time, current[:m * samples_per_bin].reshape(m, samples_per_bin).mean(axis=1)
+            start += m * bin_time
+
+
+def find_events(filename, bin_time=BIN_TIME, threshold=ACTIVE_CURRENT, gap_time=GAP_TIME, info=None):
+    """Events in the capture, with the bins above the baseline.
+    Only the bins from the start of an unfinished event are carried to the next block.
+    info gets the duration of the capture when all the events are read."""
+    carry = np.empty(0)
+    carry_start = None
+    reference = None
+    first = None
+    end = 0.0
+
+    def event(bins, start, s, e, after):
+        before = np.median(bins[max(s - baseline_bins, 0):s]) if s > 0 else reference
+        baseline = np.linspace(before, after, e - s)
+        return Event(start + s * bin_time, bin_time, bins[s:e] - baseline, (before + after) / 2)
+
+    for start, bin_time, bins in read_bins(filename, bin_time):
+        if first is None:
+            first = start
+            gap_bins = max(int(round(gap_time / bin_time)), 1)
+            baseline_bins = max(int(round(BASELINE_TIME / bin_time)), 1)
+            end_bins = max(gap_bins, baseline_bins)  # quiet bins after an event, also to find its baseline
+        end = start + len(bins) * bin_time
+        buf = np.concatenate((carry, bins))
+        buf_start = start - len(carry) * bin_time
+        if reference is None:
+            # Events take a small part of the time, so a low percentile is the baseline.
+            reference = np.percentile(buf, 10)
+
+        active = np.flatnonzero(buf - reference > threshold)
+        # Runs of active bins closer than end_bins belong to the same event.
+        splits = np.flatnonzero(np.diff(active) > end_bins) + 1
+        carry = buf[-baseline_bins:]
+        for group in np.split(active, splits) if len(active) > 0 else []:
+            s, e = group[0], group[-1] + 1
+            if e + end_bins > len(buf):
+                carry = buf[max(s - baseline_bins, 0):]
+                break
+            yield event(buf, buf_start, s, e, np.median(buf[e:e + end_bins]))
+        carry_start = end - len(carry) * bin_time
+
+        quiet = buf[buf - reference <= threshold]
+        if len(quiet) > 0:
+            reference = np.percentile(quiet, 50)
+
+    if carry_start is not None:
+        active = np.flatnonzero(carry - reference > threshold)
+        if len(active) > 0:
+            s, e = active[0], active[-1] + 1
+            after = np.median(carry[e:]) if e < len(carry) else reference
+            yield event(carry, carry_start, s, e, after)
+
+    if info is not None:
+        info['duration'] = end - first if first is not None else 0.0
+
+
+def runs(mask):
+    """(start, end) of each run of True"""
+    edges = np.diff(np.concatenate(([0], mask.astype(int), [0])))
+    return list(zip(np.flatnonzero(edges == 1), np.flatnonzero(edges == -1)))
+
+
+def radio_bursts(bins):
+    return [r for r in runs(bins > RADIO_CURRENT) if r[1] - r[0] > 1]
+
+
+def classify(event):
+    bins = event.bins
+    bin_time = event.bin_time
+    duration = len(bins) * bin_time
+    bursts = len(radio_bursts(bins))
+    if bursts >= 3:
+        return 'advertising'
+    if bursts >= 1:
+        return 'connection'
+    cpu_time = (bins > CPU_CURRENT).sum() * bin_time
+    sensor_time = ((bins > BME280_CURRENT) & (bins < CPU_CURRENT)).sum() * bin_time
+    if sensor_time > 3e-3 and cpu_time < 1e-3:
+        return 'measuring_start'
+    if 1e-3 <= duration <= 5e-3 and cpu_time > 0.8 * duration:
+        return 'measuring_end'
+    return 'other'
+
+
+def event_charge(event):
+    return event.bins.sum() * event.bin_time
+
+
+def event_row(event, event_class):
+    return dict(start_s=event.start, event=event_class,
+                duration_ms=len(event.bins) * event.bin_time * 1e3,
+                charge_uc=event_charge(event) * 1e6,
+                peak_ma=event.bins.max() * 1e3,
+                radio_bursts=len(radio_bursts(event.bins)),
+                baseline_ua=event.baseline * 1e6)
+
+
+def summarize(rows, capture_time):
+    """Count, rate and charge distribution of each class"""
+    summary = []
+    for event_class in CLASSES:
+        charge = np.array([r['charge_uc'] for r in rows if r['event'] == event_class])
+        duration = np.array([r['duration_ms'] for r in rows if r['event'] == event_class])
+        if len(charge) == 0:
+            continue
+        p5, p50, p95 = np.percentile(charge, [5, 50, 95])
+        summary.append(dict(event=event_class, count=len(charge),
+                            per_hour=len(charge) / capture_time * 3600 if capture_time > 0 else 0.0,
+                            charge_mean_uc=charge.mean(), charge_std_uc=charge.std(),
+                            charge_p5_uc=p5, charge_p50_uc=p50, charge_p95_uc=p95,
+                            charge_total_uc=charge.sum(), duration_mean_ms=duration.mean()))
+    return summary
+
+
+def format_row(row):
+    # Times keep the resolution of a bin in a long capture.
+    return {k: (f'{v:.6f}' if k == 'start_s' else f'{v:.6g}') if isinstance(v, float) else v for k, v in row.items()}
+
+
+def write_table(rows, f, fields):
+    writer = csv.DictWriter(f, fieldnames=fields)
+    writer.writeheader()
+    for row in rows:
+        writer.writerow(format_row(row))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('captures', nargs='+', help='CSV files, gzip or plain')
+    parser.add_argument('--bin', type=float, default=BIN_TIME * 1e6, help='bin width [us]')
+    parser.add_argument('--threshold', type=float, default=ACTIVE_CURRENT * 1e3, help='current above the baseline [mA]')
+    parser.add_argument('--gap', type=float, default=GAP_TIME * 1e3, help='quiet time which ends an event [ms]')
+    parser.add_argument('--events', help='write every event to this CSV file')
+    parser.add_argument('--summary', help='write the summary to this CSV file instead of stdout')
+    args = parser.parse_args()
+
+    bin_time = args.bin * 1e-6
+    rows = []
+    capture_time = 0.0
+    event_fields = ['capture', 'start_s', 'event', 'duration_ms', 'charge_uc', 'peak_ma', 'radio_bursts', 'baseline_ua']
+    events_file = open(args.events, 'w', newline='') if args.events else None
+    events_writer = csv.DictWriter(events_file, fieldnames=event_fields) if events_file else None
+    if events_writer:
+        events_writer.writeheader()
+
+    for filename in args.captures:
+        info = {}
+        for event in find_events(filename, bin_time, args.threshold * 1e-3, args.gap * 1e-3, info):
+            row = event_row(event, classify(event))
+            # Only the columns of the summary are kept for a long capture.
+            rows.append(dict(event=row['event'], charge_uc=row['charge_uc'], duration_ms=row['duration_ms']))
+            if events_writer:
+                events_writer.writerow({'capture': filename, **format_row(row)})
+        capture_time += info['duration']
+
+    if events_file:
+        events_file.close()
+
+    summary = summarize(rows, capture_time)
+    fields = ['event', 'count', 'per_hour', 'charge_mean_uc', 'charge_std_uc', 'charge_p5_uc', 'charge_p50_uc',
+              'charge_p95_uc', 'charge_total_uc', 'duration_mean_ms']
+    if args.summary:
+        with open(args.summary, 'w', newline='') as f:
+            write_table(summary, f, fields)
+    else:
+        write_table(summary, sys.stdout, fields)
+
+
+if __name__ == '__main__':
+    main()
@@ -1,32 +1,35 @@
-import gzip
-import csv
-import scipy.signal
-import numpy as np 
+import os
+import numpy as np
 import matplotlib.pyplot as plt
 
+import current_capture
+
+MARGIN = 1e-3       # s before the first event and after the last one
+PLOT_POINTS = 10000
 
-def plot_current_consumption(filename, plot_title, time_span, ylim):
-    current = []
-    time = []
-    with gzip.open(filename, 'rt') as f:
-        reader = csv.reader(f)
-        next(reader)
-        for row in reader:
-            time.append(float(row[0]))
-            current.append(float(row[1]))
-    current = np.asarray(current)
-    time = np.asarray(time)
 
-    idx_span = (np.searchsorted(time, time_span[0]), np.searchsorted(time, time_span[1]))
+def plot_current_consumption(filename, plot_title, ylim, time_span=None):
+    if not os.path.exists(filename):
+        print(f'{filename} is not found, {plot_title} is skipped')
+        return
 
-    time = time[idx_span[0]:idx_span[1]]
-    current = current[idx_span[0]:idx_span[1]]
+    # The consumed charge is the sum of the events above the baseline, same as current_capture.py.
+    events = list(current_capture.find_events(filename))
+    if time_span is None:
+        last_end = events[-1].start + len(events[-1].bins) * events[-1].bin_time
+        time_span = (events[0].start - MARGIN, last_end + MARGIN)
+    consumed_charge = sum(current_capture.event_charge(e) for e in events if time_span[0] <= e.start < time_span[1])
 
-    time = scipy.signal.decimate(time, 13*1)
-    current = scipy.signal.decimate(current, 13*1)
+    time = []
+    current = []
+    for start, bin_time, bins in current_capture.read_bins(filename, (time_span[1] - time_span[0]) / PLOT_POINTS):
+        t = start + np.arange(len(bins)) * bin_time
+        in_span = (t >= time_span[0]) & (t < time_span[1])
+        time.append(t[in_span])
+        current.append(bins[in_span])
+    time = np.concatenate(time)
+    current = np.concatenate(current)
 
-    consumed_charge = np.sum(current) * (time[1] - time[0])
-    
     x = time*1e3
     y = current * 1e3
     fig = plt.figure(figsize=(8, 5), dpi=150)
@@ -39,11 +42,11 @@ def plot_current_consumption(filename, plot_title, time_span, ylim):
     plt.ylabel('Current [mA]')
     plt.grid()
     plt.savefig('fig/' + plot_title + '.png')
-    
+    plt.close(fig)
 
 
-plot_current_consumption('data/advertising.csv.gz', 'advertising', (-1e-3, 7e-3), (-0.5e-3, 16e-3))
-plot_current_consumption('data/sensor_measuring1.csv.gz', 'measuring_start', (-1e-3, 9e-3), (-0.2e-3, 5e-3))
-plot_current_consumption('data/sensor_measuring2.csv.gz', 'measuring_end', (-1e-3, 4e-3), (-0.2e-3, 7e-3))
-plot_current_consumption('data/advertising_and_measuring.csv.gz', 'advertising_and_measuring', (-8.2, 8.2), (-0.5e-3, 16e-3))
-plot_current_consumption('data/connecting.csv.gz', 'connecting', (-0.25, 0.25), (-0.5e-3, 16e-3))
+plot_current_consumption('data/advertising.csv.gz', 'advertising', (-0.5e-3, 16e-3))
+plot_current_consumption('data/sensor_measuring1.csv.gz', 'measuring_start', (-0.2e-3, 5e-3))
+plot_current_consumption('data/sensor_measuring2.csv.gz', 'measuring_end', (-0.2e-3, 7e-3))
+plot_current_consumption('data/advertising_and_measuring.csv.gz', 'advertising_and_measuring', (-0.5e-3, 16e-3), (-8.2, 8.2))
+plot_current_consumption('data/connecting.csv.gz', 'connecting', (-0.5e-3, 16e-3), (-0.25, 0.25))
@@ -0,0 +1,98 @@
+#include "adv_slot.h"
+
+#include <string.h>
+
+#include "app_timer.h"
+#include "app_util.h"
+
+#include "scheduler.h"
+#include "wallclock.h"
+
+#define NRF_LOG_MODULE_NAME "ADV_SLOT"
+#define NRF_LOG_LEVEL 0
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+// Air time of an advertising event on 3 channels with a scan request and a scan response
+#define ADV_EVENT_TIME 5 // ms
+
+STATIC_ASSERT(ADV_SLOT_WIDTH_MS > ADV_EVENT_TIME);
+
+APP_TIMER_DEF(m_adv_slot_timer_id);
+
+static adv_slot_handler_t m_adv_slot_handler;
+static uint32_t m_adv_interval_ms;
+static uint32_t m_slot_offset_ms; // start of the slot from the start of the interval
+
+static adv_slot_stats_t m_stats;
+
+// Restart the timer for the next start of the slot.
+// The delay is always taken from the wall clock, which is corrected by the estimated drift.
+static uint32_t adv_slot_timer_restart()
+{
+    uint32_t err_code;
+
+    err_code = app_timer_stop(m_adv_slot_timer_id);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    uint32_t delay_ms = wallclock_delay_to_phase_get(m_adv_interval_ms, m_slot_offset_ms);
+    return app_timer_start(m_adv_slot_timer_id, APP_TIMER_TICKS(delay_ms, 0), NULL);
+}
+
+static void adv_slot_timer_evt_handler()
+{
+    uint32_t err_code;
+
+    m_stats.event_cnt++;
+
+    err_code = adv_slot_timer_restart();
+    APP_ERROR_CHECK(err_code);
+
+    if (m_adv_slot_handler)
+    {
+        m_adv_slot_handler();
+    }
+}
+
+static void adv_slot_timer_handler()
+{
+    uint32_t err_code = scheduler_post(SCHEDULER_EVT_ADV_SLOT_TIMER, adv_slot_timer_evt_handler);
+    APP_ERROR_CHECK(err_code);
+}
+
+uint32_t adv_slot_init(uint32_t adv_interval_ms, adv_slot_handler_t handler)
+{
+    m_adv_slot_handler = handler;
+    m_adv_interval_ms = adv_interval_ms;
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_stats.slot_cnt = (uint16_t)(adv_interval_ms / ADV_SLOT_WIDTH_MS);
+
+    return app_timer_create(&m_adv_slot_timer_id, APP_TIMER_MODE_SINGLE_SHOT, adv_slot_timer_handler);
+}
+
+// Take the slot of the DeviceID and start the schedule. Call again after a time sync or a new DeviceID.
+// Until the wall clock is synced, nothing is scheduled and advertising keeps the random delay of the stack.
+uint32_t adv_slot_start(uint16_t device_id)
+{
+    if (!wallclock_is_synced() || m_stats.slot_cnt == 0)
+    {
+        return NRF_SUCCESS;
+    }
+
+    // The event is placed in the middle of the slot so that the guard time is the same on both sides.
+    m_stats.slot = device_id % m_stats.slot_cnt;
+    m_slot_offset_ms = m_stats.slot * ADV_SLOT_WIDTH_MS + (ADV_SLOT_WIDTH_MS - ADV_EVENT_TIME) / 2;
+    m_stats.resync_cnt++;
+
+    NRF_LOG_INFO("slot %u of %u\n", m_stats.slot, m_stats.slot_cnt);
+
+    return adv_slot_timer_restart();
+}
+
+const adv_slot_stats_t *adv_slot_stats_get()
+{
+    return &m_stats;
+}
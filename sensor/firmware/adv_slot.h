@@ -0,0 +1,34 @@
+#ifndef _ADV_SLOT_H
+#define _ADV_SLOT_H
+
+#include <stdint.h>
+
+// Time slotted advertising for dense fleets.
+// The slow advertising interval is divided into slots and each device takes the slot of its DeviceID,
+// on the wall clock given by a peer. The handler is called at the start of the slot in every interval,
+// and the next slot is computed again from the wall clock, so the drift of LFCLK does not accumulate.
+// Enabled by the Makefile: make SLOTTED_ADV=1
+#ifndef SLOTTED_ADV_ENABLED
+#define SLOTTED_ADV_ENABLED 0
+#endif
+
+// Width of a slot: an advertising event with a scan response (about 5 ms) and the guard time on both sides
+#ifndef ADV_SLOT_WIDTH_MS
+#define ADV_SLOT_WIDTH_MS 40
+#endif
+
+typedef void (*adv_slot_handler_t)();
+
+typedef struct
+{
+    uint16_t slot;          // slot of this device
+    uint16_t slot_cnt;      // slots in an interval
+    uint32_t event_cnt;     // handler calls at the start of the slot
+    uint32_t resync_cnt;    // slot schedules restarted by a new time or DeviceID
+} adv_slot_stats_t;
+
+uint32_t adv_slot_init(uint32_t adv_interval_ms, adv_slot_handler_t handler);
+uint32_t adv_slot_start(uint16_t device_id);
+const adv_slot_stats_t *adv_slot_stats_get();
+
+#endif
@@ -0,0 +1,211 @@
+#include "adv_sync.h"
+
+#include <string.h>
+
+#include "nrf.h"
+#include "nrf_soc.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+
+#include "period_timer.h"
+#include "scheduler.h"
+
+#define NRF_LOG_MODULE_NAME "ADV_SYNC"
+#define NRF_LOG_LEVEL 0
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+// The notification comes just before the radio is active.
+// The SoftDevice starts HFCLK for the radio event around this time, so this short distance
+// makes the wakeup for the notification overlap with the wakeup for the radio.
+#define RADIO_NOTIFICATION_DISTANCE NRF_RADIO_NOTIFICATION_DISTANCE_800US
+#define RADIO_NOTIFICATION_DISTANCE_US 800
+#define RADIO_NOTIFICATION_IRQ_PRIORITY APP_IRQ_PRIORITY_LOW
+
+// The stack adds 0 - 10 ms random delay to every advertising event.
+// An event is predicted at the mean delay, and the sum of the delays since the notified event
+// is within 3 standard deviations (10 ms / sqrt(12), 95 ticks) times the square root of the events.
+#define ADV_DELAY_MAX 10 // ms
+#define ADV_DELAY_SD_TICKS 95
+#define ADV_DELAY_SD_CNT 3
+
+static adv_sync_handler_t m_adv_sync_handler;
+static uint32_t m_adv_interval_ticks; // advertising interval with the mean delay
+static uint32_t m_lead_ticks;
+
+static bool m_is_data_age_requested;
+static bool m_is_adv_event_known;
+static volatile uint32_t m_radio_notification_ticks;
+static uint32_t m_data_update_ticks;
+static uint64_t m_adv_event_ticks; // notification of the last known advertising event in period_timer_ticks_get()
+
+static adv_sync_stats_t m_stats;
+
+static void radio_notification_enable()
+{
+    sd_nvic_ClearPendingIRQ(SWI1_IRQn);
+    sd_nvic_EnableIRQ(SWI1_IRQn);
+}
+
+static void radio_notification_disable()
+{
+    sd_nvic_DisableIRQ(SWI1_IRQn);
+}
+
+static uint32_t ticks_to_ms(uint32_t ticks)
+{
+    return (uint32_t)(((uint64_t)ticks * 1000) / APP_TIMER_CLOCK_FREQ);
+}
+
+// Smallest integer not less than the square root
+static uint32_t sqrt_ceil(uint32_t value)
+{
+    uint32_t root = 0;
+
+    while (root * root < value)
+    {
+        root++;
+    }
+
+    return root;
+}
+
+static void radio_notification_evt_handler()
+{
+    uint32_t now_ticks;
+    uint32_t elapsed_ticks;
+
+    if (!m_is_data_age_requested)
+    {
+        return;
+    }
+
+    m_is_data_age_requested = false;
+
+    app_timer_cnt_diff_compute(m_radio_notification_ticks, m_data_update_ticks, &elapsed_ticks);
+    uint32_t data_age_ms = ticks_to_ms(elapsed_ticks) + RADIO_NOTIFICATION_DISTANCE_US / 1000;
+
+    m_stats.data_age_cnt++;
+    m_stats.data_age_last_ms = data_age_ms;
+    m_stats.data_age_total_ms += data_age_ms;
+    if (data_age_ms > m_stats.data_age_max_ms)
+    {
+        m_stats.data_age_max_ms = data_age_ms;
+    }
+    NRF_LOG_DEBUG("data age %u ms\n", data_age_ms);
+
+    // The radio event is an advertising event when the application aligns the measurements.
+    app_timer_cnt_get(&now_ticks);
+    app_timer_cnt_diff_compute(now_ticks, m_radio_notification_ticks, &elapsed_ticks);
+    m_adv_event_ticks = period_timer_ticks_get() - elapsed_ticks;
+    m_is_adv_event_known = true;
+
+    if (m_adv_sync_handler)
+    {
+        m_adv_sync_handler();
+    }
+}
+
+// Radio notification interrupt
+void SWI1_IRQHandler(void)
+{
+    uint32_t err_code;
+
+    app_timer_cnt_get((uint32_t *)&m_radio_notification_ticks);
+
+    // One notification is enough for a request.
+    radio_notification_disable();
+
+    err_code = scheduler_post(SCHEDULER_EVT_RADIO_NOTIFICATION, radio_notification_evt_handler);
+    APP_ERROR_CHECK(err_code);
+}
+
+// Radio notification can be configured only while the radio is idle,
+// so call this before advertising starts. The interrupt is enabled only while a request is pending.
+// The handler is called after each notified radio event.
+uint32_t adv_sync_init(uint32_t adv_interval_ms, uint32_t lead_time_ms, adv_sync_handler_t handler)
+{
+    uint32_t err_code;
+
+    m_adv_sync_handler = handler;
+    m_adv_interval_ticks = (uint32_t)(((uint64_t)(2 * adv_interval_ms + ADV_DELAY_MAX) * APP_TIMER_CLOCK_FREQ) / 2000);
+    m_lead_ticks = APP_TIMER_TICKS(lead_time_ms, 0);
+    m_is_data_age_requested = false;
+    m_is_adv_event_known = false;
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    radio_notification_disable();
+
+    err_code = sd_nvic_SetPriority(SWI1_IRQn, RADIO_NOTIFICATION_IRQ_PRIORITY);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    return sd_radio_notification_cfg_set(NRF_RADIO_NOTIFICATION_TYPE_INT_ON_ACTIVE, RADIO_NOTIFICATION_DISTANCE);
+}
+
+// Call this when advertising is started again, the known advertising event is not in its schedule.
+void adv_sync_adv_restart()
+{
+    m_is_adv_event_known = false;
+}
+
+// Move the next expiry of the period timer to the lead time before an advertising event,
+// predicted from the last notified one. Call this only in advertising at a fixed interval.
+uint32_t adv_sync_align()
+{
+    uint32_t err_code;
+
+    if (!m_is_adv_event_known)
+    {
+        m_stats.fallback_cnt++;
+        return NRF_SUCCESS;
+    }
+
+    uint64_t deadline_ticks = period_timer_deadline_get();
+    uint64_t start_ticks = deadline_ticks + m_lead_ticks;
+    uint64_t adv_event_ticks;
+    uint32_t margin_ticks;
+
+    // The first predicted event which leaves the lead time and the margin after the deadline
+    uint32_t adv_event_cnt = (start_ticks > m_adv_event_ticks) ? (uint32_t)((start_ticks - m_adv_event_ticks) / m_adv_interval_ticks) : 0;
+    do
+    {
+        adv_event_cnt++;
+        adv_event_ticks = m_adv_event_ticks + (uint64_t)adv_event_cnt * m_adv_interval_ticks;
+        margin_ticks = ADV_DELAY_SD_CNT * ADV_DELAY_SD_TICKS * sqrt_ceil(adv_event_cnt);
+    } while (adv_event_ticks < start_ticks + margin_ticks);
+
+    err_code = period_timer_next_delay_set((uint32_t)(adv_event_ticks - margin_ticks - start_ticks));
+    if (err_code == NRF_ERROR_INVALID_PARAM)
+    {
+        // The period is shorter than the advertising interval.
+        m_stats.fallback_cnt++;
+        return NRF_SUCCESS;
+    }
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    m_stats.sync_cnt++;
+
+    return NRF_SUCCESS;
+}
+
+// Measure the time until the updated advertising data is transmitted.
+uint32_t adv_sync_on_adv_data_update()
+{
+    app_timer_cnt_get(&m_data_update_ticks);
+    m_is_data_age_requested = true;
+
+    radio_notification_enable();
+
+    return NRF_SUCCESS;
+}
+
+const adv_sync_stats_t *adv_sync_stats_get()
+{
+    return &m_stats;
+}
@@ -0,0 +1,30 @@
+#ifndef _ADV_SYNC_H
+#define _ADV_SYNC_H
+
+#include <stdint.h>
+
+// Synchronize measurements with advertising events using radio notification.
+// The first radio event after an update of the advertising data is notified, which gives the age of
+// the data when it is transmitted and the time of an advertising event. From that time the next expiry
+// of the period timer is moved to the lead time before a predicted advertising event, so the measurement
+// starts in the wakeup of the period timer and no wakeup is added to wait for an advertising event.
+
+typedef void (*adv_sync_handler_t)();
+
+typedef struct
+{
+    uint32_t sync_cnt;          // measurements moved to the lead time before a predicted advertising event
+    uint32_t fallback_cnt;      // measurements not moved, without a notified advertising event or in a short period
+    uint32_t data_age_cnt;      // number of samples of the following data age
+    uint32_t data_age_last_ms;  // time from an advertising data update to its first transmission
+    uint32_t data_age_max_ms;
+    uint32_t data_age_total_ms;
+} adv_sync_stats_t;
+
+uint32_t adv_sync_init(uint32_t adv_interval_ms, uint32_t lead_time_ms, adv_sync_handler_t handler);
+void adv_sync_adv_restart();
+uint32_t adv_sync_align();
+uint32_t adv_sync_on_adv_data_update();
+const adv_sync_stats_t *adv_sync_stats_get();
+
+#endif
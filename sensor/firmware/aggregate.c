@@ -0,0 +1,145 @@
+#include "aggregate.h"
+
+#include <string.h>
+
+#include "app_util.h"
+
+#define NRF_LOG_MODULE_NAME "AGGREGATE"
+#define NRF_LOG_LEVEL 0
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+// Running sums of a quantity. The variance is taken from the sums at the end of the period,
+// so a sample costs a few additions and no division.
+typedef struct
+{
+    int32_t min;
+    int32_t max;
+    int32_t sum;
+    uint64_t sum_sq;
+} accumulator_t;
+
+static accumulator_t m_temperature;
+static accumulator_t m_humidity;
+static accumulator_t m_pressure;
+static uint16_t m_cnt;
+static uint16_t m_battery;
+
+static void accumulator_add(accumulator_t *p_acc, int32_t value)
+{
+    if (m_cnt == 0 || value < p_acc->min)
+    {
+        p_acc->min = value;
+    }
+    if (m_cnt == 0 || value > p_acc->max)
+    {
+        p_acc->max = value;
+    }
+    p_acc->sum += value;
+    p_acc->sum_sq += (uint64_t)((int64_t)value * value);
+}
+
+static int32_t accumulator_mean_get(const accumulator_t *p_acc)
+{
+    if (m_cnt == 0)
+    {
+        return 0;
+    }
+
+    // rounded to the nearest
+    int32_t half = (p_acc->sum < 0) ? -(m_cnt / 2) : (m_cnt / 2);
+    return (p_acc->sum + half) / m_cnt;
+}
+
+static uint32_t isqrt(uint32_t value)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > value)
+    {
+        bit >>= 2;
+    }
+
+    while (bit != 0)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return root;
+}
+
+// Population standard deviation: sqrt(E[x^2] - E[x]^2)
+static uint16_t accumulator_stddev_get(const accumulator_t *p_acc)
+{
+    if (m_cnt < 2)
+    {
+        return 0;
+    }
+
+    int64_t sum = p_acc->sum;
+    uint64_t variance = (p_acc->sum_sq - (uint64_t)((sum * sum) / m_cnt)) / m_cnt;
+
+    return (uint16_t)MIN(isqrt((uint32_t)MIN(variance, UINT32_MAX)), UINT16_MAX);
+}
+
+void aggregate_reset()
+{
+    memset(&m_temperature, 0, sizeof(m_temperature));
+    memset(&m_humidity, 0, sizeof(m_humidity));
+    memset(&m_pressure, 0, sizeof(m_pressure));
+    m_cnt = 0;
+    m_battery = 0;
+}
+
+void aggregate_add(const SensorMeasurementData *p_data)
+{
+    if (m_cnt == UINT16_MAX)
+    {
+        return;
+    }
+
+    accumulator_add(&m_temperature, p_data->temperature);
+    accumulator_add(&m_humidity, p_data->humidity);
+    accumulator_add(&m_pressure, p_data->pressure);
+    m_battery = p_data->battery;
+    m_cnt++;
+}
+
+uint16_t aggregate_cnt_get()
+{
+    return m_cnt;
+}
+
+void aggregate_mean_get(SensorMeasurementData *p_data)
+{
+    p_data->temperature = (int16_t)accumulator_mean_get(&m_temperature);
+    p_data->humidity = (uint16_t)accumulator_mean_get(&m_humidity);
+    p_data->pressure = (uint16_t)accumulator_mean_get(&m_pressure);
+    p_data->battery = m_battery;
+
+    NRF_LOG_DEBUG("%u samples, temperature %d - %d\n", m_cnt, m_temperature.min, m_temperature.max);
+}
+
+void aggregate_serialize(uint8_t *p_buffer)
+{
+    uint16_encode(m_cnt, &p_buffer[0]);
+    uint16_encode((uint16_t)m_temperature.min, &p_buffer[2]);
+    uint16_encode((uint16_t)m_temperature.max, &p_buffer[4]);
+    uint16_encode(accumulator_stddev_get(&m_temperature), &p_buffer[6]);
+    uint16_encode((uint16_t)m_humidity.min, &p_buffer[8]);
+    uint16_encode((uint16_t)m_humidity.max, &p_buffer[10]);
+    uint16_encode(accumulator_stddev_get(&m_humidity), &p_buffer[12]);
+    uint16_encode((uint16_t)m_pressure.min, &p_buffer[14]);
+    uint16_encode((uint16_t)m_pressure.max, &p_buffer[16]);
+    uint16_encode(accumulator_stddev_get(&m_pressure), &p_buffer[18]);
+}
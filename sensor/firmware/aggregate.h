@@ -0,0 +1,33 @@
+#ifndef _AGGREGATE_H
+#define _AGGREGATE_H
+
+#include <stdint.h>
+
+#include "sensor.h"
+
+// Min, max, mean and variance of the samples taken in a reporting period.
+// The sensor is sampled several times per measurement period, and only the aggregate
+// is advertised and written to the characteristics at the end of the period,
+// so a short excursion is seen without reporting more often.
+// Enabled by the Makefile: make AGGREGATE=1
+#ifndef AGGREGATE_ENABLED
+#define AGGREGATE_ENABLED 0
+#endif
+
+// Interval of the samples in s. A period of this or shorter reports every sample.
+#ifndef AGGREGATE_SAMPLE_INTERVAL
+#define AGGREGATE_SAMPLE_INTERVAL 10
+#endif
+
+// Serialized length of the sample count and min, max and standard deviation of temperature, humidity and pressure
+#define AGGREGATE_DATA_LEN 20
+
+void aggregate_reset();
+void aggregate_add(const SensorMeasurementData *p_data);
+uint16_t aggregate_cnt_get();
+// Mean of the samples. battery is the last sample's, which is averaged by the sensor already.
+void aggregate_mean_get(SensorMeasurementData *p_data);
+// Sample count, then min, max and standard deviation of each in little endian, in the units of SensorMeasurementData
+void aggregate_serialize(uint8_t *p_buffer);
+
+#endif
@@ -0,0 +1,154 @@
+#include "alarm.h"
+
+#include <stddef.h>
+
+#define NRF_LOG_MODULE_NAME "ALARM"
+#define NRF_LOG_LEVEL 0
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+// Each alarm of a channel
+#define ALARM_TEMPERATURE_LOW 0x01
+#define ALARM_TEMPERATURE_HIGH 0x02
+#define ALARM_HUMIDITY_HIGH 0x04
+
+static alarm_threshold_t m_thresholds[SENSOR_CHANNEL_CNT];
+static uint8_t m_active_alarms[SENSOR_CHANNEL_CNT];
+
+// Raised over the threshold, cleared under threshold - hysteresis.
+static bool is_over(bool is_active, int32_t value, int32_t threshold, int32_t hysteresis)
+{
+    if (is_active)
+    {
+        return value > threshold - hysteresis;
+    }
+    return value > threshold;
+}
+
+static uint8_t channel_evaluate(const alarm_threshold_t *p_threshold, uint8_t active, const SensorMeasurementData *p_data)
+{
+    uint8_t alarms = 0;
+
+    if (p_threshold->temperature_low != ALARM_TEMPERATURE_LOW_DISABLED &&
+        is_over(active & ALARM_TEMPERATURE_LOW, -(int32_t)p_data->temperature, -(int32_t)p_threshold->temperature_low, ALARM_TEMPERATURE_HYSTERESIS))
+    {
+        alarms |= ALARM_TEMPERATURE_LOW;
+    }
+
+    if (p_threshold->temperature_high != ALARM_TEMPERATURE_HIGH_DISABLED &&
+        is_over(active & ALARM_TEMPERATURE_HIGH, p_data->temperature, p_threshold->temperature_high, ALARM_TEMPERATURE_HYSTERESIS))
+    {
+        alarms |= ALARM_TEMPERATURE_HIGH;
+    }
+
+    if (p_threshold->humidity_high != ALARM_HUMIDITY_HIGH_DISABLED &&
+        is_over(active & ALARM_HUMIDITY_HIGH, p_data->humidity, p_threshold->humidity_high, ALARM_HUMIDITY_HYSTERESIS))
+    {
+        alarms |= ALARM_HUMIDITY_HIGH;
+    }
+
+    return alarms;
+}
+
+void alarm_init()
+{
+    for (uint8_t i = 0; i < SENSOR_CHANNEL_CNT; i++)
+    {
+        m_thresholds[i].temperature_low = ALARM_TEMPERATURE_LOW_DISABLED;
+        m_thresholds[i].temperature_high = ALARM_TEMPERATURE_HIGH_DISABLED;
+        m_thresholds[i].humidity_high = ALARM_HUMIDITY_HIGH_DISABLED;
+        m_active_alarms[i] = 0;
+    }
+}
+
+void alarm_threshold_set(uint8_t channel, const alarm_threshold_t *p_threshold)
+{
+    if (channel >= SENSOR_CHANNEL_CNT)
+    {
+        return;
+    }
+
+    m_thresholds[channel] = *p_threshold;
+
+    // Evaluated again from the next measurement.
+    m_active_alarms[channel] = 0;
+}
+
+const alarm_threshold_t *alarm_threshold_get(uint8_t channel)
+{
+    if (channel >= SENSOR_CHANNEL_CNT)
+    {
+        return NULL;
+    }
+
+    return &m_thresholds[channel];
+}
+
+alarm_evt_t alarm_update(const SensorMeasurementData *measurement_data)
+{
+    bool was_active = alarm_is_active();
+    bool is_raised = false;
+
+    for (uint8_t i = 0; i < SENSOR_CHANNEL_CNT; i++)
+    {
+        uint8_t alarms = channel_evaluate(&m_thresholds[i], m_active_alarms[i], &measurement_data[i]);
+
+        if (alarms & ~m_active_alarms[i])
+        {
+            NRF_LOG_INFO("channel %u alarm 0x%02x is raised\n", i, alarms & ~m_active_alarms[i]);
+            is_raised = true;
+        }
+        m_active_alarms[i] = alarms;
+    }
+
+    if (is_raised)
+    {
+        return ALARM_EVT_RAISED;
+    }
+    if (was_active && !alarm_is_active())
+    {
+        NRF_LOG_INFO("all alarms are cleared\n");
+        return ALARM_EVT_CLEARED;
+    }
+    return ALARM_EVT_NONE;
+}
+
+bool alarm_is_active()
+{
+    for (uint8_t i = 0; i < SENSOR_CHANNEL_CNT; i++)
+    {
+        if (m_active_alarms[i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void alarm_threshold_serialize(uint8_t *p_buffer)
+{
+    for (uint8_t i = 0; i < SENSOR_CHANNEL_CNT; i++)
+    {
+        uint8_t *p = &p_buffer[i * ALARM_THRESHOLD_DATA_LEN];
+        p[0] = (uint8_t)m_thresholds[i].temperature_low;
+        p[1] = (uint8_t)(m_thresholds[i].temperature_low >> 8);
+        p[2] = (uint8_t)m_thresholds[i].temperature_high;
+        p[3] = (uint8_t)(m_thresholds[i].temperature_high >> 8);
+        p[4] = (uint8_t)m_thresholds[i].humidity_high;
+        p[5] = (uint8_t)(m_thresholds[i].humidity_high >> 8);
+    }
+}
+
+void alarm_threshold_deserialize(const uint8_t *p_buffer)
+{
+    alarm_threshold_t threshold;
+
+    for (uint8_t i = 0; i < SENSOR_CHANNEL_CNT; i++)
+    {
+        const uint8_t *p = &p_buffer[i * ALARM_THRESHOLD_DATA_LEN];
+        threshold.temperature_low = (int16_t)(((uint16_t)p[1] << 8) | p[0]);
+        threshold.temperature_high = (int16_t)(((uint16_t)p[3] << 8) | p[2]);
+        threshold.humidity_high = (uint16_t)(((uint16_t)p[5] << 8) | p[4]);
+        alarm_threshold_set(i, &threshold);
+    }
+}
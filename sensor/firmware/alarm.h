@@ -0,0 +1,47 @@
+#ifndef _ALARM_H
+#define _ALARM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sensor.h"
+
+// Threshold alarms of each sensor channel with hysteresis.
+// An alarm is raised when a value crosses its threshold and cleared
+// when the value comes back by more than the hysteresis.
+
+#define ALARM_TEMPERATURE_LOW_DISABLED INT16_MIN
+#define ALARM_TEMPERATURE_HIGH_DISABLED INT16_MAX
+#define ALARM_HUMIDITY_HIGH_DISABLED UINT16_MAX
+
+#define ALARM_TEMPERATURE_HYSTERESIS 50 // 0.5 DegC
+#define ALARM_HUMIDITY_HYSTERESIS 20    // 2.0 %
+
+// Serialized length of a channel's thresholds
+#define ALARM_THRESHOLD_DATA_LEN 6
+
+typedef struct
+{
+    int16_t temperature_low;  // DegC x100, ALARM_TEMPERATURE_LOW_DISABLED disables it
+    int16_t temperature_high; // DegC x100, ALARM_TEMPERATURE_HIGH_DISABLED disables it
+    uint16_t humidity_high;   // % x10, ALARM_HUMIDITY_HIGH_DISABLED disables it
+} alarm_threshold_t;
+
+typedef enum
+{
+    ALARM_EVT_NONE,
+    ALARM_EVT_RAISED,  // an alarm has been raised
+    ALARM_EVT_CLEARED, // all alarms have been cleared
+} alarm_evt_t;
+
+void alarm_init();
+void alarm_threshold_set(uint8_t channel, const alarm_threshold_t *p_threshold);
+const alarm_threshold_t *alarm_threshold_get(uint8_t channel);
+alarm_evt_t alarm_update(const SensorMeasurementData *measurement_data);
+bool alarm_is_active();
+
+// Thresholds of all channels in little endian, SENSOR_CHANNEL_CNT * ALARM_THRESHOLD_DATA_LEN bytes
+void alarm_threshold_serialize(uint8_t *p_buffer);
+void alarm_threshold_deserialize(const uint8_t *p_buffer);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef _APP_CONFIG_H
+#define _APP_CONFIG_H
+
+// Firmware profile, one per deployment type. Selected by the Makefile: make PROFILE=LOGGER
+// This header is also included by sdk_config.h (USE_APP_CONFIG) and overrides its settings.
+// Each profile compiles out the parts the deployment does not use and fixes its constants.
+#define APP_CONFIG_PROFILE_FULL 0   // all channels, the button, configuration over GATT and log
+#define APP_CONFIG_PROFILE_LOGGER 1 // sealed coin cell logger, temperature and humidity only
+#define APP_CONFIG_PROFILE_MAINS 2  // mains or USB powered, no battery measurement
+
+#ifndef APP_CONFIG_PROFILE
+#define APP_CONFIG_PROFILE APP_CONFIG_PROFILE_FULL
+#endif
+
+// BME280 oversampling (register value) : 0 skipped, 1 x1, 2 x2, 3 x4, 4 x8, 5 x16
+#if APP_CONFIG_PROFILE == APP_CONFIG_PROFILE_FULL
+#define APP_CONFIG_BATTERY_ENABLED 1
+#define APP_CONFIG_HUMIDITY_ENABLED 1
+#define APP_CONFIG_PRESSURE_ENABLED 1
+#define APP_CONFIG_BUTTON_ENABLED 1
+#define APP_CONFIG_GATT_WRITE_ENABLED 1
+#define APP_CONFIG_BME280_OSRS_T 1
+#define APP_CONFIG_BME280_OSRS_H 1
+#define APP_CONFIG_BME280_OSRS_P 1
+#define APP_CONFIG_MEASUREMENT_WAIT_TIME 100 // ms
+#define APP_CONFIG_MEASUREMENT_PERIOD 60     // s
+#define APP_CONFIG_ADV_SLOW_INTERVAL 9600    // 0.625 ms unit, 6.0 s
+
+#elif APP_CONFIG_PROFILE == APP_CONFIG_PROFILE_LOGGER
+// Not configurable over GATT. The device ID is set at build: make PROFILE=LOGGER DEVICE_ID=3
+// Without the button, only a power cycle wakes the device up from hibernation.
+#define APP_CONFIG_BATTERY_ENABLED 1
+#define APP_CONFIG_HUMIDITY_ENABLED 1
+#define APP_CONFIG_PRESSURE_ENABLED 0
+#define APP_CONFIG_BUTTON_ENABLED 0
+#define APP_CONFIG_GATT_WRITE_ENABLED 0
+#define APP_CONFIG_BME280_OSRS_T 1
+#define APP_CONFIG_BME280_OSRS_H 1
+#define APP_CONFIG_BME280_OSRS_P 0
+#define APP_CONFIG_MEASUREMENT_WAIT_TIME 10 // ms, 6.4 ms at most for T x1 and H x1
+#define APP_CONFIG_MEASUREMENT_PERIOD 300   // s
+#define APP_CONFIG_ADV_SLOW_INTERVAL 8000   // 0.625 ms unit, 5.0 s
+#ifndef NRF_LOG_ENABLED
+#define NRF_LOG_ENABLED 0
+#endif
+
+#elif APP_CONFIG_PROFILE == APP_CONFIG_PROFILE_MAINS
+// Battery is advertised as 0. Lower noise with x4 oversampling costs no battery here.
+#define APP_CONFIG_BATTERY_ENABLED 0
+#define APP_CONFIG_HUMIDITY_ENABLED 1
+#define APP_CONFIG_PRESSURE_ENABLED 1
+#define APP_CONFIG_BUTTON_ENABLED 1
+#define APP_CONFIG_GATT_WRITE_ENABLED 1
+#define APP_CONFIG_BME280_OSRS_T 3
+#define APP_CONFIG_BME280_OSRS_H 3
+#define APP_CONFIG_BME280_OSRS_P 3
+#define APP_CONFIG_MEASUREMENT_WAIT_TIME 40 // ms, 29.9 ms at most for T, P and H x4
+#define APP_CONFIG_MEASUREMENT_PERIOD 30    // s
+#define APP_CONFIG_ADV_SLOW_INTERVAL 1600   // 0.625 ms unit, 1.0 s
+
+#else
+#error "unknown APP_CONFIG_PROFILE"
+#endif
+
+// Device ID after reset to the default. Can be set by the Makefile: make DEVICE_ID=3
+#ifndef APP_CONFIG_DEVICE_ID
+#define APP_CONFIG_DEVICE_ID 0xffff
+#endif
+
+#endif
@@ -6,12 +6,28 @@
 #include "ble_advertising.h"
 #include "ble_srv_common.h"
 
+#include "adv_slot.h"
+#include "adv_sync.h"
+#include "aggregate.h"
+#include "alarm.h"
+#include "app_config.h"
+#include "charge.h"
 #include "led_button.h"
+#include "period_timer.h"
+#include "power_profile.h"
+#include "ram_usage.h"
+#include "relay.h"
+#include "scheduler.h"
 #include "sensor.h"
+#include "trace.h"
+#include "txpower.h"
+#include "wallclock.h"
 
 #include "app_timer.h"
 #include "fds.h"
+#if ENBLE_USE_PEER_MANAGER
 #include "peer_manager.h"
+#endif
 
 #define NRF_LOG_MODULE_NAME "APP_ENBLE"
 #define NRF_LOG_LEVEL 0
@@ -19,78 +35,402 @@
 #include "nrf_log_ctrl.h"
 
 #define APP_ADV_SLOW_TIMEOUT_IN_SECONDS 0  /**< The advertising timeout in units of seconds. 0 means continuously advertising without timeout. */
-#define APP_ADV_SLOW_INTERVAL 9600         /**< The advertising interval (in units of 0.625 ms. This value corresponds to 2.0 s). */
+#define APP_ADV_SLOW_INTERVAL APP_CONFIG_ADV_SLOW_INTERVAL /**< The advertising interval (in units of 0.625 ms), set by the profile. */
 #define APP_ADV_FAST_TIMEOUT_IN_SECONDS 10 /**< The advertising timeout in units of seconds. */
 #define APP_ADV_FAST_INTERVAL 160          /**< The advertising interval (in units of 0.625 ms. This value corresponds to 0.1 s). */
 
-#define DEFAULT_DEVICE_ID 0xffff
-#define DEFAULT_MEASUREMNT_PERIOD 60    // s
-#define FIRSTTIME_MEASUREMENT_DELAY 1   // s
+#define DEFAULT_DEVICE_ID APP_CONFIG_DEVICE_ID
+#define DEFAULT_MEASUREMNT_PERIOD APP_CONFIG_MEASUREMENT_PERIOD // s
+
+// Status flags in the last byte of manufacturer data
+#define ADV_STATUS_NO_DATA 0x01 // no measurement has finished since reset, the measurement data are not valid
+#define ADV_STATUS_ALARM 0x02   // a threshold alarm is active
+#define ADV_STATUS_BATTERY_LOW 0x04 // the estimated remaining lifetime is short
+
+// Remaining lifetime to set the battery low flag
+#define CHARGE_LOW_LIFETIME_HOURS (30 * 24)
+// The counters for the charge estimation are saved at this interval and at hibernation
+#define CHARGE_SAVE_INTERVAL (24 * 3600) // s
+STATIC_ASSERT(CHARGE_DATA_LEN == BLE_ENBLE_CHARGE_DATA_LEN);
+
+// Measurement period while an alarm is active, if the configured period is longer
+#define ALARM_MEASUREMENT_PERIOD 10 // s
+STATIC_ASSERT(ALARM_THRESHOLD_DATA_LEN == BLE_ENBLE_ALARM_DATA_LEN);
+
+// Channels after channel 0 are in the service data of the scan response
+#define ADV_CHANNEL_SERVICE_UUID BLE_UUID_ENBLE_SERVICE
+// Payloads of neighbours are in the service data of the scan response in relay mode
+#define ADV_RELAY_SERVICE_UUID 0x0002
+// Min, max and standard deviation of the reporting period are in the service data of the scan response
+#define ADV_AGGREGATE_SERVICE_UUID 0x0004
+STATIC_ASSERT(AGGREGATE_DATA_LEN == BLE_ENBLE_AGGREGATE_DATA_LEN);
+
+// Histograms are printed to RTT every this number of measurements
+#define TRACE_DUMP_CYCLE_CNT 60
+STATIC_ASSERT(TRACE_HISTOGRAM_DATA_LEN == BLE_ENBLE_DIAGNOSTICS_DATA_LEN);
+STATIC_ASSERT(RAM_USAGE_DATA_LEN <= BLE_ENBLE_DIAGNOSTICS_DATA_LEN);
+STATIC_ASSERT(TRACE_BOOT_DATA_LEN <= BLE_ENBLE_DIAGNOSTICS_DATA_LEN);
+STATIC_ASSERT(BLE_ENBLE_DIAGNOSTICS_RAM >= TRACE_STAGE_CNT);
+
+#if RELAY_ENABLED && (SENSOR_CHANNEL_CNT > 1)
+#error "The scan response has room for either the channels or the relay frame"
+#endif
+#if AGGREGATE_ENABLED && (RELAY_ENABLED || (SENSOR_CHANNEL_CNT > 1))
+#error "The scan response has room for either the channels, the relay frame or the aggregate"
+#endif
 
-static ble_uuid_t m_adv_uuids[] = {{BLE_UUID_DEVICE_INFORMATION_SERVICE, BLE_UUID_TYPE_BLE}}; /**< Universally unique service identifiers. */
+// Measure just before a slow advertising event so that the advertised data is fresh.
+// Enabled by the Makefile: make ADV_SYNC=1
+// The data age at transmission is recorded in both modes.
+#ifndef ADV_SYNC_ENABLED
+#define ADV_SYNC_ENABLED 0
+#endif
+#define ADV_SYNC_LEAD_TIME (SENSOR_MEASUREMENT_WAIT_TIME + 20) // ms, measurement and the data processing
+#define APP_ADV_SLOW_INTERVAL_MS (APP_ADV_SLOW_INTERVAL * 625 / 1000)
+#define APP_ADV_FAST_INTERVAL_MS (APP_ADV_FAST_INTERVAL * 625 / 1000)
+
+#if SLOTTED_ADV_ENABLED
+// Interval of the stack in slotted advertising. It is a slot longer than the slots, so the next event of the stack
+// is never sent before the slot handler starts advertising again, unless the handler is delayed by a whole slot.
+#define APP_ADV_SLOT_INTERVAL (APP_ADV_SLOW_INTERVAL + MSEC_TO_UNITS(ADV_SLOT_WIDTH_MS, UNIT_0_625_MS))
+STATIC_ASSERT(APP_ADV_SLOT_INTERVAL <= BLE_GAP_ADV_INTERVAL_MAX);
+#endif
 
-APP_TIMER_DEF(m_meaurement_timer_id);
+static ble_uuid_t m_adv_uuids[] = {{BLE_UUID_DEVICE_INFORMATION_SERVICE, BLE_UUID_TYPE_BLE}}; /**< Universally unique service identifiers. */
 
 static uint16_t m_measurement_period;
 static uint16_t m_device_id;
-static SensorMeasurementData m_measurement_data;
+static SensorMeasurementData m_measurement_data[SENSOR_CHANNEL_CNT];
 
 static ble_enble_t *p_enble_instance;
 
-static bool m_is_first_measure;
+static bool m_has_measurement_data;
 static bool m_is_measuring;
+static bool m_is_slow_advertising;
+static bool m_is_hibernation_requested;
+static bool m_is_disconnect_pending;
+#if AGGREGATE_ENABLED
+static uint16_t m_report_sample_cnt; // samples in a reporting period
+static bool m_is_report_requested;   // the next sample is reported, for an on-demand measurement
+static uint8_t m_aggregate_data[AGGREGATE_DATA_LEN]; // aggregate of the last reporting period
+#endif
+#if TRACE_ENABLED
+static uint8_t m_diagnostics_select = TRACE_STAGE_CYCLE; // stage, BLE_ENBLE_DIAGNOSTICS_RAM or BLE_ENBLE_DIAGNOSTICS_BOOT in the Diagnostics characteristic
+#endif
 
 // FDS file id and record key for backup data
 #define FDS_BACKUP_FILE_ID 0x1000
 #define FDS_BACKUP_RECORD_KEY 0x2000
+#define FDS_ALARM_RECORD_KEY 0x2001
+#define FDS_CHARGE_RECORD_KEY 0x2002
+#define FDS_TX_POWER_RECORD_KEY 0x2003
+#define FDS_ALARM_DATA_LEN_WORDS ((SENSOR_CHANNEL_CNT * ALARM_THRESHOLD_DATA_LEN + 3) / 4)
+#define FDS_RECORD_CNT 4                          // keys from FDS_BACKUP_RECORD_KEY
+#define FDS_GC_FREEABLE_WORDS FDS_VIRTUAL_PAGE_SIZE // garbage which starts GC after an update
 
 static fds_record_desc_t m_enble_fds_record_desc;
 static uint32_t m_fds_backup_data;
+static bool m_is_fds_backup_data_valid; // m_fds_backup_data is the value in flash
+static uint32_t m_fds_alarm_data[FDS_ALARM_DATA_LEN_WORDS];
+static uint8_t m_fds_write_pending_cnt;
+static charge_counters_t m_fds_charge_data;
+static uint32_t m_charge_saved_uptime_s;
+static uint32_t m_fds_tx_power_data;
+
+// A save which found no space in flash is written again after GC, and one which found the queue full at the next event.
+// Without Peer Manager, nothing else runs GC on the records of this file.
+typedef struct
+{
+    const uint32_t *p_data; // NULL if no retry is pending
+    uint16_t length_words;
+} fds_retry_t;
 
-static uint32_t save_nonvolatile_data()
+static fds_retry_t m_fds_retry[FDS_RECORD_CNT];
+static bool m_is_fds_gc_running;
+static bool m_is_fds_gc_requested; // the queue of FDS was full, started at the next event
+
+static void fds_gc_request()
 {
-    uint32_t err_code;
+    if (m_is_fds_gc_running)
+    {
+        return;
+    }
+
+    uint32_t err_code = fds_gc();
+    if (err_code == FDS_ERR_BUSY || err_code == FDS_ERR_NO_SPACE_IN_QUEUES)
+    {
+        m_is_fds_gc_requested = true;
+        return;
+    }
+    APP_ERROR_CHECK(err_code);
+
+    m_is_fds_gc_running = true;
+    m_is_fds_gc_requested = false;
+}
 
-    m_fds_backup_data = ((uint32_t)m_measurement_period << 16) | (uint32_t)m_device_id;
+// Write a record, or update it if it exists.
+static uint32_t fds_record_write_or_update(uint16_t record_key, const uint32_t *p_data, uint16_t length_words)
+{
+    fds_record_desc_t fds_record_desc;
 
     fds_record_chunk_t fds_record_chunk;
     memset(&fds_record_chunk, 0, sizeof(fds_record_chunk));
-    fds_record_chunk.p_data = &m_fds_backup_data;
-    fds_record_chunk.length_words = 1;
+    fds_record_chunk.p_data = p_data;
+    fds_record_chunk.length_words = length_words;
 
     fds_record_t fds_record;
     memset(&fds_record, 0, sizeof(fds_record));
     fds_record.file_id = FDS_BACKUP_FILE_ID;
-    fds_record.key = FDS_BACKUP_RECORD_KEY;
+    fds_record.key = record_key;
     fds_record.data.p_chunks = &fds_record_chunk;
     fds_record.data.num_chunks = 1;
 
     fds_find_token_t fds_find_token;
     memset(&fds_find_token, 0, sizeof(fds_find_token));
 
-    uint32_t find_result = fds_record_find(FDS_BACKUP_FILE_ID, FDS_BACKUP_RECORD_KEY, &m_enble_fds_record_desc, &fds_find_token);
+    uint32_t find_result = fds_record_find(FDS_BACKUP_FILE_ID, record_key, &fds_record_desc, &fds_find_token);
 
-    // If data have already existed, write record, otherwise update
+    // If data have already existed, update record, otherwise write
     if (find_result == FDS_SUCCESS)
     {
-        err_code = fds_record_update(&m_enble_fds_record_desc, &fds_record);
-        if (err_code != NRF_SUCCESS)
+        return fds_record_update(&fds_record_desc, &fds_record);
+    }
+
+    return fds_record_write(&fds_record_desc, &fds_record);
+}
+
+// p_data must stay valid until the write is finished, also when it is retried after GC.
+static uint32_t fds_record_save(uint16_t record_key, const uint32_t *p_data, uint16_t length_words)
+{
+    fds_retry_t *p_retry = &m_fds_retry[record_key - FDS_BACKUP_RECORD_KEY];
+    bool is_retry_pending = (p_retry->p_data != NULL);
+
+    uint32_t err_code = fds_record_write_or_update(record_key, p_data, length_words);
+    if (err_code == FDS_ERR_NO_SPACE_IN_FLASH || err_code == FDS_ERR_NO_SPACE_IN_QUEUES)
+    {
+        p_retry->p_data = p_data;
+        p_retry->length_words = length_words;
+        if (err_code == FDS_ERR_NO_SPACE_IN_FLASH)
         {
-            return err_code;
+            fds_gc_request();
         }
+        err_code = NRF_SUCCESS;
     }
-    else
+    else if (err_code == NRF_SUCCESS && is_retry_pending)
     {
-        err_code = fds_record_write(&m_enble_fds_record_desc, &fds_record);
-        if (err_code != NRF_SUCCESS)
+        // Written before the retry, in place of it.
+        p_retry->p_data = NULL;
+    }
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    // A retry is counted once until it is written.
+    if (!is_retry_pending)
+    {
+        m_fds_write_pending_cnt++;
+        charge_on_flash_write();
+    }
+
+    return NRF_SUCCESS;
+}
+
+static void fds_retry_write(bool is_after_gc)
+{
+    for (uint8_t i = 0; i < FDS_RECORD_CNT; i++)
+    {
+        fds_retry_t *p_retry = &m_fds_retry[i];
+        if (p_retry->p_data == NULL)
         {
-            return err_code;
+            continue;
+        }
+
+        uint32_t err_code = fds_record_write_or_update(FDS_BACKUP_RECORD_KEY + i, p_retry->p_data, p_retry->length_words);
+        if (err_code == FDS_ERR_NO_SPACE_IN_QUEUES)
+        {
+            // Retried at the next event.
+            return;
         }
+        if (err_code == FDS_ERR_NO_SPACE_IN_FLASH && !is_after_gc)
+        {
+            // Retried after GC.
+            fds_gc_request();
+            return;
+        }
+        // The flash is full of valid records if GC did not free enough.
+        APP_ERROR_CHECK(err_code);
+
+        p_retry->p_data = NULL;
+    }
+}
+
+static uint32_t save_nonvolatile_data()
+{
+    uint32_t err_code;
+    uint32_t backup_data = ((uint32_t)m_measurement_period << 16) | (uint32_t)m_device_id;
+
+    // Flash is written only when the value is changed.
+    if (m_is_fds_backup_data_valid && backup_data == m_fds_backup_data)
+    {
+        return NRF_SUCCESS;
+    }
+
+    m_fds_backup_data = backup_data;
+
+    err_code = fds_record_save(FDS_BACKUP_RECORD_KEY, &m_fds_backup_data, 1);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
     }
 
+    m_is_fds_backup_data_valid = true;
+
     return NRF_SUCCESS;
 }
 
+static uint32_t save_alarm_data()
+{
+    memset(m_fds_alarm_data, 0, sizeof(m_fds_alarm_data));
+    alarm_threshold_serialize((uint8_t *)m_fds_alarm_data);
+
+    return fds_record_save(FDS_ALARM_RECORD_KEY, m_fds_alarm_data, FDS_ALARM_DATA_LEN_WORDS);
+}
+
+// Thresholds stay disabled if no record of the same number of channels is found.
+static uint32_t load_alarm_data()
+{
+    uint32_t err_code;
+    fds_record_desc_t fds_record_desc;
+
+    fds_flash_record_t fds_flash_record;
+    memset(&fds_flash_record, 0, sizeof(fds_flash_record));
+
+    fds_find_token_t fds_find_token;
+    memset(&fds_find_token, 0, sizeof(fds_find_token));
+
+    uint32_t find_result = fds_record_find(FDS_BACKUP_FILE_ID, FDS_ALARM_RECORD_KEY, &fds_record_desc, &fds_find_token);
+    if (find_result == FDS_ERR_NOT_FOUND)
+    {
+        return NRF_SUCCESS;
+    }
+    if (find_result != FDS_SUCCESS)
+    {
+        return find_result;
+    }
+
+    err_code = fds_record_open(&fds_record_desc, &fds_flash_record);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    if (fds_flash_record.p_header->tl.length_words == FDS_ALARM_DATA_LEN_WORDS)
+    {
+        memcpy(m_fds_alarm_data, fds_flash_record.p_data, sizeof(m_fds_alarm_data));
+        alarm_threshold_deserialize((const uint8_t *)m_fds_alarm_data);
+        NRF_LOG_INFO("alarm thresholds are loaded\n");
+    }
+
+    return fds_record_close(&fds_record_desc);
+}
+
+static uint32_t save_charge_data()
+{
+    m_fds_charge_data = *charge_counters_get();
+    m_charge_saved_uptime_s = m_fds_charge_data.uptime_s;
+
+    return fds_record_save(FDS_CHARGE_RECORD_KEY, (const uint32_t *)&m_fds_charge_data, sizeof(m_fds_charge_data) / 4);
+}
+
+// Command after a battery change. The counters start from zero and the record is overwritten.
+static void charge_reset()
+{
+    uint32_t err_code;
+
+    charge_counters_reset();
+
+    err_code = save_charge_data();
+    APP_ERROR_CHECK(err_code);
+}
+
+// Returns false if no record of the same size is found.
+static bool load_charge_data()
+{
+    uint32_t err_code;
+    bool is_loaded = false;
+    fds_record_desc_t fds_record_desc;
+
+    fds_flash_record_t fds_flash_record;
+    memset(&fds_flash_record, 0, sizeof(fds_flash_record));
+
+    fds_find_token_t fds_find_token;
+    memset(&fds_find_token, 0, sizeof(fds_find_token));
+
+    if (fds_record_find(FDS_BACKUP_FILE_ID, FDS_CHARGE_RECORD_KEY, &fds_record_desc, &fds_find_token) != FDS_SUCCESS)
+    {
+        return false;
+    }
+
+    if (fds_record_open(&fds_record_desc, &fds_flash_record) != FDS_SUCCESS)
+    {
+        return false;
+    }
+
+    if (fds_flash_record.p_header->tl.length_words == sizeof(m_fds_charge_data) / 4)
+    {
+        memcpy(&m_fds_charge_data, fds_flash_record.p_data, sizeof(m_fds_charge_data));
+        is_loaded = true;
+    }
+
+    err_code = fds_record_close(&fds_record_desc);
+    APP_ERROR_CHECK(err_code);
+
+    return is_loaded;
+}
+
+static uint32_t save_tx_power_data()
+{
+    m_fds_tx_power_data = (uint32_t)(int32_t)txpower_get();
+
+    return fds_record_save(FDS_TX_POWER_RECORD_KEY, &m_fds_tx_power_data, 1);
+}
+
+// Returns the default if no record is found.
+static int8_t load_tx_power_data()
+{
+    uint32_t err_code;
+    int8_t dbm = TXPOWER_DEFAULT_DBM;
+    fds_record_desc_t fds_record_desc;
+
+    fds_flash_record_t fds_flash_record;
+    memset(&fds_flash_record, 0, sizeof(fds_flash_record));
+
+    fds_find_token_t fds_find_token;
+    memset(&fds_find_token, 0, sizeof(fds_find_token));
+
+    if (fds_record_find(FDS_BACKUP_FILE_ID, FDS_TX_POWER_RECORD_KEY, &fds_record_desc, &fds_find_token) != FDS_SUCCESS)
+    {
+        return dbm;
+    }
+
+    if (fds_record_open(&fds_record_desc, &fds_flash_record) != FDS_SUCCESS)
+    {
+        return dbm;
+    }
+
+    if (fds_flash_record.p_header->tl.length_words == 1)
+    {
+        memcpy(&m_fds_tx_power_data, fds_flash_record.p_data, sizeof(m_fds_tx_power_data));
+        dbm = (int8_t)(int32_t)m_fds_tx_power_data;
+    }
+
+    err_code = fds_record_close(&fds_record_desc);
+    APP_ERROR_CHECK(err_code);
+
+    return dbm;
+}
+
 static uint32_t set_default_nonvolatile_data()
 {
     m_measurement_period = DEFAULT_MEASUREMNT_PERIOD;
@@ -102,6 +442,15 @@ static uint32_t set_default_nonvolatile_data()
     return save_nonvolatile_data();
 }
 
+#if APP_CONFIG_BUTTON_ENABLED
+static uint32_t set_default_alarm_data()
+{
+    alarm_init();
+
+    return save_alarm_data();
+}
+#endif
+
 static uint32_t load_nonvolatile_data()
 {
     uint32_t err_code;
@@ -123,6 +472,7 @@ static uint32_t load_nonvolatile_data()
         }
 
         memcpy(&m_fds_backup_data, fds_flash_record.p_data, sizeof(m_fds_backup_data));
+        m_is_fds_backup_data_valid = true;
 
         m_device_id = (uint16_t)m_fds_backup_data;
         m_measurement_period = (uint16_t)(m_fds_backup_data >> 16);
@@ -147,6 +497,111 @@ static uint32_t load_nonvolatile_data()
     return find_result;
 }
 
+// Enter System OFF after the measurement, the flash write and the disconnection are finished.
+// The device wakes up by the button and restarts from reset.
+static void hibernation_enter()
+{
+    uint32_t err_code;
+
+    if (!m_is_hibernation_requested || m_is_measuring || m_fds_write_pending_cnt > 0 || m_is_disconnect_pending)
+    {
+        return;
+    }
+
+    NRF_LOG_INFO("enter System OFF\n");
+
+    // GPIO output is retained in System OFF.
+    led_off();
+
+#if APP_CONFIG_BUTTON_ENABLED
+    button_wakeup_enable();
+#endif
+
+    // The wake-up is a reset, so no RAM is retained in System OFF.
+    err_code = sd_power_ramon_clr(POWER_RAMON_OFFRAM0_Msk | POWER_RAMON_OFFRAM1_Msk);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = sd_power_system_off();
+    APP_ERROR_CHECK(err_code);
+}
+
+static void hibernation_request()
+{
+    uint32_t err_code;
+
+    if (m_is_hibernation_requested)
+    {
+        return;
+    }
+
+    NRF_LOG_INFO("hibernation is requested\n");
+
+    m_is_hibernation_requested = true;
+
+    err_code = period_timer_stop();
+    APP_ERROR_CHECK(err_code);
+
+#if RELAY_ENABLED
+    err_code = relay_stop();
+    APP_ERROR_CHECK(err_code);
+#endif
+
+    err_code = save_nonvolatile_data();
+    APP_ERROR_CHECK(err_code);
+
+    // The time in System OFF is not counted, because its current is much less than the sleeping current.
+    err_code = save_charge_data();
+    APP_ERROR_CHECK(err_code);
+
+    if (p_enble_instance->conn_handle != BLE_CONN_HANDLE_INVALID)
+    {
+        err_code = sd_ble_gap_disconnect(p_enble_instance->conn_handle, BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+        APP_ERROR_CHECK(err_code);
+
+        m_is_disconnect_pending = true;
+    }
+
+    hibernation_enter();
+}
+
+static void fds_evt_handler(fds_evt_t const *p_fds_evt)
+{
+    if (p_fds_evt->id == FDS_EVT_GC)
+    {
+        // GC of Peer Manager also frees space for the retries.
+        m_is_fds_gc_running = false;
+        fds_retry_write(true);
+    }
+    else if (m_is_fds_gc_requested)
+    {
+        fds_gc_request();
+    }
+    else if (!m_is_fds_gc_running)
+    {
+        fds_retry_write(false);
+    }
+
+    if ((p_fds_evt->id == FDS_EVT_WRITE || p_fds_evt->id == FDS_EVT_UPDATE) &&
+        p_fds_evt->write.file_id == FDS_BACKUP_FILE_ID &&
+        m_fds_write_pending_cnt > 0)
+    {
+        // An update leaves the old record dirty. GC runs before they fill the flash.
+        if (p_fds_evt->id == FDS_EVT_UPDATE)
+        {
+            fds_stat_t stat;
+            uint32_t err_code = fds_stat(&stat);
+            APP_ERROR_CHECK(err_code);
+            if (stat.freeable_words >= FDS_GC_FREEABLE_WORDS)
+            {
+                fds_gc_request();
+            }
+        }
+
+        m_fds_write_pending_cnt--;
+        hibernation_enter();
+    }
+}
+
 static void on_adv_evt(ble_adv_evt_t ble_adv_evt)
 {
     uint32_t err_code;
@@ -154,14 +609,23 @@ static void on_adv_evt(ble_adv_evt_t ble_adv_evt)
     {
     case BLE_ADV_EVT_FAST:
         NRF_LOG_INFO("start fast advertising\n");
+        m_is_slow_advertising = false;
+        adv_sync_adv_restart();
+        charge_adv_mode_set(CHARGE_ADV_MODE_FAST);
         break;
 
     case BLE_ADV_EVT_SLOW:
         NRF_LOG_INFO("start slow advertising\n");
+        m_is_slow_advertising = true;
+        adv_sync_adv_restart();
+        charge_adv_mode_set(CHARGE_ADV_MODE_SLOW);
         break;
 
     case BLE_ADV_EVT_IDLE:
         NRF_LOG_INFO("advertising mode is idle\n");
+        m_is_slow_advertising = false;
+        adv_sync_adv_restart();
+        charge_adv_mode_set(CHARGE_ADV_MODE_NONE);
         err_code = ble_advertising_start(BLE_ADV_MODE_SLOW);
         APP_ERROR_CHECK(err_code);
         break;
@@ -171,25 +635,40 @@ static void on_adv_evt(ble_adv_evt_t ble_adv_evt)
     }
 }
 
+// temperature, humidity and pressure of a channel in BLE_ENBLE_CHANNEL_DATA_LEN bytes
+static void serialize_channel_data(const SensorMeasurementData *p_data, uint8_t *p_buffer)
+{
+    p_buffer[0] = (uint8_t)p_data->temperature;
+    p_buffer[1] = (uint8_t)(p_data->temperature >> 8);
+    p_buffer[2] = (uint8_t)p_data->humidity;
+    p_buffer[3] = (uint8_t)(p_data->humidity >> 8);
+    p_buffer[4] = (uint8_t)p_data->pressure;
+    p_buffer[5] = (uint8_t)(p_data->pressure >> 8);
+}
+
 static uint32_t advertising_update_data()
 {
     uint32_t err_code;
     ble_advdata_t advdata;
+    ble_advdata_t srdata;
     ble_adv_modes_config_t options;
 
-    uint8_t serialized_measurement_data[8];
-    serialized_measurement_data[0] = (uint8_t)m_measurement_data.battery;
-    serialized_measurement_data[1] = (uint8_t)(m_measurement_data.battery >> 8);
-    serialized_measurement_data[2] = (uint8_t)m_measurement_data.temperature;
-    serialized_measurement_data[3] = (uint8_t)(m_measurement_data.temperature >> 8);
-    serialized_measurement_data[4] = (uint8_t)m_measurement_data.humidity;
-    serialized_measurement_data[5] = (uint8_t)(m_measurement_data.humidity >> 8);
-    serialized_measurement_data[6] = (uint8_t)m_measurement_data.pressure;
-    serialized_measurement_data[7] = (uint8_t)(m_measurement_data.pressure >> 8);
+    uint8_t serialized_measurement_data[9];
+    serialized_measurement_data[0] = (uint8_t)m_measurement_data[0].battery;
+    serialized_measurement_data[1] = (uint8_t)(m_measurement_data[0].battery >> 8);
+    serialize_channel_data(&m_measurement_data[0], &serialized_measurement_data[2]);
+    serialized_measurement_data[8] = (m_has_measurement_data ? 0 : ADV_STATUS_NO_DATA) |
+                                     (alarm_is_active() ? ADV_STATUS_ALARM : 0);
+#if APP_CONFIG_BATTERY_ENABLED
+    if (charge_lifetime_hours_get() < CHARGE_LOW_LIFETIME_HOURS)
+    {
+        serialized_measurement_data[8] |= ADV_STATUS_BATTERY_LOW;
+    }
+#endif
 
     ble_advdata_manuf_data_t adv_manufacture_data;
     adv_manufacture_data.company_identifier = m_device_id;
-    adv_manufacture_data.data.size = 8;
+    adv_manufacture_data.data.size = sizeof(serialized_measurement_data);
     adv_manufacture_data.data.p_data = serialized_measurement_data;
 
     // Build advertising data struct to pass into @ref ble_advertising_init.
@@ -202,6 +681,41 @@ static uint32_t advertising_update_data()
     advdata.uuids_complete.p_uuids = m_adv_uuids;
     advdata.p_manuf_specific_data = &adv_manufacture_data;
 
+    // Channel 1 and the followings are sent only to active scanners.
+    uint8_t serialized_channel_data[(SENSOR_CHANNEL_MAX - 1) * BLE_ENBLE_CHANNEL_DATA_LEN];
+    for (uint8_t i = 1; i < SENSOR_CHANNEL_CNT; i++)
+    {
+        serialize_channel_data(&m_measurement_data[i], &serialized_channel_data[(i - 1) * BLE_ENBLE_CHANNEL_DATA_LEN]);
+    }
+
+    ble_advdata_service_data_t sr_service_data;
+    sr_service_data.service_uuid = ADV_CHANNEL_SERVICE_UUID;
+    sr_service_data.data.size = (SENSOR_CHANNEL_CNT - 1) * BLE_ENBLE_CHANNEL_DATA_LEN;
+    sr_service_data.data.p_data = serialized_channel_data;
+
+#if AGGREGATE_ENABLED
+    // The mean is in the manufacturer data and the rest of the aggregate is sent only to active scanners.
+    sr_service_data.service_uuid = ADV_AGGREGATE_SERVICE_UUID;
+    sr_service_data.data.size = AGGREGATE_DATA_LEN;
+    sr_service_data.data.p_data = m_aggregate_data;
+#endif
+
+#if RELAY_ENABLED
+    // Neighbours are relayed in the scan response, so they are sent only to active scanners.
+    uint8_t relay_frame[RELAY_FRAME_LEN_MAX];
+    sr_service_data.service_uuid = ADV_RELAY_SERVICE_UUID;
+    sr_service_data.data.size = relay_frame_get(relay_frame);
+    sr_service_data.data.p_data = relay_frame;
+#endif
+
+    // The bridge estimates the path loss from the TX power and the RSSI.
+    int8_t tx_power = txpower_get();
+
+    memset(&srdata, 0, sizeof(srdata));
+    srdata.p_tx_power_level = &tx_power;
+    srdata.p_service_data_array = &sr_service_data;
+    srdata.service_data_count = (sr_service_data.data.size > 0) ? 1 : 0;
+
     memset(&options, 0, sizeof(options));
     options.ble_adv_slow_enabled = true;
     options.ble_adv_slow_interval = APP_ADV_SLOW_INTERVAL;
@@ -210,62 +724,223 @@ static uint32_t advertising_update_data()
     options.ble_adv_fast_interval = APP_ADV_FAST_INTERVAL;
     options.ble_adv_fast_timeout = APP_ADV_FAST_TIMEOUT_IN_SECONDS;
 
-    err_code = ble_advertising_init(&advdata, NULL, &options, on_adv_evt, NULL);
+    err_code = ble_advertising_init(&advdata, &srdata, &options, on_adv_evt, NULL);
     return err_code;
 }
 
-// This function is not called while a measurment is running and before the first time measurement is done.
-static void button_event_handler()
+static void advertising_fast_restart()
 {
     uint32_t err_code;
 
-    led_blink(100);
+    if (p_enble_instance->conn_handle != BLE_CONN_HANDLE_INVALID)
+    {
+        return;
+    }
 
-    err_code = app_timer_stop(m_meaurement_timer_id);
+    err_code = sd_ble_gap_adv_stop();
     APP_ERROR_CHECK(err_code);
 
-    if (p_enble_instance->conn_handle == BLE_CONN_HANDLE_INVALID)
+    err_code = ble_advertising_start(BLE_ADV_MODE_FAST);
+    APP_ERROR_CHECK(err_code);
+}
+
+// The measurement period is shortened while an alarm is active.
+// After the time is synced, measurements are aligned to multiples of the period in wall clock.
+static uint32_t measurement_timer_restart()
+{
+    uint16_t period = m_measurement_period;
+
+    if (alarm_is_active() && period > ALARM_MEASUREMENT_PERIOD)
     {
-        err_code = sd_ble_gap_adv_stop();
-        APP_ERROR_CHECK(err_code);
+        period = ALARM_MEASUREMENT_PERIOD;
+    }
 
-        err_code = ble_advertising_start(BLE_ADV_MODE_FAST);
-        APP_ERROR_CHECK(err_code);
+#if AGGREGATE_ENABLED
+    // The timer samples at the sample interval and every m_report_sample_cnt samples are reported.
+    // A period which is not a multiple of the interval is rounded down.
+    m_report_sample_cnt = MAX(period / AGGREGATE_SAMPLE_INTERVAL, 1);
+    if (m_report_sample_cnt > 1)
+    {
+        period = AGGREGATE_SAMPLE_INTERVAL;
     }
+#endif
 
-    err_code = app_timer_start(m_meaurement_timer_id, APP_TIMER_TICKS(m_measurement_period * 1000, 0), NULL);
-    APP_ERROR_CHECK(err_code);
+    return period_timer_start(wallclock_delay_to_boundary_get(period), period);
 }
 
-static void sensor_data_handler(const SensorMeasurementData *measurement_data)
+#if TRACE_ENABLED
+static void diagnostics_update()
 {
-    uint32_t err_code;
+    uint8_t data[BLE_ENBLE_DIAGNOSTICS_DATA_LEN];
 
-#ifdef DEBUG
-    led_blink(10);
-#endif
+    if (m_diagnostics_select == BLE_ENBLE_DIAGNOSTICS_RAM)
+    {
+        memset(data, 0, sizeof(data));
+        ram_usage_serialize(BLE_ENBLE_DIAGNOSTICS_RAM, data);
+    }
+    else if (m_diagnostics_select == BLE_ENBLE_DIAGNOSTICS_BOOT)
+    {
+        memset(data, 0, sizeof(data));
+        trace_boot_serialize(BLE_ENBLE_DIAGNOSTICS_BOOT, data);
+    }
+    else
+    {
+        trace_histogram_serialize((trace_stage_t)m_diagnostics_select, data);
+    }
+
+    uint32_t err_code = ble_enble_update_diagnostics(p_enble_instance, data);
+    APP_ERROR_CHECK(err_code);
+}
+#endif
+
+#if APP_CONFIG_BUTTON_ENABLED
+static void button_evt_handler()
+{
+    uint32_t err_code;
+
+    led_blink(100);
+
+    advertising_fast_restart();
+
+    err_code = measurement_timer_restart();
+    APP_ERROR_CHECK(err_code);
+}
+
+static void button_event_handler()
+{
+    uint32_t err_code = scheduler_post(SCHEDULER_EVT_BUTTON, button_evt_handler);
+    APP_ERROR_CHECK(err_code);
+}
+
+static void button_long_press_event_handler()
+{
+    uint32_t err_code = scheduler_post(SCHEDULER_EVT_BUTTON, hibernation_request);
+    APP_ERROR_CHECK(err_code);
+}
+#endif
+
+// The applied TX power is shown in the characteristic and kept over a reset.
+static void tx_power_update()
+{
+    uint32_t err_code;
+
+    err_code = ble_enble_update_tx_power(p_enble_instance, txpower_get());
+    APP_ERROR_CHECK(err_code);
+
+    // The level is applied already, and a level lost by a reset is recommended again by the bridge.
+    err_code = save_tx_power_data();
+    if (err_code != NRF_SUCCESS)
+    {
+        NRF_LOG_WARNING("TX power is not saved: 0x%x\n", err_code);
+    }
+}
+
+#if ADV_SYNC_ENABLED
+// Move the next measurement to just before a slow advertising event, so that its data is fresh when it is sent.
+static void measurement_adv_sync()
+{
+    bool is_advertised = true;
+#if AGGREGATE_ENABLED
+    // A sample which is only accumulated is not advertised, so it stays on the period.
+    is_advertised = (aggregate_cnt_get() + 1 >= m_report_sample_cnt);
+#endif
 
-    memcpy(&m_measurement_data, measurement_data, sizeof(m_measurement_data));
+    // Advertising events are predictable only in slow advertising.
+    // In fast advertising or in a connection, the measurement stays on the period.
+    if (is_advertised && m_is_slow_advertising && p_enble_instance->conn_handle == BLE_CONN_HANDLE_INVALID &&
+        !m_is_hibernation_requested)
+    {
+        uint32_t err_code = adv_sync_align();
+        APP_ERROR_CHECK(err_code);
+    }
+}
+#endif
+
+static void sensor_data_handler(const SensorMeasurementData *measurement_data)
+{
+    uint32_t err_code;
+
+#ifdef DEBUG
+    led_blink(10);
+#endif
+
+    charge_on_measurement();
+
+    // Each sample is checked against the thresholds, so an alarm is not missed between reports.
+    alarm_evt_t alarm_evt = alarm_update(measurement_data);
+
+#if AGGREGATE_ENABLED
+    aggregate_add(&measurement_data[0]);
+
+    // A sample in the middle of the reporting period is only accumulated.
+    // The first data, an alarm and an on-demand measurement are reported at once.
+    if (m_has_measurement_data && !m_is_report_requested && alarm_evt == ALARM_EVT_NONE &&
+        aggregate_cnt_get() < m_report_sample_cnt)
+    {
+        m_is_measuring = false;
+        TRACE_END(TRACE_STAGE_CYCLE);
+#if ADV_SYNC_ENABLED
+        measurement_adv_sync();
+#endif
+        hibernation_enter();
+        return;
+    }
+
+    m_is_report_requested = false;
+    aggregate_mean_get(&m_measurement_data[0]);
+    aggregate_serialize(m_aggregate_data);
+    aggregate_reset();
+
+    // The mean is reported in place of the last sample.
+    measurement_data = m_measurement_data;
+
+    err_code = ble_enble_update_aggregate(p_enble_instance, m_aggregate_data);
+    APP_ERROR_CHECK(err_code);
+#else
+    memcpy(m_measurement_data, measurement_data, sizeof(m_measurement_data));
+#endif
+
+    if (!m_has_measurement_data)
+    {
+        m_has_measurement_data = true;
+        trace_boot_record(TRACE_BOOT_FIRST_DATA);
+    }
     NRF_LOG_INFO("measurement data is updated\n");
     NRF_LOG_DEBUG("%d %u %u %u\n", measurement_data->temperature, measurement_data->pressure, measurement_data->humidity, measurement_data->battery);
 
+    // The default is restored if the bridge has not recommended a TX power for long.
+    if (txpower_watchdog_check())
+    {
+        tx_power_update();
+    }
+
+    TRACE_BEGIN(TRACE_STAGE_ADV_UPDATE);
     err_code = advertising_update_data();
     APP_ERROR_CHECK(err_code);
+    TRACE_END(TRACE_STAGE_ADV_UPDATE);
 
-    if (m_is_first_measure)
-    {    
-        err_code = app_timer_stop(m_meaurement_timer_id);
-        APP_ERROR_CHECK(err_code);
+    err_code = adv_sync_on_adv_data_update();
+    APP_ERROR_CHECK(err_code);
 
-        err_code = app_timer_start(m_meaurement_timer_id, APP_TIMER_TICKS(m_measurement_period * 1000, 0), NULL);
-        APP_ERROR_CHECK(err_code);
-        
-        err_code = ble_advertising_start(BLE_ADV_MODE_SLOW);
-        APP_ERROR_CHECK(err_code);
+    // A raised alarm is advertised in fast mode right now instead of the next slow advertising event.
+    // The period timer is stopped in hibernation.
+    if (alarm_evt != ALARM_EVT_NONE && !m_is_hibernation_requested)
+    {
+        if (alarm_evt == ALARM_EVT_RAISED)
+        {
+            advertising_fast_restart();
+        }
 
-        m_is_first_measure = false;
+        err_code = measurement_timer_restart();
+        APP_ERROR_CHECK(err_code);
     }
 
+#if APP_CONFIG_BATTERY_ENABLED
+    err_code = power_profile_on_battery_update(measurement_data->battery);
+    APP_ERROR_CHECK(err_code);
+#endif
+
+    TRACE_BEGIN(TRACE_STAGE_GATT_UPDATE);
     err_code = ble_enble_update_temperature(p_enble_instance, measurement_data->temperature);
     APP_ERROR_CHECK(err_code);
 
@@ -278,25 +953,137 @@ static void sensor_data_handler(const SensorMeasurementData *measurement_data)
     err_code = ble_enble_update_battery(p_enble_instance, measurement_data->battery);
     APP_ERROR_CHECK(err_code);
 
-    m_is_measuring = false;    
-    
-    err_code = button_interrupt_enable();
+    uint16_t now_ms;
+    uint32_t now_s = wallclock_now_get(&now_ms);
+    err_code = ble_enble_update_time(p_enble_instance, now_s, now_ms);
+    APP_ERROR_CHECK(err_code);
+
+    uint8_t serialized_channels[SENSOR_CHANNEL_CNT * BLE_ENBLE_CHANNEL_DATA_LEN];
+    for (uint8_t i = 0; i < SENSOR_CHANNEL_CNT; i++)
+    {
+        serialize_channel_data(&measurement_data[i], &serialized_channels[i * BLE_ENBLE_CHANNEL_DATA_LEN]);
+    }
+    err_code = ble_enble_update_channels(p_enble_instance, serialized_channels);
     APP_ERROR_CHECK(err_code);
+
+    uint8_t serialized_charge[CHARGE_DATA_LEN];
+    charge_serialize(serialized_charge);
+    err_code = ble_enble_update_charge(p_enble_instance, serialized_charge);
+    APP_ERROR_CHECK(err_code);
+
+    // A peer may wait for this measurement to read a characteristic.
+    err_code = ble_enble_reply_measurement_read(p_enble_instance);
+    APP_ERROR_CHECK(err_code);
+    TRACE_END(TRACE_STAGE_GATT_UPDATE);
+
+    m_is_measuring = false;
+
+    if (!m_is_hibernation_requested &&
+        charge_counters_get()->uptime_s - m_charge_saved_uptime_s >= CHARGE_SAVE_INTERVAL)
+    {
+        err_code = save_charge_data();
+        APP_ERROR_CHECK(err_code);
+    }
+
+    TRACE_END(TRACE_STAGE_CYCLE);
+#if TRACE_ENABLED
+    diagnostics_update();
+    if (trace_histogram_get(TRACE_STAGE_CYCLE)->cnt % TRACE_DUMP_CYCLE_CNT == 0)
+    {
+        trace_dump();
+    }
+#endif
+
+    hibernation_enter();
 }
 
-static void measurement_timer_handler()
+static void start_measuring()
 {
     uint32_t err_code;
 
-    err_code = button_interrupt_disable();
-    APP_ERROR_CHECK(err_code);
-
     m_is_measuring = true;
 
     err_code = sensor_start_measuring();
     APP_ERROR_CHECK(err_code);
 }
 
+static void measurement_timer_evt_handler()
+{
+    TRACE_END(TRACE_STAGE_TIMER_WAKE);
+
+    // An on-demand measurement is running. Its result is used as this period's one.
+    if (m_is_measuring)
+    {
+        return;
+    }
+
+    start_measuring();
+}
+
+// The first radio event after the advertising data update is notified.
+static void adv_sync_handler()
+{
+    NRF_LOG_DEBUG("adv sync %u, fallback %u\n", adv_sync_stats_get()->sync_cnt, adv_sync_stats_get()->fallback_cnt);
+    NRF_LOG_DEBUG("data age %u ms\n", adv_sync_stats_get()->data_age_last_ms);
+    NRF_LOG_DEBUG("wakeups per hour %u\n", power_profile_stats_get()->wakeups_per_hour);
+
+    // The notification follows an update of the measurement data, so outside a connection
+    // the first one is the first advertising event with the data.
+    if (p_enble_instance->conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        trace_boot_record(TRACE_BOOT_FIRST_ADV);
+    }
+
+#if ADV_SYNC_ENABLED
+    measurement_adv_sync();
+#endif
+}
+
+#if SLOTTED_ADV_ENABLED
+// Start of the slot of this device. Slow advertising is started again so that its event is sent now.
+// Otherwise the stack adds 0 - 10 ms random delay to every event and the delays pile up over the slot.
+// Advertising is started on the SoftDevice, not by ble_advertising_start(), so no BLE_ADV_EVT_SLOW is raised.
+// The slow mode goes on, and the charge estimation counts an event per slow interval, which is the one of the slot.
+static void adv_slot_handler()
+{
+    uint32_t err_code;
+    ble_gap_adv_params_t adv_params;
+
+    if (!m_is_slow_advertising || p_enble_instance->conn_handle != BLE_CONN_HANDLE_INVALID)
+    {
+        return;
+    }
+
+    err_code = sd_ble_gap_adv_stop();
+    if (err_code != NRF_SUCCESS && err_code != NRF_ERROR_INVALID_STATE)
+    {
+        APP_ERROR_CHECK(err_code);
+    }
+
+    memset(&adv_params, 0, sizeof(adv_params));
+    adv_params.type = BLE_GAP_ADV_TYPE_ADV_IND;
+    adv_params.fp = BLE_GAP_ADV_FP_ANY;
+    adv_params.interval = APP_ADV_SLOT_INTERVAL;
+    adv_params.timeout = APP_ADV_SLOW_TIMEOUT_IN_SECONDS;
+
+    err_code = sd_ble_gap_adv_start(&adv_params);
+    APP_ERROR_CHECK(err_code);
+
+    adv_sync_adv_restart();
+}
+#endif
+
+#if RELAY_ENABLED
+// This function is executed in the main loop through the scheduler.
+static void relay_frame_update_handler()
+{
+    NRF_LOG_DEBUG("relay reports %u, duplicates %u\n", relay_stats_get()->report_cnt, relay_stats_get()->duplicate_cnt);
+
+    uint32_t err_code = advertising_update_data();
+    APP_ERROR_CHECK(err_code);
+}
+#endif
+
 static uint32_t peripheral_init()
 {
     uint32_t err_code;
@@ -307,14 +1094,53 @@ static uint32_t peripheral_init()
         return err_code;
     }
 
-    err_code = button_init(button_event_handler);
-    if (err_code != NRF_SUCCESS)
+#if APP_CONFIG_BUTTON_ENABLED
+    err_code = button_init(button_event_handler, button_long_press_event_handler);
+#endif
+    return err_code;
+}
+
+void app_enble_on_measurement_read_evt()
+{
+    NRF_LOG_INFO("on-demand measurement is requested\n");
+
+#if AGGREGATE_ENABLED
+    // The peer gets the aggregate up to this measurement.
+    m_is_report_requested = true;
+#endif
+
+    // If a measurement is already running, the read is replied when it finishes.
+    if (m_is_measuring)
     {
-        return err_code;
+        return;
     }
 
-    err_code = sensor_init(sensor_data_handler);
-    return err_code;
+    start_measuring();
+}
+
+void app_enble_on_command_evt(uint8_t command)
+{
+    NRF_LOG_INFO("command %u is received\n", command);
+
+    switch (command)
+    {
+    case BLE_ENBLE_COMMAND_HIBERNATE:
+        hibernation_request();
+        break;
+
+    case BLE_ENBLE_COMMAND_CHARGE_RESET:
+        charge_reset();
+        break;
+
+    default:
+        break;
+    }
+}
+
+void app_enble_on_disconnect_evt()
+{
+    m_is_disconnect_pending = false;
+    hibernation_enter();
 }
 
 void app_enble_on_device_id_update_evt(uint16_t new_value)
@@ -327,6 +1153,15 @@ void app_enble_on_device_id_update_evt(uint16_t new_value)
 
     m_device_id = new_value;
 
+#if RELAY_ENABLED
+    relay_own_device_id_set(m_device_id);
+#endif
+
+#if SLOTTED_ADV_ENABLED
+    err_code = adv_slot_start(m_device_id);
+    APP_ERROR_CHECK(err_code);
+#endif
+
     err_code = advertising_update_data();
     APP_ERROR_CHECK(err_code);
 
@@ -343,13 +1178,98 @@ void app_enble_on_period_update_evt(uint16_t new_value)
 
     m_measurement_period = new_value;
 
-    err_code = app_timer_stop(m_meaurement_timer_id);
+    err_code = measurement_timer_restart();
     APP_ERROR_CHECK(err_code);
 
-    err_code = app_timer_start(m_meaurement_timer_id, APP_TIMER_TICKS(m_measurement_period * 1000, 0), NULL);
+    save_nonvolatile_data();
+}
+
+void app_enble_on_time_update_evt(uint32_t epoch_s, uint16_t epoch_ms)
+{
+    uint32_t err_code;
+
+    NRF_LOG_INFO("time is updated %u\n", epoch_s);
+
+    wallclock_sync(epoch_s, epoch_ms);
+
+    if (m_is_hibernation_requested)
+    {
+        return;
+    }
+
+    err_code = measurement_timer_restart();
     APP_ERROR_CHECK(err_code);
 
-    save_nonvolatile_data();
+#if SLOTTED_ADV_ENABLED
+    // Align the slot to the new time. The drift since the last sync is removed here.
+    err_code = adv_slot_start(m_device_id);
+    APP_ERROR_CHECK(err_code);
+#endif
+}
+
+void app_enble_on_tx_power_update_evt(int8_t new_value)
+{
+    uint32_t err_code;
+
+    NRF_LOG_INFO("TX power %d dBm is recommended\n", new_value);
+
+    // A recommendation of the same level only feeds the watchdog.
+    if (!txpower_recommend(new_value))
+    {
+        return;
+    }
+
+    tx_power_update();
+
+    err_code = advertising_update_data();
+    APP_ERROR_CHECK(err_code);
+}
+
+#if TRACE_ENABLED
+void app_enble_on_diagnostics_select_evt(uint8_t stage)
+{
+    if (stage == BLE_ENBLE_DIAGNOSTICS_RESET)
+    {
+        trace_reset();
+    }
+    else if (stage < TRACE_STAGE_CNT || stage == BLE_ENBLE_DIAGNOSTICS_RAM || stage == BLE_ENBLE_DIAGNOSTICS_BOOT)
+    {
+        m_diagnostics_select = stage;
+    }
+    else
+    {
+        return;
+    }
+
+    diagnostics_update();
+}
+#endif
+
+void app_enble_on_alarm_update_evt(const uint8_t *p_data)
+{
+    uint32_t err_code;
+    uint8_t current_data[SENSOR_CHANNEL_CNT * ALARM_THRESHOLD_DATA_LEN];
+
+    alarm_threshold_serialize(current_data);
+    if (memcmp(current_data, p_data, sizeof(current_data)) == 0)
+    {
+        return;
+    }
+
+    NRF_LOG_INFO("alarm thresholds are updated\n");
+
+    led_blink(100);
+
+    alarm_threshold_deserialize(p_data);
+
+    err_code = measurement_timer_restart();
+    APP_ERROR_CHECK(err_code);
+
+    err_code = advertising_update_data();
+    APP_ERROR_CHECK(err_code);
+
+    err_code = save_alarm_data();
+    APP_ERROR_CHECK(err_code);
 }
 
 uint32_t app_enble_init(ble_enble_t *m_enble)
@@ -358,11 +1278,45 @@ uint32_t app_enble_init(ble_enble_t *m_enble)
 
     p_enble_instance = m_enble;
 
-    m_is_first_measure = true;
-    m_is_measuring = false;
+    // m_is_measuring is set by app_enble_sensor_init() before.
+    m_is_slow_advertising = false;
+    m_is_hibernation_requested = false;
+    m_is_disconnect_pending = false;
+    m_is_fds_backup_data_valid = false;
+    m_fds_write_pending_cnt = 0;
+    memset(m_fds_retry, 0, sizeof(m_fds_retry));
+    m_is_fds_gc_running = false;
+    m_is_fds_gc_requested = false;
+
+    // Reset reason is kept over resets until it is cleared.
+    uint32_t reset_reason;
+    err_code = sd_power_reset_reason_get(&reset_reason);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    err_code = sd_power_reset_reason_clr(reset_reason);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    NRF_LOG_INFO("reset reason 0x%08x\n", reset_reason);
+
+    err_code = fds_register(fds_evt_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
 
     load_nonvolatile_data();
 
+    alarm_init();
+    err_code = load_alarm_data();
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
     err_code = ble_enble_update_device_id(p_enble_instance, m_device_id);
     if (err_code != NRF_SUCCESS)
     {
@@ -381,28 +1335,162 @@ uint32_t app_enble_init(ble_enble_t *m_enble)
         return err_code;
     }
 
-    if (button_is_pushed())
+    // The counters start from zero only by an explicit action, as RESETREAS is 0 after both a power-on and a brown-out.
+    bool is_charge_reset = false;
+#if APP_CONFIG_BUTTON_ENABLED
+    // The button is still pushed when the device is woken up from hibernation by it.
+    bool is_woken_up = (reset_reason & POWER_RESETREAS_OFF_Msk) != 0;
+    if (!is_woken_up && button_is_pushed())
     {
+        is_charge_reset = true;
         err_code = set_default_nonvolatile_data();
         if (err_code != NRF_SUCCESS)
         {
             return err_code;
         }
+        err_code = set_default_alarm_data();
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+#if ENBLE_USE_PEER_MANAGER
         err_code = pm_peers_delete();
         if (err_code != NRF_SUCCESS)
         {
             return err_code;
         }
+#endif
+    }
+#endif
+    err_code = period_timer_init(measurement_timer_evt_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    wallclock_init();
+
+    if (!is_charge_reset && load_charge_data())
+    {
+        charge_init(APP_ADV_SLOW_INTERVAL_MS, APP_ADV_FAST_INTERVAL_MS, &m_fds_charge_data);
+        NRF_LOG_INFO("charge counters are loaded\n");
+    }
+    else
+    {
+        charge_init(APP_ADV_SLOW_INTERVAL_MS, APP_ADV_FAST_INTERVAL_MS, NULL);
+    }
+    if (is_charge_reset)
+    {
+        err_code = save_charge_data();
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+    m_charge_saved_uptime_s = charge_counters_get()->uptime_s;
+
+    err_code = txpower_init(load_tx_power_data());
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code = ble_enble_update_tx_power(p_enble_instance, txpower_get());
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+#if RELAY_ENABLED
+    err_code = relay_init(m_device_id, relay_frame_update_handler, app_enble_on_time_update_evt);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+#endif
+
+#if SLOTTED_ADV_ENABLED
+    // The slot is scheduled by the first time sync.
+    err_code = adv_slot_init(APP_ADV_SLOW_INTERVAL_MS, adv_slot_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+#endif
+
+    // Advertising has not started yet. Radio notification must be configured before it.
+    err_code = adv_sync_init(APP_ADV_SLOW_INTERVAL_MS, ADV_SYNC_LEAD_TIME, adv_sync_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    uint8_t alarm_data[SENSOR_CHANNEL_CNT * ALARM_THRESHOLD_DATA_LEN];
+    alarm_threshold_serialize(alarm_data);
+    err_code = ble_enble_update_alarm(p_enble_instance, alarm_data);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+#if AGGREGATE_ENABLED
+    m_is_report_requested = false;
+    aggregate_reset();
+    memset(m_aggregate_data, 0, sizeof(m_aggregate_data));
+#endif
+
+    // The first measurement has been started by app_enble_sensor_init().
+    err_code = measurement_timer_restart();
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    // Advertise right away with the no data flag, and in fast mode
+    // so that the first measurement data reach scanners soon after it finishes.
+    err_code = advertising_update_data();
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
     }
-    err_code = app_timer_create(&m_meaurement_timer_id, APP_TIMER_MODE_REPEATED, measurement_timer_handler);
+
+    err_code = ble_advertising_start(BLE_ADV_MODE_FAST);
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
     }
 
-    err_code = app_timer_start(m_meaurement_timer_id, APP_TIMER_TICKS(FIRSTTIME_MEASUREMENT_DELAY * 1000, 0), NULL);
+#if RELAY_ENABLED
+    // The observer role scans at a low duty cycle concurrently with advertising and a connection.
+    err_code = relay_start();
+#endif
 
     led_blink(500);
 
     return err_code;
+}
+
+// Call this before the SoftDevice is enabled.
+// The first measurement runs while the SoftDevice and the peer manager are initialized.
+// Its result is handled in the main loop after app_enble_init().
+// Only the conversion overlaps them. The calibration of BME280 is read here by blocking SPI before,
+// as sd_softdevice_enable() is an SVC call and blocks the interrupts of the application until the LFXO runs.
+// It takes about 3 ms, mostly the start-up time of BME280, short against the start-up of the LFXO.
+uint32_t app_enble_sensor_init()
+{
+    uint32_t err_code;
+
+    m_has_measurement_data = false;
+
+    trace_init();
+
+    err_code = sensor_init(sensor_data_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    m_is_measuring = true;
+
+    return sensor_start_measuring();
 }
\ No newline at end of file
@@ -4,8 +4,22 @@
 #include <stdint.h>
 #include "ble_enble.h"
 
+// Set 0 by the Makefile (make PEER_MANAGER=0) to build without bonding.
+// All characteristics are open, so the device works without it.
+#ifndef ENBLE_USE_PEER_MANAGER
+#define ENBLE_USE_PEER_MANAGER 1
+#endif
+
+uint32_t app_enble_sensor_init();
 uint32_t app_enble_init(ble_enble_t *m_enble);
 void app_enble_on_period_update_evt(uint16_t new_value);
 void app_enble_on_device_id_update_evt(uint16_t new_value);
+void app_enble_on_measurement_read_evt();
+void app_enble_on_command_evt(uint8_t command);
+void app_enble_on_alarm_update_evt(const uint8_t *p_data);
+void app_enble_on_time_update_evt(uint32_t epoch_s, uint16_t epoch_ms);
+void app_enble_on_diagnostics_select_evt(uint8_t stage);
+void app_enble_on_tx_power_update_evt(int8_t new_value);
+void app_enble_on_disconnect_evt();
 
 #endif
\ No newline at end of file
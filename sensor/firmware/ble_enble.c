@@ -2,16 +2,29 @@
 #include <string.h>
 #include "nordic_common.h"
 #include "ble_srv_common.h"
+#include "app_error.h"
 
 #define UUID_DEVICE_ID 0x0011
 #define UUID_PERIOD 0x0012
+#define UUID_COMMAND 0x0013
+#define UUID_ALARM 0x0014
+#define UUID_TIME 0x0015
+#define UUID_DIAGNOSTICS 0x0016
+#define UUID_TX_POWER 0x0017
 #define UUID_BATTERY 0x0021
 #define UUID_TEMPERATURE 0x0022
 #define UUID_HUMIDITY 0x0023
 #define UUID_PRESSURE 0x0024
+#define UUID_CHANNELS 0x0025
+#define UUID_CHARGE 0x0026
+#define UUID_AGGREGATE 0x0027
 
 #define CHAR_VALUE_LEN_DEVICE_ID 2
 #define CHAR_VALUE_LEN_PERIOD 2
+#define CHAR_VALUE_LEN_COMMAND 1
+#define CHAR_VALUE_LEN_TIME 6
+#define CHAR_VALUE_LEN_DIAGNOSTICS_SELECT 1
+#define CHAR_VALUE_LEN_TX_POWER 1
 #define CHAR_VALUE_LEN_BATTERY 2
 #define CHAR_VALUE_LEN_TEMPERATURE 2
 #define CHAR_VALUE_LEN_HUMIDITY 2
@@ -31,6 +44,7 @@ typedef struct
     uint16_t uuid;
     ble_gatt_char_props_t props;
     uint16_t len;
+    uint8_t rd_auth;
 } char_config_t;
 
 /**@brief Function for handling the @ref BLE_GAP_EVT_CONNECTED event from the S110 SoftDevice.
@@ -52,6 +66,7 @@ static void on_disconnect(ble_enble_t *p_enble, ble_evt_t *p_ble_evt)
 {
     UNUSED_PARAMETER(p_ble_evt);
     p_enble->conn_handle = BLE_CONN_HANDLE_INVALID;
+    p_enble->is_measurement_read_pending = false;
 }
 
 /**@brief Function for handling the @ref BLE_GATTS_EVT_WRITE event from the S110 SoftDevice.
@@ -79,12 +94,111 @@ static void on_write(ble_enble_t *p_enble, ble_evt_t *p_ble_evt)
         uint16_t *new_value = (uint16_t *)p_evt_write->data;
         p_enble->period_update_handler(p_enble, *new_value);
     }
+    else if (
+        p_evt_write->handle == p_enble->command_handles.value_handle &&
+        p_evt_write->len == CHAR_VALUE_LEN_COMMAND &&
+        p_enble->command_handler != NULL)
+    {
+        p_enble->command_handler(p_enble, p_evt_write->data[0]);
+    }
+    else if (
+        p_evt_write->handle == p_enble->alarm_handles.value_handle &&
+        p_evt_write->offset == 0 &&
+        p_evt_write->len == p_enble->channel_cnt * BLE_ENBLE_ALARM_DATA_LEN &&
+        p_enble->alarm_update_handler != NULL)
+    {
+        p_enble->alarm_update_handler(p_enble, p_evt_write->data);
+    }
+    else if (
+        p_evt_write->handle == p_enble->time_handles.value_handle &&
+        p_evt_write->len == CHAR_VALUE_LEN_TIME &&
+        p_enble->time_update_handler != NULL)
+    {
+        uint32_t epoch_s = uint32_decode(&p_evt_write->data[0]);
+        uint16_t epoch_ms = uint16_decode(&p_evt_write->data[4]);
+        p_enble->time_update_handler(p_enble, epoch_s, epoch_ms);
+    }
+    else if (
+        p_evt_write->handle == p_enble->diagnostics_handles.value_handle &&
+        p_evt_write->len == CHAR_VALUE_LEN_DIAGNOSTICS_SELECT &&
+        p_enble->diagnostics_select_handler != NULL)
+    {
+        p_enble->diagnostics_select_handler(p_enble, p_evt_write->data[0]);
+    }
+    else if (
+        p_evt_write->handle == p_enble->tx_power_handles.value_handle &&
+        p_evt_write->len == CHAR_VALUE_LEN_TX_POWER &&
+        p_enble->tx_power_update_handler != NULL)
+    {
+        p_enble->tx_power_update_handler(p_enble, (int8_t)p_evt_write->data[0]);
+    }
     else
     {
         // Do Nothing. This event is not relevant for this service.
     }
 }
 
+/**@brief Function for checking if a handle belongs to one of the measurement characteristics.
+ *
+ * @param[in] p_enble     ENBLE Service structure.
+ * @param[in] handle      Attribute handle to be checked.
+ */
+static bool is_measurement_handle(ble_enble_t *p_enble, uint16_t handle)
+{
+    return handle == p_enble->battery_handles.value_handle ||
+           handle == p_enble->temperature_handles.value_handle ||
+           handle == p_enble->humidity_handles.value_handle ||
+           handle == p_enble->pressure_handles.value_handle ||
+           (p_enble->channel_cnt > 1 && handle == p_enble->channels_handles.value_handle);
+}
+
+/**@brief Function for replying a read authorization request with the value stored in the attribute table.
+ *
+ * @param[in] p_enble     ENBLE Service structure.
+ */
+static uint32_t reply_read_authorize(ble_enble_t *p_enble)
+{
+    ble_gatts_rw_authorize_reply_params_t auth_reply;
+
+    memset(&auth_reply, 0, sizeof(auth_reply));
+    auth_reply.type = BLE_GATTS_AUTHORIZE_TYPE_READ;
+    auth_reply.params.read.gatt_status = BLE_GATT_STATUS_SUCCESS;
+    auth_reply.params.read.update = 0;
+
+    return sd_ble_gatts_rw_authorize_reply(p_enble->conn_handle, &auth_reply);
+}
+
+/**@brief Function for handling the @ref BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST event from the S110 SoftDevice.
+ *
+ * @details A read of a measurement characteristic is held until a fresh measurement is finished.
+ *          The reply is sent by @ref ble_enble_reply_measurement_read.
+ *
+ * @param[in] p_enble     ENBLE Service structure.
+ * @param[in] p_ble_evt Pointer to the event received from BLE stack.
+ */
+static void on_rw_authorize_request(ble_enble_t *p_enble, ble_evt_t *p_ble_evt)
+{
+    uint32_t err_code;
+    ble_gatts_evt_rw_authorize_request_t *p_req = &p_ble_evt->evt.gatts_evt.params.authorize_request;
+
+    if (p_req->type != BLE_GATTS_AUTHORIZE_TYPE_READ ||
+        !is_measurement_handle(p_enble, p_req->request.read.handle))
+    {
+        // Do Nothing. This event is not relevant for this service.
+        return;
+    }
+
+    if (p_enble->measurement_read_handler == NULL)
+    {
+        err_code = reply_read_authorize(p_enble);
+        APP_ERROR_CHECK(err_code);
+        return;
+    }
+
+    p_enble->is_measurement_read_pending = true;
+    p_enble->measurement_read_handler(p_enble);
+}
+
 /**@brief Function for adding a characteristic.
  *
  * @param[in] p_enble       ENBLE Service structure.
@@ -111,10 +225,17 @@ static uint32_t add_char(ble_enble_t *p_enble, const char_config_t *char_config,
     memset(&attr_md, 0, sizeof(attr_md));
 
     BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.read_perm);
-    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.write_perm);
+    if (char_config->props.write || char_config->props.write_wo_resp)
+    {
+        BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.write_perm);
+    }
+    else
+    {
+        BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.write_perm);
+    }
 
     attr_md.vloc = BLE_GATTS_VLOC_STACK;
-    attr_md.rd_auth = 0;
+    attr_md.rd_auth = char_config->rd_auth;
     attr_md.wr_auth = 0;
     attr_md.vlen = 0;
 
@@ -172,6 +293,10 @@ void ble_enble_on_ble_evt(ble_enble_t *p_enble, ble_evt_t *p_ble_evt)
         on_write(p_enble, p_ble_evt);
         break;
 
+    case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+        on_rw_authorize_request(p_enble, p_ble_evt);
+        break;
+
     default:
         // No implementation needed.
         break;
@@ -193,6 +318,15 @@ uint32_t ble_enble_init(ble_enble_t *p_enble, const ble_enble_init_t *p_enble_in
     p_enble->conn_handle = BLE_CONN_HANDLE_INVALID;
     p_enble->device_id_update_handler = p_enble_init->device_id_update_handler;
     p_enble->period_update_handler = p_enble_init->period_update_handler;
+    p_enble->measurement_read_handler = p_enble_init->measurement_read_handler;
+    p_enble->command_handler = p_enble_init->command_handler;
+    p_enble->alarm_update_handler = p_enble_init->alarm_update_handler;
+    p_enble->time_update_handler = p_enble_init->time_update_handler;
+    p_enble->diagnostics_select_handler = p_enble_init->diagnostics_select_handler;
+    p_enble->tx_power_update_handler = p_enble_init->tx_power_update_handler;
+    p_enble->is_measurement_read_pending = false;
+    p_enble->channel_cnt = p_enble_init->channel_cnt;
+    p_enble->has_aggregate = p_enble_init->has_aggregate;
 
     /**@snippet [Adding proprietary Service to S110 SoftDevice] */
     // Add a custom base UUID.
@@ -218,32 +352,112 @@ uint32_t ble_enble_init(ble_enble_t *p_enble, const ble_enble_init_t *p_enble_in
     char_config_t char_config;
     ble_gatt_char_props_t char_props;
 
+    // The configuration characteristics are read-only if the update handler is NULL.
     memset(&char_props, 0, sizeof(ble_gatt_char_props_t));
     char_props.read = 1;
-    char_props.write = 1;
-    char_props.write_wo_resp = 1;
+    char_props.write = (p_enble->device_id_update_handler != NULL);
+    char_props.write_wo_resp = char_props.write;
 
     char_config.p_handles = &p_enble->device_id_handles;
     char_config.uuid = UUID_DEVICE_ID;
     char_config.len = CHAR_VALUE_LEN_DEVICE_ID;
     char_config.props = char_props;
+    char_config.rd_auth = 0;
     err_code = add_char(p_enble, &char_config, "DevideID");
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
     }
 
+    char_props.write = (p_enble->period_update_handler != NULL);
+    char_props.write_wo_resp = char_props.write;
+
     char_config.p_handles = &p_enble->period_handles;
     char_config.uuid = UUID_PERIOD;
     char_config.len = CHAR_VALUE_LEN_PERIOD;
+    char_config.props = char_props;
     err_code = add_char(p_enble, &char_config, "Period");
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
     }
 
+    // Write only, so it is not added without the handler.
+    if (p_enble->command_handler != NULL)
+    {
+        memset(&char_props, 0, sizeof(ble_gatt_char_props_t));
+        char_props.write = 1;
+
+        char_config.p_handles = &p_enble->command_handles;
+        char_config.uuid = UUID_COMMAND;
+        char_config.len = CHAR_VALUE_LEN_COMMAND;
+        char_config.props = char_props;
+        err_code = add_char(p_enble, &char_config, "Command");
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
     memset(&char_props, 0, sizeof(ble_gatt_char_props_t));
     char_props.read = 1;
+    char_props.write = (p_enble->alarm_update_handler != NULL);
+
+    char_config.p_handles = &p_enble->alarm_handles;
+    char_config.uuid = UUID_ALARM;
+    char_config.len = p_enble->channel_cnt * BLE_ENBLE_ALARM_DATA_LEN;
+    char_config.props = char_props;
+    err_code = add_char(p_enble, &char_config, "Alarm");
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    char_props.write = (p_enble->time_update_handler != NULL);
+
+    char_config.p_handles = &p_enble->time_handles;
+    char_config.uuid = UUID_TIME;
+    char_config.len = CHAR_VALUE_LEN_TIME;
+    char_config.props = char_props;
+    err_code = add_char(p_enble, &char_config, "Time");
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    char_props.write = (p_enble->tx_power_update_handler != NULL);
+
+    char_config.p_handles = &p_enble->tx_power_handles;
+    char_config.uuid = UUID_TX_POWER;
+    char_config.len = CHAR_VALUE_LEN_TX_POWER;
+    char_config.props = char_props;
+    err_code = add_char(p_enble, &char_config, "TxPower");
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    // Only a firmware with the tracing has this characteristic.
+    if (p_enble->diagnostics_select_handler != NULL)
+    {
+        char_props.write = 1;
+
+        char_config.p_handles = &p_enble->diagnostics_handles;
+        char_config.uuid = UUID_DIAGNOSTICS;
+        char_config.len = BLE_ENBLE_DIAGNOSTICS_DATA_LEN;
+        char_config.props = char_props;
+        err_code = add_char(p_enble, &char_config, "Diagnostics");
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
+    // Reads of the measurement characteristics are authorized by the application
+    // in order to reply a value measured on demand.
+    memset(&char_props, 0, sizeof(ble_gatt_char_props_t));
+    char_props.read = 1;
+    char_config.rd_auth = 1;
 
     char_config.p_handles = &p_enble->battery_handles;
     char_config.uuid = UUID_BATTERY;
@@ -285,6 +499,47 @@ uint32_t ble_enble_init(ble_enble_t *p_enble, const ble_enble_init_t *p_enble_in
         return err_code;
     }
 
+    // The characteristics above have channel 0. All channels are in this characteristic.
+    if (p_enble->channel_cnt > 1)
+    {
+        char_config.p_handles = &p_enble->channels_handles;
+        char_config.uuid = UUID_CHANNELS;
+        char_config.len = p_enble->channel_cnt * BLE_ENBLE_CHANNEL_DATA_LEN;
+        char_config.props = char_props;
+        err_code = add_char(p_enble, &char_config, "Channels");
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
+    // The estimation of the consumed charge is updated at every measurement and read without waiting.
+    char_config.rd_auth = 0;
+
+    char_config.p_handles = &p_enble->charge_handles;
+    char_config.uuid = UUID_CHARGE;
+    char_config.len = BLE_ENBLE_CHARGE_DATA_LEN;
+    char_config.props = char_props;
+    err_code = add_char(p_enble, &char_config, "Charge");
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    // The aggregate is updated at the end of each reporting period, not by an on-demand measurement.
+    if (p_enble->has_aggregate)
+    {
+        char_config.p_handles = &p_enble->aggregate_handles;
+        char_config.uuid = UUID_AGGREGATE;
+        char_config.len = BLE_ENBLE_AGGREGATE_DATA_LEN;
+        char_config.props = char_props;
+        err_code = add_char(p_enble, &char_config, "Aggregate");
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
     return NRF_SUCCESS;
 }
 
@@ -298,6 +553,26 @@ uint32_t ble_enble_update_period(ble_enble_t *p_enble, uint16_t new_value)
     return update_char_value(p_enble, &p_enble->period_handles, (const uint8_t *)&new_value, 2);
 }
 
+uint32_t ble_enble_update_alarm(ble_enble_t *p_enble, const uint8_t *p_data)
+{
+    return update_char_value(p_enble, &p_enble->alarm_handles, p_data, p_enble->channel_cnt * BLE_ENBLE_ALARM_DATA_LEN);
+}
+
+uint32_t ble_enble_update_time(ble_enble_t *p_enble, uint32_t epoch_s, uint16_t epoch_ms)
+{
+    uint8_t data[CHAR_VALUE_LEN_TIME];
+
+    uint32_encode(epoch_s, &data[0]);
+    uint16_encode(epoch_ms, &data[4]);
+
+    return update_char_value(p_enble, &p_enble->time_handles, data, CHAR_VALUE_LEN_TIME);
+}
+
+uint32_t ble_enble_update_tx_power(ble_enble_t *p_enble, int8_t new_value)
+{
+    return update_char_value(p_enble, &p_enble->tx_power_handles, (const uint8_t *)&new_value, CHAR_VALUE_LEN_TX_POWER);
+}
+
 uint32_t ble_enble_update_battery(ble_enble_t *p_enble, uint16_t new_value)
 {
     return update_char_value(p_enble, &p_enble->battery_handles, (const uint8_t *)&new_value, 2);
@@ -317,3 +592,55 @@ uint32_t ble_enble_update_pressure(ble_enble_t *p_enble, uint16_t new_value)
 {
     return update_char_value(p_enble, &p_enble->pressure_handles, (const uint8_t *)&new_value, 2);
 }
+
+uint32_t ble_enble_update_channels(ble_enble_t *p_enble, const uint8_t *p_data)
+{
+    if (p_enble->channel_cnt <= 1)
+    {
+        return NRF_SUCCESS;
+    }
+
+    return update_char_value(p_enble, &p_enble->channels_handles, p_data, p_enble->channel_cnt * BLE_ENBLE_CHANNEL_DATA_LEN);
+}
+
+uint32_t ble_enble_update_diagnostics(ble_enble_t *p_enble, const uint8_t *p_data)
+{
+    if (p_enble->diagnostics_select_handler == NULL)
+    {
+        return NRF_SUCCESS;
+    }
+
+    return update_char_value(p_enble, &p_enble->diagnostics_handles, p_data, BLE_ENBLE_DIAGNOSTICS_DATA_LEN);
+}
+
+uint32_t ble_enble_update_charge(ble_enble_t *p_enble, const uint8_t *p_data)
+{
+    return update_char_value(p_enble, &p_enble->charge_handles, p_data, BLE_ENBLE_CHARGE_DATA_LEN);
+}
+
+uint32_t ble_enble_update_aggregate(ble_enble_t *p_enble, const uint8_t *p_data)
+{
+    if (!p_enble->has_aggregate)
+    {
+        return NRF_SUCCESS;
+    }
+
+    return update_char_value(p_enble, &p_enble->aggregate_handles, p_data, BLE_ENBLE_AGGREGATE_DATA_LEN);
+}
+
+uint32_t ble_enble_reply_measurement_read(ble_enble_t *p_enble)
+{
+    if (!p_enble->is_measurement_read_pending)
+    {
+        return NRF_SUCCESS;
+    }
+
+    p_enble->is_measurement_read_pending = false;
+
+    if (p_enble->conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return NRF_SUCCESS;
+    }
+
+    return reply_read_authorize(p_enble);
+}
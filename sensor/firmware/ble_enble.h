@@ -8,12 +8,46 @@
 
 #define BLE_UUID_ENBLE_SERVICE 0x0001
 
+/**@brief Commands written to the Command characteristic. */
+#define BLE_ENBLE_COMMAND_HIBERNATE 0x01
+#define BLE_ENBLE_COMMAND_CHARGE_RESET 0x02
+
+/**@brief Length of a channel in the Channels characteristic (temperature, humidity and pressure). */
+#define BLE_ENBLE_CHANNEL_DATA_LEN 6
+
+/**@brief Length of a channel in the Alarm characteristic (temperature low, temperature high and humidity high). */
+#define BLE_ENBLE_ALARM_DATA_LEN 6
+
+/**@brief Length of the Diagnostics characteristic (histogram of a stage). */
+#define BLE_ENBLE_DIAGNOSTICS_DATA_LEN 41
+
+/**@brief Length of the Charge characteristic (consumed charge, remaining lifetime and event counters). */
+#define BLE_ENBLE_CHARGE_DATA_LEN 40
+
+/**@brief Length of the Aggregate characteristic (sample count and min, max and standard deviation of channel 0). */
+#define BLE_ENBLE_AGGREGATE_DATA_LEN 20
+
+/**@brief Value written to the Diagnostics characteristic to clear all histograms. */
+#define BLE_ENBLE_DIAGNOSTICS_RESET 0xff
+
+/**@brief Value written to the Diagnostics characteristic to select the RAM usage. */
+#define BLE_ENBLE_DIAGNOSTICS_RAM 0x80
+
+/**@brief Value written to the Diagnostics characteristic to select the boot milestones. */
+#define BLE_ENBLE_DIAGNOSTICS_BOOT 0x81
+
 /* Forward declaration of the ble_enble_t type. */
 typedef struct ble_enble_s ble_enble_t;
 
 /**@brief ENBLE Service event handler type. */
 typedef void (*ble_enble_device_id_update_handler_t)(ble_enble_t *p_enble, uint16_t new_value);
 typedef void (*ble_enble_period_update_handler_t)(ble_enble_t *p_enble, uint16_t new_value);
+typedef void (*ble_enble_measurement_read_handler_t)(ble_enble_t *p_enble);
+typedef void (*ble_enble_command_handler_t)(ble_enble_t *p_enble, uint8_t command);
+typedef void (*ble_enble_alarm_update_handler_t)(ble_enble_t *p_enble, const uint8_t *p_data);
+typedef void (*ble_enble_time_update_handler_t)(ble_enble_t *p_enble, uint32_t epoch_s, uint16_t epoch_ms);
+typedef void (*ble_enble_diagnostics_select_handler_t)(ble_enble_t *p_enble, uint8_t stage);
+typedef void (*ble_enble_tx_power_update_handler_t)(ble_enble_t *p_enble, int8_t new_value);
 
 /**@brief ENBLE Service initialization structure.
  *
@@ -22,8 +56,16 @@ typedef void (*ble_enble_period_update_handler_t)(ble_enble_t *p_enble, uint16_t
  */
 typedef struct
 {
-    ble_enble_device_id_update_handler_t device_id_update_handler; /**< Event handler to be called for handling received new device id. */
-    ble_enble_period_update_handler_t period_update_handler;       /**< Event handler to be called for handling received new period. */
+    ble_enble_device_id_update_handler_t device_id_update_handler; /**< Event handler to be called for handling received new device id. The characteristic is read-only if it is NULL. */
+    ble_enble_period_update_handler_t period_update_handler;       /**< Event handler to be called for handling received new period. The characteristic is read-only if it is NULL. */
+    ble_enble_measurement_read_handler_t measurement_read_handler; /**< Event handler to be called when a peer reads a measurement characteristic. */
+    ble_enble_command_handler_t command_handler;                   /**< Event handler to be called for handling received command. The Command characteristic is added if it is not NULL. */
+    ble_enble_alarm_update_handler_t alarm_update_handler;         /**< Event handler to be called for handling received alarm thresholds. The characteristic is read-only if it is NULL. */
+    ble_enble_time_update_handler_t time_update_handler;           /**< Event handler to be called for handling received time. The characteristic is read-only if it is NULL. */
+    ble_enble_diagnostics_select_handler_t diagnostics_select_handler; /**< Event handler to be called when a stage is selected. The Diagnostics characteristic is added if it is not NULL. */
+    ble_enble_tx_power_update_handler_t tx_power_update_handler;   /**< Event handler to be called for handling received recommended TX power. The characteristic is read-only if it is NULL. */
+    uint8_t channel_cnt;                                           /**< Number of sensor channels. The Channels characteristic is added if it is more than 1. */
+    bool has_aggregate;                                            /**< The Aggregate characteristic is added if it is true. */
 } ble_enble_init_t;
 
 /**@brief ENBLE Service structure.
@@ -36,13 +78,30 @@ struct ble_enble_s
     uint16_t service_handle;                                       /**< Handle of ENBLE Service (as provided by the S110 SoftDevice). */
     ble_gatts_char_handles_t device_id_handles;                    /**< Handles related to the DeviceID characteristic (as provided by the S110 SoftDevice). */
     ble_gatts_char_handles_t period_handles;                       /**< Handles related to the Period characteristic (as provided by the S110 SoftDevice). */
+    ble_gatts_char_handles_t command_handles;                      /**< Handles related to the Command characteristic (as provided by the S110 SoftDevice). */
+    ble_gatts_char_handles_t alarm_handles;                        /**< Handles related to the Alarm characteristic (as provided by the S110 SoftDevice). */
+    ble_gatts_char_handles_t time_handles;                         /**< Handles related to the Time characteristic (as provided by the S110 SoftDevice). */
+    ble_gatts_char_handles_t diagnostics_handles;                  /**< Handles related to the Diagnostics characteristic (as provided by the S110 SoftDevice). */
+    ble_gatts_char_handles_t tx_power_handles;                     /**< Handles related to the TxPower characteristic (as provided by the S110 SoftDevice). */
     ble_gatts_char_handles_t temperature_handles;                  /**< Handles related to the Temperature characteristic (as provided by the S110 SoftDevice). */
     ble_gatts_char_handles_t humidity_handles;                     /**< Handles related to the Humidity characteristic (as provided by the S110 SoftDevice). */
     ble_gatts_char_handles_t pressure_handles;                     /**< Handles related to the Pressure characteristic (as provided by the S110 SoftDevice). */
     ble_gatts_char_handles_t battery_handles;                      /**< Handles related to the Battrery characteristic (as provided by the S110 SoftDevice). */
+    ble_gatts_char_handles_t channels_handles;                     /**< Handles related to the Channels characteristic (as provided by the S110 SoftDevice). */
+    ble_gatts_char_handles_t charge_handles;                       /**< Handles related to the Charge characteristic (as provided by the S110 SoftDevice). */
+    ble_gatts_char_handles_t aggregate_handles;                    /**< Handles related to the Aggregate characteristic (as provided by the S110 SoftDevice). */
+    uint8_t channel_cnt;                                           /**< Number of sensor channels. */
+    bool has_aggregate;                                            /**< True if the service has the Aggregate characteristic. */
     uint16_t conn_handle;                                          /**< Handle of the current connection (as provided by the S110 SoftDevice). BLE_CONN_HANDLE_INVALID if not in a connection. */
     ble_enble_device_id_update_handler_t device_id_update_handler; /**< Event handler to be called for handling received new device id. */
     ble_enble_period_update_handler_t period_update_handler;       /**< Event handler to be called for handling received new period. */
+    ble_enble_measurement_read_handler_t measurement_read_handler; /**< Event handler to be called when a peer reads a measurement characteristic. */
+    ble_enble_command_handler_t command_handler;                   /**< Event handler to be called for handling received command. */
+    ble_enble_alarm_update_handler_t alarm_update_handler;         /**< Event handler to be called for handling received alarm thresholds. */
+    ble_enble_time_update_handler_t time_update_handler;           /**< Event handler to be called for handling received time. */
+    ble_enble_diagnostics_select_handler_t diagnostics_select_handler; /**< Event handler to be called when a stage is selected. */
+    ble_enble_tx_power_update_handler_t tx_power_update_handler;   /**< Event handler to be called for handling received recommended TX power. */
+    bool is_measurement_read_pending;                              /**< True while a read of a measurement characteristic waits for a fresh value. */
 };
 
 /**@brief Function for initializing the ENBLE Service.
@@ -79,11 +138,69 @@ void ble_enble_on_ble_evt(ble_enble_t *p_enble, ble_evt_t *p_ble_evt);
  */
 uint32_t ble_enble_update_device_id(ble_enble_t *p_enble, uint16_t new_value);
 uint32_t ble_enble_update_period(ble_enble_t *p_enble, uint16_t new_value);
+uint32_t ble_enble_update_alarm(ble_enble_t *p_enble, const uint8_t *p_data);
+uint32_t ble_enble_update_time(ble_enble_t *p_enble, uint32_t epoch_s, uint16_t epoch_ms);
+uint32_t ble_enble_update_tx_power(ble_enble_t *p_enble, int8_t new_value);
 uint32_t ble_enble_update_battery(ble_enble_t *p_enble, uint16_t new_value);
 uint32_t ble_enble_update_temperature(ble_enble_t *p_enble, int16_t new_value);
 uint32_t ble_enble_update_humidity(ble_enble_t *p_enble, uint16_t new_value);
 uint32_t ble_enble_update_pressure(ble_enble_t *p_enble, uint16_t new_value);
 
+/**@brief Function for updating the Channels characteristic.
+ *
+ * @details Each channel is BLE_ENBLE_CHANNEL_DATA_LEN bytes of temperature, humidity and pressure in little endian.
+ *          It does nothing if the service has only one channel.
+ *
+ * @param[in] p_enble       Pointer to the ENBLE Service structure.
+ * @param[in] p_data        Serialized data of all channels, channel_cnt * BLE_ENBLE_CHANNEL_DATA_LEN bytes.
+ *
+ * @retval NRF_SUCCESS If the value was updated. Otherwise, an error code is returned.
+ */
+uint32_t ble_enble_update_channels(ble_enble_t *p_enble, const uint8_t *p_data);
+
+/**@brief Function for updating the Charge characteristic.
+ *
+ * @param[in] p_enble       Pointer to the ENBLE Service structure.
+ * @param[in] p_data        Serialized estimation of the consumed charge, BLE_ENBLE_CHARGE_DATA_LEN bytes.
+ *
+ * @retval NRF_SUCCESS If the value was updated. Otherwise, an error code is returned.
+ */
+uint32_t ble_enble_update_charge(ble_enble_t *p_enble, const uint8_t *p_data);
+
+/**@brief Function for updating the Aggregate characteristic.
+ *
+ * @details It does nothing if the service has no Aggregate characteristic.
+ *
+ * @param[in] p_enble       Pointer to the ENBLE Service structure.
+ * @param[in] p_data        Serialized aggregate of the last reporting period, BLE_ENBLE_AGGREGATE_DATA_LEN bytes.
+ *
+ * @retval NRF_SUCCESS If the value was updated. Otherwise, an error code is returned.
+ */
+uint32_t ble_enble_update_aggregate(ble_enble_t *p_enble, const uint8_t *p_data);
+
+/**@brief Function for updating the Diagnostics characteristic.
+ *
+ * @details It does nothing if the service has no Diagnostics characteristic.
+ *
+ * @param[in] p_enble       Pointer to the ENBLE Service structure.
+ * @param[in] p_data        Histogram of the selected stage, BLE_ENBLE_DIAGNOSTICS_DATA_LEN bytes.
+ *
+ * @retval NRF_SUCCESS If the value was updated. Otherwise, an error code is returned.
+ */
+uint32_t ble_enble_update_diagnostics(ble_enble_t *p_enble, const uint8_t *p_data);
+
+/**@brief Function for answering a pending read of a measurement characteristic.
+ *
+ * @details Reads of the measurement characteristics are held by the SoftDevice until this function is called,
+ * so that the peer gets a value measured on demand instead of the last periodic one.
+ * Call this after the measurement characteristics have been updated. It does nothing if no read is pending.
+ *
+ * @param[in] p_enble       Pointer to the ENBLE Service structure.
+ *
+ * @retval NRF_SUCCESS If the reply was sent or no read was pending. Otherwise, an error code is returned.
+ */
+uint32_t ble_enble_reply_measurement_read(ble_enble_t *p_enble);
+
 #endif // BLE_ENBLE_SERVICE_H__
 
 /** @} */
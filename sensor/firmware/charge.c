@@ -0,0 +1,251 @@
+#include "charge.h"
+
+#include <string.h>
+
+#include "app_timer.h"
+#include "app_util.h"
+
+#include "adv_slot.h"
+#include "app_config.h"
+#include "period_timer.h"
+
+#define NRF_LOG_MODULE_NAME "CHARGE"
+#define NRF_LOG_LEVEL 0
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+// Charge per event in nC, from the current waveforms in README (3.0 V, DC/DC off).
+// A connection event and a flash write are not measured yet and estimated from the datasheet.
+#define CHARGE_ADV_EVENT_NC 29400        // 3 channels, same for slow and fast advertising
+#define CHARGE_MEASUREMENT_NC 12210      // measuring (start) + measuring (end)
+#define CHARGE_CONNECTION_EVENT_NC 10000 // an empty packet exchange
+#define CHARGE_FLASH_WRITE_NC 20000      // a record write and a share of the garbage collection
+#define CHARGE_SLEEP_NA 3800             // sleeping current
+
+#define CHARGE_BATTERY_CAPACITY_NC ((uint64_t)CHARGE_BATTERY_CAPACITY_MAH * 3600 * 1000000)
+
+// The stack adds a random delay of 0 - 10 ms to each advertising event, so the events are apart by the interval and this on average.
+// Slotted advertising sends the slow event at the start of the slot without the delay.
+#define ADV_DELAY_MEAN_MS 5
+#if SLOTTED_ADV_ENABLED
+#define ADV_SLOW_DELAY_MEAN_MS 0
+#else
+#define ADV_SLOW_DELAY_MEAN_MS ADV_DELAY_MEAN_MS
+#endif
+
+// The average current is not reliable until the device has run for a while.
+#define LIFETIME_MIN_UPTIME_S 3600
+
+static charge_counters_t m_counters;
+
+static uint64_t m_adv_slow_interval_ticks;
+static uint64_t m_adv_fast_interval_ticks;
+static uint64_t m_conn_interval_ticks;
+
+static charge_adv_mode_t m_adv_mode;
+static bool m_is_connected;
+
+static uint64_t m_last_ticks;
+// Remainders of the time not counted yet in each counter
+static uint64_t m_uptime_ticks;
+static uint64_t m_adv_ticks;
+static uint64_t m_connected_ticks;
+static uint64_t m_connection_event_ticks;
+
+static uint64_t ms_to_ticks(uint32_t ms)
+{
+    return ((uint64_t)ms * APP_TIMER_CLOCK_FREQ) / 1000;
+}
+
+// Count the full seconds and intervals in the time since the last update
+static void counters_update()
+{
+    uint64_t now_ticks = period_timer_ticks_get();
+    uint64_t elapsed_ticks = now_ticks - m_last_ticks;
+
+    m_last_ticks = now_ticks;
+
+    m_uptime_ticks += elapsed_ticks;
+    m_counters.uptime_s += (uint32_t)(m_uptime_ticks / APP_TIMER_CLOCK_FREQ);
+    m_uptime_ticks %= APP_TIMER_CLOCK_FREQ;
+
+    if (m_adv_mode != CHARGE_ADV_MODE_NONE)
+    {
+        bool is_slow = (m_adv_mode == CHARGE_ADV_MODE_SLOW);
+        uint64_t interval_ticks = is_slow ? m_adv_slow_interval_ticks : m_adv_fast_interval_ticks;
+
+        m_adv_ticks += elapsed_ticks;
+        if (is_slow)
+        {
+            m_counters.adv_slow_cnt += (uint32_t)(m_adv_ticks / interval_ticks);
+        }
+        else
+        {
+            m_counters.adv_fast_cnt += (uint32_t)(m_adv_ticks / interval_ticks);
+        }
+        m_adv_ticks %= interval_ticks;
+    }
+
+    if (m_is_connected)
+    {
+        m_connected_ticks += elapsed_ticks;
+        m_counters.connected_s += (uint32_t)(m_connected_ticks / APP_TIMER_CLOCK_FREQ);
+        m_connected_ticks %= APP_TIMER_CLOCK_FREQ;
+
+        m_connection_event_ticks += elapsed_ticks;
+        m_counters.connection_event_cnt += (uint32_t)(m_connection_event_ticks / m_conn_interval_ticks);
+        m_connection_event_ticks %= m_conn_interval_ticks;
+    }
+}
+
+static uint64_t consumed_nc_get()
+{
+    uint64_t adv_cnt = (uint64_t)m_counters.adv_slow_cnt + m_counters.adv_fast_cnt;
+
+    return adv_cnt * CHARGE_ADV_EVENT_NC +
+           (uint64_t)m_counters.measurement_cnt * CHARGE_MEASUREMENT_NC +
+           (uint64_t)m_counters.connection_event_cnt * CHARGE_CONNECTION_EVENT_NC +
+           (uint64_t)m_counters.flash_write_cnt * CHARGE_FLASH_WRITE_NC +
+           (uint64_t)m_counters.uptime_s * CHARGE_SLEEP_NA;
+}
+
+void charge_init(uint32_t adv_slow_interval_ms, uint32_t adv_fast_interval_ms, const charge_counters_t *p_counters)
+{
+    if (p_counters)
+    {
+        m_counters = *p_counters;
+    }
+    else
+    {
+        memset(&m_counters, 0, sizeof(m_counters));
+    }
+
+    m_adv_slow_interval_ticks = ms_to_ticks(adv_slow_interval_ms + ADV_SLOW_DELAY_MEAN_MS);
+    m_adv_fast_interval_ticks = ms_to_ticks(adv_fast_interval_ms + ADV_DELAY_MEAN_MS);
+    m_adv_mode = CHARGE_ADV_MODE_NONE;
+    m_is_connected = false;
+
+    m_last_ticks = period_timer_ticks_get();
+    m_uptime_ticks = 0;
+    m_adv_ticks = 0;
+    m_connected_ticks = 0;
+    m_connection_event_ticks = 0;
+}
+
+void charge_counters_reset()
+{
+    counters_update();
+
+    memset(&m_counters, 0, sizeof(m_counters));
+}
+
+// The first advertising event is sent right after the start.
+void charge_adv_mode_set(charge_adv_mode_t mode)
+{
+    counters_update();
+
+    m_adv_mode = mode;
+    m_adv_ticks = 0;
+
+    if (mode == CHARGE_ADV_MODE_SLOW)
+    {
+        m_counters.adv_slow_cnt++;
+    }
+    else if (mode == CHARGE_ADV_MODE_FAST)
+    {
+        m_counters.adv_fast_cnt++;
+    }
+}
+
+// Advertising stops when a connection is established.
+void charge_on_connected(uint32_t conn_interval_ms)
+{
+    charge_adv_mode_set(CHARGE_ADV_MODE_NONE);
+
+    m_conn_interval_ticks = MAX(ms_to_ticks(conn_interval_ms), 1);
+    m_connected_ticks = 0;
+    m_connection_event_ticks = 0;
+    m_is_connected = true;
+    m_counters.connection_cnt++;
+}
+
+// The central may change the connection interval after the connection is established.
+void charge_conn_interval_set(uint32_t conn_interval_ms)
+{
+    counters_update();
+
+    m_conn_interval_ticks = MAX(ms_to_ticks(conn_interval_ms), 1);
+}
+
+void charge_on_disconnected()
+{
+    counters_update();
+
+    m_is_connected = false;
+}
+
+void charge_on_measurement()
+{
+    m_counters.measurement_cnt++;
+}
+
+void charge_on_flash_write()
+{
+    m_counters.flash_write_cnt++;
+}
+
+const charge_counters_t *charge_counters_get()
+{
+    counters_update();
+
+    return &m_counters;
+}
+
+uint32_t charge_consumed_mc_get()
+{
+    counters_update();
+
+    return (uint32_t)(consumed_nc_get() / 1000000);
+}
+
+uint32_t charge_lifetime_hours_get()
+{
+#if !APP_CONFIG_BATTERY_ENABLED
+    // Without a battery, the lifetime is unknown and the charge is only an estimation of the consumption.
+    return UINT32_MAX;
+#else
+    counters_update();
+
+    uint64_t consumed_nc = consumed_nc_get();
+
+    if (m_counters.uptime_s < LIFETIME_MIN_UPTIME_S || consumed_nc == 0)
+    {
+        return UINT32_MAX;
+    }
+    if (consumed_nc >= CHARGE_BATTERY_CAPACITY_NC)
+    {
+        return 0;
+    }
+
+    uint64_t nc_per_hour = (consumed_nc * 3600) / m_counters.uptime_s;
+    uint64_t lifetime_hours = (CHARGE_BATTERY_CAPACITY_NC - consumed_nc) / MAX(nc_per_hour, 1);
+
+    return (uint32_t)MIN(lifetime_hours, UINT32_MAX - 1);
+#endif
+}
+
+void charge_serialize(uint8_t *p_buffer)
+{
+    uint32_t lifetime_hours = charge_lifetime_hours_get();
+
+    uint32_encode(charge_consumed_mc_get(), &p_buffer[0]);
+    uint32_encode(lifetime_hours, &p_buffer[4]);
+    uint32_encode(m_counters.uptime_s, &p_buffer[8]);
+    uint32_encode(m_counters.adv_slow_cnt, &p_buffer[12]);
+    uint32_encode(m_counters.adv_fast_cnt, &p_buffer[16]);
+    uint32_encode(m_counters.measurement_cnt, &p_buffer[20]);
+    uint32_encode(m_counters.connection_cnt, &p_buffer[24]);
+    uint32_encode(m_counters.connected_s, &p_buffer[28]);
+    uint32_encode(m_counters.connection_event_cnt, &p_buffer[32]);
+    uint32_encode(m_counters.flash_write_cnt, &p_buffer[36]);
+}
@@ -0,0 +1,64 @@
+#ifndef _CHARGE_H
+#define _CHARGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Estimation of the battery charge consumed by the device.
+// Events are counted and multiplied by the charge per event measured in README.
+// Advertising and connection events are counted from the time in each state,
+// because the application is not woken up by each of them.
+
+// Capacity of the battery. Set by the Makefile: make BATTERY_CAPACITY_MAH=225
+#ifndef CHARGE_BATTERY_CAPACITY_MAH
+#define CHARGE_BATTERY_CAPACITY_MAH 225 // CR2032
+#endif
+
+// Serialized length of the consumed charge, the remaining lifetime and the counters
+#define CHARGE_DATA_LEN 40
+
+typedef enum
+{
+    CHARGE_ADV_MODE_NONE,
+    CHARGE_ADV_MODE_SLOW,
+    CHARGE_ADV_MODE_FAST,
+} charge_adv_mode_t;
+
+// Counters since the battery is inserted.
+// They are stored in flash as they are, so only add fields of 32 bits at the end.
+typedef struct
+{
+    uint32_t uptime_s;             // time out of System OFF
+    uint32_t adv_slow_cnt;
+    uint32_t adv_fast_cnt;
+    uint32_t measurement_cnt;
+    uint32_t connection_cnt;
+    uint32_t connected_s;
+    uint32_t connection_event_cnt;
+    uint32_t flash_write_cnt;
+} charge_counters_t;
+
+// p_counters has the counters restored from flash, or NULL after a battery insertion.
+// Call this after period_timer_init().
+void charge_init(uint32_t adv_slow_interval_ms, uint32_t adv_fast_interval_ms, const charge_counters_t *p_counters);
+
+// A new battery is inserted. The counters start from zero and the current state goes on.
+void charge_counters_reset();
+
+void charge_adv_mode_set(charge_adv_mode_t mode);
+void charge_on_connected(uint32_t conn_interval_ms);
+void charge_conn_interval_set(uint32_t conn_interval_ms);
+void charge_on_disconnected();
+void charge_on_measurement();
+void charge_on_flash_write();
+
+// Counters brought up to date
+const charge_counters_t *charge_counters_get();
+uint32_t charge_consumed_mc_get();
+// Remaining lifetime at the average current since the battery insertion. UINT32_MAX if it is unknown yet.
+uint32_t charge_lifetime_hours_get();
+
+// Consumed charge (mC), remaining lifetime (h) and the counters in the order of charge_counters_t, in little endian
+void charge_serialize(uint8_t *p_buffer);
+
+#endif
@@ -2,7 +2,7 @@
 #include "app_timer.h"
 
 #include "nrf_gpio.h"
-#include "app_button.h"
+#include "nrf_drv_gpiote.h"
 
 #include <string.h>
 
@@ -10,11 +10,18 @@
 #define BUTTON_PIN 12
 
 #define BUTTON_DETECT_DELAY 100
+#define BUTTON_LONG_PRESS_TIME 3000 // ms
 
 APP_TIMER_DEF(m_led_blink_timer_id);
+APP_TIMER_DEF(m_button_detect_timer_id);
+APP_TIMER_DEF(m_button_long_press_timer_id);
 static button_evt_handler_t m_button_evt_handler = NULL;
+static button_evt_handler_t m_button_long_press_evt_handler = NULL;
 
 static bool m_is_led_blinking;
+static volatile bool m_is_button_detecting;
+static bool m_is_button_pushed;
+static bool m_is_button_long_pressed;
 
 static void led_blink_timer_handler()
 {
@@ -22,17 +29,78 @@ static void led_blink_timer_handler()
     m_is_led_blinking = false;
 }
 
-static void button_event_handler(uint8_t pin_no, uint8_t button_action)
+static void button_long_press_timer_handler()
 {
-    if (pin_no == BUTTON_PIN && button_action == APP_BUTTON_PUSH)
+    m_is_button_long_pressed = true;
+    led_on();
+}
+
+static void button_push_handler()
+{
+    uint32_t err_code = app_timer_start(m_button_long_press_timer_id, APP_TIMER_TICKS(BUTTON_LONG_PRESS_TIME, 0), NULL);
+    APP_ERROR_CHECK(err_code);
+
+    if (m_button_evt_handler)
+    {
+        m_button_evt_handler();
+    }
+}
+
+static void button_release_handler()
+{
+    uint32_t err_code = app_timer_stop(m_button_long_press_timer_id);
+    APP_ERROR_CHECK(err_code);
+
+    // A long press is notified on release, so that the button is not pushed any more in the handler.
+    if (m_is_button_long_pressed)
     {
-        if (m_button_evt_handler)
+        m_is_button_long_pressed = false;
+        led_off();
+
+        if (m_button_long_press_evt_handler)
         {
-            m_button_evt_handler();
+            m_button_long_press_evt_handler();
         }
     }
 }
 
+// Sample the pin once after the bouncing settles.
+static void button_detect_timer_handler()
+{
+    bool is_pushed = button_is_pushed();
+
+    m_is_button_detecting = false;
+
+    if (is_pushed == m_is_button_pushed)
+    {
+        return;
+    }
+    m_is_button_pushed = is_pushed;
+
+    if (is_pushed)
+    {
+        button_push_handler();
+    }
+    else
+    {
+        button_release_handler();
+    }
+}
+
+// PORT event by SENSE of the pin. Edges while the detect timer is running are bounces.
+static void button_pin_handler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+{
+    if (pin != BUTTON_PIN || m_is_button_detecting)
+    {
+        return;
+    }
+
+    m_is_button_detecting = true;
+
+    uint32_t err_code = app_timer_start(m_button_detect_timer_id, APP_TIMER_TICKS(BUTTON_DETECT_DELAY, 0), NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
 uint32_t led_init()
 {
     nrf_gpio_cfg_output(LED_PIN);
@@ -65,34 +133,66 @@ uint32_t led_blink(uint32_t duration)
     return app_timer_start(m_led_blink_timer_id, APP_TIMER_TICKS(duration, 0), NULL);
 }
 
-uint32_t button_init(button_evt_handler_t _button_evt_handler)
+// The button uses the low power PORT event (SENSE of the pin) and no GPIOTE IN channel.
+// No timer runs while the button is not touched.
+uint32_t button_init(button_evt_handler_t _button_evt_handler, button_evt_handler_t _button_long_press_evt_handler)
 {
     uint32_t err_code;
 
-    static app_button_cfg_t button_config = {
-        .pin_no = BUTTON_PIN,
-        .active_state = APP_BUTTON_ACTIVE_LOW,
-        .pull_cfg = GPIO_PIN_CNF_PULL_Pullup,
-        .button_handler = button_event_handler};
+    nrf_drv_gpiote_in_config_t in_config = GPIOTE_CONFIG_IN_SENSE_TOGGLE(false);
+    in_config.pull = NRF_GPIO_PIN_PULLUP;
 
     m_button_evt_handler = _button_evt_handler;
+    m_button_long_press_evt_handler = _button_long_press_evt_handler;
+    m_is_button_detecting = false;
+    m_is_button_long_pressed = false;
+
+    err_code = app_timer_create(&m_button_detect_timer_id, APP_TIMER_MODE_SINGLE_SHOT, button_detect_timer_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code = app_timer_create(&m_button_long_press_timer_id, APP_TIMER_MODE_SINGLE_SHOT, button_long_press_timer_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    if (!nrf_drv_gpiote_is_init())
+    {
+        err_code = nrf_drv_gpiote_init();
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
 
-    err_code = app_button_init(&button_config, 1, BUTTON_DETECT_DELAY);
+    err_code = nrf_drv_gpiote_in_init(BUTTON_PIN, &in_config, button_pin_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    // A push at reset is handled by button_is_pushed() in the initialization, not as an event.
+    m_is_button_pushed = button_is_pushed();
 
-    return err_code;
+    nrf_drv_gpiote_in_event_enable(BUTTON_PIN, true);
+
+    return NRF_SUCCESS;
 }
 
 bool button_is_pushed()
 {
-    return app_button_is_pushed(0);
+    // active low
+    return !nrf_drv_gpiote_in_is_set(BUTTON_PIN);
 }
 
-uint32_t button_interrupt_enable()
+// Configure the button as the wakeup source from System OFF.
+// Call this just before entering System OFF with the button released,
+// otherwise the device wakes up immediately.
+void button_wakeup_enable()
 {
-    return app_button_enable();
+    nrf_drv_gpiote_in_event_disable(BUTTON_PIN);
+    nrf_gpio_cfg_sense_input(BUTTON_PIN, NRF_GPIO_PIN_PULLUP, NRF_GPIO_PIN_SENSE_LOW);
 }
-
-uint32_t button_interrupt_disable()
-{
-    return app_button_disable();
-}
\ No newline at end of file
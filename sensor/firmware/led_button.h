@@ -13,9 +13,8 @@ uint32_t led_blink(uint32_t duration);
 // Button
 typedef void (*button_evt_handler_t)();
 
-uint32_t button_init(button_evt_handler_t _button_evt_handler);
+uint32_t button_init(button_evt_handler_t _button_evt_handler, button_evt_handler_t _button_long_press_evt_handler);
 bool button_is_pushed();
-uint32_t button_interrupt_enable();
-uint32_t button_interrupt_disable();
+void button_wakeup_enable();
 
 #endif
\ No newline at end of file
@@ -68,17 +68,29 @@
 #include "app_timer.h"
 #include "fstorage.h"
 #include "fds.h"
-#include "peer_manager.h"
 
 #include "nrf_gpio.h"
 #include "ble_advdata.h"
 #include "ble_advertising.h"
-#include "ble_conn_state.h"
 
 #include "nrf_drv_clock.h"
 
 #include "ble_enble.h"
+#include "aggregate.h"
+#include "app_config.h"
 #include "app_enble.h"
+#include "charge.h"
+#include "power_profile.h"
+#include "ram_usage.h"
+#include "scheduler.h"
+#include "sensor.h"
+#include "relay.h"
+#include "trace.h"
+
+#if ENBLE_USE_PEER_MANAGER
+#include "peer_manager.h"
+#include "ble_conn_state.h"
+#endif
 
 #define NRF_LOG_MODULE_NAME "MAIN"
 #define NRF_LOG_LEVEL 0
@@ -128,11 +140,16 @@ static ble_enble_t m_enble_instance;
 
 void app_error_fault_handler(uint32_t id, uint32_t pc, uint32_t info)
 {
-	error_info_t *error_info = (error_info_t*)info;
+#if NRF_LOG_ENABLED
+	error_info_t *error_info = (error_info_t*)(uintptr_t)info;
 	printf("[APP_ERROR] code %lu at %s:%u\n",
-			error_info->err_code,
+			(unsigned long)error_info->err_code,
 			error_info->p_file_name,
 			error_info->line_num);
+#else
+	// Release image has no log output. Restart to recover from the error.
+	NVIC_SystemReset();
+#endif
 }
 
 
@@ -142,6 +159,7 @@ void assert_nrf_callback(uint16_t line_num, const uint8_t * p_file_name)
 }
 
 
+#if ENBLE_USE_PEER_MANAGER
 /**@brief Function for handling Peer Manager events.
  *
  * @param[in] p_evt  Peer Manager event.
@@ -253,6 +271,7 @@ static void pm_evt_handler(pm_evt_t const *p_evt)
         break;
     }
 }
+#endif
 
 /**@brief Function for the Timer initialization.
  *
@@ -308,6 +327,7 @@ static void gap_params_init(void)
     APP_ERROR_CHECK(err_code);
 }
 
+#if APP_CONFIG_GATT_WRITE_ENABLED
 /**@brief Function for handling the Enble Service events. 
  *
  * @details This function will be called for all YY Service events which are passed to
@@ -335,6 +355,83 @@ static void on_enble_period_update_evt(ble_enble_t *p_enble, uint16_t new_value)
 {
     app_enble_on_period_update_evt(new_value);
 }
+#endif
+
+/**@brief Function for handling the Enble Service events. 
+ *
+ * @details This function will be called when a peer reads a measurement characteristic.
+ *
+ * @param[in]   p_enble   Enble Service structure.
+ */
+static void on_enble_measurement_read_evt(ble_enble_t *p_enble)
+{
+    app_enble_on_measurement_read_evt();
+}
+
+#if APP_CONFIG_GATT_WRITE_ENABLED
+/**@brief Function for handling the Enble Service events. 
+ *
+ * @details This function will be called when a peer writes the Command characteristic.
+ *
+ * @param[in]   p_enble   Enble Service structure.
+ * @param[in]   command   Received command.
+ */
+static void on_enble_command_evt(ble_enble_t *p_enble, uint8_t command)
+{
+    app_enble_on_command_evt(command);
+}
+
+/**@brief Function for handling the Enble Service events. 
+ *
+ * @details This function will be called when a peer writes the Alarm characteristic.
+ *
+ * @param[in]   p_enble   Enble Service structure.
+ * @param[in]   p_data    Received thresholds of all channels.
+ */
+static void on_enble_alarm_update_evt(ble_enble_t *p_enble, const uint8_t *p_data)
+{
+    app_enble_on_alarm_update_evt(p_data);
+}
+
+/**@brief Function for handling the Enble Service events. 
+ *
+ * @details This function will be called when a peer writes the Time characteristic.
+ *
+ * @param[in]   p_enble    Enble Service structure.
+ * @param[in]   epoch_s    Received Unix time in seconds.
+ * @param[in]   epoch_ms   Milliseconds of the received time.
+ */
+static void on_enble_time_update_evt(ble_enble_t *p_enble, uint32_t epoch_s, uint16_t epoch_ms)
+{
+    app_enble_on_time_update_evt(epoch_s, epoch_ms);
+}
+
+/**@brief Function for handling the Enble Service events. 
+ *
+ * @details This function will be called when a peer writes the TxPower characteristic.
+ *
+ * @param[in]   p_enble     Enble Service structure.
+ * @param[in]   new_value   TX power in dBm recommended by the peer.
+ */
+static void on_enble_tx_power_update_evt(ble_enble_t *p_enble, int8_t new_value)
+{
+    app_enble_on_tx_power_update_evt(new_value);
+}
+#endif
+
+#if TRACE_ENABLED
+/**@brief Function for handling the Enble Service events. 
+ *
+ * @details This function will be called when a peer selects a stage in the Diagnostics characteristic.
+ *
+ * @param[in]   p_enble    Enble Service structure.
+ * @param[in]   stage      Selected stage, or BLE_ENBLE_DIAGNOSTICS_RESET.
+ */
+static void on_enble_diagnostics_select_evt(ble_enble_t *p_enble, uint8_t stage)
+{
+    app_enble_on_diagnostics_select_evt(stage);
+}
+#endif
 
 /**@brief Function for initializing services that will be used by the application.
  */
@@ -343,8 +440,30 @@ static void services_init(void)
     uint32_t err_code;
     ble_enble_init_t enble_init;
 
+    enble_init.measurement_read_handler = on_enble_measurement_read_evt;
+#if APP_CONFIG_GATT_WRITE_ENABLED
     enble_init.device_id_update_handler = on_enble_device_id_update_evt;
     enble_init.period_update_handler = on_enble_period_update_evt;
+    enble_init.command_handler = on_enble_command_evt;
+    enble_init.alarm_update_handler = on_enble_alarm_update_evt;
+    enble_init.time_update_handler = on_enble_time_update_evt;
+    enble_init.tx_power_update_handler = on_enble_tx_power_update_evt;
+#else
+    // The configuration is fixed by the profile.
+    enble_init.device_id_update_handler = NULL;
+    enble_init.period_update_handler = NULL;
+    enble_init.command_handler = NULL;
+    enble_init.alarm_update_handler = NULL;
+    enble_init.time_update_handler = NULL;
+    enble_init.tx_power_update_handler = NULL;
+#endif
+#if TRACE_ENABLED
+    enble_init.diagnostics_select_handler = on_enble_diagnostics_select_evt;
+#else
+    enble_init.diagnostics_select_handler = NULL;
+#endif
+    enble_init.channel_cnt = SENSOR_CHANNEL_CNT;
+    enble_init.has_aggregate = AGGREGATE_ENABLED;
 
     err_code = ble_enble_init(&m_enble_instance, &enble_init);
     APP_ERROR_CHECK(err_code);
@@ -415,6 +534,9 @@ static void on_ble_evt(ble_evt_t *p_ble_evt)
     case BLE_GAP_EVT_DISCONNECTED:
         NRF_LOG_INFO("Disconnected.\r\n");
         APP_ERROR_CHECK(err_code);
+
+        charge_on_disconnected();
+        app_enble_on_disconnect_evt();
         
         err_code = ble_advertising_start(BLE_ADV_MODE_SLOW);
         APP_ERROR_CHECK(err_code);
@@ -425,8 +547,13 @@ static void on_ble_evt(ble_evt_t *p_ble_evt)
         NRF_LOG_INFO("Connected.\r\n");
         APP_ERROR_CHECK(err_code);
         m_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+        charge_on_connected(p_ble_evt->evt.gap_evt.params.connected.conn_params.max_conn_interval * 1250 / 1000);
         break; // BLE_GAP_EVT_CONNECTED
 
+    case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+        charge_conn_interval_set(p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params.max_conn_interval * 1250 / 1000);
+        break; // BLE_GAP_EVT_CONN_PARAM_UPDATE
+
     case BLE_GATTC_EVT_TIMEOUT:
         // Disconnect on GATT Client timeout event.
         NRF_LOG_DEBUG("GATT Client Timeout.\r\n");
@@ -455,7 +582,8 @@ static void on_ble_evt(ble_evt_t *p_ble_evt)
 
         req = p_ble_evt->evt.gatts_evt.params.authorize_request;
 
-        if (req.type != BLE_GATTS_AUTHORIZE_TYPE_INVALID)
+        // Read requests are handled by the ENBLE Service.
+        if (req.type == BLE_GATTS_AUTHORIZE_TYPE_WRITE)
         {
             if ((req.request.write.op == BLE_GATTS_OP_PREP_WRITE_REQ) ||
                 (req.request.write.op == BLE_GATTS_OP_EXEC_WRITE_REQ_NOW) ||
@@ -478,6 +606,22 @@ static void on_ble_evt(ble_evt_t *p_ble_evt)
     }
     break; // BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST
 
+#if !ENBLE_USE_PEER_MANAGER
+    // Without Peer Manager, pairing is rejected and no bond is stored.
+    case BLE_GAP_EVT_SEC_PARAMS_REQUEST:
+        err_code = sd_ble_gap_sec_params_reply(p_ble_evt->evt.gap_evt.conn_handle,
+                                               BLE_GAP_SEC_STATUS_PAIRING_NOT_SUPP,
+                                               NULL,
+                                               NULL);
+        APP_ERROR_CHECK(err_code);
+        break; // BLE_GAP_EVT_SEC_PARAMS_REQUEST
+
+    case BLE_GATTS_EVT_SYS_ATTR_MISSING:
+        err_code = sd_ble_gatts_sys_attr_set(p_ble_evt->evt.gatts_evt.conn_handle, NULL, 0, 0);
+        APP_ERROR_CHECK(err_code);
+        break; // BLE_GATTS_EVT_SYS_ATTR_MISSING
+#endif
+
 #if (NRF_SD_BLE_API_VERSION == 3)
     case BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST:
         err_code = sd_ble_gatts_exchange_mtu_reply(p_ble_evt->evt.gatts_evt.conn_handle,
@@ -501,14 +645,23 @@ static void on_ble_evt(ble_evt_t *p_ble_evt)
  */
 static void ble_evt_dispatch(ble_evt_t *p_ble_evt)
 {
+    uint32_t begin_ticks = scheduler_profile_begin();
+
     /** The Connection state module has to be fed BLE events in order to function correctly
      * Remember to call ble_conn_state_on_ble_evt before calling any ble_conns_state_* functions. */
+#if ENBLE_USE_PEER_MANAGER
     ble_conn_state_on_ble_evt(p_ble_evt);
     pm_on_ble_evt(p_ble_evt);
+#endif
     ble_conn_params_on_ble_evt(p_ble_evt);
     on_ble_evt(p_ble_evt);
     ble_advertising_on_ble_evt(p_ble_evt);
     ble_enble_on_ble_evt(&m_enble_instance, p_ble_evt);
+#if RELAY_ENABLED
+    relay_on_ble_evt(p_ble_evt);
+#endif
+
+    scheduler_profile_end(SCHEDULER_EVT_BLE, begin_ticks);
 }
 
 /**@brief Function for dispatching a system event to interested modules.
@@ -520,6 +673,8 @@ static void ble_evt_dispatch(ble_evt_t *p_ble_evt)
  */
 static void sys_evt_dispatch(uint32_t sys_evt)
 {
+    uint32_t begin_ticks = scheduler_profile_begin();
+
     // Dispatch the system event to the fstorage module, where it will be
     // dispatched to the Flash Data Storage (FDS) module.
     fs_sys_event_handler(sys_evt);
@@ -528,6 +683,8 @@ static void sys_evt_dispatch(uint32_t sys_evt)
     // pending flash operations in fstorage. Let fstorage process system events first,
     // so that it can report correctly to the Advertising module.
     ble_advertising_on_sys_evt(sys_evt);
+
+    scheduler_profile_end(SCHEDULER_EVT_SYS, begin_ticks);
 }
 
 /**@brief Function for initializing the BLE stack.
@@ -545,7 +702,8 @@ static void ble_stack_init(void)
         .xtal_accuracy = NRF_CLOCK_LF_XTAL_ACCURACY_20_PPM};
 
     // Initialize the SoftDevice handler module.
-    SOFTDEVICE_HANDLER_INIT(&clock_lf_cfg, NULL);
+    // BLE and system events are pulled from the SoftDevice in the main loop through the scheduler.
+    SOFTDEVICE_HANDLER_APPSH_INIT(&clock_lf_cfg, true);
 
     ble_enable_params_t ble_enable_params;
     err_code = softdevice_enable_get_default_config(CENTRAL_LINK_COUNT,
@@ -572,13 +730,54 @@ static void ble_stack_init(void)
     APP_ERROR_CHECK(err_code);
 }
 
+static volatile bool m_is_fds_initialized;
+
+static void fds_init_evt_handler(fds_evt_t const *p_fds_evt)
+{
+    if (p_fds_evt->id == FDS_EVT_INIT)
+    {
+        APP_ERROR_CHECK(p_fds_evt->result);
+        m_is_fds_initialized = true;
+    }
+}
+
+/**@brief Function for waiting for the Flash Data Storage initialization.
+ *
+ * @details FDS formats its pages on the first boot after the flash is erased, and the records
+ *          can be accessed after FDS_EVT_INIT. Flash operations complete through SoC events,
+ *          which are processed by the scheduler.
+ */
+static void fds_init_wait()
+{
+    ret_code_t err_code;
+
+    while (!m_is_fds_initialized)
+    {
+        scheduler_execute();
+
+        if (!m_is_fds_initialized)
+        {
+            err_code = sd_app_evt_wait();
+            APP_ERROR_CHECK(err_code);
+        }
+    }
+}
+
+#if ENBLE_USE_PEER_MANAGER
 /**@brief Function for the Peer Manager initialization.
+ *
+ * @details FDS is initialized by the Peer Manager.
  */
 static void peer_manager_init()
 {
     ble_gap_sec_params_t sec_param;
     ret_code_t err_code;
 
+    m_is_fds_initialized = false;
+
+    err_code = fds_register(fds_init_evt_handler);
+    APP_ERROR_CHECK(err_code);
+
     err_code = pm_init();
     APP_ERROR_CHECK(err_code);
 
@@ -603,7 +802,29 @@ static void peer_manager_init()
 
     err_code = pm_register(pm_evt_handler);
     APP_ERROR_CHECK(err_code);
+
+    fds_init_wait();
 }
+#else
+/**@brief Function for the Flash Data Storage initialization.
+ *
+ * @details Without the Peer Manager, FDS for the configuration is initialized here.
+ */
+static void fds_storage_init()
+{
+    ret_code_t err_code;
+
+    m_is_fds_initialized = false;
+
+    err_code = fds_register(fds_init_evt_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = fds_init();
+    APP_ERROR_CHECK(err_code);
+
+    fds_init_wait();
+}
+#endif
 
 /**@brief Function for the Power manager.
  */
@@ -612,6 +833,8 @@ static void power_manage(void)
     uint32_t err_code = sd_app_evt_wait();
 
     APP_ERROR_CHECK(err_code);
+
+    power_profile_on_wakeup();
 }
 
 /**@brief Function for application main entry.
@@ -620,14 +843,32 @@ int main(void)
 {
     uint32_t err_code;
 
+#if TRACE_ENABLED
+    ram_usage_init();
+#endif
+
     // Initialize.
     err_code = NRF_LOG_INIT(NULL);
     APP_ERROR_CHECK(err_code);
 
+    err_code = scheduler_init();
+    APP_ERROR_CHECK(err_code);
+
     timers_init();
+
+    err_code = app_enble_sensor_init();
+    APP_ERROR_CHECK(err_code);
+
     ble_stack_init();
 
+    err_code = power_profile_init();
+    APP_ERROR_CHECK(err_code);
+
+#if ENBLE_USE_PEER_MANAGER
     peer_manager_init();
+#else
+    fds_storage_init();
+#endif
 
     gap_params_init();
     services_init();
@@ -638,9 +879,13 @@ int main(void)
     err_code = app_enble_init(&m_enble_instance);
     APP_ERROR_CHECK(err_code);
 
+    trace_boot_record(TRACE_BOOT_INIT);
+
     // Enter main loop.
     for (;;)
     {
+        scheduler_execute();
+
         if (NRF_LOG_PROCESS() == false)
         {
             power_manage();
@@ -0,0 +1,67 @@
+# Application build options, shared by this Makefile and the host simulation (sim/Makefile).
+# Each is a make variable that can be set on the command line: make PROFILE=LOGGER RELAY=1
+
+# Release image: make RELEASE=1
+# NRF_LOG and RTT output are compiled out.
+RELEASE ?= 0
+ifeq ($(RELEASE), 1)
+CFLAGS += -DNRF_LOG_ENABLED=0
+endif
+
+# Firmware profile in app_config.h: FULL, LOGGER or MAINS
+PROFILE ?= FULL
+CFLAGS += -DUSE_APP_CONFIG -DAPP_CONFIG_PROFILE=APP_CONFIG_PROFILE_$(PROFILE)
+# Device ID after reset to the default, for a profile without configuration over GATT
+ifdef DEVICE_ID
+CFLAGS += -DAPP_CONFIG_DEVICE_ID=$(DEVICE_ID)
+endif
+
+# Power profile used after reset: POWER_PROFILE_NORMAL or POWER_PROFILE_LOW_POWER
+POWER_PROFILE ?= POWER_PROFILE_LOW_POWER
+CFLAGS += -DPOWER_PROFILE_DEFAULT=$(POWER_PROFILE)
+# Set 1 if the board has the inductor for the DC/DC converter
+DCDC_AVAILABLE ?= 0
+CFLAGS += -DPOWER_PROFILE_DCDC_AVAILABLE=$(DCDC_AVAILABLE)
+# Set 1 to measure just before slow advertising events (radio notification on SWI1)
+ADV_SYNC ?= 0
+CFLAGS += -DADV_SYNC_ENABLED=$(ADV_SYNC)
+# Set 1 to start ADC by RTC1 compare through PPI and read BME280 in a single wakeup
+SENSOR_HW_TRIGGER ?= 0
+CFLAGS += -DSENSOR_HW_TRIGGER_ENABLED=$(SENSOR_HW_TRIGGER)
+# Set 1 to send slow advertising in the time slot of the DeviceID after a time sync
+SLOTTED_ADV ?= 0
+CFLAGS += -DSLOTTED_ADV_ENABLED=$(SLOTTED_ADV)
+# Width of a slot in ms, an advertising event and the guard time for the drift between time syncs
+SLOTTED_ADV_SLOT_MS ?= 40
+CFLAGS += -DADV_SLOT_WIDTH_MS=$(SLOTTED_ADV_SLOT_MS)
+# Set 1 to scan neighbour ENBLEs and relay them in the scan response (for mains or AA powered devices)
+RELAY ?= 0
+CFLAGS += -DRELAY_ENABLED=$(RELAY)
+# Set 1 to sample every AGGREGATE_SAMPLE_INTERVAL s and report min, max, mean and deviation once per period
+AGGREGATE ?= 0
+CFLAGS += -DAGGREGATE_ENABLED=$(AGGREGATE)
+AGGREGATE_SAMPLE_INTERVAL ?= 10
+CFLAGS += -DAGGREGATE_SAMPLE_INTERVAL=$(AGGREGATE_SAMPLE_INTERVAL)
+# Set 1 to record histograms of the duration of each stage of a measurement
+TRACE ?= 0
+CFLAGS += -DTRACE_ENABLED=$(TRACE)
+# Lowest TX power in dBm a bridge can set through the TxPower characteristic
+TX_POWER_MIN ?= -20
+CFLAGS += -DTXPOWER_MIN_DBM=$(TX_POWER_MIN)
+# Capacity of the battery for the estimation of the remaining lifetime
+BATTERY_CAPACITY_MAH ?= 225
+CFLAGS += -DCHARGE_BATTERY_CAPACITY_MAH=$(BATTERY_CAPACITY_MAH)
+# CS pins of BME280s on the SPI bus separated by spaces, one channel per pin (up to 5)
+BME280_CS_PINS ?= 5
+comma := ,
+empty :=
+space := $(empty) $(empty)
+CFLAGS += -DSENSOR_CHANNEL_CNT=$(words $(BME280_CS_PINS))
+CFLAGS += -DSENSOR_BME280_CS_PINS=$(subst $(space),$(comma),$(strip $(BME280_CS_PINS)))
+# RAM reserved for the stack and the heap by gcc_startup_nrf51.S (2048 bytes each by default)
+STACK_SIZE ?= 2048
+HEAP_SIZE ?= 2048
+ASMFLAGS += -D__STACK_SIZE=$(STACK_SIZE) -D__HEAP_SIZE=$(HEAP_SIZE)
+# Set 0 to build without Peer Manager (no bonding, pairing is rejected)
+PEER_MANAGER ?= 1
+CFLAGS += -DENBLE_USE_PEER_MANAGER=$(PEER_MANAGER)
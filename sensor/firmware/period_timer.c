@@ -0,0 +1,234 @@
+#include "period_timer.h"
+
+#include "app_timer.h"
+#include "app_util.h"
+#include "sdk_common.h"
+
+#include "scheduler.h"
+#include "trace.h"
+
+#define NRF_LOG_MODULE_NAME "PERIOD_TIMER"
+#define NRF_LOG_LEVEL 0
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+// Half of the RTC1 range. The elapsed time between two wakeups is always
+// less than the RTC1 period, so the 64 bit tick counter can be extended from the RTC1 counter.
+#define CHUNK_TICKS_MAX 0x800000 // 256 s
+
+// app_timer stops and clears RTC1 when no timer is running, e.g. between the handler of a chunk
+// and the start of the next one. The counter must keep running for the elapsed time.
+STATIC_ASSERT(APP_TIMER_KEEPS_RTC_ACTIVE);
+
+// Frequency error of LFCLK in ppm. Positive when the clock is fast.
+// The LFXO on the board is within +-20 ppm. Use the calibrated value of the board if it is known.
+#ifndef PERIOD_TIMER_DRIFT_PPM
+#define PERIOD_TIMER_DRIFT_PPM 0
+#endif
+
+#define PPM 1000000
+
+APP_TIMER_DEF(m_chunk_timer_id);
+
+static period_timer_handler_t m_period_timer_handler;
+static int32_t m_drift_ppm;
+
+static bool m_is_running;
+static uint32_t m_period_s;
+static uint64_t m_period_ticks;        // integer part of the period in RTC1 ticks
+static uint32_t m_period_frac;         // fractional part of the period in 1/PPM ticks
+static uint32_t m_deadline_frac;       // accumulated fractional part of the deadline
+static uint32_t m_delay_ticks;         // delay of the next expiry from the deadline
+
+static uint32_t m_rtc_ticks;           // RTC1 counter at the last update of m_now_ticks
+static uint64_t m_now_ticks;           // RTC1 ticks since period_timer_init(), never reset
+static uint64_t m_deadline_ticks;
+
+static void now_ticks_update()
+{
+    uint32_t rtc_ticks;
+    uint32_t elapsed_ticks;
+
+    app_timer_cnt_get(&rtc_ticks);
+    app_timer_cnt_diff_compute(rtc_ticks, m_rtc_ticks, &elapsed_ticks);
+    m_rtc_ticks = rtc_ticks;
+    m_now_ticks += elapsed_ticks;
+}
+
+// Period in ticks of the drifting LFCLK, split into integer and fractional parts.
+// The fractional part is accumulated on the deadline, so the rounding error does not build up.
+static void period_ticks_update()
+{
+    uint64_t period_ticks_ppm = (uint64_t)m_period_s * APP_TIMER_CLOCK_FREQ * (uint64_t)(PPM + m_drift_ppm);
+
+    m_period_ticks = period_ticks_ppm / PPM;
+    m_period_frac = (uint32_t)(period_ticks_ppm % PPM);
+}
+
+static void deadline_advance()
+{
+    m_deadline_ticks += m_period_ticks;
+    m_deadline_frac += m_period_frac;
+    if (m_deadline_frac >= PPM)
+    {
+        m_deadline_frac -= PPM;
+        m_deadline_ticks++;
+    }
+}
+
+static uint32_t chunk_timer_start()
+{
+    uint64_t expiry_ticks = m_deadline_ticks + m_delay_ticks;
+    uint64_t remaining_ticks = (expiry_ticks > m_now_ticks) ? expiry_ticks - m_now_ticks : 0;
+    uint32_t timeout_ticks = (uint32_t)MIN(remaining_ticks, CHUNK_TICKS_MAX);
+
+    if (timeout_ticks < APP_TIMER_MIN_TIMEOUT_TICKS)
+    {
+        timeout_ticks = APP_TIMER_MIN_TIMEOUT_TICKS;
+    }
+
+    return app_timer_start(m_chunk_timer_id, timeout_ticks, NULL);
+}
+
+static void chunk_timer_evt_handler()
+{
+    uint32_t err_code;
+
+    if (!m_is_running)
+    {
+        return;
+    }
+
+    now_ticks_update();
+
+    bool is_expired = (m_now_ticks + APP_TIMER_MIN_TIMEOUT_TICKS >= m_deadline_ticks + m_delay_ticks);
+    if (is_expired)
+    {
+        m_delay_ticks = 0;
+
+        // If deadlines were missed, skip them instead of calling the handler in a burst.
+        do
+        {
+            deadline_advance();
+        } while (m_deadline_ticks <= m_now_ticks);
+    }
+
+    err_code = chunk_timer_start();
+    APP_ERROR_CHECK(err_code);
+
+    if (is_expired && m_period_timer_handler)
+    {
+        m_period_timer_handler();
+    }
+}
+
+static void chunk_timer_handler()
+{
+    // Ended by the handler of the application if the period has expired.
+    TRACE_BEGIN(TRACE_STAGE_TIMER_WAKE);
+
+    uint32_t err_code = scheduler_post(SCHEDULER_EVT_MEASUREMENT_TIMER, chunk_timer_evt_handler);
+    APP_ERROR_CHECK(err_code);
+}
+
+uint32_t period_timer_init(period_timer_handler_t handler)
+{
+    m_period_timer_handler = handler;
+    m_drift_ppm = PERIOD_TIMER_DRIFT_PPM;
+    m_is_running = false;
+
+    app_timer_cnt_get(&m_rtc_ticks);
+    m_now_ticks = 0;
+
+    return app_timer_create(&m_chunk_timer_id, APP_TIMER_MODE_SINGLE_SHOT, chunk_timer_handler);
+}
+
+// Call the handler first_delay_ms later and every period_s after that.
+uint32_t period_timer_start(uint32_t first_delay_ms, uint32_t period_s)
+{
+    uint32_t err_code;
+
+    if (period_s == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    err_code = app_timer_stop(m_chunk_timer_id);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    m_period_s = period_s;
+    period_ticks_update();
+
+    now_ticks_update();
+    m_deadline_ticks = m_now_ticks + ((uint64_t)first_delay_ms * APP_TIMER_CLOCK_FREQ) / 1000;
+    m_deadline_frac = 0;
+    m_delay_ticks = 0;
+    m_is_running = true;
+
+    NRF_LOG_DEBUG("period %u s, %u ticks\n", m_period_s, (uint32_t)m_period_ticks);
+
+    return chunk_timer_start();
+}
+
+uint32_t period_timer_stop()
+{
+    m_is_running = false;
+
+    return app_timer_stop(m_chunk_timer_id);
+}
+
+// Delay only the next expiry, the following ones stay on the period.
+// The delay must be shorter than the period.
+uint32_t period_timer_next_delay_set(uint32_t delay_ticks)
+{
+    uint32_t err_code;
+
+    if (!m_is_running)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (delay_ticks >= m_period_ticks)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    err_code = app_timer_stop(m_chunk_timer_id);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    m_delay_ticks = delay_ticks;
+    now_ticks_update();
+
+    return chunk_timer_start();
+}
+
+// The chunk timer updates the counter at least every 256 s while the timer runs,
+// so the counter does not miss a wrap around of RTC1.
+uint64_t period_timer_ticks_get()
+{
+    now_ticks_update();
+
+    return m_now_ticks;
+}
+
+uint64_t period_timer_deadline_get()
+{
+    return m_deadline_ticks;
+}
+
+// Takes effect from the next period.
+void period_timer_drift_set(int32_t drift_ppm)
+{
+    m_drift_ppm = drift_ppm;
+
+    if (m_is_running)
+    {
+        period_ticks_update();
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef _PERIOD_TIMER_H
+#define _PERIOD_TIMER_H
+
+#include <stdint.h>
+
+// Periodic timer for periods longer than a single app_timer can count.
+// RTC1 is 24 bit with prescaler 0, so one app_timer expires within 512 s.
+// This timer chains shorter timeouts toward an absolute deadline.
+
+typedef void (*period_timer_handler_t)();
+
+uint32_t period_timer_init(period_timer_handler_t handler);
+uint32_t period_timer_start(uint32_t first_delay_ms, uint32_t period_s);
+uint32_t period_timer_stop();
+uint32_t period_timer_next_delay_set(uint32_t delay_ticks);
+void period_timer_drift_set(int32_t drift_ppm);
+
+// RTC1 ticks since period_timer_init() in 64 bit. Valid while the timer runs.
+uint64_t period_timer_ticks_get();
+// Time of the next expiry in the same ticks, without the delay of period_timer_next_delay_set().
+uint64_t period_timer_deadline_get();
+
+#endif
@@ -0,0 +1,204 @@
+#include "power_profile.h"
+
+#include <string.h>
+
+#include "nrf.h"
+#include "nrf_soc.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+
+#define NRF_LOG_MODULE_NAME "POWER"
+#define NRF_LOG_LEVEL 0
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+// Profile used after reset. It can be overridden by the Makefile.
+#ifndef POWER_PROFILE_DEFAULT
+#define POWER_PROFILE_DEFAULT POWER_PROFILE_LOW_POWER
+#endif
+
+// The DC/DC converter needs the external inductor on DCC pin.
+// Set 1 only for a board which has it, otherwise the chip browns out when DC/DC is enabled.
+#ifndef POWER_PROFILE_DCDC_AVAILABLE
+#define POWER_PROFILE_DCDC_AVAILABLE 0
+#endif
+
+// nRF51 DC/DC converter works with VDD 2.1V - 3.6V
+// Use hysteresis not to toggle it around the threshold by noise of the battery measurement.
+#define DCDC_ENABLE_VOLTAGE 2300  // mV
+#define DCDC_DISABLE_VOLTAGE 2100 // mV
+
+#define RAM_START_ADDR 0x20000000
+#define RAM_BLOCK_NUM_MAX 2 // RAMON register covers RAM0 and RAM1. nRF51822xxAA has only these.
+
+// end of RAM used by the application, defined in the linker script
+extern uint32_t __StackTop;
+
+static power_profile_stats_t m_stats;
+static uint16_t m_battery_voltage;
+static uint8_t m_hfclk_request_cnt;
+static uint32_t m_hfclk_request_ticks;
+static uint32_t m_wakeup_ticks;
+static uint32_t m_wakeup_window_ticks;
+static uint32_t m_wakeup_window_cnt;
+
+static uint32_t dcdc_update()
+{
+    bool is_dcdc_enabled = m_stats.is_dcdc_enabled;
+
+    if (!POWER_PROFILE_DCDC_AVAILABLE || m_stats.profile != POWER_PROFILE_LOW_POWER)
+    {
+        is_dcdc_enabled = false;
+    }
+    else if (m_battery_voltage >= DCDC_ENABLE_VOLTAGE)
+    {
+        is_dcdc_enabled = true;
+    }
+    else if (m_battery_voltage < DCDC_DISABLE_VOLTAGE)
+    {
+        is_dcdc_enabled = false;
+    }
+
+    if (is_dcdc_enabled == m_stats.is_dcdc_enabled)
+    {
+        return NRF_SUCCESS;
+    }
+
+    NRF_LOG_INFO("DC/DC enabled %u at %u mV\n", is_dcdc_enabled, m_battery_voltage);
+
+    m_stats.is_dcdc_enabled = is_dcdc_enabled;
+    return sd_power_dcdc_mode_set(is_dcdc_enabled ? NRF_POWER_DCDC_ENABLE : NRF_POWER_DCDC_DISABLE);
+}
+
+// Power RAM blocks which are not in the region used by the SoftDevice and the application.
+// Only the blocks in use are kept on in System ON, and no block is retained in System OFF,
+// which is left only by a reset.
+static uint32_t ram_retention_update()
+{
+    uint32_t err_code;
+    uint32_t block_size = NRF_FICR->SIZERAMBLOCKS;
+    uint32_t block_num = MIN(NRF_FICR->NUMRAMBLOCK, RAM_BLOCK_NUM_MAX);
+    uint32_t ram_end_addr = (uint32_t)(uintptr_t)&__StackTop;
+    uint32_t used_block_mask = 0;
+    uint32_t unused_block_mask = 0;
+    uint32_t off_retention_mask = 0;
+
+    for (uint32_t i = 0; i < block_num; i++)
+    {
+        off_retention_mask |= POWER_RAMON_OFFRAM0_Msk << i;
+
+        if (RAM_START_ADDR + i * block_size >= ram_end_addr && m_stats.profile == POWER_PROFILE_LOW_POWER)
+        {
+            unused_block_mask |= POWER_RAMON_ONRAM0_Msk << i;
+        }
+        else
+        {
+            used_block_mask |= POWER_RAMON_ONRAM0_Msk << i;
+        }
+    }
+
+    err_code = sd_power_ramon_set(used_block_mask);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code = sd_power_ramon_clr(unused_block_mask | off_retention_mask);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    NRF_LOG_INFO("RAM block off mask %x\n", unused_block_mask);
+
+    m_stats.ram_block_off_mask = unused_block_mask;
+    return NRF_SUCCESS;
+}
+
+uint32_t power_profile_init()
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_battery_voltage = 0;
+    m_hfclk_request_cnt = 0;
+
+    return power_profile_set(POWER_PROFILE_DEFAULT);
+}
+
+uint32_t power_profile_set(power_profile_t profile)
+{
+    uint32_t err_code;
+
+    m_stats.profile = profile;
+
+    err_code = ram_retention_update();
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    return dcdc_update();
+}
+
+uint32_t power_profile_on_battery_update(uint16_t battery_voltage)
+{
+    m_battery_voltage = battery_voltage;
+
+    return dcdc_update();
+}
+
+// Peripherals like ADC and SPI run on HFCLK, which is started by the hardware automatically.
+// These functions do not start the crystal oscillator, but account how long the application keeps HFCLK running.
+void power_profile_hfclk_request()
+{
+    CRITICAL_REGION_ENTER();
+    if (m_hfclk_request_cnt++ == 0)
+    {
+        app_timer_cnt_get(&m_hfclk_request_ticks);
+        m_stats.hfclk_request_cnt++;
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+void power_profile_hfclk_release()
+{
+    uint32_t now_ticks;
+    uint32_t held_ticks;
+
+    CRITICAL_REGION_ENTER();
+    if (m_hfclk_request_cnt > 0 && --m_hfclk_request_cnt == 0)
+    {
+        app_timer_cnt_get(&now_ticks);
+        app_timer_cnt_diff_compute(now_ticks, m_hfclk_request_ticks, &held_ticks);
+        m_stats.hfclk_held_ticks += held_ticks;
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+// Call every time the application wakes up.
+// The application wakes up at least once in a RTC1 period (512 s) for its timers,
+// so the difference of RTC1 counter is enough to measure the window.
+void power_profile_on_wakeup()
+{
+    uint32_t now_ticks;
+    uint32_t elapsed_ticks;
+
+    app_timer_cnt_get(&now_ticks);
+    app_timer_cnt_diff_compute(now_ticks, m_wakeup_ticks, &elapsed_ticks);
+    m_wakeup_ticks = now_ticks;
+
+    m_stats.wakeup_cnt++;
+    m_wakeup_window_cnt++;
+    m_wakeup_window_ticks += elapsed_ticks;
+
+    if (m_wakeup_window_ticks >= 3600 * APP_TIMER_CLOCK_FREQ)
+    {
+        m_stats.wakeups_per_hour = m_wakeup_window_cnt;
+        m_wakeup_window_ticks = 0;
+        m_wakeup_window_cnt = 0;
+    }
+}
+
+const power_profile_stats_t *power_profile_stats_get()
+{
+    return &m_stats;
+}
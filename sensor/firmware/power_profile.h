@@ -0,0 +1,35 @@
+#ifndef _POWER_PROFILE_H
+#define _POWER_PROFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum
+{
+    POWER_PROFILE_NORMAL,    // DC/DC off and all RAM blocks on
+    POWER_PROFILE_LOW_POWER, // DC/DC depending on battery voltage and unused RAM blocks off
+} power_profile_t;
+
+typedef struct
+{
+    power_profile_t profile;
+    bool is_dcdc_enabled;
+    uint32_t ram_block_off_mask; // RAMON bits cleared for unused RAM blocks
+    uint32_t hfclk_held_ticks;   // total time in RTC1 ticks (30.5 us) while HFCLK is held by the application
+    uint32_t hfclk_request_cnt;
+    uint32_t wakeup_cnt;         // wakeups of the application from sd_app_evt_wait()
+    uint32_t wakeups_per_hour;   // wakeups in the last full hour
+} power_profile_stats_t;
+
+uint32_t power_profile_init();
+uint32_t power_profile_set(power_profile_t profile);
+uint32_t power_profile_on_battery_update(uint16_t battery_voltage);
+
+void power_profile_hfclk_request();
+void power_profile_hfclk_release();
+
+void power_profile_on_wakeup();
+
+const power_profile_stats_t *power_profile_stats_get();
+
+#endif
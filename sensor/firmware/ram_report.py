@@ -0,0 +1,107 @@
+import sys
+import os
+import re
+from collections import defaultdict
+
+# Print the RAM usage of each module from the map file given by the linker.
+# usage: python3 ram_report.py build/ENBLE_nrf51822xxaa.map
+
+RAM_SECTIONS = ('.data', '.bss', 'COMMON', '.fs_data', '.pwr_mgmt_data')
+
+# " .bss.m_stats   0x20002010   0x18 build/sensor.o"
+# A long section name is followed by a line break before the address.
+INPUT_SECTION = re.compile(r'^ (\S+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S+)$')
+INPUT_SECTION_NAME = re.compile(r'^ (\S+)$')
+INPUT_SECTION_ADDRESS = re.compile(r'^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S+)$')
+OUTPUT_SECTION = re.compile(r'^(\.\S+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)')
+MEMORY_REGION = re.compile(r'^RAM\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)')
+
+
+def module_name(object_file):
+    """libc_nano.a(lib_a-memcpy.o) -> libc_nano.a, build/app_enble.c.o -> app_enble"""
+    archive = re.match(r'(.*\.a)\(', object_file)
+    if archive:
+        return os.path.basename(archive.group(1))
+    name = os.path.basename(object_file)
+    return name.split('.')[0]
+
+
+def parse_map(lines):
+    """Return the RAM region, the sizes of output sections and the RAM usage per module."""
+    region = None
+    output_sections = {}
+    modules = defaultdict(int)
+    pending_name = None
+
+    for line in lines:
+        line = line.rstrip('\n')
+
+        match = MEMORY_REGION.match(line)
+        if match and region is None:
+            region = (int(match.group(1), 16), int(match.group(2), 16))
+            continue
+
+        match = OUTPUT_SECTION.match(line)
+        if match:
+            output_sections[match.group(1)] = int(match.group(3), 16)
+            pending_name = None
+            continue
+
+        match = INPUT_SECTION.match(line)
+        if match:
+            name, address, size, object_file = match.groups()
+        elif pending_name:
+            match = INPUT_SECTION_ADDRESS.match(line)
+            name = pending_name
+            pending_name = None
+            if not match:
+                continue
+            address, size, object_file = match.groups()
+        else:
+            match = INPUT_SECTION_NAME.match(line)
+            if match:
+                pending_name = match.group(1)
+            continue
+
+        if not name.startswith(RAM_SECTIONS) or region is None:
+            continue
+        address = int(address, 16)
+        if not region[0] <= address < region[0] + region[1]:
+            continue
+        modules[module_name(object_file)] += int(size, 16)
+
+    return region, output_sections, modules
+
+
+def print_report(region, output_sections, modules):
+    # The output sections include the alignment between modules.
+    static_size = sum(output_sections.get(name, 0) for name in RAM_SECTIONS if name != 'COMMON')
+    heap_size = output_sections.get('.heap', 0)
+    stack_size = output_sections.get('.stack_dummy', 0)
+    free_size = region[1] - static_size - heap_size - stack_size
+
+    print('RAM region 0x{:08x}, {} bytes'.format(region[0], region[1]))
+    print()
+    print('{:<32}{:>8}'.format('module', 'bytes'))
+    for name, size in sorted(modules.items(), key=lambda x: x[1], reverse=True):
+        if size > 0:
+            print('{:<32}{:>8}'.format(name, size))
+    print()
+    print('{:<32}{:>8}'.format('static (.data, .bss)', static_size))
+    print('{:<32}{:>8}'.format('heap', heap_size))
+    print('{:<32}{:>8}'.format('stack', stack_size))
+    print('{:<32}{:>8}'.format('free', free_size))
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 2:
+        print('usage: python3 ram_report.py <map file>')
+        sys.exit(1)
+
+    with open(sys.argv[1]) as map_file:
+        region, output_sections, modules = parse_map(map_file)
+    if region is None:
+        print('RAM region is not found in ' + sys.argv[1])
+        sys.exit(1)
+
+    print_report(region, output_sections, modules)
@@ -0,0 +1,69 @@
+#include "ram_usage.h"
+
+#include "nrf.h"
+#include "app_util.h"
+
+#define STACK_PAINT_PATTERN 0xDEADBEEF
+// An interrupt may push its frame below the stack pointer while the RAM is painted.
+#define STACK_PAINT_MARGIN 64 // bytes
+// Address of a word of the RAM. The RAM is in the 32 bit space, also in the host simulation.
+#define RAM_ADDR(p_word) ((uint32_t)(uintptr_t)(p_word))
+
+// Defined in the linker script nrf5x_common.ld of the SDK
+extern uint32_t __data_start__;
+extern uint32_t __bss_end__;
+extern uint32_t __HeapBase;
+extern uint32_t __HeapLimit;
+extern uint32_t __StackLimit;
+extern uint32_t __StackTop;
+
+void ram_usage_init()
+{
+    uint32_t *p_word = &__HeapLimit;
+    uint32_t *p_end = (uint32_t *)(uintptr_t)(__get_MSP() - STACK_PAINT_MARGIN);
+
+    while (p_word < p_end)
+    {
+        *p_word++ = STACK_PAINT_PATTERN;
+    }
+}
+
+// The stack may grow below __StackLimit, so the mark is searched from the top of the heap.
+static uint32_t *stack_high_water_mark_get()
+{
+    uint32_t *p_word = &__HeapLimit;
+
+    while (p_word < &__StackTop && *p_word == STACK_PAINT_PATTERN)
+    {
+        p_word++;
+    }
+
+    return p_word;
+}
+
+void ram_usage_get(ram_usage_t *p_usage)
+{
+    uint32_t *p_mark = stack_high_water_mark_get();
+
+    p_usage->region_size = (uint16_t)(RAM_ADDR(&__StackTop) - RAM_ADDR(&__data_start__));
+    p_usage->static_size = (uint16_t)(RAM_ADDR(&__bss_end__) - RAM_ADDR(&__data_start__));
+    p_usage->heap_size = (uint16_t)(RAM_ADDR(&__HeapLimit) - RAM_ADDR(&__HeapBase));
+    p_usage->stack_size = (uint16_t)(RAM_ADDR(&__StackTop) - RAM_ADDR(&__StackLimit));
+    p_usage->stack_max_used = (uint16_t)(RAM_ADDR(&__StackTop) - RAM_ADDR(p_mark));
+    p_usage->free_size = (uint16_t)(RAM_ADDR(p_mark) - RAM_ADDR(&__HeapLimit));
+}
+
+void ram_usage_serialize(uint8_t type, uint8_t *p_data)
+{
+    ram_usage_t usage;
+
+    ram_usage_get(&usage);
+
+    p_data[0] = type;
+    uint16_encode(usage.region_size, &p_data[1]);
+    uint16_encode(usage.static_size, &p_data[3]);
+    uint16_encode(usage.heap_size, &p_data[5]);
+    uint16_encode(usage.stack_size, &p_data[7]);
+    uint16_encode(usage.stack_max_used, &p_data[9]);
+    uint16_encode(usage.free_size, &p_data[11]);
+}
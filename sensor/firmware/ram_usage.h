@@ -0,0 +1,29 @@
+#ifndef _RAM_USAGE_H
+#define _RAM_USAGE_H
+
+#include <stdint.h>
+
+// RAM usage of the application from the symbols of the linker script,
+// and the high-water mark of the stack by painting the unused RAM at startup.
+
+// type (1) + 6 fields (2 each), little endian
+#define RAM_USAGE_DATA_LEN 13
+
+typedef struct
+{
+    uint16_t region_size;    // RAM region of the application in the linker script
+    uint16_t static_size;    // .data and .bss of all modules
+    uint16_t heap_size;      // reserved by __HEAP_SIZE
+    uint16_t stack_size;     // reserved by __STACK_SIZE
+    uint16_t stack_max_used; // deepest stack since startup
+    uint16_t free_size;      // never touched between the heap and the stack
+} ram_usage_t;
+
+// Call this first in main(). RAM above the heap and below the current stack is painted.
+void ram_usage_init();
+
+// The painted RAM is scanned, so this takes about 1 us per 4 free bytes.
+void ram_usage_get(ram_usage_t *p_usage);
+void ram_usage_serialize(uint8_t type, uint8_t *p_data);
+
+#endif
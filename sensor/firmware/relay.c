@@ -0,0 +1,360 @@
+#include "relay.h"
+
+#include <string.h>
+
+#include "app_timer.h"
+#include "app_util.h"
+#include "ble_gap.h"
+
+#include "scheduler.h"
+
+#define NRF_LOG_MODULE_NAME "RELAY"
+#define NRF_LOG_LEVEL 0
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+// Scan window every scan interval. The default is 10 % duty cycle.
+#ifndef RELAY_SCAN_INTERVAL
+#define RELAY_SCAN_INTERVAL 1000 // ms
+#endif
+#ifndef RELAY_SCAN_WINDOW
+#define RELAY_SCAN_WINDOW 100 // ms
+#endif
+
+#define RELAY_DEVICE_MAX 8
+// A neighbour not heard for this time is forgotten.
+// It is checked at every rotation, well before RTC1 wraps around in 512 s.
+#define RELAY_ENTRY_TIMEOUT 300 // s
+// The frame moves to the next entries at this interval when there are more neighbours than the frame has.
+#define RELAY_FRAME_ROTATE_INTERVAL 12000 // ms, 2 slow advertising events
+
+#define RELAY_LOCAL_NAME "ENBLE"
+#define RELAY_MANUF_DATA_LEN 11 // company identifier (DeviceID) and 9 bytes
+#define RELAY_MANUF_DATA_LEN_OLD 10 // without the status flags
+
+#define MS_TO_SCAN_UNITS(MS) ((MS) * 1000 / 625)
+
+typedef struct
+{
+    bool is_used;
+    uint8_t payload[RELAY_ENTRY_LEN];
+    uint32_t last_heard_ticks;
+} relay_entry_t;
+
+APP_TIMER_DEF(m_rotate_timer_id);
+
+static relay_frame_update_handler_t m_frame_update_handler;
+static relay_time_beacon_handler_t m_time_beacon_handler;
+static uint16_t m_own_device_id;
+static bool m_is_scanning;
+
+static relay_entry_t m_entries[RELAY_DEVICE_MAX];
+static uint8_t m_frame_start_index;
+
+static relay_stats_t m_stats;
+
+static const ble_gap_scan_params_t m_scan_params =
+    {
+        .active = 0,
+        .selective = 0,
+        .p_whitelist = NULL,
+        .interval = MS_TO_SCAN_UNITS(RELAY_SCAN_INTERVAL),
+        .window = MS_TO_SCAN_UNITS(RELAY_SCAN_WINDOW),
+        .timeout = 0,
+};
+
+// Find an AD structure of the type in advertising data.
+static bool adv_data_find(uint8_t type, const uint8_t *p_data, uint16_t len, const uint8_t **pp_field, uint8_t *p_field_len)
+{
+    uint16_t index = 0;
+
+    while (index + 1 < len)
+    {
+        uint8_t field_len = p_data[index];
+
+        if (field_len == 0 || index + 1 + field_len > len)
+        {
+            return false;
+        }
+
+        if (p_data[index + 1] == type)
+        {
+            *pp_field = &p_data[index + 2];
+            *p_field_len = field_len - 1;
+            return true;
+        }
+
+        index += field_len + 1;
+    }
+
+    return false;
+}
+
+static uint8_t entry_cnt_get()
+{
+    uint8_t cnt = 0;
+
+    for (uint8_t i = 0; i < RELAY_DEVICE_MAX; i++)
+    {
+        if (m_entries[i].is_used)
+        {
+            cnt++;
+        }
+    }
+
+    return cnt;
+}
+
+static void entries_expire(uint32_t now_ticks)
+{
+    for (uint8_t i = 0; i < RELAY_DEVICE_MAX; i++)
+    {
+        uint32_t elapsed_ticks;
+
+        if (!m_entries[i].is_used)
+        {
+            continue;
+        }
+
+        app_timer_cnt_diff_compute(now_ticks, m_entries[i].last_heard_ticks, &elapsed_ticks);
+        if (elapsed_ticks > APP_TIMER_TICKS(RELAY_ENTRY_TIMEOUT * 1000, 0))
+        {
+            NRF_LOG_INFO("device %02x%02x is forgotten\n", m_entries[i].payload[1], m_entries[i].payload[0]);
+            m_entries[i].is_used = false;
+        }
+    }
+}
+
+// Keep the latest payload of each neighbour. Returns true if the table is changed.
+static bool entry_update(const uint8_t *p_payload, uint32_t now_ticks)
+{
+    relay_entry_t *p_free_entry = NULL;
+
+    m_stats.report_cnt++;
+
+    for (uint8_t i = 0; i < RELAY_DEVICE_MAX; i++)
+    {
+        relay_entry_t *p_entry = &m_entries[i];
+
+        if (!p_entry->is_used)
+        {
+            if (p_free_entry == NULL)
+            {
+                p_free_entry = p_entry;
+            }
+            continue;
+        }
+
+        // The first 2 bytes are the DeviceID.
+        if (memcmp(p_entry->payload, p_payload, 2) == 0)
+        {
+            p_entry->last_heard_ticks = now_ticks;
+
+            if (memcmp(p_entry->payload, p_payload, RELAY_ENTRY_LEN) == 0)
+            {
+                m_stats.duplicate_cnt++;
+                return false;
+            }
+
+            memcpy(p_entry->payload, p_payload, RELAY_ENTRY_LEN);
+            return true;
+        }
+    }
+
+    if (p_free_entry == NULL)
+    {
+        m_stats.drop_cnt++;
+        return false;
+    }
+
+    NRF_LOG_INFO("device %02x%02x is found\n", p_payload[1], p_payload[0]);
+
+    p_free_entry->is_used = true;
+    p_free_entry->last_heard_ticks = now_ticks;
+    memcpy(p_free_entry->payload, p_payload, RELAY_ENTRY_LEN);
+
+    return true;
+}
+
+static void on_adv_report(const ble_gap_evt_adv_report_t *p_adv_report)
+{
+    const uint8_t *p_field;
+    uint8_t field_len;
+    uint8_t payload[RELAY_ENTRY_LEN];
+    uint32_t now_ticks;
+
+    // A relayed frame is not relayed again, because it is only in the scan response.
+    if (p_adv_report->scan_rsp)
+    {
+        return;
+    }
+
+    // A time beacon comes from a bridge, not from an ENBLE.
+    if (adv_data_find(BLE_GAP_AD_TYPE_SERVICE_DATA, p_adv_report->data, p_adv_report->dlen, &p_field, &field_len) &&
+        field_len == 2 + RELAY_TIME_BEACON_LEN &&
+        uint16_decode(p_field) == RELAY_TIME_BEACON_UUID)
+    {
+        if (m_time_beacon_handler)
+        {
+            m_time_beacon_handler(uint32_decode(&p_field[2]), uint16_decode(&p_field[6]));
+        }
+        return;
+    }
+
+    if (!adv_data_find(BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME, p_adv_report->data, p_adv_report->dlen, &p_field, &field_len) ||
+        field_len != strlen(RELAY_LOCAL_NAME) ||
+        memcmp(p_field, RELAY_LOCAL_NAME, field_len) != 0)
+    {
+        return;
+    }
+
+    if (!adv_data_find(BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA, p_adv_report->data, p_adv_report->dlen, &p_field, &field_len) ||
+        (field_len != RELAY_MANUF_DATA_LEN && field_len != RELAY_MANUF_DATA_LEN_OLD))
+    {
+        return;
+    }
+
+    if (uint16_decode(p_field) == m_own_device_id)
+    {
+        return;
+    }
+
+    // The status flags of older firmware are 0.
+    memset(payload, 0, sizeof(payload));
+    memcpy(payload, p_field, field_len);
+
+    app_timer_cnt_get(&now_ticks);
+    if (entry_update(payload, now_ticks) && m_frame_update_handler)
+    {
+        m_frame_update_handler();
+    }
+}
+
+// This function is executed in the main loop through the scheduler, as the advertising reports.
+static void rotate_evt_handler()
+{
+    uint32_t now_ticks;
+    uint8_t cnt_before = entry_cnt_get();
+
+    app_timer_cnt_get(&now_ticks);
+    entries_expire(now_ticks);
+
+    if (cnt_before <= RELAY_FRAME_ENTRY_MAX && entry_cnt_get() == cnt_before)
+    {
+        return;
+    }
+
+    m_frame_start_index = (m_frame_start_index + RELAY_FRAME_ENTRY_MAX) % RELAY_DEVICE_MAX;
+
+    if (m_frame_update_handler)
+    {
+        m_frame_update_handler();
+    }
+}
+
+static void rotate_timer_handler(void *p_context)
+{
+    uint32_t err_code = scheduler_post(SCHEDULER_EVT_RELAY_TIMER, rotate_evt_handler);
+    APP_ERROR_CHECK(err_code);
+}
+
+uint32_t relay_init(uint16_t own_device_id, relay_frame_update_handler_t handler, relay_time_beacon_handler_t time_beacon_handler)
+{
+    m_own_device_id = own_device_id;
+    m_frame_update_handler = handler;
+    m_time_beacon_handler = time_beacon_handler;
+    m_is_scanning = false;
+    m_frame_start_index = 0;
+    memset(m_entries, 0, sizeof(m_entries));
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    return app_timer_create(&m_rotate_timer_id, APP_TIMER_MODE_REPEATED, rotate_timer_handler);
+}
+
+uint32_t relay_start()
+{
+    uint32_t err_code;
+
+    if (m_is_scanning)
+    {
+        return NRF_SUCCESS;
+    }
+
+    err_code = sd_ble_gap_scan_start(&m_scan_params);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    m_is_scanning = true;
+
+    return app_timer_start(m_rotate_timer_id, APP_TIMER_TICKS(RELAY_FRAME_ROTATE_INTERVAL, 0), NULL);
+}
+
+uint32_t relay_stop()
+{
+    uint32_t err_code;
+
+    if (!m_is_scanning)
+    {
+        return NRF_SUCCESS;
+    }
+
+    m_is_scanning = false;
+
+    err_code = app_timer_stop(m_rotate_timer_id);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    return sd_ble_gap_scan_stop();
+}
+
+void relay_own_device_id_set(uint16_t own_device_id)
+{
+    m_own_device_id = own_device_id;
+}
+
+// Called in the main loop through the scheduler.
+void relay_on_ble_evt(ble_evt_t *p_ble_evt)
+{
+    switch (p_ble_evt->header.evt_id)
+    {
+    case BLE_GAP_EVT_ADV_REPORT:
+        on_adv_report(&p_ble_evt->evt.gap_evt.params.adv_report);
+        break;
+
+    default:
+        // No implementation needed.
+        break;
+    }
+}
+
+// Entries from the current rotation position, up to RELAY_FRAME_ENTRY_MAX.
+uint8_t relay_frame_get(uint8_t *p_buffer)
+{
+    uint8_t len = 0;
+    uint8_t entry_cnt = 0;
+
+    for (uint8_t i = 0; i < RELAY_DEVICE_MAX && entry_cnt < RELAY_FRAME_ENTRY_MAX; i++)
+    {
+        const relay_entry_t *p_entry = &m_entries[(m_frame_start_index + i) % RELAY_DEVICE_MAX];
+
+        if (!p_entry->is_used)
+        {
+            continue;
+        }
+
+        memcpy(&p_buffer[len], p_entry->payload, RELAY_ENTRY_LEN);
+        len += RELAY_ENTRY_LEN;
+        entry_cnt++;
+    }
+
+    return len;
+}
+
+const relay_stats_t *relay_stats_get()
+{
+    return &m_stats;
+}
@@ -0,0 +1,45 @@
+#ifndef _RELAY_H
+#define _RELAY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ble.h"
+
+// Relay of the advertising data of neighbour ENBLEs.
+// The device scans as an observer at a low duty cycle, keeps the latest payload of each neighbour
+// and puts some of them in its own scan response. For ENBLEs powered by mains or AA batteries.
+// Enabled by the Makefile: make RELAY=1
+#ifndef RELAY_ENABLED
+#define RELAY_ENABLED 0
+#endif
+
+// Payload of a neighbour, same as its manufacturer data (DeviceID, 8 bytes of data and the status flags)
+#define RELAY_ENTRY_LEN 11
+// Entries in a relay frame. 2 entries fill the scan response with the service data header.
+#define RELAY_FRAME_ENTRY_MAX 2
+#define RELAY_FRAME_LEN_MAX (RELAY_ENTRY_LEN * RELAY_FRAME_ENTRY_MAX)
+
+// Time beacon: service data of 16 bit UUID 0x0003 with Unix time (uint32 s and uint16 ms)
+#define RELAY_TIME_BEACON_UUID 0x0003
+#define RELAY_TIME_BEACON_LEN 6
+
+typedef void (*relay_frame_update_handler_t)();
+typedef void (*relay_time_beacon_handler_t)(uint32_t epoch_s, uint16_t epoch_ms);
+
+typedef struct
+{
+    uint32_t report_cnt;    // advertising reports of ENBLEs
+    uint32_t duplicate_cnt; // reports with the same payload as the last one
+    uint32_t drop_cnt;      // reports of new neighbours dropped because the table is full
+} relay_stats_t;
+
+uint32_t relay_init(uint16_t own_device_id, relay_frame_update_handler_t handler, relay_time_beacon_handler_t time_beacon_handler);
+uint32_t relay_start();
+uint32_t relay_stop();
+void relay_own_device_id_set(uint16_t own_device_id);
+void relay_on_ble_evt(ble_evt_t *p_ble_evt);
+uint8_t relay_frame_get(uint8_t *p_buffer);
+const relay_stats_t *relay_stats_get();
+
+#endif
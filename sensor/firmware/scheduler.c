@@ -0,0 +1,88 @@
+#include "scheduler.h"
+
+#include <string.h>
+
+#include "app_scheduler.h"
+#include "app_timer.h"
+#include "softdevice_handler.h"
+
+#define NRF_LOG_MODULE_NAME "SCHEDULER"
+#define NRF_LOG_LEVEL 0
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+#define SCHEDULER_QUEUE_SIZE 8
+
+// event posted from interrupt context
+typedef struct
+{
+    scheduler_evt_t evt;
+    scheduler_evt_handler_t handler;
+} scheduler_evt_data_t;
+
+#define SCHEDULER_MAX_EVENT_DATA_SIZE MAX(sizeof(scheduler_evt_data_t), BLE_STACK_HANDLER_SCHED_EVT_SIZE)
+
+static scheduler_evt_stats_t m_evt_stats[SCHEDULER_EVT_COUNT];
+
+static void scheduler_evt_handler(void *p_event_data, uint16_t event_size)
+{
+    scheduler_evt_data_t *p_evt_data = (scheduler_evt_data_t *)p_event_data;
+
+    uint32_t begin_ticks = scheduler_profile_begin();
+    p_evt_data->handler();
+    scheduler_profile_end(p_evt_data->evt, begin_ticks);
+}
+
+uint32_t scheduler_init()
+{
+    memset(m_evt_stats, 0, sizeof(m_evt_stats));
+
+    APP_SCHED_INIT(SCHEDULER_MAX_EVENT_DATA_SIZE, SCHEDULER_QUEUE_SIZE);
+
+    return NRF_SUCCESS;
+}
+
+// This function can be called from any interrupt context.
+uint32_t scheduler_post(scheduler_evt_t evt, scheduler_evt_handler_t handler)
+{
+    scheduler_evt_data_t evt_data;
+    evt_data.evt = evt;
+    evt_data.handler = handler;
+
+    return app_sched_event_put(&evt_data, sizeof(evt_data), scheduler_evt_handler);
+}
+
+void scheduler_execute()
+{
+    app_sched_execute();
+}
+
+uint32_t scheduler_profile_begin()
+{
+    uint32_t ticks;
+    app_timer_cnt_get(&ticks);
+    return ticks;
+}
+
+void scheduler_profile_end(scheduler_evt_t evt, uint32_t begin_ticks)
+{
+    uint32_t end_ticks;
+    uint32_t elapsed_ticks;
+
+    app_timer_cnt_get(&end_ticks);
+    app_timer_cnt_diff_compute(end_ticks, begin_ticks, &elapsed_ticks);
+
+    scheduler_evt_stats_t *p_stats = &m_evt_stats[evt];
+    p_stats->count++;
+    p_stats->total_ticks += elapsed_ticks;
+    if (elapsed_ticks > p_stats->max_ticks)
+    {
+        p_stats->max_ticks = elapsed_ticks;
+        NRF_LOG_DEBUG("event %u takes %u ticks\n", evt, elapsed_ticks);
+    }
+}
+
+const scheduler_evt_stats_t *scheduler_evt_stats_get(scheduler_evt_t evt)
+{
+    return &m_evt_stats[evt];
+}
@@ -0,0 +1,42 @@
+#ifndef _SCHEDULER_H
+#define _SCHEDULER_H
+
+#include <stdint.h>
+
+// Events executed in the main loop.
+// Interrupt handlers only post these events and the actual work runs in thread mode,
+// so the SoftDevice and other peripherals are never delayed by the application.
+typedef enum
+{
+    SCHEDULER_EVT_BLE,
+    SCHEDULER_EVT_SYS,
+    SCHEDULER_EVT_MEASUREMENT_TIMER,
+    SCHEDULER_EVT_SENSOR_WAIT_TIMER,
+    SCHEDULER_EVT_SENSOR_DATA,
+    SCHEDULER_EVT_BATTERY_ADC,
+    SCHEDULER_EVT_BUTTON,
+    SCHEDULER_EVT_RADIO_NOTIFICATION,
+    SCHEDULER_EVT_RELAY_TIMER,
+    SCHEDULER_EVT_ADV_SLOT_TIMER,
+    SCHEDULER_EVT_COUNT
+} scheduler_evt_t;
+
+typedef void (*scheduler_evt_handler_t)();
+
+// Execution time of each event in RTC1 ticks (30.5 us)
+typedef struct
+{
+    uint32_t count;
+    uint32_t total_ticks;
+    uint32_t max_ticks;
+} scheduler_evt_stats_t;
+
+uint32_t scheduler_init();
+uint32_t scheduler_post(scheduler_evt_t evt, scheduler_evt_handler_t handler);
+void scheduler_execute();
+
+uint32_t scheduler_profile_begin();
+void scheduler_profile_end(scheduler_evt_t evt, uint32_t begin_ticks);
+const scheduler_evt_stats_t *scheduler_evt_stats_get(scheduler_evt_t evt);
+
+#endif
@@ -1,9 +1,19 @@
 #include "sensor.h"
 
+#include <string.h>
+
+#include "power_profile.h"
+#include "scheduler.h"
+#include "trace.h"
+
 #include "app_timer.h"
+#include "app_util_platform.h"
+#include "nrf_soc.h"
+#include "nrf_sdm.h"
 #include "nrf_drv_spi.h"
 #include "nrf_gpio.h"
 #include "nrf_drv_adc.h"
+#include "nrf_delay.h"
 
 
 #define NRF_LOG_MODULE_NAME "SENSOR"
@@ -12,7 +22,10 @@
 #include "nrf_log_ctrl.h"
 
 #define BME280_SPI_BUFFER_LEN 32
-#define BME280_SPI_CS_PIN 5
+// CS pins of BME280s on the SPI bus, one per channel. Set by the Makefile: make BME280_CS_PINS="5 6"
+#ifndef SENSOR_BME280_CS_PINS
+#define SENSOR_BME280_CS_PINS 5
+#endif
 #define BME280_SPI_SCK_PIN 1
 #define BME280_SPI_MOSI_PIN 3
 #define BME280_SPI_MISO_PIN 2
@@ -24,12 +37,47 @@
 #define BME280_RA_CALIB00 0x88 //26bytes
 #define BME280_RA_CALIB26 0xE1 //16bytes
 
-#define SENSOR_MEASUREMENT_WAIT_TIME 100
+// Channels compiled out by the profile are skipped by BME280 and not read.
+#if APP_CONFIG_HUMIDITY_ENABLED
+#define BME280_OSRS_H APP_CONFIG_BME280_OSRS_H
+#define BME280_MEASUREMENT_DATA_LEN 8 // press, temp, hum
+#else
+#define BME280_OSRS_H 0
+#define BME280_MEASUREMENT_DATA_LEN 6 // press, temp
+#endif
+#if APP_CONFIG_PRESSURE_ENABLED
+#define BME280_OSRS_P APP_CONFIG_BME280_OSRS_P
+#else
+#define BME280_OSRS_P 0
+#endif
+// [1:0] mode : 0 sleep, 1 forced
+// [4:2] osrs_p : pressure oversampling
+// [7:5] osrs_t : temperature oversampling
+#define BME280_CTRL_MEAS_SLEEP ((APP_CONFIG_BME280_OSRS_T << 5) | (BME280_OSRS_P << 2))
+#define BME280_CTRL_MEAS_FORCED (BME280_CTRL_MEAS_SLEEP | 0x01)
+
+#define BME280_STARTUP_TIME 2 // ms, from power on to the first communication
 #define BATTERY_ADC_RESULT_AVERAGE_CNT   10
 
+// Measurement sequence, can be set by the Makefile: make SENSOR_HW_TRIGGER=1
+// 0 : Each step is started by the CPU. SPI done (x2), ADC done and the wait timer wake the CPU.
+// 1 : RTC1 compare starts ADC through PPI after the wait time, and ADC done wakes the CPU only once.
+//     BME280 is read by blocking SPI then. SPI of nRF51 has no task to be triggered by PPI.
+#ifndef SENSOR_HW_TRIGGER_ENABLED
+#define SENSOR_HW_TRIGGER_ENABLED 0
+#endif
+#define SENSOR_PPI_CHANNEL 0  // channel 0 - 7 are available to the application with S130
+#define SENSOR_RTC_CC_INDEX 1 // CC[0] of RTC1 is used by app_timer
+#define SENSOR_MEASUREMENT_TIMEOUT (SENSOR_MEASUREMENT_WAIT_TIME + 50)
+
+#if SENSOR_HW_TRIGGER_ENABLED && !APP_CONFIG_BATTERY_ENABLED
+#error "SENSOR_HW_TRIGGER needs the battery ADC, which wakes the CPU"
+#endif
+
 #define MARGE_16BIT(H, L) ((((uint16_t)H) << 8) | ((uint16_t)L))
 #define MARGE_20BIT(H, L, XL) ((((uint32_t)H) << 12) | (((uint32_t)L) << 4) | (((uint32_t)XL) >> 4))
 
+#if APP_CONFIG_BATTERY_ENABLED
 // ADC config
 // reference : internal 1.2V
 // input : VDD / 3
@@ -40,6 +88,7 @@ static const nrf_drv_adc_channel_t adc_channel_config =
        .ain = NRF_ADC_CONFIG_INPUT_DISABLED}}};
 
 static const nrf_drv_adc_config_t adc_config = NRF_DRV_ADC_DEFAULT_CONFIG;
+#endif
 
 // SPI config
 static nrf_drv_spi_config_t spi_config =
@@ -57,24 +106,25 @@ static nrf_drv_spi_config_t spi_config =
 static const nrf_drv_spi_t m_bme280_spi_master = NRF_DRV_SPI_INSTANCE(0);
 static uint8_t m_bme280_spi_tx_buffer[BME280_SPI_BUFFER_LEN]; ///< SPI master TX buffer.
 static uint8_t m_bme280_spi_rx_buffer[BME280_SPI_BUFFER_LEN]; ///< SPI master RX buffer.
-static volatile bool m_bme280_spi_transfer_completed = false;
 
 static sensor_data_handler_t m_sensor_data_handler = NULL;
-static volatile bool m_bme280_receiving_measurement_data = false;
-static SensorMeasurementData m_sensor_measurment_data;
+static SensorMeasurementData m_sensor_measurment_data[SENSOR_CHANNEL_CNT];
 
+#if APP_CONFIG_BATTERY_ENABLED
 // to calc moving average of battery adc result, use the following buffer and index as circular buffer
 static uint32_t m_battery_adc_result_buffer[BATTERY_ADC_RESULT_AVERAGE_CNT];
 static uint8_t m_battery_adc_result_buffer_index;
-static bool m_is_first_measurement;
 static nrf_adc_value_t m_battery_adc_result;
+#endif
+
+static sensor_stats_t m_stats;
 
 
 APP_TIMER_DEF(m_sensor_measurement_wait_timer_id);
 
 // calibration parameters
 // details are in datesheet of BME280
-static struct
+typedef struct
 {
     uint16_t dig_T1;
     int16_t dig_T2;
@@ -95,87 +145,159 @@ static struct
     int16_t dig_H5;
     int8_t dig_H6;
     int32_t t_fine;
-} m_bme280_calib_data;
+} bme280_calib_data_t;
+
+// Context of a BME280 on the SPI bus
+typedef struct
+{
+    uint8_t cs_pin;
+    bme280_calib_data_t calib_data;
+    uint8_t measurement_data[BME280_MEASUREMENT_DATA_LEN]; // raw data read in the last measurement
+} bme280_t;
+
+static const uint8_t m_bme280_cs_pins[] = {SENSOR_BME280_CS_PINS};
+STATIC_ASSERT(sizeof(m_bme280_cs_pins) == SENSOR_CHANNEL_CNT);
+
+static bme280_t m_bme280[SENSOR_CHANNEL_CNT];
+
+#if !SENSOR_HW_TRIGGER_ENABLED
+// All sensors are accessed back to back in one SPI session.
+// The next transfer is started in the SPI done interrupt of the previous one.
+typedef enum
+{
+    BME280_SESSION_START_FORCED_MODE,
+    BME280_SESSION_READ_MEASUREMENT_DATA,
+} bme280_session_t;
 
+static bme280_session_t m_bme280_session;
+static uint8_t m_bme280_session_index;
+#endif
 
-static void bme280_spi_master_event_handler(nrf_drv_spi_evt_t const *p_event);
+static uint32_t stats_begin()
+{
+    uint32_t ticks;
+    app_timer_cnt_get(&ticks);
+    return ticks;
+}
 
-static void bme280_spi_assert_cs()
+// A handler is shorter than a RTC1 tick in most cases, but the difference of the counter
+// is 1 with the probability of its duration over a tick. So the sum is the expected active time.
+static void stats_end(uint32_t begin_ticks, bool is_wakeup)
 {
-    nrf_gpio_pin_clear(BME280_SPI_CS_PIN);
+    uint32_t end_ticks;
+    uint32_t active_ticks;
+
+    app_timer_cnt_get(&end_ticks);
+    app_timer_cnt_diff_compute(end_ticks, begin_ticks, &active_ticks);
+
+    CRITICAL_REGION_ENTER();
+    m_stats.active_ticks += active_ticks;
+    if (is_wakeup)
+    {
+        m_stats.wakeup_cnt++;
+    }
+    CRITICAL_REGION_EXIT();
 }
 
-static void bme280_spi_deassert_cs()
+// SPI runs on HFCLK while CS is asserted
+static void bme280_spi_assert_cs(const bme280_t *p_bme280)
 {
-    nrf_gpio_pin_set(BME280_SPI_CS_PIN);
+    power_profile_hfclk_request();
+    nrf_gpio_pin_clear(p_bme280->cs_pin);
 }
 
-static uint32_t bme280_spi_start_write_reg_byte(uint8_t reg_addr, uint8_t data)
+static void bme280_spi_deassert_cs(const bme280_t *p_bme280)
+{
+    nrf_gpio_pin_set(p_bme280->cs_pin);
+    power_profile_hfclk_release();
+}
+
+// Transfer without SPI interrupt in a session opened by nrf_drv_spi_init() without a handler.
+// A few bytes at 1 MHz take less time than an interrupt wakeup.
+static uint32_t bme280_spi_transfer_blocking(const bme280_t *p_bme280, uint8_t len)
 {
     uint32_t err_code;
 
-    m_bme280_spi_tx_buffer[0] = reg_addr & 0x7f;
-    m_bme280_spi_tx_buffer[1] = data;
+    bme280_spi_assert_cs(p_bme280);
+    err_code = nrf_drv_spi_transfer(&m_bme280_spi_master, m_bme280_spi_tx_buffer, len, m_bme280_spi_rx_buffer, len);
+    bme280_spi_deassert_cs(p_bme280);
 
-    m_bme280_spi_transfer_completed = false;
+    return err_code;
+}
 
-    err_code = nrf_drv_spi_init(&m_bme280_spi_master, &spi_config, bme280_spi_master_event_handler);
+static uint32_t bme280_read_reg_bytes(const bme280_t *p_bme280, uint8_t reg_addr, uint8_t len)
+{
+    uint32_t err_code;
+
+    m_bme280_spi_tx_buffer[0] = reg_addr | 0x80;
+    memset(&m_bme280_spi_tx_buffer[1], 0, len);
+
+    err_code = nrf_drv_spi_init(&m_bme280_spi_master, &spi_config, NULL);
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
     }
 
-    bme280_spi_assert_cs();
-    err_code = nrf_drv_spi_transfer(&m_bme280_spi_master, m_bme280_spi_tx_buffer, 2, m_bme280_spi_rx_buffer, 2);
+    err_code = bme280_spi_transfer_blocking(p_bme280, len + 1);
+
+    nrf_drv_spi_uninit(&m_bme280_spi_master);
 
     return err_code;
 }
 
-static uint32_t bme280_spi_start_read_reg_bytes(uint8_t reg_addr, uint8_t len)
+static uint32_t bme280_write_reg_byte(const bme280_t *p_bme280, uint8_t reg_addr, uint8_t data)
 {
     uint32_t err_code;
 
-    m_bme280_spi_tx_buffer[0] = reg_addr | 0x80;
-    m_bme280_spi_tx_buffer[1] = 0x00;
-
-    m_bme280_spi_transfer_completed = false;
+    m_bme280_spi_tx_buffer[0] = reg_addr & 0x7f;
+    m_bme280_spi_tx_buffer[1] = data;
 
-    err_code = nrf_drv_spi_init(&m_bme280_spi_master, &spi_config, bme280_spi_master_event_handler);
+    err_code = nrf_drv_spi_init(&m_bme280_spi_master, &spi_config, NULL);
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
     }
 
-    bme280_spi_assert_cs();
-    err_code = nrf_drv_spi_transfer(&m_bme280_spi_master, m_bme280_spi_tx_buffer, len + 1, m_bme280_spi_rx_buffer, len + 1);
+    err_code = bme280_spi_transfer_blocking(p_bme280, 2);
+
+    nrf_drv_spi_uninit(&m_bme280_spi_master);
 
     return err_code;
 }
 
-static void bme280_spi_wait_for_transfer_complete()
+static uint8_t bme280_prepare_start_forced_mode()
 {
-    while (!m_bme280_spi_transfer_completed)
-        ;
-    nrf_drv_spi_uninit(&m_bme280_spi_master);
+    m_bme280_spi_tx_buffer[0] = BME280_RA_CTRL_MEAS & 0x7f;
+    m_bme280_spi_tx_buffer[1] = BME280_CTRL_MEAS_FORCED;
+
+    return 2;
+}
+
+static uint8_t bme280_prepare_read_measurement_data()
+{
+    m_bme280_spi_tx_buffer[0] = BME280_RA_MEASURMENT_DATA | 0x80;
+    memset(&m_bme280_spi_tx_buffer[1], 0, BME280_MEASUREMENT_DATA_LEN);
+
+    return BME280_MEASUREMENT_DATA_LEN + 1;
 }
 
 // calibration code is cited from below url.
 // https://github.com/BoschSensortec/BME280_driver
 
 // Returns temperature in DegC, resolution is 0.01 DegC. Output value of 5123 equals 51.23 DegC.
-// t_fine carries fine temperature as global value
-static int32_t bme280_compensate_temperature(uint32_t uncomp_data)
+// t_fine carries fine temperature to the pressure and humidity compensation
+static int32_t bme280_compensate_temperature(bme280_calib_data_t *p_calib, uint32_t uncomp_data)
 {
     int32_t var1, var2, temperature;
     const int32_t temperature_min = -4000;
     const int32_t temperature_max = 8500;
 
-    var1 = (int32_t)(((int32_t)uncomp_data >> 3) - ((int32_t)m_bme280_calib_data.dig_T1 << 1));
-    var1 = (var1 * ((int32_t)m_bme280_calib_data.dig_T2)) >> 11;
-    var2 = (int32_t)(((int32_t)uncomp_data >> 4) - ((int32_t)m_bme280_calib_data.dig_T1));
-    var2 = (((var2 * var2) >> 12) * ((int32_t)m_bme280_calib_data.dig_T3)) >> 14;
-    m_bme280_calib_data.t_fine = var1 + var2;
-    temperature = (m_bme280_calib_data.t_fine * 5 + 128) >> 8;
+    var1 = (int32_t)(((int32_t)uncomp_data >> 3) - ((int32_t)p_calib->dig_T1 << 1));
+    var1 = (var1 * ((int32_t)p_calib->dig_T2)) >> 11;
+    var2 = (int32_t)(((int32_t)uncomp_data >> 4) - ((int32_t)p_calib->dig_T1));
+    var2 = (((var2 * var2) >> 12) * ((int32_t)p_calib->dig_T3)) >> 14;
+    p_calib->t_fine = var1 + var2;
+    temperature = (p_calib->t_fine * 5 + 128) >> 8;
 
     if (temperature < temperature_min)
     {
@@ -189,8 +311,9 @@ static int32_t bme280_compensate_temperature(uint32_t uncomp_data)
     return temperature;
 }
 
+#if APP_CONFIG_PRESSURE_ENABLED
 // Returns pressure in Pa as unsigned 32 bit integer. Output value of 96386 equals 96386 Pa = 963.86 hPa
-static uint32_t bme280_compensate_pressure(uint32_t uncomp_data)
+static uint32_t bme280_compensate_pressure(bme280_calib_data_t *p_calib, uint32_t uncomp_data)
 {
     int32_t var1, var2, var3, var4;
     uint32_t var5;
@@ -198,14 +321,14 @@ static uint32_t bme280_compensate_pressure(uint32_t uncomp_data)
     const uint32_t pressure_min = 30000;
     const uint32_t pressure_max = 110000;
 
-    var1 = (((int32_t)m_bme280_calib_data.t_fine) >> 1) - (int32_t)64000;
-    var2 = (((var1 >> 2) * (var1 >> 2)) / 11) * ((int32_t)m_bme280_calib_data.dig_P6);
-    var2 = var2 + ((var1 * ((int32_t)m_bme280_calib_data.dig_P5)) << 1);
-    var2 = (var2 >> 2) + (((int32_t)m_bme280_calib_data.dig_P4) << 16);
-    var3 = (m_bme280_calib_data.dig_P3 * (((var1 >> 2) * (var1 >> 2)) >> 13)) >> 3;
-    var4 = (((int32_t)m_bme280_calib_data.dig_P2) * var1) >> 1;
+    var1 = (((int32_t)p_calib->t_fine) >> 1) - (int32_t)64000;
+    var2 = (((var1 >> 2) * (var1 >> 2)) / 11) * ((int32_t)p_calib->dig_P6);
+    var2 = var2 + ((var1 * ((int32_t)p_calib->dig_P5)) << 1);
+    var2 = (var2 >> 2) + (((int32_t)p_calib->dig_P4) << 16);
+    var3 = (p_calib->dig_P3 * (((var1 >> 2) * (var1 >> 2)) >> 13)) >> 3;
+    var4 = (((int32_t)p_calib->dig_P2) * var1) >> 1;
     var1 = (var3 + var4) >> 18;
-    var1 = (((32768 + var1)) * ((int32_t)m_bme280_calib_data.dig_P1)) >> 15;
+    var1 = (((32768 + var1)) * ((int32_t)p_calib->dig_P1)) >> 15;
     /* avoid exception caused by division by zero */
     if (var1)
     {
@@ -220,9 +343,9 @@ static uint32_t bme280_compensate_pressure(uint32_t uncomp_data)
             pressure = (pressure / (uint32_t)var1) * 2;
         }
 
-        var1 = (((int32_t)m_bme280_calib_data.dig_P9) * ((int32_t)(((pressure >> 3) * (pressure >> 3)) >> 13))) >> 12;
-        var2 = (((int32_t)(pressure >> 2)) * ((int32_t)m_bme280_calib_data.dig_P8)) >> 13;
-        pressure = (uint32_t)((int32_t)pressure + ((var1 + var2 + m_bme280_calib_data.dig_P7) >> 4));
+        var1 = (((int32_t)p_calib->dig_P9) * ((int32_t)(((pressure >> 3) * (pressure >> 3)) >> 13))) >> 12;
+        var2 = (((int32_t)(pressure >> 2)) * ((int32_t)p_calib->dig_P8)) >> 13;
+        pressure = (uint32_t)((int32_t)pressure + ((var1 + var2 + p_calib->dig_P7) >> 4));
 
         if (pressure < pressure_min)
         {
@@ -240,9 +363,11 @@ static uint32_t bme280_compensate_pressure(uint32_t uncomp_data)
 
     return pressure;
 }
+#endif
 
+#if APP_CONFIG_HUMIDITY_ENABLED
 // Returns humidity in %, resolution is 0.001 %. Output value of 51232 equals 51.232 %.
-static uint32_t bme280_compensate_humidity(uint32_t uncomp_data)
+static uint32_t bme280_compensate_humidity(bme280_calib_data_t *p_calib, uint32_t uncomp_data)
 {
     int32_t var1;
     int32_t var2;
@@ -252,18 +377,18 @@ static uint32_t bme280_compensate_humidity(uint32_t uncomp_data)
     uint32_t humidity;
     const uint32_t humidity_max = 102400;
 
-    var1 = m_bme280_calib_data.t_fine - ((int32_t)76800);
+    var1 = p_calib->t_fine - ((int32_t)76800);
     var2 = (int32_t)(uncomp_data << 14);
-    var3 = (int32_t)(((int32_t)m_bme280_calib_data.dig_H4) << 20);
-    var4 = ((int32_t)m_bme280_calib_data.dig_H5) * var1;
+    var3 = (int32_t)(((int32_t)p_calib->dig_H4) << 20);
+    var4 = ((int32_t)p_calib->dig_H5) * var1;
     var5 = (((var2 - var3) - var4) + (int32_t)16384) >> 15;
-    var2 = (var1 * ((int32_t)m_bme280_calib_data.dig_H6)) >> 10;
-    var3 = (var1 * ((int32_t)m_bme280_calib_data.dig_H3)) >> 11;
+    var2 = (var1 * ((int32_t)p_calib->dig_H6)) >> 10;
+    var3 = (var1 * ((int32_t)p_calib->dig_H3)) >> 11;
     var4 = ((var2 * (var3 + (int32_t)32768)) >> 10) + (int32_t)2097152;
-    var2 = ((var4 * ((int32_t)m_bme280_calib_data.dig_H2)) + 8192) >> 14;
+    var2 = ((var4 * ((int32_t)p_calib->dig_H2)) + 8192) >> 14;
     var3 = var5 * var2;
     var4 = ((var3 >> 15) * (var3 >> 15)) >> 7;
-    var5 = var3 - ((var4 * ((int32_t)m_bme280_calib_data.dig_H1)) >> 4);
+    var5 = var3 - ((var4 * ((int32_t)p_calib->dig_H1)) >> 4);
     var5 = (var5 < 0 ? 0 : var5);
     var5 = (var5 > 419430400 ? 419430400 : var5);
     humidity = (uint32_t)(var5 >> 12);
@@ -275,26 +400,38 @@ static uint32_t bme280_compensate_humidity(uint32_t uncomp_data)
 
     return humidity;
 }
+#endif
 
-static void parse_sensor_data()
+static void parse_sensor_data(bme280_t *p_bme280, SensorMeasurementData *p_measurement_data)
 {
-    uint32_t temperature_uncomp_data = MARGE_20BIT(m_bme280_spi_rx_buffer[4], m_bme280_spi_rx_buffer[5], m_bme280_spi_rx_buffer[6]);
-    uint32_t pressure_uncomp_data = MARGE_20BIT(m_bme280_spi_rx_buffer[1], m_bme280_spi_rx_buffer[2], m_bme280_spi_rx_buffer[3]);
-    uint32_t humidity_uncomp_data = MARGE_16BIT(m_bme280_spi_rx_buffer[7], m_bme280_spi_rx_buffer[8]);
+    const uint8_t *p_raw = p_bme280->measurement_data;
 
     // temperature in DegC, resolution is 0.01 DegC
-    int32_t temperature_data = bme280_compensate_temperature(temperature_uncomp_data);
-    // pressure in Pa
-    uint32_t pressure_data = bme280_compensate_pressure(pressure_uncomp_data);
-    // humidity in %, resolution is 0.001 %
-    uint32_t humidity_data = bme280_compensate_humidity(humidity_uncomp_data);
+    // This updates t_fine, which the compensation of pressure and humidity uses.
+    uint32_t temperature_uncomp_data = MARGE_20BIT(p_raw[3], p_raw[4], p_raw[5]);
+    int32_t temperature_data = bme280_compensate_temperature(&p_bme280->calib_data, temperature_uncomp_data);
+    p_measurement_data->temperature = (int16_t)(temperature_data);
 
-    // temperature in DegC, resolution is 0.01 DegC
-    m_sensor_measurment_data.temperature = (int16_t)(temperature_data);
+#if APP_CONFIG_PRESSURE_ENABLED
+    // pressure in Pa
+    uint32_t pressure_uncomp_data = MARGE_20BIT(p_raw[0], p_raw[1], p_raw[2]);
+    uint32_t pressure_data = bme280_compensate_pressure(&p_bme280->calib_data, pressure_uncomp_data);
     // air pressure in Pa, resolution is 10 Pa
-    m_sensor_measurment_data.pressure = (uint16_t)(pressure_data / 10);
+    p_measurement_data->pressure = (uint16_t)(pressure_data / 10);
+#endif
+
+#if APP_CONFIG_HUMIDITY_ENABLED
+    // humidity in %, Q22.10 (resolution is 1/1024 %)
+    uint32_t humidity_uncomp_data = MARGE_16BIT(p_raw[6], p_raw[7]);
+    uint32_t humidity_data = bme280_compensate_humidity(&p_bme280->calib_data, humidity_uncomp_data);
     // humidity in %, resolution is 0.1 %
-    m_sensor_measurment_data.humidity = (uint16_t)(humidity_data / 100);
+    p_measurement_data->humidity = (uint16_t)((humidity_data * 10) >> 10);
+#endif
+}
+
+#if APP_CONFIG_BATTERY_ENABLED
+static uint16_t battery_voltage_get()
+{
     // battery voltage in mV
     uint32_t adc_result_averaged = 0;
     for (uint8_t i=0;i<BATTERY_ADC_RESULT_AVERAGE_CNT;i++)
@@ -302,47 +439,135 @@ static void parse_sensor_data()
         adc_result_averaged += (uint32_t)m_battery_adc_result_buffer[i];
     }
     adc_result_averaged = adc_result_averaged / BATTERY_ADC_RESULT_AVERAGE_CNT;
-    m_sensor_measurment_data.battery = (uint16_t)((uint32_t)adc_result_averaged * 3600 / 1024);
+    return (uint16_t)((uint32_t)adc_result_averaged * 3600 / 1024);
+}
+#else
+// Not measured in this profile
+static uint16_t battery_voltage_get()
+{
+    return 0;
 }
+#endif
 
-void bme280_spi_master_event_handler(nrf_drv_spi_evt_t const *p_event)
+// This function is executed in the main loop through the scheduler.
+static void sensor_data_evt_handler()
 {
+    uint32_t begin_ticks = stats_begin();
+    uint16_t battery = battery_voltage_get();
+
+    TRACE_BEGIN(TRACE_STAGE_COMPENSATION);
+    for (uint8_t i = 0; i < SENSOR_CHANNEL_CNT; i++)
+    {
+        parse_sensor_data(&m_bme280[i], &m_sensor_measurment_data[i]);
+        m_sensor_measurment_data[i].battery = battery;
+    }
+    TRACE_END(TRACE_STAGE_COMPENSATION);
+
+    if (m_sensor_data_handler)
+    {
+        m_sensor_data_handler(m_sensor_measurment_data);
+    }
+
+#if APP_CONFIG_BATTERY_ENABLED
+    nrf_drv_adc_uninit();
+#endif
+
+    stats_end(begin_ticks, false);
+}
+
+#if !SENSOR_HW_TRIGGER_ENABLED
+static uint32_t bme280_session_transfer()
+{
+    uint8_t len;
+
+    if (m_bme280_session == BME280_SESSION_READ_MEASUREMENT_DATA)
+    {
+        len = bme280_prepare_read_measurement_data();
+    }
+    else
+    {
+        len = bme280_prepare_start_forced_mode();
+    }
+
+    bme280_spi_assert_cs(&m_bme280[m_bme280_session_index]);
+    return nrf_drv_spi_transfer(&m_bme280_spi_master, m_bme280_spi_tx_buffer, len, m_bme280_spi_rx_buffer, len);
+}
+
+static void bme280_spi_master_event_handler(nrf_drv_spi_evt_t const *p_event)
+{
+    uint32_t err_code;
+    uint32_t begin_ticks = stats_begin();
+
     switch (p_event->type)
     {
     case NRF_DRV_SPI_EVENT_DONE:
-        if (m_bme280_receiving_measurement_data)
-        {
-            parse_sensor_data();
-
-            if (m_sensor_data_handler)
-            {
-                m_sensor_data_handler(&m_sensor_measurment_data);
-            }
-            m_bme280_receiving_measurement_data = false;
+        bme280_spi_deassert_cs(&m_bme280[m_bme280_session_index]);
 
-            nrf_drv_adc_uninit();
+        if (m_bme280_session == BME280_SESSION_READ_MEASUREMENT_DATA)
+        {
+            memcpy(m_bme280[m_bme280_session_index].measurement_data, &m_bme280_spi_rx_buffer[1], BME280_MEASUREMENT_DATA_LEN);
         }
 
-        m_bme280_spi_transfer_completed = true;
-        bme280_spi_deassert_cs();
+        m_bme280_session_index++;
+        if (m_bme280_session_index < SENSOR_CHANNEL_CNT)
+        {
+            err_code = bme280_session_transfer();
+            APP_ERROR_CHECK(err_code);
+            break;
+        }
 
         nrf_drv_spi_uninit(&m_bme280_spi_master);
+
+        // Only post the received data to the main loop.
+        // The raw data is not touched until the next measurement starts.
+        if (m_bme280_session == BME280_SESSION_READ_MEASUREMENT_DATA)
+        {
+            TRACE_END(TRACE_STAGE_SPI_READ);
+
+            err_code = scheduler_post(SCHEDULER_EVT_SENSOR_DATA, sensor_data_evt_handler);
+            APP_ERROR_CHECK(err_code);
+        }
+        else
+        {
+            TRACE_END(TRACE_STAGE_SPI_TRIGGER);
+            TRACE_BEGIN(TRACE_STAGE_CONVERSION_WAIT);
+        }
         break;
 
     default:
         // No implementation needed.
         break;
     }
+
+    stats_end(begin_ticks, true);
 }
 
-static uint32_t bme280_check_chip_id()
+static uint32_t bme280_session_start(bme280_session_t session)
 {
-    uint32_t err_code = bme280_spi_start_read_reg_bytes(BME280_RA_CHIP_ID, 1);
+    uint32_t err_code;
+
+    m_bme280_session = session;
+    m_bme280_session_index = 0;
+
+    TRACE_BEGIN((session == BME280_SESSION_READ_MEASUREMENT_DATA) ? TRACE_STAGE_SPI_READ : TRACE_STAGE_SPI_TRIGGER);
+
+    err_code = nrf_drv_spi_init(&m_bme280_spi_master, &spi_config, bme280_spi_master_event_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    return bme280_session_transfer();
+}
+#endif
+
+static uint32_t bme280_check_chip_id(const bme280_t *p_bme280)
+{
+    uint32_t err_code = bme280_read_reg_bytes(p_bme280, BME280_RA_CHIP_ID, 1);
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
     }
-    bme280_spi_wait_for_transfer_complete();
 
     if (m_bme280_spi_rx_buffer[1] != 0x60)
     {
@@ -352,51 +577,61 @@ static uint32_t bme280_check_chip_id()
     return NRF_SUCCESS;
 }
 
-static uint32_t bme280_read_calibration_data()
+static uint32_t bme280_read_calibration_data(bme280_t *p_bme280)
 {
     uint32_t err_code;
-    err_code = bme280_spi_start_read_reg_bytes(BME280_RA_CALIB00, 26);
+    bme280_calib_data_t *p_calib = &p_bme280->calib_data;
+
+    err_code = bme280_read_reg_bytes(p_bme280, BME280_RA_CALIB00, 26);
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
     }
-    bme280_spi_wait_for_transfer_complete();
 
-    m_bme280_calib_data.dig_T1 = MARGE_16BIT(m_bme280_spi_rx_buffer[2], m_bme280_spi_rx_buffer[1]);
-    m_bme280_calib_data.dig_T2 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[4], m_bme280_spi_rx_buffer[3]);
-    m_bme280_calib_data.dig_T3 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[6], m_bme280_spi_rx_buffer[5]);
+    p_calib->dig_T1 = MARGE_16BIT(m_bme280_spi_rx_buffer[2], m_bme280_spi_rx_buffer[1]);
+    p_calib->dig_T2 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[4], m_bme280_spi_rx_buffer[3]);
+    p_calib->dig_T3 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[6], m_bme280_spi_rx_buffer[5]);
 
-    m_bme280_calib_data.dig_P1 = MARGE_16BIT(m_bme280_spi_rx_buffer[8], m_bme280_spi_rx_buffer[7]);
-    m_bme280_calib_data.dig_P2 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[10], m_bme280_spi_rx_buffer[9]);
-    m_bme280_calib_data.dig_P3 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[12], m_bme280_spi_rx_buffer[11]);
-    m_bme280_calib_data.dig_P4 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[14], m_bme280_spi_rx_buffer[13]);
-    m_bme280_calib_data.dig_P5 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[16], m_bme280_spi_rx_buffer[15]);
-    m_bme280_calib_data.dig_P6 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[18], m_bme280_spi_rx_buffer[17]);
-    m_bme280_calib_data.dig_P7 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[20], m_bme280_spi_rx_buffer[19]);
-    m_bme280_calib_data.dig_P8 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[22], m_bme280_spi_rx_buffer[21]);
-    m_bme280_calib_data.dig_P9 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[24], m_bme280_spi_rx_buffer[23]);
+    p_calib->dig_P1 = MARGE_16BIT(m_bme280_spi_rx_buffer[8], m_bme280_spi_rx_buffer[7]);
+    p_calib->dig_P2 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[10], m_bme280_spi_rx_buffer[9]);
+    p_calib->dig_P3 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[12], m_bme280_spi_rx_buffer[11]);
+    p_calib->dig_P4 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[14], m_bme280_spi_rx_buffer[13]);
+    p_calib->dig_P5 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[16], m_bme280_spi_rx_buffer[15]);
+    p_calib->dig_P6 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[18], m_bme280_spi_rx_buffer[17]);
+    p_calib->dig_P7 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[20], m_bme280_spi_rx_buffer[19]);
+    p_calib->dig_P8 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[22], m_bme280_spi_rx_buffer[21]);
+    p_calib->dig_P9 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[24], m_bme280_spi_rx_buffer[23]);
 
-    m_bme280_calib_data.dig_H1 = m_bme280_spi_rx_buffer[26];
+    p_calib->dig_H1 = m_bme280_spi_rx_buffer[26];
 
-    err_code = bme280_spi_start_read_reg_bytes(BME280_RA_CALIB26, 6);
+    err_code = bme280_read_reg_bytes(p_bme280, BME280_RA_CALIB26, 7);
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
     }
-    bme280_spi_wait_for_transfer_complete();
 
-    m_bme280_calib_data.dig_H2 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[2], m_bme280_spi_rx_buffer[1]);
-    m_bme280_calib_data.dig_H3 = m_bme280_spi_rx_buffer[3];
-    m_bme280_calib_data.dig_H4 = (int16_t)((((uint16_t)m_bme280_spi_rx_buffer[4]) << 4) | (m_bme280_spi_rx_buffer[5] & 0x0f));
-    m_bme280_calib_data.dig_H5 = (int16_t)((((uint16_t)m_bme280_spi_rx_buffer[6]) << 4) | (m_bme280_spi_rx_buffer[5] >> 4));
+    p_calib->dig_H2 = (int16_t)MARGE_16BIT(m_bme280_spi_rx_buffer[2], m_bme280_spi_rx_buffer[1]);
+    p_calib->dig_H3 = m_bme280_spi_rx_buffer[3];
+    p_calib->dig_H4 = (int16_t)((((uint16_t)m_bme280_spi_rx_buffer[4]) << 4) | (m_bme280_spi_rx_buffer[5] & 0x0f));
+    p_calib->dig_H5 = (int16_t)((((uint16_t)m_bme280_spi_rx_buffer[6]) << 4) | (m_bme280_spi_rx_buffer[5] >> 4));
+    p_calib->dig_H6 = (int8_t)m_bme280_spi_rx_buffer[7];
 
     return NRF_SUCCESS;
 }
 
-static uint32_t bme280_read_measurement_data()
+static uint32_t bme280_config_measurement(const bme280_t *p_bme280)
 {
     uint32_t err_code;
-    err_code = bme280_spi_start_read_reg_bytes(BME280_RA_MEASURMENT_DATA, 8);
+
+    // [2:0] osrs_h : humidity oversampling
+    err_code = bme280_write_reg_byte(p_bme280, BME280_RA_CTRL_HUM, BME280_OSRS_H);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    // enter sleep mode
+    err_code = bme280_write_reg_byte(p_bme280, BME280_RA_CTRL_MEAS, BME280_CTRL_MEAS_SLEEP);
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
@@ -404,72 +639,228 @@ static uint32_t bme280_read_measurement_data()
 
     return NRF_SUCCESS;
 }
+#if SENSOR_HW_TRIGGER_ENABLED
+static bool m_is_hw_trigger_enabled;
 
-static uint32_t bme280_config_measurement()
+// The first measurement starts before the SoftDevice is enabled.
+// PPI is accessed directly then, because the SoftDevice calls are not available.
+static bool is_softdevice_enabled()
+{
+    uint8_t is_enabled = 0;
+
+    sd_softdevice_is_enabled(&is_enabled);
+
+    return is_enabled != 0;
+}
+
+static void hw_trigger_disable()
 {
     uint32_t err_code;
 
-    // [2:0] osrs_h=1 : humidity oversample x1
-    err_code = bme280_spi_start_write_reg_byte(BME280_RA_CTRL_HUM, 1);
-    if (err_code != NRF_SUCCESS)
+    m_is_hw_trigger_enabled = false;
+    NRF_RTC1->EVTENCLR = RTC_EVTEN_COMPARE1_Msk;
+
+    if (!is_softdevice_enabled())
     {
-        return err_code;
+        NRF_PPI->CHENCLR = 1 << SENSOR_PPI_CHANNEL;
+        return;
     }
-    bme280_spi_wait_for_transfer_complete();
 
-    // [1:0] mode=0 : enter sleep mode
-    // [4:2] osrs_p=1 : pressure oversample x1
-    // [7:5] osrs_t=1 : temperature oversample x1
-    err_code = bme280_spi_start_write_reg_byte(BME280_RA_CTRL_MEAS, 0x24);
-    if (err_code != NRF_SUCCESS)
+    err_code = sd_ppi_channel_enable_clr(1 << SENSOR_PPI_CHANNEL);
+    APP_ERROR_CHECK(err_code);
+}
+
+// ADC sample starts at the compare event of RTC1 after the wait time without CPU.
+static uint32_t hw_trigger_enable()
+{
+    uint32_t err_code;
+    uint32_t now_ticks;
+
+    if (!is_softdevice_enabled())
     {
-        return err_code;
+        NRF_PPI->CH[SENSOR_PPI_CHANNEL].EEP = (uint32_t)(uintptr_t)&NRF_RTC1->EVENTS_COMPARE[SENSOR_RTC_CC_INDEX];
+        NRF_PPI->CH[SENSOR_PPI_CHANNEL].TEP = nrf_drv_adc_start_task_get();
+        NRF_PPI->CHENSET = 1 << SENSOR_PPI_CHANNEL;
     }
-    bme280_spi_wait_for_transfer_complete();
+    else
+    {
+        err_code = sd_ppi_channel_assign(SENSOR_PPI_CHANNEL,
+                                         &NRF_RTC1->EVENTS_COMPARE[SENSOR_RTC_CC_INDEX],
+                                         (const volatile void *)(uintptr_t)nrf_drv_adc_start_task_get());
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+
+        err_code = sd_ppi_channel_enable_set(1 << SENSOR_PPI_CHANNEL);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
+    app_timer_cnt_get(&now_ticks);
+    NRF_RTC1->CC[SENSOR_RTC_CC_INDEX] = (now_ticks + APP_TIMER_TICKS(SENSOR_MEASUREMENT_WAIT_TIME, 0)) & 0x00FFFFFF;
+    NRF_RTC1->EVENTS_COMPARE[SENSOR_RTC_CC_INDEX] = 0;
+    NRF_RTC1->EVTENSET = RTC_EVTEN_COMPARE1_Msk;
+    m_is_hw_trigger_enabled = true;
 
     return NRF_SUCCESS;
 }
 
-static void sensor_mesurement_wait_timer_handler()
+// This function is executed in the main loop through the scheduler.
+// ADC is done, and BME280 has finished the conversion because the wait time is over.
+static void sensor_hw_ready_evt_handler()
+{
+    uint32_t err_code;
+    uint32_t begin_ticks = stats_begin();
+
+    hw_trigger_disable();
+
+    err_code = app_timer_stop(m_sensor_measurement_wait_timer_id);
+    APP_ERROR_CHECK(err_code);
+
+    TRACE_END(TRACE_STAGE_CONVERSION_WAIT);
+    TRACE_BEGIN(TRACE_STAGE_SPI_READ);
+
+    // All sensors are read back to back in this wakeup.
+    err_code = nrf_drv_spi_init(&m_bme280_spi_master, &spi_config, NULL);
+    APP_ERROR_CHECK(err_code);
+
+    for (uint8_t i = 0; i < SENSOR_CHANNEL_CNT; i++)
+    {
+        uint8_t len = bme280_prepare_read_measurement_data();
+
+        err_code = bme280_spi_transfer_blocking(&m_bme280[i], len);
+        APP_ERROR_CHECK(err_code);
+
+        memcpy(m_bme280[i].measurement_data, &m_bme280_spi_rx_buffer[1], BME280_MEASUREMENT_DATA_LEN);
+    }
+
+    nrf_drv_spi_uninit(&m_bme280_spi_master);
+
+    TRACE_END(TRACE_STAGE_SPI_READ);
+
+    stats_end(begin_ticks, false);
+
+    sensor_data_evt_handler();
+}
+
+// RTC1 may stop while no app_timer is running and the compare event does not come.
+// Then the ADC sample is started by the CPU.
+static void sensor_mesurement_wait_evt_handler()
+{
+    // ADC has been done just before the timeout.
+    if (!m_is_hw_trigger_enabled)
+    {
+        return;
+    }
+
+    NRF_LOG_INFO("ADC is started by timeout\n");
+
+    hw_trigger_disable();
+    nrf_drv_adc_sample();
+}
+#else
+static void sensor_mesurement_wait_evt_handler()
 {
     uint32_t err_code;
 
-    m_bme280_receiving_measurement_data = true;
+    TRACE_END(TRACE_STAGE_CONVERSION_WAIT);
 
-    err_code = bme280_read_measurement_data();
+    err_code = bme280_session_start(BME280_SESSION_READ_MEASUREMENT_DATA);
     APP_ERROR_CHECK(err_code);
 }
+#endif
 
-uint32_t sensor_init(sensor_data_handler_t sensor_data_handler)
+static void sensor_mesurement_wait_timer_handler()
 {
-    uint32_t err_code = NRF_SUCCESS;
+    uint32_t begin_ticks = stats_begin();
 
-    m_sensor_data_handler = sensor_data_handler;
-    
-    m_battery_adc_result_buffer_index = 0;
-    m_is_first_measurement = true;
+    uint32_t err_code = scheduler_post(SCHEDULER_EVT_SENSOR_WAIT_TIMER, sensor_mesurement_wait_evt_handler);
+    APP_ERROR_CHECK(err_code);
 
-    nrf_gpio_cfg_output(BME280_SPI_CS_PIN);
-    nrf_gpio_pin_set(BME280_SPI_CS_PIN);
+    stats_end(begin_ticks, true);
+}
 
-    // chech chip ID
-    err_code = bme280_check_chip_id();
+#if APP_CONFIG_BATTERY_ENABLED
+// The moving average starts from a blocking conversion at init,
+// so that the ADC result handler has no branch for the first measurement.
+static uint32_t battery_adc_buffer_init()
+{
+    uint32_t err_code;
+    nrf_adc_value_t adc_result;
+
+    err_code = nrf_drv_adc_init(&adc_config, NULL);
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
     }
 
-    err_code = bme280_read_calibration_data();
+    err_code = nrf_drv_adc_sample_convert(&adc_channel_config, &adc_result);
+    nrf_drv_adc_uninit();
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
     }
 
-    err_code = bme280_config_measurement();
+    for (uint8_t i = 0; i < BATTERY_ADC_RESULT_AVERAGE_CNT; i++)
+    {
+        m_battery_adc_result_buffer[i] = adc_result;
+    }
+    m_battery_adc_result_buffer_index = 0;
+
+    return NRF_SUCCESS;
+}
+#endif
+
+uint32_t sensor_init(sensor_data_handler_t sensor_data_handler)
+{
+    uint32_t err_code = NRF_SUCCESS;
+
+    m_sensor_data_handler = sensor_data_handler;
+    
+    memset(&m_stats, 0, sizeof(m_stats));
+
+#if APP_CONFIG_BATTERY_ENABLED
+    err_code = battery_adc_buffer_init();
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
     }
+#endif
+
+    for (uint8_t i = 0; i < SENSOR_CHANNEL_CNT; i++)
+    {
+        m_bme280[i].cs_pin = m_bme280_cs_pins[i];
+        nrf_gpio_cfg_output(m_bme280[i].cs_pin);
+        nrf_gpio_pin_set(m_bme280[i].cs_pin);
+    }
+
+    // This is called right after reset.
+    nrf_delay_ms(BME280_STARTUP_TIME);
+
+    for (uint8_t i = 0; i < SENSOR_CHANNEL_CNT; i++)
+    {
+        // chech chip ID
+        err_code = bme280_check_chip_id(&m_bme280[i]);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+
+        err_code = bme280_read_calibration_data(&m_bme280[i]);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+
+        err_code = bme280_config_measurement(&m_bme280[i]);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
 
     err_code = app_timer_create(&m_sensor_measurement_wait_timer_id, APP_TIMER_MODE_SINGLE_SHOT, sensor_mesurement_wait_timer_handler);
     if (err_code != NRF_SUCCESS)
@@ -480,48 +871,108 @@ uint32_t sensor_init(sensor_data_handler_t sensor_data_handler)
     return NRF_SUCCESS;
 }
 
+#if APP_CONFIG_BATTERY_ENABLED
+// This function is executed in the main loop through the scheduler.
+// m_battery_adc_result is kept until the next measurement starts.
+static void battery_adc_evt_handler()
+{
+    uint32_t begin_ticks = stats_begin();
+
+    NRF_LOG_DEBUG("ADC :%u\n", m_battery_adc_result);
+
+    m_battery_adc_result_buffer_index = (m_battery_adc_result_buffer_index + 1) % BATTERY_ADC_RESULT_AVERAGE_CNT;
+    m_battery_adc_result_buffer[m_battery_adc_result_buffer_index] = m_battery_adc_result;
+
+    stats_end(begin_ticks, false);
+}
+
+#if SENSOR_HW_TRIGGER_ENABLED
+static void sensor_hw_ready_evt()
+{
+    battery_adc_evt_handler();
+    sensor_hw_ready_evt_handler();
+}
+#endif
+
 static void adc_evt_handler(nrf_drv_adc_evt_t const * p_event)
 {
+    uint32_t err_code;
+    uint32_t begin_ticks = stats_begin();
+
     if (p_event->type == NRF_DRV_ADC_EVT_DONE)
     {
-        NRF_LOG_DEBUG("ADC %u :%u\n", p_event->data.done.size, m_battery_adc_result);
+#if SENSOR_HW_TRIGGER_ENABLED
+        err_code = scheduler_post(SCHEDULER_EVT_SENSOR_DATA, sensor_hw_ready_evt);
+        APP_ERROR_CHECK(err_code);
+#else
+        TRACE_END(TRACE_STAGE_ADC);
+        power_profile_hfclk_release();
+
+        err_code = scheduler_post(SCHEDULER_EVT_BATTERY_ADC, battery_adc_evt_handler);
+        APP_ERROR_CHECK(err_code);
+#endif
+    }
 
-        if (m_is_first_measurement)
-        {
-            m_is_first_measurement = false;
+    stats_end(begin_ticks, true);
+}
+#endif
 
-            for (uint8_t i=0;i<BATTERY_ADC_RESULT_AVERAGE_CNT;i++)
-            {
-                m_battery_adc_result_buffer[i] = m_battery_adc_result;
-            }
-        }
-        else
+#if SENSOR_HW_TRIGGER_ENABLED
+static uint32_t start_measuring_sequence()
+{
+    uint32_t err_code;
+
+    TRACE_BEGIN(TRACE_STAGE_SPI_TRIGGER);
+
+    // All sensors start the conversion at the same time.
+    err_code = nrf_drv_spi_init(&m_bme280_spi_master, &spi_config, NULL);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    for (uint8_t i = 0; i < SENSOR_CHANNEL_CNT; i++)
+    {
+        uint8_t len = bme280_prepare_start_forced_mode();
+
+        err_code = bme280_spi_transfer_blocking(&m_bme280[i], len);
+        if (err_code != NRF_SUCCESS)
         {
-            m_battery_adc_result_buffer_index = (m_battery_adc_result_buffer_index + 1) % BATTERY_ADC_RESULT_AVERAGE_CNT;
-            m_battery_adc_result_buffer[m_battery_adc_result_buffer_index] = m_battery_adc_result;
+            break;
         }
     }
-}
 
-uint32_t sensor_start_measuring()
-{
-    uint32_t err_code;
+    nrf_drv_spi_uninit(&m_bme280_spi_master);
 
-    err_code = nrf_drv_adc_init(&adc_config, adc_evt_handler);
-    APP_ERROR_CHECK(err_code);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
 
-    nrf_drv_adc_channel_enable((nrf_drv_adc_channel_t *const)&adc_channel_config);
+    TRACE_END(TRACE_STAGE_SPI_TRIGGER);
+    TRACE_BEGIN(TRACE_STAGE_CONVERSION_WAIT);
 
-    err_code = nrf_drv_adc_buffer_convert(&m_battery_adc_result, 1);
-    APP_ERROR_CHECK(err_code);
+    err_code = hw_trigger_enable();
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
 
+    return app_timer_start(m_sensor_measurement_wait_timer_id, APP_TIMER_TICKS(SENSOR_MEASUREMENT_TIMEOUT, 0), NULL);
+}
+#else
+static uint32_t start_measuring_sequence()
+{
+    uint32_t err_code;
+
+#if APP_CONFIG_BATTERY_ENABLED
     // start adc sample
+    power_profile_hfclk_request();
     nrf_drv_adc_sample();
+#endif
 
-    // [1:0] mode=01 : start force mode
-    // [4:2] osrs_p=1 : pressure oversample x1
-    // [7:5] osrs_t=1 : temperature oversample x1
-    err_code = bme280_spi_start_write_reg_byte(BME280_RA_CTRL_MEAS, 0x25);
+    // All sensors start the conversion at the same time.
+    err_code = bme280_session_start(BME280_SESSION_START_FORCED_MODE);
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
@@ -534,4 +985,44 @@ uint32_t sensor_start_measuring()
     }
 
     return NRF_SUCCESS;
+}
+#endif
+
+uint32_t sensor_start_measuring()
+{
+    uint32_t err_code;
+    uint32_t begin_ticks = stats_begin();
+
+    m_stats.cycle_cnt++;
+
+    TRACE_BEGIN(TRACE_STAGE_CYCLE);
+
+#if APP_CONFIG_BATTERY_ENABLED
+    err_code = nrf_drv_adc_init(&adc_config, adc_evt_handler);
+    APP_ERROR_CHECK(err_code);
+
+    nrf_drv_adc_channel_enable((nrf_drv_adc_channel_t *const)&adc_channel_config);
+
+    err_code = nrf_drv_adc_buffer_convert(&m_battery_adc_result, 1);
+    APP_ERROR_CHECK(err_code);
+
+#if !SENSOR_HW_TRIGGER_ENABLED
+    TRACE_BEGIN(TRACE_STAGE_ADC);
+#else
+    // ADC is started by PPI at the end of the conversion wait, so it is recorded in that stage.
+    // The ADC stage is timed by TIMER2, which would keep HFCLK running over the wait.
+#endif
+#endif
+
+    err_code = start_measuring_sequence();
+
+    // Called by the measurement timer, which wakes the CPU.
+    stats_end(begin_ticks, true);
+
+    return err_code;
+}
+
+const sensor_stats_t *sensor_stats_get()
+{
+    return &m_stats;
 }
\ No newline at end of file
@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 
+#include "app_config.h"
+
 typedef struct
 {
     int16_t temperature; // ℃ x10
@@ -11,9 +13,34 @@ typedef struct
     uint16_t battery;
 } SensorMeasurementData;
 
+// Time from sensor_start_measuring() to the data handler call, long enough for the conversion of the profile
+#define SENSOR_MEASUREMENT_WAIT_TIME APP_CONFIG_MEASUREMENT_WAIT_TIME // ms
+
+// Number of BME280s on the SPI bus. Set by the Makefile from BME280_CS_PINS.
+#ifndef SENSOR_CHANNEL_CNT
+#define SENSOR_CHANNEL_CNT 1
+#endif
+// Channel 0 is advertised in the manufacturer data and the others in the scan response (6 bytes each).
+#define SENSOR_CHANNEL_MAX 5
+
+#if (SENSOR_CHANNEL_CNT < 1) || (SENSOR_CHANNEL_CNT > SENSOR_CHANNEL_MAX)
+#error "SENSOR_CHANNEL_CNT must be 1 to SENSOR_CHANNEL_MAX"
+#endif
+
+// measurement_data is an array of SENSOR_CHANNEL_CNT channels. battery is the same in all channels.
+// Fields compiled out by the profile are 0.
 typedef void (*sensor_data_handler_t)(const SensorMeasurementData *measurement_data);
 
+// Cost of the measurements
+typedef struct
+{
+    uint32_t cycle_cnt;    // number of measurements
+    uint32_t wakeup_cnt;   // interrupts and calls handled for the measurements
+    uint32_t active_ticks; // CPU time in the measurement handlers in RTC1 ticks (30.5 us)
+} sensor_stats_t;
+
 uint32_t sensor_init(sensor_data_handler_t sensor_data_handler);
 uint32_t sensor_start_measuring();
+const sensor_stats_t *sensor_stats_get();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,6 @@
+#ifndef _SIM_APP_ERROR_H
+#define _SIM_APP_ERROR_H
+
+#include "sim_sdk.h"
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef _SIM_APP_SCHEDULER_H
+#define _SIM_APP_SCHEDULER_H
+
+#include "sim_sdk.h"
+
+typedef void (*app_sched_event_handler_t)(void *p_event_data, uint16_t event_size);
+
+#define APP_SCHED_INIT(EVENT_SIZE, QUEUE_SIZE)                                 \
+    do                                                                         \
+    {                                                                          \
+        uint32_t ERR_CODE = app_sched_init((EVENT_SIZE), (QUEUE_SIZE), NULL);  \
+        APP_ERROR_CHECK(ERR_CODE);                                             \
+    } while (0)
+
+uint32_t app_sched_init(uint16_t max_event_size, uint16_t queue_size, void *p_evt_buffer);
+uint32_t app_sched_event_put(void const *p_event_data, uint16_t event_size, app_sched_event_handler_t handler);
+void app_sched_execute(void);
+uint16_t app_sched_queue_utilization_get(void);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef _SIM_APP_UTIL_H
+#define _SIM_APP_UTIL_H
+
+#include "sim_sdk.h"
+
+static inline uint8_t uint16_encode(uint16_t value, uint8_t *p_encoded_data)
+{
+    p_encoded_data[0] = (uint8_t)(value & 0x00FF);
+    p_encoded_data[1] = (uint8_t)((value & 0xFF00) >> 8);
+    return sizeof(uint16_t);
+}
+
+static inline uint8_t uint32_encode(uint32_t value, uint8_t *p_encoded_data)
+{
+    p_encoded_data[0] = (uint8_t)(value & 0x000000FF);
+    p_encoded_data[1] = (uint8_t)((value & 0x0000FF00) >> 8);
+    p_encoded_data[2] = (uint8_t)((value & 0x00FF0000) >> 16);
+    p_encoded_data[3] = (uint8_t)((value & 0xFF000000) >> 24);
+    return sizeof(uint32_t);
+}
+
+static inline uint16_t uint16_decode(const uint8_t *p_encoded_data)
+{
+    return (uint16_t)(((uint16_t)p_encoded_data[0]) | (((uint16_t)p_encoded_data[1]) << 8));
+}
+
+static inline uint32_t uint32_decode(const uint8_t *p_encoded_data)
+{
+    return (((uint32_t)p_encoded_data[0]) << 0) |
+           (((uint32_t)p_encoded_data[1]) << 8) |
+           (((uint32_t)p_encoded_data[2]) << 16) |
+           (((uint32_t)p_encoded_data[3]) << 24);
+}
+
+#endif
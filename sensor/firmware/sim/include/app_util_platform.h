@@ -0,0 +1,7 @@
+#ifndef _SIM_APP_UTIL_PLATFORM_H
+#define _SIM_APP_UTIL_PLATFORM_H
+
+#include "sim_sdk.h"
+#include "nrf_soc.h"
+
+#endif
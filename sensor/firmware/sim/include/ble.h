@@ -0,0 +1,511 @@
+#ifndef _SIM_BLE_H
+#define _SIM_BLE_H
+
+// BLE API of S130 2.0 (NRF_SD_BLE_API_VERSION 2) as far as the application uses it.
+// GAP, GATTS and the common parts are in this header, ble_gap.h and ble_gatts.h include it.
+
+#include "sim_sdk.h"
+
+#define BLE_CONN_HANDLE_INVALID 0xFFFF
+#define BLE_GATT_HANDLE_INVALID 0x0000
+
+#define BLE_UUID_TYPE_UNKNOWN 0x00
+#define BLE_UUID_TYPE_BLE 0x01
+#define BLE_UUID_TYPE_VENDOR_BEGIN 0x02
+
+#define BLE_UUID_DEVICE_INFORMATION_SERVICE 0x180A
+#define BLE_UUID_GAP 0x1800
+#define BLE_UUID_GATT 0x1801
+
+#define GATT_MTU_SIZE_DEFAULT 23
+
+#define BLE_HCI_STATUS_CODE_SUCCESS 0x00
+#define BLE_HCI_CONNECTION_TIMEOUT 0x08
+#define BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION 0x13
+#define BLE_HCI_LOCAL_HOST_TERMINATED_CONNECTION 0x16
+#define BLE_HCI_CONN_INTERVAL_UNACCEPTABLE 0x3B
+
+#define BLE_GATT_STATUS_SUCCESS 0x0000
+#define BLE_GATT_STATUS_ATTERR_READ_NOT_PERMITTED 0x0102
+#define BLE_GATT_STATUS_ATTERR_WRITE_NOT_PERMITTED 0x0103
+#define BLE_GATT_STATUS_ATTERR_INVALID_OFFSET 0x0107
+#define BLE_GATT_STATUS_ATTERR_INVALID_ATT_VAL_LENGTH 0x010D
+#define BLE_GATT_STATUS_ATTERR_APP_BEGIN 0x0180
+
+enum BLE_COMMON_EVTS
+{
+    BLE_EVT_TX_COMPLETE = 0x01,
+    BLE_EVT_USER_MEM_REQUEST = 0x02,
+    BLE_EVT_USER_MEM_RELEASE = 0x03,
+};
+
+enum BLE_GAP_EVTS
+{
+    BLE_GAP_EVT_CONNECTED = 0x10,
+    BLE_GAP_EVT_DISCONNECTED = 0x11,
+    BLE_GAP_EVT_CONN_PARAM_UPDATE = 0x12,
+    BLE_GAP_EVT_SEC_PARAMS_REQUEST = 0x13,
+    BLE_GAP_EVT_SEC_INFO_REQUEST = 0x14,
+    BLE_GAP_EVT_AUTH_STATUS = 0x19,
+    BLE_GAP_EVT_CONN_SEC_UPDATE = 0x1A,
+    BLE_GAP_EVT_TIMEOUT = 0x1B,
+    BLE_GAP_EVT_RSSI_CHANGED = 0x1C,
+    BLE_GAP_EVT_ADV_REPORT = 0x1D,
+    BLE_GAP_EVT_SEC_REQUEST = 0x1E,
+    BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST = 0x1F,
+    BLE_GAP_EVT_SCAN_REQ_REPORT = 0x20,
+};
+
+enum BLE_GATTC_EVTS
+{
+    BLE_GATTC_EVT_TIMEOUT = 0x3A,
+};
+
+enum BLE_GATTS_EVTS
+{
+    BLE_GATTS_EVT_WRITE = 0x50,
+    BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST = 0x51,
+    BLE_GATTS_EVT_SYS_ATTR_MISSING = 0x52,
+    BLE_GATTS_EVT_HVC = 0x53,
+    BLE_GATTS_EVT_SC_CONFIRM = 0x54,
+    BLE_GATTS_EVT_TIMEOUT = 0x55,
+};
+
+#define BLE_GAP_TIMEOUT_SRC_ADVERTISING 0x00
+#define BLE_GAP_TIMEOUT_SRC_SECURITY_REQUEST 0x01
+#define BLE_GAP_TIMEOUT_SRC_SCAN 0x02
+#define BLE_GAP_TIMEOUT_SRC_CONN 0x03
+
+#define BLE_GAP_ROLE_INVALID 0x0
+#define BLE_GAP_ROLE_PERIPH 0x1
+#define BLE_GAP_ROLE_CENTRAL 0x2
+
+#define BLE_GAP_ADV_TYPE_ADV_IND 0x00
+#define BLE_GAP_ADV_TYPE_ADV_DIRECT_IND 0x01
+#define BLE_GAP_ADV_TYPE_ADV_SCAN_IND 0x02
+#define BLE_GAP_ADV_TYPE_ADV_NONCONN_IND 0x03
+
+#define BLE_GAP_ADV_FP_ANY 0x00
+
+#define BLE_GAP_ADV_INTERVAL_MIN 0x0020
+#define BLE_GAP_ADV_INTERVAL_MAX 0x4000
+#define BLE_GAP_ADV_NONCON_INTERVAL_MIN 0x00A0
+#define BLE_GAP_ADV_TIMEOUT_LIMITED_MAX 180
+#define BLE_GAP_ADV_MAX_SIZE 31
+#define BLE_GAP_DEVNAME_MAX_LEN 248
+
+#define BLE_GAP_SCAN_INTERVAL_MIN 0x0004
+#define BLE_GAP_SCAN_INTERVAL_MAX 0x4000
+#define BLE_GAP_SCAN_WINDOW_MIN 0x0004
+
+#define BLE_GAP_ADV_FLAG_LE_LIMITED_DISC_MODE 0x01
+#define BLE_GAP_ADV_FLAG_LE_GENERAL_DISC_MODE 0x02
+#define BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED 0x04
+#define BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE (BLE_GAP_ADV_FLAG_LE_GENERAL_DISC_MODE | BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED)
+
+#define BLE_GAP_AD_TYPE_FLAGS 0x01
+#define BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_MORE_AVAILABLE 0x02
+#define BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE 0x03
+#define BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME 0x08
+#define BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME 0x09
+#define BLE_GAP_AD_TYPE_TX_POWER_LEVEL 0x0A
+#define BLE_GAP_AD_TYPE_SLAVE_CONNECTION_INTERVAL_RANGE 0x12
+#define BLE_GAP_AD_TYPE_SOLICITED_SERVICE_UUIDS_16BIT 0x14
+#define BLE_GAP_AD_TYPE_SERVICE_DATA 0x16
+#define BLE_GAP_AD_TYPE_APPEARANCE 0x19
+#define BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA 0xFF
+
+#define BLE_GAP_IO_CAPS_DISPLAY_ONLY 0x00
+#define BLE_GAP_IO_CAPS_NONE 0x03
+#define BLE_GAP_SEC_STATUS_SUCCESS 0x00
+#define BLE_GAP_SEC_STATUS_PAIRING_NOT_SUPP 0x85
+
+#define BLE_GAP_CP_MIN_CONN_INTVL_MIN 0x0006
+#define BLE_GAP_CP_MAX_CONN_INTVL_MAX 0x0C80
+
+#define BLE_GATTS_SRVC_TYPE_PRIMARY 0x01
+#define BLE_GATTS_VLOC_INVALID 0x00
+#define BLE_GATTS_VLOC_STACK 0x01
+#define BLE_GATTS_VLOC_USER 0x02
+
+#define BLE_GATTS_AUTHORIZE_TYPE_INVALID 0x00
+#define BLE_GATTS_AUTHORIZE_TYPE_READ 0x01
+#define BLE_GATTS_AUTHORIZE_TYPE_WRITE 0x02
+
+#define BLE_GATTS_OP_INVALID 0x00
+#define BLE_GATTS_OP_WRITE_REQ 0x01
+#define BLE_GATTS_OP_WRITE_CMD 0x02
+#define BLE_GATTS_OP_SIGN_WRITE_CMD 0x03
+#define BLE_GATTS_OP_PREP_WRITE_REQ 0x04
+#define BLE_GATTS_OP_EXEC_WRITE_REQ_CANCEL 0x05
+#define BLE_GATTS_OP_EXEC_WRITE_REQ_NOW 0x06
+
+#define BLE_GATTS_VAR_ATTR_LEN_MAX 512
+#define BLE_GATTS_FIX_ATTR_LEN_MAX 510
+
+typedef struct
+{
+    uint16_t uuid;
+    uint8_t type;
+} ble_uuid_t;
+
+typedef struct
+{
+    uint8_t uuid128[16];
+} ble_uuid128_t;
+
+typedef struct
+{
+    uint8_t addr_type;
+    uint8_t addr[6];
+} ble_gap_addr_t;
+
+typedef struct
+{
+    uint8_t sm : 4;
+    uint8_t lv : 4;
+} ble_gap_conn_sec_mode_t;
+
+#define BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(ptr) do {(ptr)->sm = 0; (ptr)->lv = 0;} while (0)
+#define BLE_GAP_CONN_SEC_MODE_SET_OPEN(ptr) do {(ptr)->sm = 1; (ptr)->lv = 1;} while (0)
+
+typedef struct
+{
+    uint16_t min_conn_interval;
+    uint16_t max_conn_interval;
+    uint16_t slave_latency;
+    uint16_t conn_sup_timeout;
+} ble_gap_conn_params_t;
+
+typedef struct
+{
+    uint8_t type;
+    ble_gap_addr_t const *p_peer_addr;
+    uint8_t fp;
+    void const *p_whitelist;
+    uint16_t interval;
+    uint16_t timeout;
+    struct
+    {
+        uint8_t ch_37_off : 1;
+        uint8_t ch_38_off : 1;
+        uint8_t ch_39_off : 1;
+    } channel_mask;
+} ble_gap_adv_params_t;
+
+typedef struct
+{
+    uint8_t active : 1;
+    uint8_t selective : 1;
+    void const *p_whitelist;
+    uint16_t interval;
+    uint16_t window;
+    uint16_t timeout;
+} ble_gap_scan_params_t;
+
+typedef struct
+{
+    uint8_t enc : 1;
+    uint8_t id : 1;
+    uint8_t sign : 1;
+    uint8_t link : 1;
+} ble_gap_sec_kdist_t;
+
+typedef struct
+{
+    uint8_t bond : 1;
+    uint8_t mitm : 1;
+    uint8_t lesc : 1;
+    uint8_t keypress : 1;
+    uint8_t io_caps : 3;
+    uint8_t oob : 1;
+    uint8_t min_key_size;
+    uint8_t max_key_size;
+    ble_gap_sec_kdist_t kdist_own;
+    ble_gap_sec_kdist_t kdist_peer;
+} ble_gap_sec_params_t;
+
+typedef struct
+{
+    ble_gap_addr_t peer_addr;
+    ble_gap_addr_t own_addr;
+    uint8_t role;
+    uint8_t irk_match : 1;
+    uint8_t irk_match_idx : 7;
+    ble_gap_conn_params_t conn_params;
+} ble_gap_evt_connected_t;
+
+typedef struct
+{
+    uint8_t reason;
+} ble_gap_evt_disconnected_t;
+
+typedef struct
+{
+    ble_gap_conn_params_t conn_params;
+} ble_gap_evt_conn_param_update_t;
+
+typedef struct
+{
+    ble_gap_sec_params_t peer_params;
+} ble_gap_evt_sec_params_request_t;
+
+typedef struct
+{
+    uint8_t src;
+} ble_gap_evt_timeout_t;
+
+typedef struct
+{
+    ble_gap_addr_t peer_addr;
+    int8_t rssi;
+    uint8_t scan_rsp : 1;
+    uint8_t type : 2;
+    uint8_t dlen : 5;
+    uint8_t data[BLE_GAP_ADV_MAX_SIZE];
+} ble_gap_evt_adv_report_t;
+
+typedef struct
+{
+    uint16_t conn_handle;
+    union
+    {
+        ble_gap_evt_connected_t connected;
+        ble_gap_evt_disconnected_t disconnected;
+        ble_gap_evt_conn_param_update_t conn_param_update;
+        ble_gap_evt_sec_params_request_t sec_params_request;
+        ble_gap_evt_timeout_t timeout;
+        ble_gap_evt_adv_report_t adv_report;
+    } params;
+} ble_gap_evt_t;
+
+typedef struct
+{
+    uint8_t broadcast : 1;
+    uint8_t read : 1;
+    uint8_t write_wo_resp : 1;
+    uint8_t write : 1;
+    uint8_t notify : 1;
+    uint8_t indicate : 1;
+    uint8_t auth_signed_wr : 1;
+} ble_gatt_char_props_t;
+
+typedef struct
+{
+    uint8_t reliable_wr : 1;
+    uint8_t wr_aux : 1;
+} ble_gatt_char_ext_props_t;
+
+typedef struct
+{
+    ble_gap_conn_sec_mode_t read_perm;
+    ble_gap_conn_sec_mode_t write_perm;
+    uint8_t vlen : 1;
+    uint8_t vloc : 2;
+    uint8_t rd_auth : 1;
+    uint8_t wr_auth : 1;
+} ble_gatts_attr_md_t;
+
+typedef struct
+{
+    ble_uuid_t const *p_uuid;
+    ble_gatts_attr_md_t const *p_attr_md;
+    uint16_t init_len;
+    uint16_t init_offs;
+    uint16_t max_len;
+    uint8_t *p_value;
+} ble_gatts_attr_t;
+
+typedef struct
+{
+    uint16_t len;
+    uint16_t offset;
+    uint8_t *p_value;
+} ble_gatts_value_t;
+
+typedef struct
+{
+    ble_gatt_char_props_t char_props;
+    ble_gatt_char_ext_props_t char_ext_props;
+    uint8_t *p_char_user_desc;
+    uint16_t char_user_desc_max_size;
+    uint16_t char_user_desc_size;
+    void const *p_char_pf;
+    ble_gatts_attr_md_t const *p_user_desc_md;
+    ble_gatts_attr_md_t const *p_cccd_md;
+    ble_gatts_attr_md_t const *p_sccd_md;
+} ble_gatts_char_md_t;
+
+typedef struct
+{
+    uint16_t value_handle;
+    uint16_t user_desc_handle;
+    uint16_t cccd_handle;
+    uint16_t sccd_handle;
+} ble_gatts_char_handles_t;
+
+typedef struct
+{
+    uint16_t handle;
+    ble_uuid_t uuid;
+    uint8_t op;
+    uint8_t auth_required;
+    uint16_t offset;
+    uint16_t len;
+    uint8_t data[1]; // the event buffer has len bytes
+} ble_gatts_evt_write_t;
+
+typedef struct
+{
+    uint16_t handle;
+    ble_uuid_t uuid;
+    uint16_t offset;
+} ble_gatts_evt_read_t;
+
+typedef struct
+{
+    uint8_t type;
+    union
+    {
+        ble_gatts_evt_read_t read;
+        ble_gatts_evt_write_t write;
+    } request;
+} ble_gatts_evt_rw_authorize_request_t;
+
+typedef struct
+{
+    uint16_t gatt_status;
+    uint8_t update : 1;
+    uint16_t offset;
+    uint16_t len;
+    const uint8_t *p_data;
+} ble_gatts_authorize_params_t;
+
+typedef struct
+{
+    uint8_t type;
+    union
+    {
+        ble_gatts_authorize_params_t read;
+        ble_gatts_authorize_params_t write;
+    } params;
+} ble_gatts_rw_authorize_reply_params_t;
+
+typedef struct
+{
+    uint8_t hint;
+} ble_gatts_evt_sys_attr_missing_t;
+
+typedef struct
+{
+    uint8_t src;
+} ble_gatts_evt_timeout_t;
+
+typedef struct
+{
+    uint16_t conn_handle;
+    union
+    {
+        ble_gatts_evt_write_t write;
+        ble_gatts_evt_rw_authorize_request_t authorize_request;
+        ble_gatts_evt_sys_attr_missing_t sys_attr_missing;
+        ble_gatts_evt_timeout_t timeout;
+    } params;
+} ble_gatts_evt_t;
+
+typedef struct
+{
+    uint16_t conn_handle;
+    uint16_t gatt_status;
+    uint16_t error_handle;
+} ble_gattc_evt_t;
+
+typedef struct
+{
+    uint16_t conn_handle;
+} ble_common_evt_t;
+
+typedef struct
+{
+    uint16_t evt_id;
+    uint16_t evt_len;
+} ble_evt_hdr_t;
+
+typedef struct
+{
+    ble_evt_hdr_t header;
+    union
+    {
+        ble_common_evt_t common_evt;
+        ble_gap_evt_t gap_evt;
+        ble_gattc_evt_t gattc_evt;
+        ble_gatts_evt_t gatts_evt;
+    } evt;
+} ble_evt_t;
+
+// Largest event with the data of a write of the default ATT MTU
+#define BLE_EVT_LEN_MAX (sizeof(ble_evt_t) + GATT_MTU_SIZE_DEFAULT)
+
+typedef struct
+{
+    uint8_t source;
+    uint8_t rc_ctiv;
+    uint8_t rc_temp_ctiv;
+    uint8_t xtal_accuracy;
+} nrf_clock_lf_cfg_t;
+
+#define NRF_CLOCK_LF_SRC_RC 0
+#define NRF_CLOCK_LF_SRC_XTAL 1
+#define NRF_CLOCK_LF_SRC_SYNTH 2
+#define NRF_CLOCK_LF_XTAL_ACCURACY_250_PPM 0
+#define NRF_CLOCK_LF_XTAL_ACCURACY_20_PPM 7
+
+typedef struct
+{
+    struct
+    {
+        uint8_t periph_conn_count;
+        uint8_t central_conn_count;
+        uint8_t central_sec_count;
+    } gap_enable_params;
+    struct
+    {
+        uint8_t service_changed : 1;
+        uint32_t attr_tab_size;
+    } gatts_enable_params;
+    struct
+    {
+        uint8_t vs_uuid_count;
+    } common_enable_params;
+} ble_enable_params_t;
+
+uint32_t sd_ble_enable(ble_enable_params_t *p_ble_enable_params, uint32_t *p_app_ram_base);
+uint32_t sd_ble_uuid_vs_add(ble_uuid128_t const *p_vs_uuid, uint8_t *p_uuid_type);
+uint32_t sd_ble_user_mem_reply(uint16_t conn_handle, void const *p_block);
+
+uint32_t sd_ble_gap_adv_data_set(uint8_t const *p_data, uint8_t dlen, uint8_t const *p_sr_data, uint8_t srdlen);
+uint32_t sd_ble_gap_adv_start(ble_gap_adv_params_t const *p_adv_params);
+uint32_t sd_ble_gap_adv_stop(void);
+uint32_t sd_ble_gap_scan_start(ble_gap_scan_params_t const *p_scan_params);
+uint32_t sd_ble_gap_scan_stop(void);
+uint32_t sd_ble_gap_disconnect(uint16_t conn_handle, uint8_t hci_status_code);
+uint32_t sd_ble_gap_conn_param_update(uint16_t conn_handle, ble_gap_conn_params_t const *p_conn_params);
+uint32_t sd_ble_gap_tx_power_set(int8_t tx_power);
+uint32_t sd_ble_gap_appearance_set(uint16_t appearance);
+uint32_t sd_ble_gap_appearance_get(uint16_t *p_appearance);
+uint32_t sd_ble_gap_ppcp_set(ble_gap_conn_params_t const *p_conn_params);
+uint32_t sd_ble_gap_ppcp_get(ble_gap_conn_params_t *p_conn_params);
+uint32_t sd_ble_gap_device_name_set(ble_gap_conn_sec_mode_t const *p_write_perm, uint8_t const *p_dev_name, uint16_t len);
+uint32_t sd_ble_gap_device_name_get(uint8_t *p_dev_name, uint16_t *p_len);
+uint32_t sd_ble_gap_address_get(ble_gap_addr_t *p_addr);
+uint32_t sd_ble_gap_sec_params_reply(uint16_t conn_handle, uint8_t sec_status, ble_gap_sec_params_t const *p_sec_params, void const *p_sec_keyset);
+
+uint32_t sd_ble_gatts_service_add(uint8_t type, ble_uuid_t const *p_uuid, uint16_t *p_handle);
+uint32_t sd_ble_gatts_characteristic_add(uint16_t service_handle, ble_gatts_char_md_t const *p_char_md, ble_gatts_attr_t const *p_attr_char_value, ble_gatts_char_handles_t *p_handles);
+uint32_t sd_ble_gatts_value_set(uint16_t conn_handle, uint16_t handle, ble_gatts_value_t *p_value);
+uint32_t sd_ble_gatts_value_get(uint16_t conn_handle, uint16_t handle, ble_gatts_value_t *p_value);
+uint32_t sd_ble_gatts_rw_authorize_reply(uint16_t conn_handle, ble_gatts_rw_authorize_reply_params_t const *p_rw_authorize_reply_params);
+uint32_t sd_ble_gatts_sys_attr_set(uint16_t conn_handle, uint8_t const *p_sys_attr_data, uint16_t len, uint32_t flags);
+uint32_t sd_ble_gatts_exchange_mtu_reply(uint16_t conn_handle, uint16_t server_rx_mtu);
+
+#endif
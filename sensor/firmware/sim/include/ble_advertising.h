@@ -0,0 +1,55 @@
+#ifndef _SIM_BLE_ADVERTISING_H
+#define _SIM_BLE_ADVERTISING_H
+
+#include "ble_advdata.h"
+
+typedef enum
+{
+    BLE_ADV_MODE_IDLE,
+    BLE_ADV_MODE_DIRECTED,
+    BLE_ADV_MODE_DIRECTED_SLOW,
+    BLE_ADV_MODE_FAST,
+    BLE_ADV_MODE_SLOW,
+} ble_adv_mode_t;
+
+typedef enum
+{
+    BLE_ADV_EVT_IDLE,
+    BLE_ADV_EVT_DIRECTED,
+    BLE_ADV_EVT_DIRECTED_SLOW,
+    BLE_ADV_EVT_FAST,
+    BLE_ADV_EVT_SLOW,
+    BLE_ADV_EVT_FAST_WHITELIST,
+    BLE_ADV_EVT_SLOW_WHITELIST,
+    BLE_ADV_EVT_WHITELIST_REQUEST,
+    BLE_ADV_EVT_PEER_ADDR_REQUEST,
+} ble_adv_evt_t;
+
+typedef struct
+{
+    bool ble_adv_whitelist_enabled;
+    bool ble_adv_directed_enabled;
+    bool ble_adv_directed_slow_enabled;
+    uint32_t ble_adv_directed_slow_interval;
+    uint32_t ble_adv_directed_slow_timeout;
+    bool ble_adv_fast_enabled;
+    uint32_t ble_adv_fast_interval;
+    uint32_t ble_adv_fast_timeout;
+    bool ble_adv_slow_enabled;
+    uint32_t ble_adv_slow_interval;
+    uint32_t ble_adv_slow_timeout;
+} ble_adv_modes_config_t;
+
+typedef void (*ble_advertising_evt_handler_t)(ble_adv_evt_t const adv_evt);
+typedef void (*ble_advertising_error_handler_t)(uint32_t nrf_error);
+
+uint32_t ble_advertising_init(ble_advdata_t const *p_advdata,
+                              ble_advdata_t const *p_srdata,
+                              ble_adv_modes_config_t const *p_config,
+                              ble_advertising_evt_handler_t const evt_handler,
+                              ble_advertising_error_handler_t const error_handler);
+uint32_t ble_advertising_start(ble_adv_mode_t advertising_mode);
+void ble_advertising_on_ble_evt(ble_evt_t const *p_ble_evt);
+void ble_advertising_on_sys_evt(uint32_t sys_evt);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef _SIM_BLE_CONN_STATE_H
+#define _SIM_BLE_CONN_STATE_H
+
+#include "ble.h"
+
+void ble_conn_state_init(void);
+void ble_conn_state_on_ble_evt(ble_evt_t *p_ble_evt);
+uint8_t ble_conn_state_role(uint16_t conn_handle);
+
+#endif
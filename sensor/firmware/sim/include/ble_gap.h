@@ -0,0 +1,6 @@
+#ifndef _SIM_BLE_GAP_H
+#define _SIM_BLE_GAP_H
+
+#include "ble.h"
+
+#endif
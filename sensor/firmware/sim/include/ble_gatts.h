@@ -0,0 +1,6 @@
+#ifndef _SIM_BLE_GATTS_H
+#define _SIM_BLE_GATTS_H
+
+#include "ble.h"
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef _SIM_BLE_SRV_COMMON_H
+#define _SIM_BLE_SRV_COMMON_H
+
+#include "ble.h"
+#include "app_util.h"
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef _SIM_FSTORAGE_H
+#define _SIM_FSTORAGE_H
+
+#include "sim_sdk.h"
+
+void fs_sys_event_handler(uint32_t sys_evt);
+uint32_t fs_queued_op_count_get(uint32_t *p_op_count);
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef _SIM_NORDIC_COMMON_H
+#define _SIM_NORDIC_COMMON_H
+
+#include "sim_sdk.h"
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef _SIM_NRF_H
+#define _SIM_NRF_H
+
+#include "sim_sdk.h"
+
+#endif
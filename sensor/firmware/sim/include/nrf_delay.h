@@ -0,0 +1,10 @@
+#ifndef _SIM_NRF_DELAY_H
+#define _SIM_NRF_DELAY_H
+
+#include "sim_sdk.h"
+
+// Busy waits advance the virtual time with the CPU active.
+void nrf_delay_us(uint32_t number_of_us);
+void nrf_delay_ms(uint32_t number_of_ms);
+
+#endif
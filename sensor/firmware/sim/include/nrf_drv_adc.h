@@ -0,0 +1,86 @@
+#ifndef _SIM_NRF_DRV_ADC_H
+#define _SIM_NRF_DRV_ADC_H
+
+// ADC driver of SDK 12 on the simulated battery voltage.
+
+#include "sim_sdk.h"
+
+typedef int16_t nrf_adc_value_t;
+
+#define NRF_ADC_CONFIG_RES_8BIT 0
+#define NRF_ADC_CONFIG_RES_9BIT 1
+#define NRF_ADC_CONFIG_RES_10BIT 2
+
+#define NRF_ADC_CONFIG_SCALING_INPUT_FULL_SCALE 0
+#define NRF_ADC_CONFIG_SCALING_INPUT_TWO_THIRDS 1
+#define NRF_ADC_CONFIG_SCALING_INPUT_ONE_THIRD 2
+#define NRF_ADC_CONFIG_SCALING_SUPPLY_TWO_THIRDS 5
+#define NRF_ADC_CONFIG_SCALING_SUPPLY_ONE_THIRD 6
+
+#define NRF_ADC_CONFIG_REF_VBG 0
+#define NRF_ADC_CONFIG_INPUT_DISABLED 0
+
+typedef struct
+{
+    uint32_t resolution : 2;
+    uint32_t input : 3;
+    uint32_t reference : 2;
+    uint32_t ain : 8;
+} nrf_drv_adc_channel_config_t;
+
+typedef struct nrf_drv_adc_channel_s
+{
+    union
+    {
+        nrf_drv_adc_channel_config_t config;
+        uint32_t data;
+    } config;
+    struct nrf_drv_adc_channel_s *p_next;
+} nrf_drv_adc_channel_t;
+
+typedef struct
+{
+    uint8_t interrupt_priority;
+} nrf_drv_adc_config_t;
+
+#define NRF_DRV_ADC_DEFAULT_CONFIG {.interrupt_priority = APP_IRQ_PRIORITY_LOW}
+
+typedef enum
+{
+    NRF_DRV_ADC_EVT_DONE,
+    NRF_DRV_ADC_EVT_SAMPLE,
+} nrf_drv_adc_evt_type_t;
+
+typedef struct
+{
+    nrf_drv_adc_evt_type_t type;
+    union
+    {
+        struct
+        {
+            nrf_adc_value_t *p_buffer;
+            uint16_t size;
+        } done;
+        struct
+        {
+            nrf_adc_value_t sample;
+        } sample;
+    } data;
+} nrf_drv_adc_evt_t;
+
+typedef void (*nrf_drv_adc_event_handler_t)(nrf_drv_adc_evt_t const *p_event);
+
+ret_code_t nrf_drv_adc_init(nrf_drv_adc_config_t const *p_config, nrf_drv_adc_event_handler_t event_handler);
+void nrf_drv_adc_uninit(void);
+void nrf_drv_adc_channel_enable(nrf_drv_adc_channel_t *const p_channel);
+void nrf_drv_adc_channel_disable(nrf_drv_adc_channel_t *const p_channel);
+ret_code_t nrf_drv_adc_buffer_convert(nrf_adc_value_t *buffer, uint16_t size);
+void nrf_drv_adc_sample(void);
+ret_code_t nrf_drv_adc_sample_convert(nrf_drv_adc_channel_t const *const p_channel, nrf_adc_value_t *p_value);
+
+__STATIC_INLINE uint32_t nrf_drv_adc_start_task_get(void)
+{
+    return (uint32_t)(uintptr_t)&NRF_ADC->TASKS_START;
+}
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef _SIM_NRF_DRV_CLOCK_H
+#define _SIM_NRF_DRV_CLOCK_H
+
+#include "sim_sdk.h"
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef _SIM_NRF_LOG_H
+#define _SIM_NRF_LOG_H
+
+#include "sim_sdk.h"
+
+// NRF_LOG output goes to stderr with the virtual time. The level of each module is kept,
+// unless the simulation is started with -l, which prints the log of all modules.
+#define NRF_LOG_LEVEL_ERROR 1
+#define NRF_LOG_LEVEL_WARNING 2
+#define NRF_LOG_LEVEL_INFO 3
+#define NRF_LOG_LEVEL_DEBUG 4
+
+#ifndef NRF_LOG_MODULE_NAME
+#define NRF_LOG_MODULE_NAME "APP"
+#endif
+
+#ifndef NRF_LOG_DEFAULT_LEVEL
+#define NRF_LOG_DEFAULT_LEVEL 0
+#endif
+
+#ifndef NRF_LOG_LEVEL
+#define NRF_LOG_LEVEL NRF_LOG_DEFAULT_LEVEL
+#endif
+
+extern bool sim_log_all;
+void sim_log(const char *p_module, const char *p_format, ...);
+
+#define SIM_NRF_LOG(LEVEL, ...)                                                           \
+    do                                                                                    \
+    {                                                                                     \
+        if (NRF_LOG_ENABLED && (NRF_LOG_LEVEL >= (LEVEL) || sim_log_all))                 \
+        {                                                                                 \
+            sim_log(NRF_LOG_MODULE_NAME, __VA_ARGS__);                                    \
+        }                                                                                 \
+    } while (0)
+
+#define NRF_LOG_ERROR(...) SIM_NRF_LOG(NRF_LOG_LEVEL_ERROR, __VA_ARGS__)
+#define NRF_LOG_WARNING(...) SIM_NRF_LOG(NRF_LOG_LEVEL_WARNING, __VA_ARGS__)
+#define NRF_LOG_INFO(...) SIM_NRF_LOG(NRF_LOG_LEVEL_INFO, __VA_ARGS__)
+#define NRF_LOG_DEBUG(...) SIM_NRF_LOG(NRF_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define NRF_LOG_RAW_INFO(...) SIM_NRF_LOG(NRF_LOG_LEVEL_INFO, __VA_ARGS__)
+
+#endif
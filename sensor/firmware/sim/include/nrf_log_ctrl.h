@@ -0,0 +1,11 @@
+#ifndef _SIM_NRF_LOG_CTRL_H
+#define _SIM_NRF_LOG_CTRL_H
+
+#include "sim_sdk.h"
+
+// The log is written immediately and nothing is deferred to the main loop.
+#define NRF_LOG_INIT(TIMESTAMP_FUNC) NRF_SUCCESS
+#define NRF_LOG_PROCESS() false
+#define NRF_LOG_FLUSH() do {} while (0)
+
+#endif
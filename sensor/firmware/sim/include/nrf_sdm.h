@@ -0,0 +1,8 @@
+#ifndef _SIM_NRF_SDM_H
+#define _SIM_NRF_SDM_H
+
+#include "sim_sdk.h"
+
+uint32_t sd_softdevice_is_enabled(uint8_t *p_softdevice_enabled);
+
+#endif
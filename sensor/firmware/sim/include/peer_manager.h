@@ -0,0 +1,77 @@
+#ifndef _SIM_PEER_MANAGER_H
+#define _SIM_PEER_MANAGER_H
+
+// Peer Manager of SDK 12 as far as no bond is stored: the central of the simulation does not pair.
+// It owns FDS, so its init runs fds_init().
+
+#include "ble.h"
+
+typedef uint16_t pm_peer_id_t;
+
+typedef enum
+{
+    PM_EVT_BONDED_PEER_CONNECTED,
+    PM_EVT_CONN_SEC_START,
+    PM_EVT_CONN_SEC_SUCCEEDED,
+    PM_EVT_CONN_SEC_FAILED,
+    PM_EVT_CONN_SEC_CONFIG_REQ,
+    PM_EVT_STORAGE_FULL,
+    PM_EVT_ERROR_UNEXPECTED,
+    PM_EVT_PEER_DATA_UPDATE_SUCCEEDED,
+    PM_EVT_PEER_DATA_UPDATE_FAILED,
+    PM_EVT_PEER_DELETE_SUCCEEDED,
+    PM_EVT_PEER_DELETE_FAILED,
+    PM_EVT_PEERS_DELETE_SUCCEEDED,
+    PM_EVT_PEERS_DELETE_FAILED,
+    PM_EVT_LOCAL_DB_CACHE_APPLIED,
+    PM_EVT_LOCAL_DB_CACHE_APPLY_FAILED,
+    PM_EVT_SERVICE_CHANGED_IND_SENT,
+    PM_EVT_SERVICE_CHANGED_IND_CONFIRMED,
+} pm_evt_id_t;
+
+typedef struct
+{
+    bool allow_repairing;
+} pm_conn_sec_config_t;
+
+typedef struct
+{
+    pm_evt_id_t evt_id;
+    uint16_t conn_handle;
+    pm_peer_id_t peer_id;
+    union
+    {
+        struct
+        {
+            uint8_t procedure;
+        } conn_sec_succeeded;
+        struct
+        {
+            uint32_t error;
+        } peer_data_update_failed;
+        struct
+        {
+            uint32_t error;
+        } peer_delete_failed;
+        struct
+        {
+            uint32_t error;
+        } peers_delete_failed_evt;
+        struct
+        {
+            uint32_t error;
+        } error_unexpected;
+    } params;
+} pm_evt_t;
+
+typedef void (*pm_evt_handler_t)(pm_evt_t const *p_event);
+
+ret_code_t pm_init(void);
+ret_code_t pm_register(pm_evt_handler_t event_handler);
+ret_code_t pm_sec_params_set(ble_gap_sec_params_t *p_sec_params);
+void pm_on_ble_evt(ble_evt_t *p_ble_evt);
+void pm_conn_sec_config_reply(uint16_t conn_handle, pm_conn_sec_config_t *p_conn_sec_config);
+void pm_local_database_has_changed(void);
+ret_code_t pm_peers_delete(void);
+
+#endif
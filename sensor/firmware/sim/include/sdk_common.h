@@ -0,0 +1,7 @@
+#ifndef _SIM_SDK_COMMON_H
+#define _SIM_SDK_COMMON_H
+
+#include "sim_sdk.h"
+#include "app_util.h"
+
+#endif
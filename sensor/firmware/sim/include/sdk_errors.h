@@ -0,0 +1,6 @@
+#ifndef _SIM_SDK_ERRORS_H
+#define _SIM_SDK_ERRORS_H
+
+#include "sim_sdk.h"
+
+#endif
@@ -0,0 +1,294 @@
+#ifndef _SIM_SDK_H
+#define _SIM_SDK_H
+
+// Definitions shared by the SDK and SoftDevice headers of the host simulation.
+// Only what the application uses is declared, with the names and the values of SDK 12.3.0 and S130 2.0.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sdk_config.h"
+
+typedef uint32_t ret_code_t;
+
+#define NRF_SUCCESS 0
+#define NRF_ERROR_SVC_HANDLER_MISSING 1
+#define NRF_ERROR_SOFTDEVICE_NOT_ENABLED 2
+#define NRF_ERROR_INTERNAL 3
+#define NRF_ERROR_NO_MEM 4
+#define NRF_ERROR_NOT_FOUND 5
+#define NRF_ERROR_NOT_SUPPORTED 6
+#define NRF_ERROR_INVALID_PARAM 7
+#define NRF_ERROR_INVALID_STATE 8
+#define NRF_ERROR_INVALID_LENGTH 9
+#define NRF_ERROR_INVALID_FLAGS 10
+#define NRF_ERROR_INVALID_DATA 11
+#define NRF_ERROR_DATA_SIZE 12
+#define NRF_ERROR_TIMEOUT 13
+#define NRF_ERROR_NULL 14
+#define NRF_ERROR_FORBIDDEN 15
+#define NRF_ERROR_INVALID_ADDR 16
+#define NRF_ERROR_BUSY 17
+#define NRF_ERROR_CONN_COUNT 18
+#define NRF_ERROR_RESOURCES 19
+
+#define NRF_ERROR_STK_BASE_NUM 0x3000
+#define BLE_ERROR_NOT_ENABLED (NRF_ERROR_STK_BASE_NUM + 0x001)
+#define BLE_ERROR_INVALID_CONN_HANDLE (NRF_ERROR_STK_BASE_NUM + 0x002)
+#define BLE_ERROR_INVALID_ATTR_HANDLE (NRF_ERROR_STK_BASE_NUM + 0x003)
+
+#define UNUSED_PARAMETER(X) (void)(X)
+#define UNUSED_VARIABLE(X) (void)(X)
+#define UNUSED_RETURN_VALUE(X) (void)(X)
+#ifndef MIN
+#define MIN(A, B) ((A) < (B) ? (A) : (B))
+#endif
+#ifndef MAX
+#define MAX(A, B) ((A) > (B) ? (A) : (B))
+#endif
+#define ROUNDED_DIV(A, B) (((A) + ((B) / 2)) / (B))
+#define CEIL_DIV(A, B) (((A) + (B) - 1) / (B))
+#define STATIC_ASSERT(EXPR) _Static_assert(EXPR, #EXPR)
+#define ARRAY_SIZE(ARR) (sizeof(ARR) / sizeof((ARR)[0]))
+#define MSEC_TO_UNITS(TIME, RESOLUTION) (((TIME) * 1000) / (RESOLUTION))
+#define UNIT_0_625_MS 625
+#define UNIT_1_25_MS 1250
+#define UNIT_10_MS 10000
+#define STRINGIFY_(VAL) #VAL
+#define STRINGIFY(VAL) STRINGIFY_(VAL)
+
+#define __STATIC_INLINE static inline
+#define __ALIGN(N) __attribute__((aligned(N)))
+#define __WFE() do {} while (0)
+#define __SEV() do {} while (0)
+#define __NOP() do {} while (0)
+
+// The application runs in a single thread. Interrupts preempt only blocking waits.
+#define CRITICAL_REGION_ENTER() {
+#define CRITICAL_REGION_EXIT() }
+
+// Main stack pointer of the application at the top of the simulated RAM
+uint32_t __get_MSP(void);
+
+void NVIC_SystemReset(void) __attribute__((noreturn));
+
+// Interrupt numbers of nRF51
+typedef enum
+{
+    POWER_CLOCK_IRQn = 0,
+    RADIO_IRQn = 1,
+    UART0_IRQn = 2,
+    SPI0_TWI0_IRQn = 3,
+    SPI1_TWI1_IRQn = 4,
+    GPIOTE_IRQn = 6,
+    ADC_IRQn = 7,
+    TIMER0_IRQn = 8,
+    TIMER1_IRQn = 9,
+    TIMER2_IRQn = 10,
+    RTC0_IRQn = 11,
+    TEMP_IRQn = 12,
+    RNG_IRQn = 13,
+    ECB_IRQn = 14,
+    CCM_AAR_IRQn = 15,
+    WDT_IRQn = 16,
+    RTC1_IRQn = 17,
+    QDEC_IRQn = 18,
+    LPCOMP_IRQn = 19,
+    SWI0_IRQn = 20,
+    SWI1_IRQn = 21,
+    SWI2_IRQn = 22,
+    SWI3_IRQn = 23,
+    SWI4_IRQn = 24,
+    SWI5_IRQn = 25,
+} IRQn_Type;
+
+#define APP_IRQ_PRIORITY_HIGH 1
+#define APP_IRQ_PRIORITY_LOW 3
+
+// Errors are reported as by the DEBUG build of app_error, with the file and the line.
+#define NRF_FAULT_ID_SDK_ERROR 0x4001
+
+typedef struct
+{
+    uint16_t line_num;
+    uint8_t const *p_file_name;
+    uint32_t err_code;
+} error_info_t;
+
+void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t *p_file_name);
+void app_error_fault_handler(uint32_t id, uint32_t pc, uint32_t info);
+
+#define APP_ERROR_HANDLER(ERR_CODE)                                              \
+    do                                                                           \
+    {                                                                            \
+        app_error_handler((ERR_CODE), __LINE__, (const uint8_t *)__FILE__);      \
+    } while (0)
+
+#define APP_ERROR_CHECK(ERR_CODE)                                                \
+    do                                                                           \
+    {                                                                            \
+        const uint32_t LOCAL_ERR_CODE = (ERR_CODE);                              \
+        if (LOCAL_ERR_CODE != NRF_SUCCESS)                                       \
+        {                                                                        \
+            APP_ERROR_HANDLER(LOCAL_ERR_CODE);                                   \
+        }                                                                        \
+    } while (0)
+
+#define APP_ERROR_CHECK_BOOL(BOOLEAN_VALUE)                                      \
+    do                                                                           \
+    {                                                                            \
+        if (!(BOOLEAN_VALUE))                                                    \
+        {                                                                        \
+            APP_ERROR_HANDLER(0);                                                \
+        }                                                                        \
+    } while (0)
+
+#define VERIFY_SUCCESS(STATEMENT)                                                \
+    do                                                                           \
+    {                                                                            \
+        uint32_t _err_code = (uint32_t)(STATEMENT);                              \
+        if (_err_code != NRF_SUCCESS)                                            \
+        {                                                                        \
+            return _err_code;                                                    \
+        }                                                                        \
+    } while (0)
+
+// Registers of the peripherals the application accesses directly.
+// They are mapped at the addresses of nRF51 by the simulation, and the writes take effect
+// at the next call into the SDK or the SoftDevice.
+typedef struct
+{
+    volatile uint32_t TASKS_START;
+    volatile uint32_t TASKS_STOP;
+    volatile uint32_t TASKS_CLEAR;
+    volatile uint32_t TASKS_TRIGOVRFLW;
+    volatile uint32_t RESERVED0[60];
+    volatile uint32_t EVENTS_TICK;
+    volatile uint32_t EVENTS_OVRFLW;
+    volatile uint32_t RESERVED1[14];
+    volatile uint32_t EVENTS_COMPARE[4];
+    volatile uint32_t RESERVED2[109];
+    volatile uint32_t INTENSET;
+    volatile uint32_t INTENCLR;
+    volatile uint32_t RESERVED3[13];
+    volatile uint32_t EVTEN;
+    volatile uint32_t EVTENSET;
+    volatile uint32_t EVTENCLR;
+    volatile uint32_t RESERVED4[110];
+    volatile uint32_t COUNTER;
+    volatile uint32_t PRESCALER;
+    volatile uint32_t RESERVED5[13];
+    volatile uint32_t CC[4];
+} NRF_RTC_Type;
+
+// TIMER is not clocked by the simulation, as the CPU time is not modeled. A capture reads 0.
+typedef struct
+{
+    volatile uint32_t TASKS_START;
+    volatile uint32_t TASKS_STOP;
+    volatile uint32_t TASKS_COUNT;
+    volatile uint32_t TASKS_CLEAR;
+    volatile uint32_t TASKS_SHUTDOWN;
+    volatile uint32_t RESERVED0[11];
+    volatile uint32_t TASKS_CAPTURE[4];
+    volatile uint32_t RESERVED1[60];
+    volatile uint32_t EVENTS_COMPARE[4];
+    volatile uint32_t RESERVED2[44];
+    volatile uint32_t SHORTS;
+    volatile uint32_t RESERVED3[64];
+    volatile uint32_t INTENSET;
+    volatile uint32_t INTENCLR;
+    volatile uint32_t RESERVED4[126];
+    volatile uint32_t MODE;
+    volatile uint32_t BITMODE;
+    volatile uint32_t RESERVED5;
+    volatile uint32_t PRESCALER;
+    volatile uint32_t RESERVED6[11];
+    volatile uint32_t CC[4];
+} NRF_TIMER_Type;
+
+typedef struct
+{
+    volatile uint32_t TASKS_START;
+    volatile uint32_t TASKS_STOP;
+    volatile uint32_t RESERVED0[62];
+    volatile uint32_t EVENTS_END;
+    volatile uint32_t RESERVED1[128];
+    volatile uint32_t INTENSET;
+    volatile uint32_t INTENCLR;
+    volatile uint32_t RESERVED2[61];
+    volatile uint32_t BUSY;
+    volatile uint32_t RESERVED3[63];
+    volatile uint32_t ENABLE;
+    volatile uint32_t CONFIG;
+    volatile uint32_t RESULT;
+} NRF_ADC_Type;
+
+typedef struct
+{
+    volatile uint32_t EEP;
+    volatile uint32_t TEP;
+} PPI_CH_Type;
+
+typedef struct
+{
+    volatile uint32_t RESERVED0[320];
+    volatile uint32_t CHEN;
+    volatile uint32_t CHENSET;
+    volatile uint32_t CHENCLR;
+    volatile uint32_t RESERVED1;
+    PPI_CH_Type CH[16];
+} NRF_PPI_Type;
+
+typedef struct
+{
+    volatile uint32_t RESERVED0[4];
+    volatile uint32_t CODEPAGESIZE;
+    volatile uint32_t CODESIZE;
+    volatile uint32_t RESERVED1[4];
+    volatile uint32_t CLENR0;
+    volatile uint32_t PPFC;
+    volatile uint32_t RESERVED2;
+    volatile uint32_t NUMRAMBLOCK;
+    volatile uint32_t SIZERAMBLOCKS;
+} NRF_FICR_Type;
+
+#define NRF_FICR_BASE 0x10000000UL
+#define NRF_ADC_BASE 0x40007000UL
+#define NRF_TIMER2_BASE 0x4000A000UL
+#define NRF_RTC1_BASE 0x40011000UL
+#define NRF_PPI_BASE 0x4001F000UL
+
+#define NRF_FICR ((NRF_FICR_Type *)NRF_FICR_BASE)
+#define NRF_ADC ((NRF_ADC_Type *)NRF_ADC_BASE)
+#define NRF_TIMER2 ((NRF_TIMER_Type *)NRF_TIMER2_BASE)
+#define NRF_RTC1 ((NRF_RTC_Type *)NRF_RTC1_BASE)
+#define NRF_PPI ((NRF_PPI_Type *)NRF_PPI_BASE)
+
+#define TIMER_MODE_MODE_Timer 0UL
+#define TIMER_BITMODE_BITMODE_16Bit 0UL
+
+#define RTC_EVTEN_COMPARE0_Msk (1UL << 16)
+#define RTC_EVTEN_COMPARE1_Msk (1UL << 17)
+#define RTC_EVTEN_COMPARE2_Msk (1UL << 18)
+#define RTC_EVTEN_COMPARE3_Msk (1UL << 19)
+
+#define POWER_RESETREAS_RESETPIN_Msk (1UL << 0)
+#define POWER_RESETREAS_DOG_Msk (1UL << 1)
+#define POWER_RESETREAS_SREQ_Msk (1UL << 2)
+#define POWER_RESETREAS_LOCKUP_Msk (1UL << 3)
+#define POWER_RESETREAS_OFF_Msk (1UL << 16)
+#define POWER_RESETREAS_LPCOMP_Msk (1UL << 17)
+#define POWER_RESETREAS_DIF_Msk (1UL << 18)
+
+#define POWER_RAMON_ONRAM0_Msk (1UL << 0)
+#define POWER_RAMON_ONRAM1_Msk (1UL << 1)
+#define POWER_RAMON_OFFRAM0_Msk (1UL << 16)
+#define POWER_RAMON_OFFRAM1_Msk (1UL << 17)
+#define POWER_RAMONB_ONRAM2_Msk (1UL << 0)
+#define POWER_RAMONB_ONRAM3_Msk (1UL << 1)
+
+#endif
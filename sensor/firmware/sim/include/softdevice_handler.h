@@ -0,0 +1,39 @@
+#ifndef _SIM_SOFTDEVICE_HANDLER_H
+#define _SIM_SOFTDEVICE_HANDLER_H
+
+// SoftDevice handler of SDK 12 with the scheduler (APPSH). The events are pulled from
+// the simulated SoftDevice in the main loop and dispatched to the registered handlers.
+
+#include "ble.h"
+#include "nrf_sdm.h"
+#include "nrf_soc.h"
+
+#define BLE_STACK_HANDLER_SCHED_EVT_SIZE 0
+
+typedef void (*ble_evt_handler_t)(ble_evt_t *p_ble_evt);
+typedef void (*sys_evt_handler_t)(uint32_t evt_id);
+
+#define SOFTDEVICE_HANDLER_APPSH_INIT(CLOCK_SOURCE, USE_SCHEDULER)           \
+    do                                                                      \
+    {                                                                       \
+        uint32_t ERR_CODE = softdevice_handler_init((CLOCK_SOURCE), (USE_SCHEDULER)); \
+        APP_ERROR_CHECK(ERR_CODE);                                          \
+    } while (0)
+
+#define SOFTDEVICE_HANDLER_INIT(CLOCK_SOURCE, EVT_HANDLER) SOFTDEVICE_HANDLER_APPSH_INIT(CLOCK_SOURCE, false)
+
+// The application RAM base is checked by the linker script on the target only
+#define CHECK_RAM_START_ADDR(C_LINK_CNT, P_LINK_CNT) \
+    do                                              \
+    {                                               \
+    } while (0)
+
+uint32_t softdevice_handler_init(nrf_clock_lf_cfg_t const *p_clock_lf_cfg, bool use_scheduler);
+uint32_t softdevice_enable_get_default_config(uint8_t central_links_count,
+                                              uint8_t periph_links_count,
+                                              ble_enable_params_t *p_ble_enable_params);
+uint32_t softdevice_enable(ble_enable_params_t *p_ble_enable_params);
+uint32_t softdevice_ble_evt_handler_set(ble_evt_handler_t ble_evt_handler);
+uint32_t softdevice_sys_evt_handler_set(sys_evt_handler_t sys_evt_handler);
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef _SIM_H
+#define _SIM_H
+
+// Host simulation of the application.
+// The application and its modules are compiled unchanged, and the SDK libraries, the SoftDevice
+// and the peripherals are replaced by models running on a virtual time in ns.
+// Interrupt handlers run at the time of their event, also while the main context waits in
+// sd_app_evt_wait() or in a busy wait, like on the target.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define SIM_NS_PER_US 1000ULL
+#define SIM_NS_PER_MS 1000000ULL
+#define SIM_NS_PER_S 1000000000ULL
+
+#define SIM_RAM_BASE 0x20000000UL
+#define SIM_RAM_SIZE 0x4000UL // nRF51822 QFAA, 16 kB
+#define SIM_FICR_BASE 0x10000000UL
+#define SIM_PERIPHERAL_BASE 0x40000000UL
+#define SIM_PERIPHERAL_SIZE 0x20000UL
+
+typedef struct sim_event_s sim_event_t;
+typedef void (*sim_event_handler_t)(sim_event_t *p_event);
+
+// Event on the virtual time. Embed it in the state of the model and schedule it with its handler.
+struct sim_event_s
+{
+    sim_event_handler_t handler;
+    uint64_t time_ns;
+    uint64_t seq;        // events at the same time run in the order they are scheduled
+    uint32_t heap_index; // 0 while not scheduled
+};
+
+// Interrupts waking up the application from sd_app_evt_wait()
+typedef enum
+{
+    SIM_WAKE_RTC,
+    SIM_WAKE_SOFTDEVICE,
+    SIM_WAKE_RADIO_NOTIFICATION,
+    SIM_WAKE_GPIOTE,
+    SIM_WAKE_SPI,
+    SIM_WAKE_ADC,
+    SIM_WAKE_CNT
+} sim_wake_source_t;
+
+typedef struct
+{
+    uint64_t duration_ns;
+    uint64_t seed;
+    double lfclk_ppm;          // error of the 32.768 kHz clock
+    const char *trace_path;    // CSV of the events, NULL for none
+    const char *script_path;   // stimulus script, NULL for none
+    bool is_flash_erased;      // FDS starts on erased flash instead of formatted pages
+    bool exit_on_error;        // end at the first APP_ERROR instead of continuing like the target
+    uint32_t epoch_start;      // UNIX time at the start, written by the bridge
+    double active_scan_ratio;  // probability that an advertising event gets a scan request
+    uint32_t bridge_period_s;  // a central connects and writes the time at this period, 0 for none
+    uint16_t central_interval_ms;
+    uint16_t battery_mv;
+} sim_config_t;
+
+#define SIM_ADV_INTERVAL_SLOTS 4
+
+// Ground truth counted by the models, compared with the estimation of the application at the end
+typedef struct
+{
+    uint32_t wakeup_cnt;
+    uint32_t wakeup_source_cnt[SIM_WAKE_CNT];
+    uint32_t error_cnt;
+    struct
+    {
+        uint16_t interval; // 0.625 ms unit
+        uint32_t cnt;
+    } adv[SIM_ADV_INTERVAL_SLOTS];
+    uint32_t adv_start_cnt;
+    uint32_t adv_data_set_cnt;
+    uint64_t adv_data_age_total_ns; // from sd_ble_gap_adv_data_set() to each advertising event
+    uint32_t adv_data_age_cnt;
+    uint32_t scan_response_cnt;
+    uint32_t radio_notification_cnt;
+    uint32_t connection_cnt;
+    uint32_t connection_event_cnt;
+    uint64_t connected_ns;
+    uint32_t gatt_write_cnt;
+    uint32_t gatt_read_cnt;
+    uint64_t gatt_read_latency_total_ns; // from the read request of the central to the response
+    uint64_t gatt_read_latency_max_ns;
+    uint32_t flash_write_cnt;
+    uint32_t flash_word_cnt;
+    uint32_t flash_page_erase_cnt;
+    uint32_t flash_error_cnt;
+    uint32_t fds_record_write_cnt; // writes and updates of FDS records
+    uint32_t spi_transfer_cnt;
+    uint32_t bme280_conversion_cnt;
+    uint32_t bme280_early_read_cnt;
+    uint32_t adc_sample_cnt;
+    uint32_t sched_peak;
+    uint32_t timer_start_cnt;
+    uint32_t timer_restart_ignored_cnt;
+    uint32_t rtc_stop_cnt;
+    uint32_t scan_report_cnt;
+} sim_stats_t;
+
+extern sim_config_t sim_config;
+extern sim_stats_t sim_stats;
+
+// sim_core.c
+uint64_t sim_now(void);
+void sim_event_schedule(sim_event_t *p_event, uint64_t time_ns);
+void sim_event_cancel(sim_event_t *p_event);
+bool sim_event_is_scheduled(const sim_event_t *p_event);
+void sim_irq(sim_wake_source_t source);
+const char *sim_wake_source_name(sim_wake_source_t source);
+void sim_busy_wait(uint64_t duration_ns);
+void sim_trace(const char *p_event, const char *p_format, ...) __attribute__((format(printf, 2, 3)));
+uint32_t sim_rand(void);
+double sim_rand_uniform(void);
+double sim_rand_normal(void);
+void sim_memory_init(void);
+void sim_run(int (*p_main)(void)) __attribute__((noreturn));
+void sim_finish(const char *p_reason) __attribute__((noreturn));
+uint32_t sim_epoch_now(void);
+
+// sim_timer.c
+uint64_t sim_rtc_ticks(uint64_t time_ns);
+uint64_t sim_rtc_time_ns(uint64_t ticks);
+void sim_hw_sync(void);
+void sim_timer_report(void);
+
+// sim_softdevice.c
+void sim_sd_ble_evt_put(const void *p_evt, uint16_t len);
+void sim_sd_soc_evt_put(uint32_t evt_id);
+void sim_sd_radio_notification(void);
+bool sim_sd_is_enabled(void);
+void sim_softdevice_report(void);
+
+// sim_ble.c
+void sim_ble_init(void);
+void sim_ble_connect(uint16_t interval_ms);
+void sim_ble_disconnect(void);
+void sim_ble_write(uint16_t uuid, const uint8_t *p_data, uint16_t len);
+void sim_ble_read(uint16_t uuid);
+void sim_ble_adv_report(const uint8_t *p_data, uint8_t len, int8_t rssi);
+bool sim_ble_adv_data_get(uint8_t *p_data, uint8_t *p_len);
+void sim_ble_report(void);
+
+// sim_periph.c
+void sim_periph_init(const uint8_t *p_cs_pins, uint8_t cs_pin_cnt);
+void sim_ppi_task(uint32_t task_address);
+void sim_button_press(uint32_t duration_ms);
+void sim_battery_set(uint16_t mv);
+void sim_env_get(double *p_temperature, double *p_humidity, double *p_pressure);
+
+// sim_fds.c
+void sim_fds_report(void);
+
+// sim_main.c
+void sim_report(const char *p_reason);
+
+#endif
@@ -0,0 +1,1103 @@
+// BLE of the SoftDevice: advertiser, peripheral link, scanner and the GATT server,
+// with a central (the bridge or a phone) driven by the stimulus of sim_main.c
+
+#include "sim.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "ble.h"
+#include "app_util.h"
+#include "nrf_soc.h"
+
+#define ATTR_CNT_MAX 96
+#define ATTR_VALUE_LEN_MAX 64
+#define VS_UUID_CNT_MAX 1
+#define CONN_HANDLE 0
+#define ATT_PAYLOAD_MAX (GATT_MTU_SIZE_DEFAULT - 3)
+#define ADV_DELAY_MAX_NS (10 * SIM_NS_PER_MS) // advDelay of the link layer
+#define ADV_START_DELAY_NS (1 * SIM_NS_PER_MS)
+#define RADIO_NOTIFICATION_DISTANCE_NS (800 * SIM_NS_PER_US)
+#define CONN_SUP_TIMEOUT_UNITS 400                 // 4 s in 10 ms unit
+#define CONN_PARAM_UPDATE_INSTANT_EVENTS 6         // connection events until the new parameters apply
+#define DISCONNECT_EVENTS 2                        // connection events until a local disconnect completes
+#define ATT_TIMEOUT_NS (30 * SIM_NS_PER_S)
+#define CENTRAL_OP_QUEUE_SIZE 16
+
+typedef enum
+{
+    ATTR_KIND_SERVICE,
+    ATTR_KIND_CHAR_DECL,
+    ATTR_KIND_VALUE,
+    ATTR_KIND_USER_DESC,
+    ATTR_KIND_CCCD,
+} attr_kind_t;
+
+typedef struct
+{
+    attr_kind_t kind;
+    ble_uuid_t uuid;
+    ble_gatt_char_props_t props;
+    bool rd_auth;
+    bool wr_auth;
+    uint16_t max_len;
+    uint16_t len;
+    uint8_t value[ATTR_VALUE_LEN_MAX];
+} attr_t;
+
+typedef enum
+{
+    CENTRAL_OP_WRITE,
+    CENTRAL_OP_WRITE_EPOCH, // Time characteristic with the current time of the simulation
+    CENTRAL_OP_READ,
+    CENTRAL_OP_DISCONNECT,
+} central_op_type_t;
+
+typedef struct
+{
+    central_op_type_t type;
+    uint16_t uuid;
+    uint16_t len;
+    uint8_t data[ATTR_VALUE_LEN_MAX];
+} central_op_t;
+
+typedef enum
+{
+    LINK_IDLE,
+    LINK_CONNECTED,
+    LINK_DISCONNECTING,
+} link_state_t;
+
+static struct
+{
+    bool is_enabled;
+    uint8_t vs_uuid_cnt;
+    attr_t attrs[ATTR_CNT_MAX]; // handle is the index + 1
+    uint16_t attr_cnt;
+    uint8_t device_name[BLE_GAP_DEVNAME_MAX_LEN];
+    uint16_t device_name_len;
+    uint16_t appearance;
+    ble_gap_conn_params_t ppcp;
+    int8_t tx_power;
+} m_gap;
+
+static struct
+{
+    bool is_active;
+    ble_gap_adv_params_t params;
+    uint8_t data[BLE_GAP_ADV_MAX_SIZE];
+    uint8_t dlen;
+    uint8_t sr_data[BLE_GAP_ADV_MAX_SIZE];
+    uint8_t srlen;
+    uint64_t data_set_ns;
+    uint64_t start_ns;
+    sim_event_t adv_event;
+    sim_event_t notification_event;
+    sim_event_t timeout_event;
+} m_adv;
+
+static struct
+{
+    link_state_t state;
+    ble_gap_conn_params_t params;
+    uint64_t connected_ns;
+    uint32_t event_cnt;
+    sim_event_t conn_event;
+    sim_event_t notification_event;
+    // Connection parameter update requested by the peripheral, applied at the instant
+    bool is_update_pending;
+    uint16_t update_interval;
+    uint32_t update_instant;
+    uint32_t disconnect_instant;
+    uint8_t disconnect_reason;
+} m_link;
+
+static struct
+{
+    bool is_connect_pending;
+    uint16_t connect_interval_ms;
+    central_op_t ops[CENTRAL_OP_QUEUE_SIZE];
+    uint8_t op_head;
+    uint8_t op_cnt;
+    // Read held by the authorization of the application
+    bool is_read_pending;
+    uint16_t read_handle;
+    uint64_t read_request_ns;
+} m_central;
+
+static struct
+{
+    bool is_active;
+    ble_gap_scan_params_t params;
+    sim_event_t timeout_event;
+} m_scan;
+
+// Event buffer with the room for the data of a write
+typedef union
+{
+    ble_evt_t evt;
+    uint32_t buffer[BLE_EVT_LEN_MAX / 4 + 1];
+} evt_buffer_t;
+
+static void evt_init(evt_buffer_t *p_buffer, uint16_t evt_id)
+{
+    memset(p_buffer, 0, sizeof(*p_buffer));
+    p_buffer->evt.header.evt_id = evt_id;
+}
+
+static void evt_put(evt_buffer_t *p_buffer, uint16_t len)
+{
+    sim_sd_ble_evt_put(&p_buffer->evt, len);
+}
+
+static attr_t *attr_get(uint16_t handle)
+{
+    if (handle == 0 || handle > m_gap.attr_cnt)
+    {
+        return NULL;
+    }
+
+    return &m_gap.attrs[handle - 1];
+}
+
+// Value handle of a characteristic of the vendor specific service by its 16 bit UUID
+static uint16_t value_handle_find(uint16_t uuid)
+{
+    for (uint16_t i = 0; i < m_gap.attr_cnt; i++)
+    {
+        if (m_gap.attrs[i].kind == ATTR_KIND_VALUE && m_gap.attrs[i].uuid.uuid == uuid)
+        {
+            return i + 1;
+        }
+    }
+
+    return BLE_GATT_HANDLE_INVALID;
+}
+
+static void hex_format(char *p_str, const uint8_t *p_data, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++)
+    {
+        sprintf(&p_str[i * 2], "%02x", p_data[i]);
+    }
+    p_str[len * 2] = '\0';
+}
+
+void sim_ble_init(void)
+{
+    memset(&m_gap, 0, sizeof(m_gap));
+    m_gap.is_enabled = true;
+    memcpy(m_gap.device_name, "nRF5x", 5);
+    m_gap.device_name_len = 5;
+}
+
+bool sim_ble_adv_data_get(uint8_t *p_data, uint8_t *p_len)
+{
+    memcpy(p_data, m_adv.data, m_adv.dlen);
+    *p_len = m_adv.dlen;
+
+    return m_adv.dlen > 0;
+}
+
+uint32_t sd_ble_uuid_vs_add(ble_uuid128_t const *p_vs_uuid, uint8_t *p_uuid_type)
+{
+    if (!m_gap.is_enabled)
+    {
+        return BLE_ERROR_NOT_ENABLED;
+    }
+    if (m_gap.vs_uuid_cnt == VS_UUID_CNT_MAX)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    *p_uuid_type = BLE_UUID_TYPE_VENDOR_BEGIN + m_gap.vs_uuid_cnt++;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_user_mem_reply(uint16_t conn_handle, void const *p_block)
+{
+    return (m_link.state == LINK_IDLE) ? BLE_ERROR_INVALID_CONN_HANDLE : NRF_SUCCESS;
+}
+
+static attr_t *attr_add(attr_kind_t kind)
+{
+    if (m_gap.attr_cnt == ATTR_CNT_MAX)
+    {
+        return NULL;
+    }
+
+    attr_t *p_attr = &m_gap.attrs[m_gap.attr_cnt++];
+    memset(p_attr, 0, sizeof(*p_attr));
+    p_attr->kind = kind;
+
+    return p_attr;
+}
+
+uint32_t sd_ble_gatts_service_add(uint8_t type, ble_uuid_t const *p_uuid, uint16_t *p_handle)
+{
+    if (!m_gap.is_enabled)
+    {
+        return BLE_ERROR_NOT_ENABLED;
+    }
+    if (type != BLE_GATTS_SRVC_TYPE_PRIMARY)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    attr_t *p_attr = attr_add(ATTR_KIND_SERVICE);
+    if (p_attr == NULL)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    p_attr->uuid = *p_uuid;
+    *p_handle = m_gap.attr_cnt;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_characteristic_add(uint16_t service_handle,
+                                         ble_gatts_char_md_t const *p_char_md,
+                                         ble_gatts_attr_t const *p_attr_char_value,
+                                         ble_gatts_char_handles_t *p_handles)
+{
+    attr_t *p_service = attr_get(service_handle);
+
+    if (!m_gap.is_enabled)
+    {
+        return BLE_ERROR_NOT_ENABLED;
+    }
+    if (p_service == NULL || p_service->kind != ATTR_KIND_SERVICE)
+    {
+        return BLE_ERROR_INVALID_ATTR_HANDLE;
+    }
+    if (p_attr_char_value->max_len > ATTR_VALUE_LEN_MAX || p_attr_char_value->init_len > p_attr_char_value->max_len)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (m_gap.attr_cnt + 4 > ATTR_CNT_MAX)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    attr_t *p_decl = attr_add(ATTR_KIND_CHAR_DECL);
+    p_decl->props = p_char_md->char_props;
+
+    attr_t *p_value = attr_add(ATTR_KIND_VALUE);
+    p_value->uuid = *p_attr_char_value->p_uuid;
+    p_value->props = p_char_md->char_props;
+    p_value->rd_auth = p_attr_char_value->p_attr_md->rd_auth;
+    p_value->wr_auth = p_attr_char_value->p_attr_md->wr_auth;
+    p_value->max_len = p_attr_char_value->max_len;
+    p_value->len = p_attr_char_value->init_len;
+    if (p_attr_char_value->p_value != NULL)
+    {
+        memcpy(p_value->value, p_attr_char_value->p_value + p_attr_char_value->init_offs, p_value->len);
+    }
+
+    memset(p_handles, 0, sizeof(*p_handles));
+    p_handles->value_handle = m_gap.attr_cnt;
+
+    if (p_char_md->p_char_user_desc != NULL && p_char_md->char_user_desc_max_size > 0)
+    {
+        attr_t *p_desc = attr_add(ATTR_KIND_USER_DESC);
+        p_desc->len = MIN(p_char_md->char_user_desc_size, ATTR_VALUE_LEN_MAX);
+        memcpy(p_desc->value, p_char_md->p_char_user_desc, p_desc->len);
+        p_handles->user_desc_handle = m_gap.attr_cnt;
+    }
+
+    if (p_char_md->char_props.notify || p_char_md->char_props.indicate)
+    {
+        attr_t *p_cccd = attr_add(ATTR_KIND_CCCD);
+        p_cccd->len = 2;
+        p_cccd->max_len = 2;
+        p_handles->cccd_handle = m_gap.attr_cnt;
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_value_set(uint16_t conn_handle, uint16_t handle, ble_gatts_value_t *p_value)
+{
+    attr_t *p_attr = attr_get(handle);
+
+    if (p_attr == NULL || p_attr->kind != ATTR_KIND_VALUE)
+    {
+        return BLE_ERROR_INVALID_ATTR_HANDLE;
+    }
+    if (p_value->offset > p_attr->max_len)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (p_value->offset + p_value->len > p_attr->max_len)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    if (p_value->p_value != NULL)
+    {
+        memcpy(&p_attr->value[p_value->offset], p_value->p_value, p_value->len);
+    }
+    p_attr->len = MAX(p_attr->len, p_value->offset + p_value->len);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_value_get(uint16_t conn_handle, uint16_t handle, ble_gatts_value_t *p_value)
+{
+    attr_t *p_attr = attr_get(handle);
+
+    if (p_attr == NULL)
+    {
+        return BLE_ERROR_INVALID_ATTR_HANDLE;
+    }
+    if (p_value->offset > p_attr->len)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    uint16_t len = MIN(p_value->len, p_attr->len - p_value->offset);
+    if (p_value->p_value != NULL)
+    {
+        memcpy(p_value->p_value, &p_attr->value[p_value->offset], len);
+    }
+    p_value->len = len;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_sys_attr_set(uint16_t conn_handle, uint8_t const *p_sys_attr_data, uint16_t len, uint32_t flags)
+{
+    return (m_link.state == LINK_IDLE) ? BLE_ERROR_INVALID_CONN_HANDLE : NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_exchange_mtu_reply(uint16_t conn_handle, uint16_t server_rx_mtu)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+static void read_complete(uint16_t gatt_status)
+{
+    attr_t *p_attr = attr_get(m_central.read_handle);
+    uint64_t latency_ns = sim_now() - m_central.read_request_ns;
+    char hex[ATTR_VALUE_LEN_MAX * 2 + 1];
+
+    m_central.is_read_pending = false;
+    sim_stats.gatt_read_cnt++;
+    sim_stats.gatt_read_latency_total_ns += latency_ns;
+    if (latency_ns > sim_stats.gatt_read_latency_max_ns)
+    {
+        sim_stats.gatt_read_latency_max_ns = latency_ns;
+    }
+
+    hex_format(hex, p_attr->value, MIN(p_attr->len, ATT_PAYLOAD_MAX));
+    sim_trace("GATT_READ", "0x%04x status 0x%04x latency %.1f ms value %s",
+              p_attr->uuid.uuid, gatt_status, latency_ns / (double)SIM_NS_PER_MS, hex);
+}
+
+uint32_t sd_ble_gatts_rw_authorize_reply(uint16_t conn_handle, ble_gatts_rw_authorize_reply_params_t const *p_reply)
+{
+    if (m_link.state == LINK_IDLE || conn_handle != CONN_HANDLE)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if (p_reply->type != BLE_GATTS_AUTHORIZE_TYPE_READ || !m_central.is_read_pending)
+    {
+        // No write of the central asks for authorization.
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (p_reply->params.read.update && p_reply->params.read.p_data != NULL)
+    {
+        ble_gatts_value_t value = {
+            .len = p_reply->params.read.len,
+            .offset = p_reply->params.read.offset,
+            .p_value = (uint8_t *)p_reply->params.read.p_data};
+        uint32_t err_code = sd_ble_gatts_value_set(conn_handle, m_central.read_handle, &value);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
+    read_complete(p_reply->params.read.gatt_status);
+
+    return NRF_SUCCESS;
+}
+
+// Advertiser
+static void adv_interval_count(uint16_t interval)
+{
+    for (uint32_t i = 0; i < SIM_ADV_INTERVAL_SLOTS; i++)
+    {
+        if (sim_stats.adv[i].interval == interval || sim_stats.adv[i].cnt == 0)
+        {
+            sim_stats.adv[i].interval = interval;
+            sim_stats.adv[i].cnt++;
+            return;
+        }
+    }
+}
+
+static void adv_stop(void)
+{
+    m_adv.is_active = false;
+    sim_event_cancel(&m_adv.adv_event);
+    sim_event_cancel(&m_adv.notification_event);
+    sim_event_cancel(&m_adv.timeout_event);
+}
+
+static void adv_notification_evt(sim_event_t *p_event)
+{
+    sim_sd_radio_notification();
+}
+
+static void adv_event_schedule(uint64_t time_ns)
+{
+    sim_event_schedule(&m_adv.adv_event, time_ns);
+    if (time_ns >= sim_now() + RADIO_NOTIFICATION_DISTANCE_NS)
+    {
+        sim_event_schedule(&m_adv.notification_event, time_ns - RADIO_NOTIFICATION_DISTANCE_NS);
+    }
+}
+
+static void conn_event_schedule(uint64_t time_ns);
+
+static void link_connect(void)
+{
+    evt_buffer_t buffer;
+
+    adv_stop();
+
+    m_central.is_connect_pending = false;
+    m_link.state = LINK_CONNECTED;
+    m_link.params.min_conn_interval = MSEC_TO_UNITS(m_central.connect_interval_ms, UNIT_1_25_MS);
+    m_link.params.max_conn_interval = m_link.params.min_conn_interval;
+    m_link.params.slave_latency = 0;
+    m_link.params.conn_sup_timeout = CONN_SUP_TIMEOUT_UNITS;
+    m_link.connected_ns = sim_now();
+    m_link.event_cnt = 0;
+    m_link.is_update_pending = false;
+    sim_stats.connection_cnt++;
+    sim_trace("CONNECTED", "interval %u ms", m_central.connect_interval_ms);
+
+    evt_init(&buffer, BLE_GAP_EVT_CONNECTED);
+    buffer.evt.evt.gap_evt.conn_handle = CONN_HANDLE;
+    buffer.evt.evt.gap_evt.params.connected.role = BLE_GAP_ROLE_PERIPH;
+    buffer.evt.evt.gap_evt.params.connected.conn_params = m_link.params;
+    evt_put(&buffer, sizeof(ble_evt_hdr_t) + sizeof(ble_gap_evt_t));
+
+    // transmitWindowOffset and transmitWindowSize are folded into 1.25 ms
+    conn_event_schedule(sim_now() + 1250 * SIM_NS_PER_US + m_link.params.max_conn_interval * 1250 * SIM_NS_PER_US);
+}
+
+static void adv_evt(sim_event_t *p_event)
+{
+    adv_interval_count(m_adv.params.interval);
+    sim_stats.adv_data_age_total_ns += sim_now() - m_adv.data_set_ns;
+    sim_stats.adv_data_age_cnt++;
+
+    bool is_scan_response = (m_adv.srlen > 0 && sim_config.active_scan_ratio > 0 &&
+                             sim_rand_uniform() < sim_config.active_scan_ratio);
+    if (is_scan_response)
+    {
+        sim_stats.scan_response_cnt++;
+    }
+    sim_trace("ADV", "interval %u, %u+%u bytes%s", m_adv.params.interval, m_adv.dlen, m_adv.srlen,
+              is_scan_response ? ", scan response" : "");
+
+    if (m_central.is_connect_pending && m_adv.params.type == BLE_GAP_ADV_TYPE_ADV_IND)
+    {
+        link_connect();
+        return;
+    }
+
+    uint64_t interval_ns = m_adv.params.interval * 625 * SIM_NS_PER_US;
+    adv_event_schedule(sim_now() + interval_ns + (uint64_t)(sim_rand_uniform() * ADV_DELAY_MAX_NS));
+}
+
+static void adv_timeout_evt(sim_event_t *p_event)
+{
+    evt_buffer_t buffer;
+
+    adv_stop();
+    sim_trace("ADV_TIMEOUT", "");
+
+    evt_init(&buffer, BLE_GAP_EVT_TIMEOUT);
+    buffer.evt.evt.gap_evt.conn_handle = BLE_CONN_HANDLE_INVALID;
+    buffer.evt.evt.gap_evt.params.timeout.src = BLE_GAP_TIMEOUT_SRC_ADVERTISING;
+    evt_put(&buffer, sizeof(ble_evt_hdr_t) + sizeof(ble_gap_evt_t));
+}
+
+// Length fields of the AD structures have to add up to the length of the data.
+static bool adv_data_is_valid(uint8_t const *p_data, uint8_t dlen)
+{
+    uint8_t index = 0;
+
+    while (index < dlen)
+    {
+        uint8_t field_len = p_data[index];
+
+        if (field_len == 0 || index + 1 + field_len > dlen)
+        {
+            return false;
+        }
+        index += 1 + field_len;
+    }
+
+    return true;
+}
+
+uint32_t sd_ble_gap_adv_data_set(uint8_t const *p_data, uint8_t dlen, uint8_t const *p_sr_data, uint8_t srlen)
+{
+    if (!m_gap.is_enabled)
+    {
+        return BLE_ERROR_NOT_ENABLED;
+    }
+    if (dlen > BLE_GAP_ADV_MAX_SIZE || srlen > BLE_GAP_ADV_MAX_SIZE)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    if ((p_data != NULL && !adv_data_is_valid(p_data, dlen)) ||
+        (p_sr_data != NULL && !adv_data_is_valid(p_sr_data, srlen)))
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    // NULL keeps the current data.
+    if (p_data != NULL)
+    {
+        memcpy(m_adv.data, p_data, dlen);
+        m_adv.dlen = dlen;
+    }
+    if (p_sr_data != NULL)
+    {
+        memcpy(m_adv.sr_data, p_sr_data, srlen);
+        m_adv.srlen = srlen;
+    }
+
+    m_adv.data_set_ns = sim_now();
+    sim_stats.adv_data_set_cnt++;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_adv_start(ble_gap_adv_params_t const *p_adv_params)
+{
+    if (!m_gap.is_enabled)
+    {
+        return BLE_ERROR_NOT_ENABLED;
+    }
+    if (m_adv.is_active)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_adv_params->interval < BLE_GAP_ADV_INTERVAL_MIN || p_adv_params->interval > BLE_GAP_ADV_INTERVAL_MAX ||
+        (p_adv_params->type == BLE_GAP_ADV_TYPE_ADV_NONCONN_IND && p_adv_params->interval < BLE_GAP_ADV_NONCON_INTERVAL_MIN))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (p_adv_params->type == BLE_GAP_ADV_TYPE_ADV_IND && m_link.state != LINK_IDLE)
+    {
+        return NRF_ERROR_CONN_COUNT;
+    }
+
+    m_adv.is_active = true;
+    m_adv.params = *p_adv_params;
+    m_adv.start_ns = sim_now();
+    m_adv.adv_event.handler = adv_evt;
+    m_adv.notification_event.handler = adv_notification_evt;
+    m_adv.timeout_event.handler = adv_timeout_evt;
+    sim_stats.adv_start_cnt++;
+    sim_trace("ADV_START", "interval %u timeout %u", p_adv_params->interval, p_adv_params->timeout);
+
+    adv_event_schedule(sim_now() + ADV_START_DELAY_NS);
+    if (p_adv_params->timeout > 0)
+    {
+        sim_event_schedule(&m_adv.timeout_event, sim_now() + p_adv_params->timeout * SIM_NS_PER_S);
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_adv_stop(void)
+{
+    if (!m_adv.is_active)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    adv_stop();
+    sim_trace("ADV_STOP", "");
+
+    return NRF_SUCCESS;
+}
+
+// Peripheral link
+static void link_disconnected(uint8_t reason)
+{
+    evt_buffer_t buffer;
+
+    sim_event_cancel(&m_link.conn_event);
+    sim_event_cancel(&m_link.notification_event);
+    m_link.state = LINK_IDLE;
+    sim_stats.connected_ns += sim_now() - m_link.connected_ns;
+    m_central.op_cnt = 0;
+    m_central.is_read_pending = false;
+    sim_trace("DISCONNECTED", "reason 0x%02x events %u", reason, m_link.event_cnt);
+
+    evt_init(&buffer, BLE_GAP_EVT_DISCONNECTED);
+    buffer.evt.evt.gap_evt.conn_handle = CONN_HANDLE;
+    buffer.evt.evt.gap_evt.params.disconnected.reason = reason;
+    evt_put(&buffer, sizeof(ble_evt_hdr_t) + sizeof(ble_gap_evt_t));
+}
+
+static void gatts_write(uint16_t handle, const uint8_t *p_data, uint16_t len)
+{
+    attr_t *p_attr = attr_get(handle);
+    evt_buffer_t buffer;
+
+    if (!p_attr->props.write && !p_attr->props.write_wo_resp)
+    {
+        sim_trace("GATT_WRITE_NOT_PERMITTED", "0x%04x", p_attr->uuid.uuid);
+        return;
+    }
+    if (len > p_attr->max_len || len > ATT_PAYLOAD_MAX)
+    {
+        sim_trace("GATT_WRITE_INVALID_LENGTH", "0x%04x len %u", p_attr->uuid.uuid, len);
+        return;
+    }
+
+    memcpy(p_attr->value, p_data, len);
+    p_attr->len = len;
+    sim_stats.gatt_write_cnt++;
+    sim_trace("GATT_WRITE", "0x%04x len %u", p_attr->uuid.uuid, len);
+
+    evt_init(&buffer, BLE_GATTS_EVT_WRITE);
+    buffer.evt.evt.gatts_evt.conn_handle = CONN_HANDLE;
+    buffer.evt.evt.gatts_evt.params.write.handle = handle;
+    buffer.evt.evt.gatts_evt.params.write.uuid = p_attr->uuid;
+    buffer.evt.evt.gatts_evt.params.write.op = p_attr->props.write ? BLE_GATTS_OP_WRITE_REQ : BLE_GATTS_OP_WRITE_CMD;
+    buffer.evt.evt.gatts_evt.params.write.len = len;
+    memcpy(buffer.evt.evt.gatts_evt.params.write.data, p_data, len);
+    evt_put(&buffer, offsetof(ble_evt_t, evt.gatts_evt.params.write.data) + len);
+}
+
+static void gatts_read(uint16_t handle)
+{
+    attr_t *p_attr = attr_get(handle);
+    evt_buffer_t buffer;
+
+    m_central.is_read_pending = true;
+    m_central.read_handle = handle;
+    m_central.read_request_ns = sim_now();
+
+    if (!p_attr->rd_auth)
+    {
+        read_complete(BLE_GATT_STATUS_SUCCESS);
+        return;
+    }
+
+    evt_init(&buffer, BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST);
+    buffer.evt.evt.gatts_evt.conn_handle = CONN_HANDLE;
+    buffer.evt.evt.gatts_evt.params.authorize_request.type = BLE_GATTS_AUTHORIZE_TYPE_READ;
+    buffer.evt.evt.gatts_evt.params.authorize_request.request.read.handle = handle;
+    buffer.evt.evt.gatts_evt.params.authorize_request.request.read.uuid = p_attr->uuid;
+    evt_put(&buffer, sizeof(ble_evt_hdr_t) + sizeof(ble_gatts_evt_t));
+}
+
+// One operation of the central per connection event. A read held by the authorization
+// blocks the following operations, as ATT allows one transaction at a time.
+static void central_op_process(void)
+{
+    if (m_central.is_read_pending)
+    {
+        if (sim_now() - m_central.read_request_ns >= ATT_TIMEOUT_NS)
+        {
+            sim_trace("GATT_READ_TIMEOUT", "0x%04x", attr_get(m_central.read_handle)->uuid.uuid);
+            link_disconnected(BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+        }
+        return;
+    }
+    if (m_central.op_cnt == 0)
+    {
+        return;
+    }
+
+    central_op_t *p_op = &m_central.ops[m_central.op_head];
+    m_central.op_head = (m_central.op_head + 1) % CENTRAL_OP_QUEUE_SIZE;
+    m_central.op_cnt--;
+
+    if (p_op->type == CENTRAL_OP_DISCONNECT)
+    {
+        link_disconnected(BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+        return;
+    }
+
+    uint16_t handle = value_handle_find(p_op->uuid);
+    if (handle == BLE_GATT_HANDLE_INVALID)
+    {
+        sim_trace("GATT_NOT_FOUND", "0x%04x", p_op->uuid);
+        return;
+    }
+
+    if (p_op->type == CENTRAL_OP_READ)
+    {
+        gatts_read(handle);
+    }
+    else if (p_op->type == CENTRAL_OP_WRITE_EPOCH)
+    {
+        uint8_t data[6];
+
+        uint32_encode(sim_epoch_now(), &data[0]);
+        uint16_encode((uint16_t)((sim_now() / SIM_NS_PER_MS) % 1000), &data[4]);
+        gatts_write(handle, data, sizeof(data));
+    }
+    else
+    {
+        gatts_write(handle, p_op->data, p_op->len);
+    }
+}
+
+static void conn_param_update_apply(void)
+{
+    evt_buffer_t buffer;
+
+    m_link.is_update_pending = false;
+    m_link.params.min_conn_interval = m_link.update_interval;
+    m_link.params.max_conn_interval = m_link.update_interval;
+    sim_trace("CONN_PARAM_UPDATE", "interval %.2f ms", m_link.update_interval * 1.25);
+
+    evt_init(&buffer, BLE_GAP_EVT_CONN_PARAM_UPDATE);
+    buffer.evt.evt.gap_evt.conn_handle = CONN_HANDLE;
+    buffer.evt.evt.gap_evt.params.conn_param_update.conn_params = m_link.params;
+    evt_put(&buffer, sizeof(ble_evt_hdr_t) + sizeof(ble_gap_evt_t));
+}
+
+static void conn_notification_evt(sim_event_t *p_event)
+{
+    sim_sd_radio_notification();
+}
+
+static void conn_evt(sim_event_t *p_event)
+{
+    m_link.event_cnt++;
+    sim_stats.connection_event_cnt++;
+    sim_trace("CONN_EVENT", "%u", m_link.event_cnt);
+
+    if (m_link.state == LINK_DISCONNECTING && m_link.event_cnt >= m_link.disconnect_instant)
+    {
+        link_disconnected(BLE_HCI_LOCAL_HOST_TERMINATED_CONNECTION);
+        return;
+    }
+    if (m_link.is_update_pending && m_link.event_cnt >= m_link.update_instant)
+    {
+        conn_param_update_apply();
+    }
+
+    central_op_process();
+    if (m_link.state == LINK_IDLE)
+    {
+        return;
+    }
+
+    conn_event_schedule(sim_now() + m_link.params.max_conn_interval * 1250 * SIM_NS_PER_US);
+}
+
+static void conn_event_schedule(uint64_t time_ns)
+{
+    m_link.conn_event.handler = conn_evt;
+    m_link.notification_event.handler = conn_notification_evt;
+    sim_event_schedule(&m_link.conn_event, time_ns);
+    sim_event_schedule(&m_link.notification_event, time_ns - RADIO_NOTIFICATION_DISTANCE_NS);
+}
+
+uint32_t sd_ble_gap_disconnect(uint16_t conn_handle, uint8_t hci_status_code)
+{
+    if (m_link.state == LINK_IDLE || conn_handle != CONN_HANDLE)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if (hci_status_code != BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION &&
+        hci_status_code != BLE_HCI_CONN_INTERVAL_UNACCEPTABLE)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (m_link.state == LINK_DISCONNECTING)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_link.state = LINK_DISCONNECTING;
+    m_link.disconnect_instant = m_link.event_cnt + DISCONNECT_EVENTS;
+    m_link.disconnect_reason = hci_status_code;
+    sim_trace("DISCONNECT", "reason 0x%02x", hci_status_code);
+
+    return NRF_SUCCESS;
+}
+
+// The central accepts the request and takes the maximum interval.
+uint32_t sd_ble_gap_conn_param_update(uint16_t conn_handle, ble_gap_conn_params_t const *p_conn_params)
+{
+    if (m_link.state == LINK_IDLE || conn_handle != CONN_HANDLE)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if (m_link.is_update_pending)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    ble_gap_conn_params_t params = (p_conn_params != NULL) ? *p_conn_params : m_gap.ppcp;
+    if (params.min_conn_interval < BLE_GAP_CP_MIN_CONN_INTVL_MIN ||
+        params.max_conn_interval > BLE_GAP_CP_MAX_CONN_INTVL_MAX ||
+        params.min_conn_interval > params.max_conn_interval)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_link.is_update_pending = true;
+    m_link.update_interval = params.max_conn_interval;
+    m_link.update_instant = m_link.event_cnt + CONN_PARAM_UPDATE_INSTANT_EVENTS;
+    sim_trace("CONN_PARAM_UPDATE_REQUEST", "%u-%u", params.min_conn_interval, params.max_conn_interval);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_sec_params_reply(uint16_t conn_handle, uint8_t sec_status,
+                                     ble_gap_sec_params_t const *p_sec_params, void const *p_sec_keyset)
+{
+    return (m_link.state == LINK_IDLE) ? BLE_ERROR_INVALID_CONN_HANDLE : NRF_SUCCESS;
+}
+
+// Scanner
+static void scan_timeout_evt(sim_event_t *p_event)
+{
+    evt_buffer_t buffer;
+
+    m_scan.is_active = false;
+    sim_trace("SCAN_TIMEOUT", "");
+
+    evt_init(&buffer, BLE_GAP_EVT_TIMEOUT);
+    buffer.evt.evt.gap_evt.conn_handle = BLE_CONN_HANDLE_INVALID;
+    buffer.evt.evt.gap_evt.params.timeout.src = BLE_GAP_TIMEOUT_SRC_SCAN;
+    evt_put(&buffer, sizeof(ble_evt_hdr_t) + sizeof(ble_gap_evt_t));
+}
+
+uint32_t sd_ble_gap_scan_start(ble_gap_scan_params_t const *p_scan_params)
+{
+    if (!m_gap.is_enabled)
+    {
+        return BLE_ERROR_NOT_ENABLED;
+    }
+    if (m_scan.is_active)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_scan_params->interval < BLE_GAP_SCAN_INTERVAL_MIN || p_scan_params->interval > BLE_GAP_SCAN_INTERVAL_MAX ||
+        p_scan_params->window < BLE_GAP_SCAN_WINDOW_MIN || p_scan_params->window > p_scan_params->interval)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_scan.is_active = true;
+    m_scan.params = *p_scan_params;
+    m_scan.timeout_event.handler = scan_timeout_evt;
+    if (p_scan_params->timeout > 0)
+    {
+        sim_event_schedule(&m_scan.timeout_event, sim_now() + p_scan_params->timeout * SIM_NS_PER_S);
+    }
+    sim_trace("SCAN_START", "interval %u window %u", p_scan_params->interval, p_scan_params->window);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_scan_stop(void)
+{
+    if (!m_scan.is_active)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_scan.is_active = false;
+    sim_event_cancel(&m_scan.timeout_event);
+    sim_trace("SCAN_STOP", "");
+
+    return NRF_SUCCESS;
+}
+
+// GAP settings
+uint32_t sd_ble_gap_tx_power_set(int8_t tx_power)
+{
+    static const int8_t levels[] = {-40, -30, -20, -16, -12, -8, -4, 0, 4};
+
+    for (uint32_t i = 0; i < ARRAY_SIZE(levels); i++)
+    {
+        if (levels[i] == tx_power)
+        {
+            if (m_gap.tx_power != tx_power)
+            {
+                sim_trace("TX_POWER", "%d", tx_power);
+            }
+            m_gap.tx_power = tx_power;
+            return NRF_SUCCESS;
+        }
+    }
+
+    return NRF_ERROR_INVALID_PARAM;
+}
+
+uint32_t sd_ble_gap_appearance_set(uint16_t appearance)
+{
+    m_gap.appearance = appearance;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_appearance_get(uint16_t *p_appearance)
+{
+    *p_appearance = m_gap.appearance;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_ppcp_set(ble_gap_conn_params_t const *p_conn_params)
+{
+    m_gap.ppcp = *p_conn_params;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_ppcp_get(ble_gap_conn_params_t *p_conn_params)
+{
+    *p_conn_params = m_gap.ppcp;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_device_name_set(ble_gap_conn_sec_mode_t const *p_write_perm, uint8_t const *p_dev_name, uint16_t len)
+{
+    if (len > BLE_GAP_DEVNAME_MAX_LEN)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    memcpy(m_gap.device_name, p_dev_name, len);
+    m_gap.device_name_len = len;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_device_name_get(uint8_t *p_dev_name, uint16_t *p_len)
+{
+    if (p_dev_name != NULL)
+    {
+        if (*p_len < m_gap.device_name_len)
+        {
+            return NRF_ERROR_DATA_SIZE;
+        }
+        memcpy(p_dev_name, m_gap.device_name, m_gap.device_name_len);
+    }
+    *p_len = m_gap.device_name_len;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_address_get(ble_gap_addr_t *p_addr)
+{
+    static const uint8_t addr[6] = {0x01, 0x00, 0x00, 0x00, 0xAD, 0xDE};
+
+    p_addr->addr_type = 1; // random static
+    memcpy(p_addr->addr, addr, sizeof(addr));
+
+    return NRF_SUCCESS;
+}
+
+// Stimulus of the central
+void sim_ble_connect(uint16_t interval_ms)
+{
+    if (m_link.state != LINK_IDLE || m_central.is_connect_pending)
+    {
+        sim_trace("CONNECT_IGNORED", "already connected");
+        return;
+    }
+
+    m_central.is_connect_pending = true;
+    m_central.connect_interval_ms = interval_ms;
+    m_central.op_head = 0;
+    m_central.op_cnt = 0;
+}
+
+static void central_op_put(const central_op_t *p_op)
+{
+    if (m_link.state == LINK_IDLE && !m_central.is_connect_pending)
+    {
+        sim_trace("CENTRAL_OP_IGNORED", "not connected");
+        return;
+    }
+    if (m_central.op_cnt == CENTRAL_OP_QUEUE_SIZE)
+    {
+        sim_trace("CENTRAL_OP_IGNORED", "queue full");
+        return;
+    }
+
+    m_central.ops[(m_central.op_head + m_central.op_cnt) % CENTRAL_OP_QUEUE_SIZE] = *p_op;
+    m_central.op_cnt++;
+}
+
+void sim_ble_disconnect(void)
+{
+    central_op_t op = {.type = CENTRAL_OP_DISCONNECT};
+
+    central_op_put(&op);
+}
+
+// NULL data writes the time of the simulation in the format of the Time characteristic.
+void sim_ble_write(uint16_t uuid, const uint8_t *p_data, uint16_t len)
+{
+    central_op_t op = {.type = (p_data == NULL) ? CENTRAL_OP_WRITE_EPOCH : CENTRAL_OP_WRITE, .uuid = uuid};
+
+    if (p_data != NULL)
+    {
+        op.len = MIN(len, ATTR_VALUE_LEN_MAX);
+        memcpy(op.data, p_data, op.len);
+    }
+    central_op_put(&op);
+}
+
+void sim_ble_read(uint16_t uuid)
+{
+    central_op_t op = {.type = CENTRAL_OP_READ, .uuid = uuid};
+
+    central_op_put(&op);
+}
+
+void sim_ble_adv_report(const uint8_t *p_data, uint8_t len, int8_t rssi)
+{
+    evt_buffer_t buffer;
+
+    if (!m_scan.is_active)
+    {
+        sim_trace("ADV_REPORT_IGNORED", "not scanning");
+        return;
+    }
+
+    sim_stats.scan_report_cnt++;
+    evt_init(&buffer, BLE_GAP_EVT_ADV_REPORT);
+    buffer.evt.evt.gap_evt.conn_handle = BLE_CONN_HANDLE_INVALID;
+    buffer.evt.evt.gap_evt.params.adv_report.rssi = rssi;
+    buffer.evt.evt.gap_evt.params.adv_report.type = BLE_GAP_ADV_TYPE_ADV_NONCONN_IND;
+    buffer.evt.evt.gap_evt.params.adv_report.dlen = MIN(len, BLE_GAP_ADV_MAX_SIZE);
+    memcpy(buffer.evt.evt.gap_evt.params.adv_report.data, p_data, buffer.evt.evt.gap_evt.params.adv_report.dlen);
+    evt_put(&buffer, sizeof(ble_evt_hdr_t) + sizeof(ble_gap_evt_t));
+}
+
+void sim_ble_report(void)
+{
+    if (m_link.state != LINK_IDLE)
+    {
+        sim_stats.connected_ns += sim_now() - m_link.connected_ns;
+        m_link.connected_ns = sim_now();
+    }
+}
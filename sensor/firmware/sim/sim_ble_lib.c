@@ -0,0 +1,612 @@
+// BLE libraries of SDK 12 on the simulated SoftDevice: ble_advdata, ble_advertising,
+// ble_conn_params, ble_conn_state and the Peer Manager without bonds.
+// They follow the SDK sources where the behaviour is visible to the application.
+
+#include "sim.h"
+
+#include <string.h>
+
+#include "ble.h"
+#include "ble_advdata.h"
+#include "ble_advertising.h"
+#include "ble_conn_params.h"
+#include "ble_conn_state.h"
+#include "app_timer.h"
+#include "app_scheduler.h"
+#include "app_util.h"
+#include "fds.h"
+#include "fstorage.h"
+#include "nrf_soc.h"
+#include "peer_manager.h"
+
+#define AD_LENGTH_OFFSET 0
+#define AD_TYPE_OFFSET 1
+#define AD_DATA_OFFSET 2
+#define PEERS_DELETE_DELAY_NS (50 * SIM_NS_PER_MS)
+
+// ble_advdata
+static uint32_t ad_header_encode(uint8_t ad_type, uint16_t data_len, uint8_t *p_encoded, uint16_t *p_offset, uint16_t max_size)
+{
+    if (*p_offset + AD_DATA_OFFSET + data_len > max_size)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    p_encoded[*p_offset + AD_LENGTH_OFFSET] = (uint8_t)(1 + data_len);
+    p_encoded[*p_offset + AD_TYPE_OFFSET] = ad_type;
+    *p_offset += AD_DATA_OFFSET;
+
+    return NRF_SUCCESS;
+}
+
+static uint32_t uuid_list_encode(const ble_advdata_uuid_list_t *p_list, uint8_t ad_type,
+                                 uint8_t *p_encoded, uint16_t *p_offset, uint16_t max_size)
+{
+    if (p_list->uuid_cnt == 0)
+    {
+        return NRF_SUCCESS;
+    }
+
+    // Vendor specific UUIDs are not advertised by the application, only 16 bit UUIDs are encoded.
+    uint32_t err_code = ad_header_encode(ad_type, p_list->uuid_cnt * 2, p_encoded, p_offset, max_size);
+    VERIFY_SUCCESS(err_code);
+
+    for (uint16_t i = 0; i < p_list->uuid_cnt; i++)
+    {
+        if (p_list->p_uuids[i].type != BLE_UUID_TYPE_BLE)
+        {
+            return NRF_ERROR_NOT_SUPPORTED;
+        }
+        *p_offset += uint16_encode(p_list->p_uuids[i].uuid, &p_encoded[*p_offset]);
+    }
+
+    return NRF_SUCCESS;
+}
+
+// The name is encoded last and shortened to the space left, as in SDK 12.
+static uint32_t name_encode(const ble_advdata_t *p_advdata, uint8_t *p_encoded, uint16_t *p_offset, uint16_t max_size)
+{
+    uint8_t name[BLE_GAP_DEVNAME_MAX_LEN];
+    uint16_t name_len = sizeof(name);
+    uint8_t ad_type = BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME;
+
+    uint32_t err_code = sd_ble_gap_device_name_get(name, &name_len);
+    VERIFY_SUCCESS(err_code);
+
+    if (*p_offset + AD_DATA_OFFSET > max_size)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    uint16_t rem_len = max_size - *p_offset - AD_DATA_OFFSET;
+    if (p_advdata->name_type == BLE_ADVDATA_SHORT_NAME)
+    {
+        if (p_advdata->short_name_len > rem_len)
+        {
+            return NRF_ERROR_DATA_SIZE;
+        }
+        name_len = MIN(name_len, p_advdata->short_name_len);
+        ad_type = BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME;
+    }
+    else if (name_len > rem_len)
+    {
+        name_len = rem_len;
+        ad_type = BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME;
+    }
+
+    err_code = ad_header_encode(ad_type, name_len, p_encoded, p_offset, max_size);
+    VERIFY_SUCCESS(err_code);
+    memcpy(&p_encoded[*p_offset], name, name_len);
+    *p_offset += name_len;
+
+    return NRF_SUCCESS;
+}
+
+static uint32_t adv_data_encode(const ble_advdata_t *p_advdata, uint8_t *p_encoded, uint16_t *p_len)
+{
+    uint32_t err_code;
+    uint16_t max_size = *p_len;
+
+    *p_len = 0;
+
+    if (p_advdata->include_appearance)
+    {
+        uint16_t appearance;
+
+        err_code = sd_ble_gap_appearance_get(&appearance);
+        VERIFY_SUCCESS(err_code);
+        err_code = ad_header_encode(BLE_GAP_AD_TYPE_APPEARANCE, 2, p_encoded, p_len, max_size);
+        VERIFY_SUCCESS(err_code);
+        *p_len += uint16_encode(appearance, &p_encoded[*p_len]);
+    }
+
+    if (p_advdata->flags != 0)
+    {
+        err_code = ad_header_encode(BLE_GAP_AD_TYPE_FLAGS, 1, p_encoded, p_len, max_size);
+        VERIFY_SUCCESS(err_code);
+        p_encoded[(*p_len)++] = p_advdata->flags;
+    }
+
+    if (p_advdata->p_tx_power_level != NULL)
+    {
+        err_code = ad_header_encode(BLE_GAP_AD_TYPE_TX_POWER_LEVEL, 1, p_encoded, p_len, max_size);
+        VERIFY_SUCCESS(err_code);
+        p_encoded[(*p_len)++] = (uint8_t)*p_advdata->p_tx_power_level;
+    }
+
+    err_code = uuid_list_encode(&p_advdata->uuids_more_available, BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_MORE_AVAILABLE,
+                                p_encoded, p_len, max_size);
+    VERIFY_SUCCESS(err_code);
+    err_code = uuid_list_encode(&p_advdata->uuids_complete, BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE,
+                                p_encoded, p_len, max_size);
+    VERIFY_SUCCESS(err_code);
+    err_code = uuid_list_encode(&p_advdata->uuids_solicited, BLE_GAP_AD_TYPE_SOLICITED_SERVICE_UUIDS_16BIT,
+                                p_encoded, p_len, max_size);
+    VERIFY_SUCCESS(err_code);
+
+    if (p_advdata->p_slave_conn_int != NULL)
+    {
+        err_code = ad_header_encode(BLE_GAP_AD_TYPE_SLAVE_CONNECTION_INTERVAL_RANGE, 4, p_encoded, p_len, max_size);
+        VERIFY_SUCCESS(err_code);
+        *p_len += uint16_encode(p_advdata->p_slave_conn_int->min_conn_interval, &p_encoded[*p_len]);
+        *p_len += uint16_encode(p_advdata->p_slave_conn_int->max_conn_interval, &p_encoded[*p_len]);
+    }
+
+    if (p_advdata->p_manuf_specific_data != NULL)
+    {
+        const ble_advdata_manuf_data_t *p_manuf = p_advdata->p_manuf_specific_data;
+
+        err_code = ad_header_encode(BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA, 2 + p_manuf->data.size,
+                                    p_encoded, p_len, max_size);
+        VERIFY_SUCCESS(err_code);
+        *p_len += uint16_encode(p_manuf->company_identifier, &p_encoded[*p_len]);
+        memcpy(&p_encoded[*p_len], p_manuf->data.p_data, p_manuf->data.size);
+        *p_len += p_manuf->data.size;
+    }
+
+    for (uint8_t i = 0; i < p_advdata->service_data_count; i++)
+    {
+        const ble_advdata_service_data_t *p_service = &p_advdata->p_service_data_array[i];
+
+        err_code = ad_header_encode(BLE_GAP_AD_TYPE_SERVICE_DATA, 2 + p_service->data.size, p_encoded, p_len, max_size);
+        VERIFY_SUCCESS(err_code);
+        *p_len += uint16_encode(p_service->service_uuid, &p_encoded[*p_len]);
+        memcpy(&p_encoded[*p_len], p_service->data.p_data, p_service->data.size);
+        *p_len += p_service->data.size;
+    }
+
+    if (p_advdata->name_type != BLE_ADVDATA_NO_NAME)
+    {
+        err_code = name_encode(p_advdata, p_encoded, p_len, max_size);
+        VERIFY_SUCCESS(err_code);
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t ble_advdata_set(const ble_advdata_t *p_advdata, const ble_advdata_t *p_srdata)
+{
+    uint32_t err_code;
+    uint8_t encoded_advdata[BLE_GAP_ADV_MAX_SIZE];
+    uint8_t encoded_srdata[BLE_GAP_ADV_MAX_SIZE];
+    uint16_t len_advdata = sizeof(encoded_advdata);
+    uint16_t len_srdata = sizeof(encoded_srdata);
+    uint8_t *p_encoded_advdata = NULL;
+    uint8_t *p_encoded_srdata = NULL;
+
+    if (p_advdata != NULL)
+    {
+        err_code = adv_data_encode(p_advdata, encoded_advdata, &len_advdata);
+        VERIFY_SUCCESS(err_code);
+        p_encoded_advdata = encoded_advdata;
+    }
+    else
+    {
+        len_advdata = 0;
+    }
+
+    if (p_srdata != NULL)
+    {
+        err_code = adv_data_encode(p_srdata, encoded_srdata, &len_srdata);
+        VERIFY_SUCCESS(err_code);
+        p_encoded_srdata = encoded_srdata;
+    }
+    else
+    {
+        len_srdata = 0;
+    }
+
+    return sd_ble_gap_adv_data_set(p_encoded_advdata, (uint8_t)len_advdata, p_encoded_srdata, (uint8_t)len_srdata);
+}
+
+// ble_advertising
+static ble_adv_mode_t m_adv_mode_current;
+static ble_adv_modes_config_t m_adv_modes_config;
+static ble_advertising_evt_handler_t m_adv_evt_handler;
+static ble_advertising_error_handler_t m_adv_error_handler;
+static uint16_t m_current_slave_link_conn_handle = BLE_CONN_HANDLE_INVALID;
+static bool m_advertising_start_pending;
+
+// The mode is kept, so a timeout after a new init goes on from the current mode.
+uint32_t ble_advertising_init(ble_advdata_t const *p_advdata,
+                              ble_advdata_t const *p_srdata,
+                              ble_adv_modes_config_t const *p_config,
+                              ble_advertising_evt_handler_t const evt_handler,
+                              ble_advertising_error_handler_t const error_handler)
+{
+    if (p_advdata == NULL || p_config == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    m_adv_evt_handler = evt_handler;
+    m_adv_error_handler = error_handler;
+    m_adv_modes_config = *p_config;
+
+    return ble_advdata_set(p_advdata, p_srdata);
+}
+
+uint32_t ble_advertising_start(ble_adv_mode_t advertising_mode)
+{
+    uint32_t err_code;
+    uint32_t flash_op_cnt;
+    ble_gap_adv_params_t adv_params;
+    ble_adv_evt_t adv_evt;
+
+    m_adv_mode_current = advertising_mode;
+
+    // A flash operation cannot complete while the radio is busy with a fast advertising,
+    // so the start is deferred until the queue of fstorage is empty.
+    err_code = fs_queued_op_count_get(&flash_op_cnt);
+    VERIFY_SUCCESS(err_code);
+    if (flash_op_cnt != 0)
+    {
+        m_advertising_start_pending = true;
+        sim_trace("ADV_START_PENDING", "%u flash operations", flash_op_cnt);
+        return NRF_SUCCESS;
+    }
+
+    memset(&adv_params, 0, sizeof(adv_params));
+    adv_params.type = BLE_GAP_ADV_TYPE_ADV_IND;
+    adv_params.fp = BLE_GAP_ADV_FP_ANY;
+
+    // No peer address is given for the directed modes, so they fall through to the fast mode.
+    if (m_adv_mode_current == BLE_ADV_MODE_DIRECTED || m_adv_mode_current == BLE_ADV_MODE_DIRECTED_SLOW)
+    {
+        m_adv_mode_current = BLE_ADV_MODE_FAST;
+    }
+
+    if (m_adv_mode_current == BLE_ADV_MODE_FAST && !m_adv_modes_config.ble_adv_fast_enabled)
+    {
+        m_adv_mode_current = BLE_ADV_MODE_SLOW;
+    }
+    if (m_adv_mode_current == BLE_ADV_MODE_SLOW && !m_adv_modes_config.ble_adv_slow_enabled)
+    {
+        m_adv_mode_current = BLE_ADV_MODE_IDLE;
+    }
+
+    switch (m_adv_mode_current)
+    {
+    case BLE_ADV_MODE_FAST:
+        adv_params.interval = m_adv_modes_config.ble_adv_fast_interval;
+        adv_params.timeout = m_adv_modes_config.ble_adv_fast_timeout;
+        adv_evt = BLE_ADV_EVT_FAST;
+        break;
+
+    case BLE_ADV_MODE_SLOW:
+        adv_params.interval = m_adv_modes_config.ble_adv_slow_interval;
+        adv_params.timeout = m_adv_modes_config.ble_adv_slow_timeout;
+        adv_evt = BLE_ADV_EVT_SLOW;
+        break;
+
+    default:
+        adv_evt = BLE_ADV_EVT_IDLE;
+        break;
+    }
+
+    if (m_adv_mode_current != BLE_ADV_MODE_IDLE)
+    {
+        err_code = sd_ble_gap_adv_start(&adv_params);
+        VERIFY_SUCCESS(err_code);
+    }
+
+    if (m_adv_evt_handler != NULL)
+    {
+        m_adv_evt_handler(adv_evt);
+    }
+
+    return NRF_SUCCESS;
+}
+
+void ble_advertising_on_ble_evt(ble_evt_t const *p_ble_evt)
+{
+    uint32_t err_code;
+
+    switch (p_ble_evt->header.evt_id)
+    {
+    case BLE_GAP_EVT_CONNECTED:
+        if (p_ble_evt->evt.gap_evt.params.connected.role == BLE_GAP_ROLE_PERIPH)
+        {
+            m_current_slave_link_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+        }
+        break;
+
+    // The SDK restarts in the directed mode, also after the application has started advertising.
+    case BLE_GAP_EVT_DISCONNECTED:
+        if (p_ble_evt->evt.gap_evt.conn_handle == m_current_slave_link_conn_handle)
+        {
+            m_current_slave_link_conn_handle = BLE_CONN_HANDLE_INVALID;
+            err_code = ble_advertising_start(BLE_ADV_MODE_DIRECTED);
+            if (err_code != NRF_SUCCESS && m_adv_error_handler != NULL)
+            {
+                m_adv_error_handler(err_code);
+            }
+        }
+        break;
+
+    case BLE_GAP_EVT_TIMEOUT:
+        if (p_ble_evt->evt.gap_evt.params.timeout.src == BLE_GAP_TIMEOUT_SRC_ADVERTISING)
+        {
+            ble_adv_mode_t next_mode = (ble_adv_mode_t)((m_adv_mode_current + 1) % (BLE_ADV_MODE_SLOW + 1));
+
+            err_code = ble_advertising_start(next_mode);
+            if (err_code != NRF_SUCCESS && m_adv_error_handler != NULL)
+            {
+                m_adv_error_handler(err_code);
+            }
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+void ble_advertising_on_sys_evt(uint32_t sys_evt)
+{
+    uint32_t err_code;
+
+    if ((sys_evt == NRF_EVT_FLASH_OPERATION_SUCCESS || sys_evt == NRF_EVT_FLASH_OPERATION_ERROR) &&
+        m_advertising_start_pending)
+    {
+        m_advertising_start_pending = false;
+        err_code = ble_advertising_start(m_adv_mode_current);
+        if (err_code != NRF_SUCCESS && m_adv_error_handler != NULL)
+        {
+            m_adv_error_handler(err_code);
+        }
+    }
+}
+
+// ble_conn_params
+APP_TIMER_DEF(m_conn_params_timer_id);
+
+static ble_conn_params_init_t m_conn_params_config;
+static ble_gap_conn_params_t m_preferred_conn_params;
+static uint16_t m_conn_params_conn_handle = BLE_CONN_HANDLE_INVALID;
+static uint8_t m_conn_params_update_cnt;
+
+static bool is_conn_params_ok(const ble_gap_conn_params_t *p_conn_params)
+{
+    return p_conn_params->max_conn_interval >= m_preferred_conn_params.min_conn_interval &&
+           p_conn_params->max_conn_interval <= m_preferred_conn_params.max_conn_interval;
+}
+
+static void conn_params_evt_send(ble_conn_params_evt_type_t evt_type)
+{
+    ble_conn_params_evt_t evt = {.evt_type = evt_type};
+
+    if (m_conn_params_config.evt_handler != NULL)
+    {
+        m_conn_params_config.evt_handler(&evt);
+    }
+}
+
+static void update_timeout_handler(void *p_context)
+{
+    uint32_t err_code;
+
+    if (m_conn_params_conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return;
+    }
+
+    m_conn_params_update_cnt++;
+    err_code = sd_ble_gap_conn_param_update(m_conn_params_conn_handle, &m_preferred_conn_params);
+    if (err_code != NRF_SUCCESS && err_code != NRF_ERROR_BUSY && m_conn_params_config.error_handler != NULL)
+    {
+        m_conn_params_config.error_handler(err_code);
+    }
+}
+
+static void conn_params_negotiation(void)
+{
+    uint32_t err_code;
+    uint32_t timeout_ticks;
+
+    if (m_conn_params_update_cnt == m_conn_params_config.max_conn_params_update_count)
+    {
+        if (m_conn_params_config.disconnect_on_fail)
+        {
+            err_code = sd_ble_gap_disconnect(m_conn_params_conn_handle, BLE_HCI_CONN_INTERVAL_UNACCEPTABLE);
+            if (err_code != NRF_SUCCESS && m_conn_params_config.error_handler != NULL)
+            {
+                m_conn_params_config.error_handler(err_code);
+            }
+        }
+        else
+        {
+            conn_params_evt_send(BLE_CONN_PARAMS_EVT_FAILED);
+        }
+        return;
+    }
+
+    timeout_ticks = (m_conn_params_update_cnt == 0) ? m_conn_params_config.first_conn_params_update_delay
+                                                     : m_conn_params_config.next_conn_params_update_delay;
+    err_code = app_timer_start(m_conn_params_timer_id, timeout_ticks, NULL);
+    if (err_code != NRF_SUCCESS && m_conn_params_config.error_handler != NULL)
+    {
+        m_conn_params_config.error_handler(err_code);
+    }
+}
+
+uint32_t ble_conn_params_init(const ble_conn_params_init_t *p_init)
+{
+    uint32_t err_code;
+
+    m_conn_params_config = *p_init;
+    m_conn_params_update_cnt = 0;
+
+    if (p_init->p_conn_params != NULL)
+    {
+        m_preferred_conn_params = *p_init->p_conn_params;
+        err_code = sd_ble_gap_ppcp_set(&m_preferred_conn_params);
+    }
+    else
+    {
+        err_code = sd_ble_gap_ppcp_get(&m_preferred_conn_params);
+    }
+    VERIFY_SUCCESS(err_code);
+
+    m_conn_params_conn_handle = BLE_CONN_HANDLE_INVALID;
+
+    return app_timer_create(&m_conn_params_timer_id, APP_TIMER_MODE_SINGLE_SHOT, update_timeout_handler);
+}
+
+void ble_conn_params_on_ble_evt(ble_evt_t *p_ble_evt)
+{
+    switch (p_ble_evt->header.evt_id)
+    {
+    case BLE_GAP_EVT_CONNECTED:
+        m_conn_params_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+        m_conn_params_update_cnt = 0;
+        if (m_conn_params_config.start_on_notify_cccd_handle != BLE_GATT_HANDLE_INVALID)
+        {
+            break;
+        }
+        if (is_conn_params_ok(&p_ble_evt->evt.gap_evt.params.connected.conn_params))
+        {
+            conn_params_evt_send(BLE_CONN_PARAMS_EVT_SUCCEEDED);
+        }
+        else
+        {
+            conn_params_negotiation();
+        }
+        break;
+
+    case BLE_GAP_EVT_DISCONNECTED:
+        m_conn_params_conn_handle = BLE_CONN_HANDLE_INVALID;
+        UNUSED_RETURN_VALUE(app_timer_stop(m_conn_params_timer_id));
+        break;
+
+    case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+        if (is_conn_params_ok(&p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params))
+        {
+            conn_params_evt_send(BLE_CONN_PARAMS_EVT_SUCCEEDED);
+        }
+        else
+        {
+            conn_params_negotiation();
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+// ble_conn_state
+static uint16_t m_conn_state_handle = BLE_CONN_HANDLE_INVALID;
+static uint8_t m_conn_state_role = BLE_GAP_ROLE_INVALID;
+
+void ble_conn_state_init(void)
+{
+    m_conn_state_handle = BLE_CONN_HANDLE_INVALID;
+    m_conn_state_role = BLE_GAP_ROLE_INVALID;
+}
+
+void ble_conn_state_on_ble_evt(ble_evt_t *p_ble_evt)
+{
+    if (p_ble_evt->header.evt_id == BLE_GAP_EVT_CONNECTED)
+    {
+        m_conn_state_handle = p_ble_evt->evt.gap_evt.conn_handle;
+        m_conn_state_role = p_ble_evt->evt.gap_evt.params.connected.role;
+    }
+    else if (p_ble_evt->header.evt_id == BLE_GAP_EVT_DISCONNECTED)
+    {
+        m_conn_state_handle = BLE_CONN_HANDLE_INVALID;
+        m_conn_state_role = BLE_GAP_ROLE_INVALID;
+    }
+}
+
+uint8_t ble_conn_state_role(uint16_t conn_handle)
+{
+    return (conn_handle == m_conn_state_handle) ? m_conn_state_role : BLE_GAP_ROLE_INVALID;
+}
+
+// Peer Manager
+static pm_evt_handler_t m_pm_evt_handler;
+static sim_event_t m_peers_delete_event;
+
+static void pm_evt_send(void *p_event_data, uint16_t event_size)
+{
+    if (m_pm_evt_handler != NULL)
+    {
+        m_pm_evt_handler((pm_evt_t const *)p_event_data);
+    }
+}
+
+// The deletion completes on the FDS events in the SoftDevice event handler, which runs from the scheduler.
+static void peers_delete_evt(sim_event_t *p_event)
+{
+    pm_evt_t evt = {.evt_id = PM_EVT_PEERS_DELETE_SUCCEEDED, .conn_handle = BLE_CONN_HANDLE_INVALID};
+
+    sim_irq(SIM_WAKE_SOFTDEVICE);
+    uint32_t err_code = app_sched_event_put(&evt, sizeof(evt), pm_evt_send);
+    APP_ERROR_CHECK(err_code);
+}
+
+ret_code_t pm_init(void)
+{
+    ble_conn_state_init();
+
+    return fds_init();
+}
+
+ret_code_t pm_register(pm_evt_handler_t event_handler)
+{
+    m_pm_evt_handler = event_handler;
+
+    return NRF_SUCCESS;
+}
+
+ret_code_t pm_sec_params_set(ble_gap_sec_params_t *p_sec_params)
+{
+    return NRF_SUCCESS;
+}
+
+// The central of the simulation does not pair, so no event of the Peer Manager comes from the link.
+void pm_on_ble_evt(ble_evt_t *p_ble_evt)
+{
+}
+
+void pm_conn_sec_config_reply(uint16_t conn_handle, pm_conn_sec_config_t *p_conn_sec_config)
+{
+}
+
+void pm_local_database_has_changed(void)
+{
+}
+
+ret_code_t pm_peers_delete(void)
+{
+    if (sim_event_is_scheduled(&m_peers_delete_event))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_peers_delete_event.handler = peers_delete_evt;
+    sim_event_schedule(&m_peers_delete_event, sim_now() + PEERS_DELETE_DELAY_NS);
+
+    return NRF_SUCCESS;
+}
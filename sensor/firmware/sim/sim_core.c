@@ -0,0 +1,398 @@
+// Virtual time, event queue, waits, trace and the fixed memory map of the simulation
+
+#include "sim.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "nrf.h"
+#include "nrf_soc.h"
+#include "nrf_delay.h"
+#include "nrf_log.h"
+#include "app_error.h"
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+#define EVENT_HEAP_SIZE_INIT 64
+
+sim_config_t sim_config;
+sim_stats_t sim_stats;
+bool sim_log_all;
+
+static uint64_t m_now_ns;
+static uint64_t m_seq;
+static sim_event_t **m_heap; // 1-based binary heap ordered by (time_ns, seq)
+static uint32_t m_heap_cnt;
+static uint32_t m_heap_size;
+static uint32_t m_pending_irq_mask;
+static FILE *m_trace_file;
+static uint64_t m_rng_state;
+
+// Static and not on the host stack, so that (uint32_t)&m_error_info keeps the address
+// in the non-PIE image, as app_error_fault_handler() of the application takes it as uint32_t.
+static error_info_t m_error_info;
+
+uint64_t sim_now(void)
+{
+    return m_now_ns;
+}
+
+static bool event_is_before(const sim_event_t *p_a, const sim_event_t *p_b)
+{
+    return p_a->time_ns < p_b->time_ns || (p_a->time_ns == p_b->time_ns && p_a->seq < p_b->seq);
+}
+
+static void heap_place(sim_event_t *p_event, uint32_t index)
+{
+    m_heap[index] = p_event;
+    p_event->heap_index = index;
+}
+
+static void heap_sift_up(uint32_t index)
+{
+    sim_event_t *p_event = m_heap[index];
+
+    while (index > 1 && event_is_before(p_event, m_heap[index / 2]))
+    {
+        heap_place(m_heap[index / 2], index);
+        index /= 2;
+    }
+    heap_place(p_event, index);
+}
+
+static void heap_sift_down(uint32_t index)
+{
+    sim_event_t *p_event = m_heap[index];
+
+    while (2 * index <= m_heap_cnt)
+    {
+        uint32_t child = 2 * index;
+
+        if (child < m_heap_cnt && event_is_before(m_heap[child + 1], m_heap[child]))
+        {
+            child++;
+        }
+        if (!event_is_before(m_heap[child], p_event))
+        {
+            break;
+        }
+        heap_place(m_heap[child], index);
+        index = child;
+    }
+    heap_place(p_event, index);
+}
+
+static void heap_remove(uint32_t index)
+{
+    sim_event_t *p_last = m_heap[m_heap_cnt--];
+
+    m_heap[index]->heap_index = 0;
+    if (index > m_heap_cnt)
+    {
+        return;
+    }
+
+    heap_place(p_last, index);
+    heap_sift_up(index);
+    heap_sift_down(p_last->heap_index);
+}
+
+void sim_event_schedule(sim_event_t *p_event, uint64_t time_ns)
+{
+    if (p_event->heap_index != 0)
+    {
+        heap_remove(p_event->heap_index);
+    }
+
+    if (m_heap_cnt + 1 >= m_heap_size)
+    {
+        m_heap_size = m_heap_size ? m_heap_size * 2 : EVENT_HEAP_SIZE_INIT;
+        m_heap = realloc(m_heap, m_heap_size * sizeof(*m_heap));
+        if (m_heap == NULL)
+        {
+            fprintf(stderr, "sim: out of memory\n");
+            exit(2);
+        }
+    }
+
+    p_event->time_ns = (time_ns < m_now_ns) ? m_now_ns : time_ns;
+    p_event->seq = m_seq++;
+    m_heap[++m_heap_cnt] = p_event;
+    heap_sift_up(m_heap_cnt);
+}
+
+void sim_event_cancel(sim_event_t *p_event)
+{
+    if (p_event->heap_index != 0)
+    {
+        heap_remove(p_event->heap_index);
+    }
+}
+
+bool sim_event_is_scheduled(const sim_event_t *p_event)
+{
+    return p_event->heap_index != 0;
+}
+
+// Runs the next event if it is due at limit_ns at the latest
+static bool step(uint64_t limit_ns)
+{
+    if (m_heap_cnt == 0 || m_heap[1]->time_ns > limit_ns)
+    {
+        return false;
+    }
+
+    sim_event_t *p_event = m_heap[1];
+    heap_remove(1);
+    m_now_ns = p_event->time_ns;
+    p_event->handler(p_event);
+
+    return true;
+}
+
+void sim_irq(sim_wake_source_t source)
+{
+    m_pending_irq_mask |= 1UL << source;
+}
+
+static const char *const m_wake_source_names[SIM_WAKE_CNT] = {
+    [SIM_WAKE_RTC] = "rtc",
+    [SIM_WAKE_SOFTDEVICE] = "softdevice",
+    [SIM_WAKE_RADIO_NOTIFICATION] = "radio_notification",
+    [SIM_WAKE_GPIOTE] = "gpiote",
+    [SIM_WAKE_SPI] = "spi",
+    [SIM_WAKE_ADC] = "adc",
+};
+
+const char *sim_wake_source_name(sim_wake_source_t source)
+{
+    return m_wake_source_names[source];
+}
+
+// Returns at once if an interrupt has come since the last call, as WFE with the event register.
+uint32_t sd_app_evt_wait(void)
+{
+    sim_hw_sync();
+
+    while (m_pending_irq_mask == 0)
+    {
+        if (!step(sim_config.duration_ns))
+        {
+            m_now_ns = sim_config.duration_ns;
+            sim_finish("end of the simulated time");
+        }
+    }
+
+    sim_stats.wakeup_cnt++;
+    for (uint32_t i = 0; i < SIM_WAKE_CNT; i++)
+    {
+        if (m_pending_irq_mask & (1UL << i))
+        {
+            sim_stats.wakeup_source_cnt[i]++;
+        }
+    }
+    sim_trace("WAKE", "0x%02x", m_pending_irq_mask);
+    m_pending_irq_mask = 0;
+
+    return NRF_SUCCESS;
+}
+
+// The CPU is running, interrupts due in the meantime preempt it.
+void sim_busy_wait(uint64_t duration_ns)
+{
+    uint64_t end_ns = m_now_ns + duration_ns;
+
+    sim_hw_sync();
+    while (step(end_ns))
+    {
+    }
+    m_now_ns = end_ns;
+}
+
+void nrf_delay_us(uint32_t number_of_us)
+{
+    sim_busy_wait(number_of_us * SIM_NS_PER_US);
+}
+
+void nrf_delay_ms(uint32_t number_of_ms)
+{
+    sim_busy_wait(number_of_ms * SIM_NS_PER_MS);
+}
+
+uint32_t sim_epoch_now(void)
+{
+    return sim_config.epoch_start + (uint32_t)(m_now_ns / SIM_NS_PER_S);
+}
+
+static void trace_open(void)
+{
+    if (sim_config.trace_path == NULL)
+    {
+        return;
+    }
+
+    m_trace_file = fopen(sim_config.trace_path, "w");
+    if (m_trace_file == NULL)
+    {
+        perror(sim_config.trace_path);
+        exit(2);
+    }
+    fprintf(m_trace_file, "time_s,event,detail\n");
+}
+
+void sim_trace(const char *p_event, const char *p_format, ...)
+{
+    va_list args;
+
+    if (m_trace_file == NULL)
+    {
+        return;
+    }
+
+    fprintf(m_trace_file, "%.6f,%s,\"", m_now_ns / (double)SIM_NS_PER_S, p_event);
+    va_start(args, p_format);
+    vfprintf(m_trace_file, p_format, args);
+    va_end(args);
+    fprintf(m_trace_file, "\"\n");
+}
+
+void sim_log(const char *p_module, const char *p_format, ...)
+{
+    char line[256];
+    va_list args;
+
+    va_start(args, p_format);
+    vsnprintf(line, sizeof(line), p_format, args);
+    va_end(args);
+
+    // The log of the SDK ends lines with \r\n or \n.
+    size_t len = strcspn(line, "\r\n");
+    fprintf(stderr, "[%12.6f] %s: %.*s\n", m_now_ns / (double)SIM_NS_PER_S, p_module, (int)len, line);
+}
+
+// xorshift64*, reproducible from the seed
+uint32_t sim_rand(void)
+{
+    m_rng_state ^= m_rng_state >> 12;
+    m_rng_state ^= m_rng_state << 25;
+    m_rng_state ^= m_rng_state >> 27;
+
+    return (uint32_t)((m_rng_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+double sim_rand_uniform(void)
+{
+    return (sim_rand() + 0.5) / 4294967296.0;
+}
+
+double sim_rand_normal(void)
+{
+    return sqrt(-2.0 * log(sim_rand_uniform())) * cos(2.0 * M_PI * sim_rand_uniform());
+}
+
+uint32_t sd_rand_application_vector_get(uint8_t *p_buff, uint8_t length)
+{
+    for (uint8_t i = 0; i < length; i++)
+    {
+        p_buff[i] = (uint8_t)sim_rand();
+    }
+
+    return NRF_SUCCESS;
+}
+
+static void *map_fixed(uintptr_t addr, size_t size)
+{
+    void *p = mmap((void *)addr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+    if (p != (void *)addr)
+    {
+        fprintf(stderr, "sim: cannot map 0x%08lx, the image has to be linked with -no-pie\n", (unsigned long)addr);
+        exit(2);
+    }
+
+    return p;
+}
+
+// The application takes the addresses of the RAM, FICR and the peripherals as uint32_t,
+// so they are mapped at the addresses of nRF51 in the low 4 GB of the host.
+void sim_memory_init(void)
+{
+    map_fixed(SIM_RAM_BASE, SIM_RAM_SIZE);
+    map_fixed(SIM_FICR_BASE, 0x1000);
+    map_fixed(SIM_PERIPHERAL_BASE, SIM_PERIPHERAL_SIZE);
+
+    NRF_FICR->CODEPAGESIZE = 1024;
+    NRF_FICR->CODESIZE = 256;
+    NRF_FICR->NUMRAMBLOCK = 2;
+    NRF_FICR->SIZERAMBLOCKS = 8192;
+}
+
+// The stack of the host is not in the simulated RAM. The main stack pointer is reported
+// near the top, so that the stack painting of the application covers the region.
+uint32_t __get_MSP(void)
+{
+    return SIM_RAM_BASE + SIM_RAM_SIZE - 256;
+}
+
+void NVIC_SystemReset(void)
+{
+    sim_trace("RESET", "NVIC_SystemReset");
+    sim_finish("NVIC_SystemReset");
+}
+
+uint32_t sd_power_system_off(void)
+{
+    sim_trace("SYSTEM_OFF", "");
+    sim_finish("System OFF");
+}
+
+void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t *p_file_name)
+{
+    sim_stats.error_cnt++;
+    sim_trace("ERROR", "0x%x %s:%u", error_code, (const char *)p_file_name, line_num);
+    fprintf(stderr, "[%12.6f] APP_ERROR 0x%x at %s:%u\n",
+            m_now_ns / (double)SIM_NS_PER_S, error_code, (const char *)p_file_name, line_num);
+
+    m_error_info.line_num = (uint16_t)line_num;
+    m_error_info.p_file_name = p_file_name;
+    m_error_info.err_code = error_code;
+    app_error_fault_handler(NRF_FAULT_ID_SDK_ERROR, 0, (uint32_t)(uintptr_t)&m_error_info);
+
+    if (sim_config.exit_on_error)
+    {
+        sim_finish("APP_ERROR");
+    }
+}
+
+void sim_run(int (*p_main)(void))
+{
+    m_rng_state = sim_config.seed * 0x9E3779B97F4A7C15ULL + 0x632BE59BD9B4E019ULL;
+    if (m_rng_state == 0)
+    {
+        m_rng_state = 1;
+    }
+
+    trace_open();
+    p_main();
+    sim_finish("main() returned");
+}
+
+void sim_finish(const char *p_reason)
+{
+    sim_trace("END", "%s", p_reason);
+    if (m_trace_file != NULL)
+    {
+        fclose(m_trace_file);
+        m_trace_file = NULL;
+    }
+
+    fflush(stdout);
+    sim_report(p_reason);
+    exit(sim_stats.error_cnt > 0 ? 1 : 0);
+}
@@ -0,0 +1,943 @@
+// fstorage and FDS of SDK 12 on a simulated flash.
+// The pages, the record headers and the steps of the operations are those of SDK 12, so the flash
+// fills up and is written at the same rate as on the target. A step is a flash operation of the
+// SoftDevice, which ends with a SoC event, and the next step starts from fs_sys_event_handler()
+// in the context of the application.
+
+#include "sim.h"
+
+#include <string.h>
+
+#include "fds.h"
+#include "fstorage.h"
+#include "nrf_soc.h"
+#include "sdk_config.h"
+
+#define PAGE_TAG_MAGIC 0xDEADC0DE
+#define PAGE_TAG_DATA 0xF11E01FF
+#define PAGE_TAG_SWAP 0xF11E01FE
+#define PAGE_HEADER_WORDS 2
+#define RECORD_HEADER_WORDS 3
+#define RECORD_TL_OFFSET 0
+#define RECORD_IC_OFFSET 1
+#define RECORD_ID_OFFSET 2
+#define WORD_ERASED 0xFFFFFFFF
+#define DATA_PAGE_CNT (FDS_VIRTUAL_PAGES - 1)
+#define RECORD_WORDS_MAX (FDS_VIRTUAL_PAGE_SIZE - PAGE_HEADER_WORDS - RECORD_HEADER_WORDS)
+
+// nRF51 reference manual, maximum times
+#define FLASH_WORD_WRITE_NS (46 * SIM_NS_PER_US)
+#define FLASH_PAGE_ERASE_NS (22300 * SIM_NS_PER_US)
+
+typedef enum
+{
+    STEP_FORMAT,       // page tags of an erased page
+    STEP_HEADER_BEGIN, // file id, CRC and record id
+    STEP_DATA,
+    STEP_TL,           // key and length, written last to complete the record
+    STEP_FLAG_DIRTY,   // key of the old record set to FDS_RECORD_KEY_DIRTY
+    STEP_GC_COPY,      // valid records of a page to the swap page
+    STEP_GC_ERASE,
+} step_t;
+
+typedef struct
+{
+    fds_evt_id_t id;
+    step_t step;
+    uint16_t file_id;
+    uint16_t record_key;
+    uint32_t record_id;
+    uint32_t old_record_id;
+    uint16_t length_words;
+    uint8_t page;          // reserved data page of a write, the page being formatted or compacted
+    uint16_t offset;       // of the record in the page, fixed when the write starts
+    uint8_t chunk_index;   // first chunk in the chunk queue
+    uint8_t chunk_cnt;
+    uint16_t dirty_words;  // step of FLAG_DIRTY of a file delete
+} fds_op_t;
+
+typedef struct
+{
+    uint32_t *p_words;      // physical page, swapped with the swap page by GC
+    uint16_t write_offset;
+    uint16_t words_reserved;
+} page_t;
+
+static uint32_t m_flash[FDS_VIRTUAL_PAGES][FDS_VIRTUAL_PAGE_SIZE];
+static page_t m_pages[DATA_PAGE_CNT];
+static uint32_t *mp_swap;
+
+static fds_cb_t m_users[FDS_MAX_USERS];
+static uint8_t m_user_cnt;
+static bool m_is_initialized;
+static bool m_is_init_pending;
+
+static fds_op_t m_ops[FDS_OP_QUEUE_SIZE];
+static uint8_t m_op_head;
+static uint8_t m_op_cnt;
+static fds_record_chunk_t m_chunks[FDS_CHUNK_QUEUE_SIZE];
+static uint8_t m_chunk_head;
+static uint8_t m_chunk_cnt;
+
+static bool m_is_step_running; // flash operation in the SoftDevice, the only operation of fstorage
+static sim_event_t m_step_event;
+static uint32_t m_latest_record_id;
+static uint16_t m_gc_run_cnt;
+static uint16_t m_open_record_cnt;
+static uint32_t m_gc_cnt;
+static uint32_t m_no_space_cnt;
+static uint64_t m_first_no_space_ns;
+
+static void flash_init(void)
+{
+    static bool is_flash_initialized;
+
+    if (is_flash_initialized)
+    {
+        return;
+    }
+    is_flash_initialized = true;
+
+    memset(m_flash, 0xFF, sizeof(m_flash));
+    for (uint8_t i = 0; i < DATA_PAGE_CNT; i++)
+    {
+        m_pages[i].p_words = m_flash[i];
+        m_pages[i].write_offset = PAGE_HEADER_WORDS;
+    }
+    mp_swap = m_flash[FDS_VIRTUAL_PAGES - 1];
+
+    // A device which has run once has the pages formatted.
+    if (!sim_config.is_flash_erased)
+    {
+        for (uint8_t i = 0; i < DATA_PAGE_CNT; i++)
+        {
+            m_pages[i].p_words[0] = PAGE_TAG_MAGIC;
+            m_pages[i].p_words[1] = PAGE_TAG_DATA;
+        }
+        mp_swap[0] = PAGE_TAG_MAGIC;
+        mp_swap[1] = PAGE_TAG_SWAP;
+    }
+}
+
+static bool page_is_formatted(const page_t *p_page)
+{
+    return p_page->p_words[0] == PAGE_TAG_MAGIC && p_page->p_words[1] == PAGE_TAG_DATA;
+}
+
+// Records of a page in order. A record without its TL is not complete and ends the page.
+static uint32_t *record_next(const page_t *p_page, uint32_t *p_record)
+{
+    uint32_t *p_next = (p_record == NULL) ? &p_page->p_words[PAGE_HEADER_WORDS]
+                                          : p_record + RECORD_HEADER_WORDS + (p_record[RECORD_TL_OFFSET] >> 16);
+
+    if (p_next >= &p_page->p_words[FDS_VIRTUAL_PAGE_SIZE] || p_next[RECORD_TL_OFFSET] == WORD_ERASED)
+    {
+        return NULL;
+    }
+
+    return p_next;
+}
+
+static uint16_t record_key_get(const uint32_t *p_record)
+{
+    return (uint16_t)p_record[RECORD_TL_OFFSET];
+}
+
+static uint16_t record_file_id_get(const uint32_t *p_record)
+{
+    return (uint16_t)p_record[RECORD_IC_OFFSET];
+}
+
+static uint32_t *record_find_by_id(uint32_t record_id)
+{
+    for (uint8_t i = 0; i < DATA_PAGE_CNT; i++)
+    {
+        for (uint32_t *p_record = record_next(&m_pages[i], NULL); p_record != NULL; p_record = record_next(&m_pages[i], p_record))
+        {
+            if (p_record[RECORD_ID_OFFSET] == record_id && record_key_get(p_record) != FDS_RECORD_KEY_DIRTY)
+            {
+                return p_record;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void evt_send(const fds_evt_t *p_evt)
+{
+    for (uint8_t i = 0; i < m_user_cnt; i++)
+    {
+        m_users[i](p_evt);
+    }
+}
+
+// fstorage
+static void step_complete_evt(sim_event_t *p_event)
+{
+    sim_sd_soc_evt_put(NRF_EVT_FLASH_OPERATION_SUCCESS);
+}
+
+static void flash_operation_start(uint32_t words, bool is_erase)
+{
+    uint64_t duration_ns = words * FLASH_WORD_WRITE_NS;
+
+    if (is_erase)
+    {
+        duration_ns += FLASH_PAGE_ERASE_NS;
+        sim_stats.flash_page_erase_cnt++;
+        sim_trace("FLASH_ERASE", "");
+    }
+    if (words > 0)
+    {
+        sim_stats.flash_write_cnt++;
+        sim_stats.flash_word_cnt += words;
+        sim_trace("FLASH_WRITE", "%u words", words);
+    }
+
+    m_is_step_running = true;
+    m_step_event.handler = step_complete_evt;
+    sim_event_schedule(&m_step_event, sim_now() + duration_ns);
+}
+
+uint32_t fs_queued_op_count_get(uint32_t *p_op_count)
+{
+    *p_op_count = m_is_step_running ? 1 : 0;
+
+    return NRF_SUCCESS;
+}
+
+// FDS operations
+static bool gc_page_is_dirty(const page_t *p_page)
+{
+    for (uint32_t *p_record = record_next(p_page, NULL); p_record != NULL; p_record = record_next(p_page, p_record))
+    {
+        if (record_key_get(p_record) == FDS_RECORD_KEY_DIRTY)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static uint16_t gc_valid_words(const page_t *p_page)
+{
+    uint16_t words = 0;
+
+    for (uint32_t *p_record = record_next(p_page, NULL); p_record != NULL; p_record = record_next(p_page, p_record))
+    {
+        if (record_key_get(p_record) != FDS_RECORD_KEY_DIRTY)
+        {
+            words += RECORD_HEADER_WORDS + (p_record[RECORD_TL_OFFSET] >> 16);
+        }
+    }
+
+    return words;
+}
+
+// Next page for GC or format from op->page on, DATA_PAGE_CNT when done
+static uint8_t op_page_next(const fds_op_t *p_op, uint8_t page)
+{
+    for (; page < DATA_PAGE_CNT; page++)
+    {
+        if (p_op->id == FDS_EVT_GC && gc_page_is_dirty(&m_pages[page]))
+        {
+            break;
+        }
+        if (p_op->id == FDS_EVT_INIT && !page_is_formatted(&m_pages[page]))
+        {
+            break;
+        }
+    }
+
+    return page;
+}
+
+static void step_start(fds_op_t *p_op)
+{
+    switch (p_op->step)
+    {
+    case STEP_FORMAT:
+        flash_operation_start(PAGE_HEADER_WORDS, false);
+        break;
+
+    case STEP_HEADER_BEGIN:
+        flash_operation_start(RECORD_HEADER_WORDS - 1, false);
+        break;
+
+    case STEP_DATA:
+        flash_operation_start(p_op->length_words, false);
+        break;
+
+    case STEP_TL:
+        flash_operation_start(1, false);
+        break;
+
+    case STEP_FLAG_DIRTY:
+        flash_operation_start(p_op->dirty_words, false);
+        break;
+
+    case STEP_GC_COPY:
+        flash_operation_start(gc_valid_words(&m_pages[p_op->page]), false);
+        break;
+
+    case STEP_GC_ERASE:
+        flash_operation_start(0, true);
+        break;
+    }
+}
+
+static void gc_page_apply(uint8_t page)
+{
+    page_t *p_page = &m_pages[page];
+    uint16_t offset = PAGE_HEADER_WORDS;
+
+    memset(mp_swap, 0xFF, FDS_VIRTUAL_PAGE_SIZE * 4);
+    mp_swap[0] = PAGE_TAG_MAGIC;
+    mp_swap[1] = PAGE_TAG_DATA;
+    for (uint32_t *p_record = record_next(p_page, NULL); p_record != NULL; p_record = record_next(p_page, p_record))
+    {
+        uint16_t words = RECORD_HEADER_WORDS + (p_record[RECORD_TL_OFFSET] >> 16);
+
+        if (record_key_get(p_record) != FDS_RECORD_KEY_DIRTY)
+        {
+            memcpy(&mp_swap[offset], p_record, words * 4);
+            offset += words;
+        }
+    }
+
+    // The erased page is the new swap page.
+    uint32_t *p_old = p_page->p_words;
+    memset(p_old, 0xFF, FDS_VIRTUAL_PAGE_SIZE * 4);
+    p_old[0] = PAGE_TAG_MAGIC;
+    p_old[1] = PAGE_TAG_SWAP;
+    p_page->p_words = mp_swap;
+    p_page->write_offset = offset;
+    mp_swap = p_old;
+}
+
+static void chunks_copy(const fds_op_t *p_op, uint32_t *p_dst)
+{
+    for (uint8_t i = 0; i < p_op->chunk_cnt; i++)
+    {
+        const fds_record_chunk_t *p_chunk = &m_chunks[(p_op->chunk_index + i) % FDS_CHUNK_QUEUE_SIZE];
+
+        memcpy(p_dst, p_chunk->p_data, p_chunk->length_words * 4);
+        p_dst += p_chunk->length_words;
+    }
+}
+
+static void flag_dirty(uint32_t *p_record)
+{
+    p_record[RECORD_TL_OFFSET] &= 0xFFFF0000;
+}
+
+// Applies the completed step to the flash and selects the next one. Returns true when the operation is done.
+static bool step_complete(fds_op_t *p_op)
+{
+    page_t *p_page = &m_pages[p_op->page];
+    uint32_t *p_record = &p_page->p_words[p_op->offset];
+
+    switch (p_op->step)
+    {
+    case STEP_FORMAT:
+        p_page->p_words[0] = PAGE_TAG_MAGIC;
+        p_page->p_words[1] = PAGE_TAG_DATA;
+        p_op->page = op_page_next(p_op, p_op->page + 1);
+        if (p_op->page < DATA_PAGE_CNT)
+        {
+            return false;
+        }
+        if (mp_swap[0] != PAGE_TAG_MAGIC)
+        {
+            mp_swap[0] = PAGE_TAG_MAGIC;
+            mp_swap[1] = PAGE_TAG_SWAP;
+        }
+        m_is_initialized = true;
+        return true;
+
+    case STEP_HEADER_BEGIN:
+        p_record[RECORD_IC_OFFSET] = p_op->file_id;
+        p_record[RECORD_ID_OFFSET] = p_op->record_id;
+        p_op->step = STEP_DATA;
+        return false;
+
+    case STEP_DATA:
+        chunks_copy(p_op, &p_record[RECORD_HEADER_WORDS]);
+        p_op->step = STEP_TL;
+        return false;
+
+    case STEP_TL:
+        p_record[RECORD_TL_OFFSET] = p_op->record_key | ((uint32_t)p_op->length_words << 16);
+        m_chunk_head = (m_chunk_head + p_op->chunk_cnt) % FDS_CHUNK_QUEUE_SIZE;
+        m_chunk_cnt -= p_op->chunk_cnt;
+        if (p_op->id != FDS_EVT_UPDATE)
+        {
+            return true;
+        }
+        p_op->step = STEP_FLAG_DIRTY;
+        p_op->dirty_words = 1;
+        return false;
+
+    case STEP_FLAG_DIRTY:
+        if (p_op->id == FDS_EVT_DEL_FILE)
+        {
+            for (uint8_t i = 0; i < DATA_PAGE_CNT; i++)
+            {
+                for (uint32_t *p = record_next(&m_pages[i], NULL); p != NULL; p = record_next(&m_pages[i], p))
+                {
+                    if (record_file_id_get(p) == p_op->file_id)
+                    {
+                        flag_dirty(p);
+                    }
+                }
+            }
+        }
+        else
+        {
+            uint32_t *p_old = record_find_by_id(p_op->old_record_id);
+            if (p_old != NULL)
+            {
+                flag_dirty(p_old);
+            }
+        }
+        return true;
+
+    case STEP_GC_COPY:
+        p_op->step = STEP_GC_ERASE;
+        return false;
+
+    case STEP_GC_ERASE:
+        gc_page_apply(p_op->page);
+        m_gc_run_cnt++;
+        p_op->page = op_page_next(p_op, p_op->page + 1);
+        p_op->step = STEP_GC_COPY;
+        return p_op->page == DATA_PAGE_CNT;
+    }
+
+    return true;
+}
+
+static void op_begin(fds_op_t *p_op)
+{
+    if (p_op->id == FDS_EVT_GC)
+    {
+        p_op->page = op_page_next(p_op, 0);
+    }
+    else if (p_op->id == FDS_EVT_WRITE || p_op->id == FDS_EVT_UPDATE)
+    {
+        page_t *p_page = &m_pages[p_op->page];
+        uint16_t words = RECORD_HEADER_WORDS + p_op->length_words;
+
+        p_op->offset = p_page->write_offset;
+        p_page->write_offset += words;
+        p_page->words_reserved -= words;
+    }
+}
+
+static void op_complete(fds_op_t *p_op)
+{
+    fds_evt_t evt;
+
+    memset(&evt, 0, sizeof(evt));
+    evt.id = p_op->id;
+    evt.result = FDS_SUCCESS;
+    if (p_op->id == FDS_EVT_WRITE || p_op->id == FDS_EVT_UPDATE)
+    {
+        evt.write.record_id = p_op->record_id;
+        evt.write.file_id = p_op->file_id;
+        evt.write.record_key = p_op->record_key;
+        evt.write.is_record_updated = (p_op->id == FDS_EVT_UPDATE);
+        sim_stats.fds_record_write_cnt++;
+    }
+    else if (p_op->id == FDS_EVT_DEL_RECORD || p_op->id == FDS_EVT_DEL_FILE)
+    {
+        evt.del.record_id = p_op->old_record_id;
+        evt.del.file_id = p_op->file_id;
+        evt.del.record_key = p_op->record_key;
+    }
+    else if (p_op->id == FDS_EVT_GC)
+    {
+        m_gc_cnt++;
+        sim_trace("FDS_GC", "%u", m_gc_cnt);
+    }
+
+    m_op_head = (m_op_head + 1) % FDS_OP_QUEUE_SIZE;
+    m_op_cnt--;
+    if (m_op_cnt > 0)
+    {
+        op_begin(&m_ops[m_op_head]);
+    }
+    evt_send(&evt);
+}
+
+static void op_queue_process(void)
+{
+    while (m_op_cnt > 0 && !m_is_step_running)
+    {
+        fds_op_t *p_op = &m_ops[m_op_head];
+
+        // GC without a dirty page ends at once.
+        if (p_op->id == FDS_EVT_GC && p_op->page == DATA_PAGE_CNT)
+        {
+            op_complete(p_op);
+            continue;
+        }
+
+        step_start(p_op);
+    }
+}
+
+void fs_sys_event_handler(uint32_t sys_evt)
+{
+    if ((sys_evt != NRF_EVT_FLASH_OPERATION_SUCCESS && sys_evt != NRF_EVT_FLASH_OPERATION_ERROR) || !m_is_step_running)
+    {
+        return;
+    }
+
+    m_is_step_running = false;
+
+    fds_op_t *p_op = &m_ops[m_op_head];
+    if (step_complete(p_op))
+    {
+        op_complete(p_op);
+    }
+
+    op_queue_process();
+}
+
+static fds_op_t *op_alloc(fds_evt_id_t id)
+{
+    if (m_op_cnt == FDS_OP_QUEUE_SIZE)
+    {
+        return NULL;
+    }
+
+    fds_op_t *p_op = &m_ops[(m_op_head + m_op_cnt) % FDS_OP_QUEUE_SIZE];
+    memset(p_op, 0, sizeof(*p_op));
+    p_op->id = id;
+
+    return p_op;
+}
+
+static void op_enqueue(void)
+{
+    m_op_cnt++;
+    if (m_op_cnt == 1)
+    {
+        op_begin(&m_ops[m_op_head]);
+        op_queue_process();
+    }
+}
+
+ret_code_t fds_register(fds_cb_t cb)
+{
+    if (m_user_cnt == FDS_MAX_USERS)
+    {
+        return FDS_ERR_USER_LIMIT_REACHED;
+    }
+
+    m_users[m_user_cnt++] = cb;
+
+    return FDS_SUCCESS;
+}
+
+static void pages_scan(void)
+{
+    for (uint8_t i = 0; i < DATA_PAGE_CNT; i++)
+    {
+        uint32_t *p_last = NULL;
+
+        for (uint32_t *p_record = record_next(&m_pages[i], NULL); p_record != NULL; p_record = record_next(&m_pages[i], p_record))
+        {
+            p_last = p_record;
+            if (p_record[RECORD_ID_OFFSET] > m_latest_record_id)
+            {
+                m_latest_record_id = p_record[RECORD_ID_OFFSET];
+            }
+        }
+        m_pages[i].write_offset = (p_last == NULL) ? PAGE_HEADER_WORDS
+                                                   : (uint16_t)(p_last - m_pages[i].p_words) + RECORD_HEADER_WORDS + (p_last[RECORD_TL_OFFSET] >> 16);
+    }
+}
+
+// Formatted pages are initialized at once, erased pages are formatted by flash operations.
+ret_code_t fds_init(void)
+{
+    fds_evt_t evt = {.id = FDS_EVT_INIT, .result = FDS_SUCCESS};
+
+    flash_init();
+
+    if (m_is_initialized)
+    {
+        evt_send(&evt);
+        return FDS_SUCCESS;
+    }
+    if (m_is_init_pending)
+    {
+        return FDS_SUCCESS;
+    }
+
+    pages_scan();
+
+    fds_op_t *p_op = op_alloc(FDS_EVT_INIT);
+    p_op->step = STEP_FORMAT;
+    p_op->page = op_page_next(p_op, 0);
+    if (p_op->page == DATA_PAGE_CNT)
+    {
+        m_is_initialized = true;
+        evt_send(&evt);
+        return FDS_SUCCESS;
+    }
+
+    m_is_init_pending = true;
+    op_enqueue();
+
+    return FDS_SUCCESS;
+}
+
+static void no_space_count(void)
+{
+    if (m_no_space_cnt++ == 0)
+    {
+        m_first_no_space_ns = sim_now();
+    }
+    sim_stats.flash_error_cnt++;
+    sim_trace("FDS_NO_SPACE", "");
+}
+
+static ret_code_t write_enqueue(fds_evt_id_t id, fds_record_desc_t *p_desc, fds_record_t const *p_record)
+{
+    uint16_t length_words = 0;
+
+    if (!m_is_initialized)
+    {
+        return FDS_ERR_NOT_INITIALIZED;
+    }
+    if (p_record == NULL)
+    {
+        return FDS_ERR_NULL_ARG;
+    }
+    if (p_record->file_id == FDS_FILE_ID_INVALID || p_record->key == FDS_RECORD_KEY_DIRTY)
+    {
+        return FDS_ERR_INVALID_ARG;
+    }
+    for (uint16_t i = 0; i < p_record->data.num_chunks; i++)
+    {
+        length_words += p_record->data.p_chunks[i].length_words;
+    }
+    if (length_words > RECORD_WORDS_MAX)
+    {
+        return FDS_ERR_RECORD_TOO_LARGE;
+    }
+    if (m_op_cnt == FDS_OP_QUEUE_SIZE || m_chunk_cnt + p_record->data.num_chunks > FDS_CHUNK_QUEUE_SIZE)
+    {
+        return FDS_ERR_NO_SPACE_IN_QUEUES;
+    }
+
+    // The space is reserved at once, dirty records take space until the next GC.
+    uint16_t words = RECORD_HEADER_WORDS + length_words;
+    uint8_t page;
+    for (page = 0; page < DATA_PAGE_CNT; page++)
+    {
+        if (m_pages[page].write_offset + m_pages[page].words_reserved + words <= FDS_VIRTUAL_PAGE_SIZE)
+        {
+            break;
+        }
+    }
+    if (page == DATA_PAGE_CNT)
+    {
+        no_space_count();
+        return FDS_ERR_NO_SPACE_IN_FLASH;
+    }
+
+    fds_op_t *p_op = op_alloc(id);
+    p_op->step = STEP_HEADER_BEGIN;
+    p_op->file_id = p_record->file_id;
+    p_op->record_key = p_record->key;
+    p_op->record_id = ++m_latest_record_id;
+    p_op->old_record_id = (id == FDS_EVT_UPDATE) ? p_desc->record_id : 0;
+    p_op->length_words = length_words;
+    p_op->page = page;
+    p_op->chunk_index = (m_chunk_head + m_chunk_cnt) % FDS_CHUNK_QUEUE_SIZE;
+    p_op->chunk_cnt = (uint8_t)p_record->data.num_chunks;
+    for (uint16_t i = 0; i < p_record->data.num_chunks; i++)
+    {
+        m_chunks[(p_op->chunk_index + i) % FDS_CHUNK_QUEUE_SIZE] = p_record->data.p_chunks[i];
+    }
+    m_chunk_cnt += p_record->data.num_chunks;
+    m_pages[page].words_reserved += words;
+
+    if (p_desc != NULL)
+    {
+        p_desc->record_id = p_op->record_id;
+        p_desc->p_record = NULL;
+        p_desc->gc_run_count = m_gc_run_cnt;
+        p_desc->record_is_open = false;
+    }
+
+    op_enqueue();
+
+    return FDS_SUCCESS;
+}
+
+ret_code_t fds_record_write(fds_record_desc_t *p_desc, fds_record_t const *p_record)
+{
+    return write_enqueue(FDS_EVT_WRITE, p_desc, p_record);
+}
+
+ret_code_t fds_record_update(fds_record_desc_t *p_desc, fds_record_t const *p_record)
+{
+    if (p_desc == NULL)
+    {
+        return FDS_ERR_NULL_ARG;
+    }
+
+    return write_enqueue(FDS_EVT_UPDATE, p_desc, p_record);
+}
+
+ret_code_t fds_record_delete(fds_record_desc_t *p_desc)
+{
+    if (!m_is_initialized)
+    {
+        return FDS_ERR_NOT_INITIALIZED;
+    }
+    if (p_desc == NULL)
+    {
+        return FDS_ERR_NULL_ARG;
+    }
+
+    fds_op_t *p_op = op_alloc(FDS_EVT_DEL_RECORD);
+    if (p_op == NULL)
+    {
+        return FDS_ERR_NO_SPACE_IN_QUEUES;
+    }
+
+    uint32_t *p_record = record_find_by_id(p_desc->record_id);
+    p_op->step = STEP_FLAG_DIRTY;
+    p_op->dirty_words = 1;
+    p_op->old_record_id = p_desc->record_id;
+    if (p_record != NULL)
+    {
+        p_op->file_id = record_file_id_get(p_record);
+        p_op->record_key = record_key_get(p_record);
+    }
+    op_enqueue();
+
+    return FDS_SUCCESS;
+}
+
+ret_code_t fds_file_delete(uint16_t file_id)
+{
+    if (!m_is_initialized)
+    {
+        return FDS_ERR_NOT_INITIALIZED;
+    }
+    if (file_id == FDS_FILE_ID_INVALID)
+    {
+        return FDS_ERR_INVALID_ARG;
+    }
+
+    fds_op_t *p_op = op_alloc(FDS_EVT_DEL_FILE);
+    if (p_op == NULL)
+    {
+        return FDS_ERR_NO_SPACE_IN_QUEUES;
+    }
+
+    p_op->step = STEP_FLAG_DIRTY;
+    p_op->file_id = file_id;
+    p_op->dirty_words = 0;
+    for (uint8_t i = 0; i < DATA_PAGE_CNT; i++)
+    {
+        for (uint32_t *p = record_next(&m_pages[i], NULL); p != NULL; p = record_next(&m_pages[i], p))
+        {
+            if (record_file_id_get(p) == file_id && record_key_get(p) != FDS_RECORD_KEY_DIRTY)
+            {
+                p_op->dirty_words++;
+            }
+        }
+    }
+    op_enqueue();
+
+    return FDS_SUCCESS;
+}
+
+// The pages to compact are selected when GC starts, after the operations queued before it.
+ret_code_t fds_gc(void)
+{
+    if (!m_is_initialized)
+    {
+        return FDS_ERR_NOT_INITIALIZED;
+    }
+
+    fds_op_t *p_op = op_alloc(FDS_EVT_GC);
+    if (p_op == NULL)
+    {
+        return FDS_ERR_NO_SPACE_IN_QUEUES;
+    }
+
+    p_op->step = STEP_GC_COPY;
+    op_enqueue();
+
+    return FDS_SUCCESS;
+}
+
+static ret_code_t record_find(uint16_t const *p_file_id, uint16_t record_key,
+                              fds_record_desc_t *p_desc, fds_find_token_t *p_token)
+{
+    bool is_after_token = (p_token->p_addr == NULL);
+
+    if (!m_is_initialized)
+    {
+        return FDS_ERR_NOT_INITIALIZED;
+    }
+
+    for (uint8_t i = p_token->page; i < DATA_PAGE_CNT; i++)
+    {
+        for (uint32_t *p_record = record_next(&m_pages[i], NULL); p_record != NULL; p_record = record_next(&m_pages[i], p_record))
+        {
+            if (!is_after_token)
+            {
+                is_after_token = (p_record == p_token->p_addr);
+                continue;
+            }
+            if (record_key_get(p_record) != record_key ||
+                (p_file_id != NULL && record_file_id_get(p_record) != *p_file_id))
+            {
+                continue;
+            }
+
+            p_token->p_addr = p_record;
+            p_token->page = i;
+            p_desc->record_id = p_record[RECORD_ID_OFFSET];
+            p_desc->p_record = p_record;
+            p_desc->gc_run_count = m_gc_run_cnt;
+            p_desc->record_is_open = false;
+            return FDS_SUCCESS;
+        }
+    }
+
+    return FDS_ERR_NOT_FOUND;
+}
+
+ret_code_t fds_record_find(uint16_t file_id, uint16_t record_key, fds_record_desc_t *p_desc, fds_find_token_t *p_token)
+{
+    return record_find(&file_id, record_key, p_desc, p_token);
+}
+
+ret_code_t fds_record_find_by_key(uint16_t record_key, fds_record_desc_t *p_desc, fds_find_token_t *p_token)
+{
+    return record_find(NULL, record_key, p_desc, p_token);
+}
+
+ret_code_t fds_record_open(fds_record_desc_t *p_desc, fds_flash_record_t *p_flash_record)
+{
+    if (p_desc == NULL || p_flash_record == NULL)
+    {
+        return FDS_ERR_NULL_ARG;
+    }
+
+    // The address is looked up again after a GC has moved the record.
+    if (p_desc->p_record == NULL || p_desc->gc_run_count != m_gc_run_cnt)
+    {
+        p_desc->p_record = record_find_by_id(p_desc->record_id);
+        p_desc->gc_run_count = m_gc_run_cnt;
+    }
+    if (p_desc->p_record == NULL || record_key_get(p_desc->p_record) == FDS_RECORD_KEY_DIRTY)
+    {
+        return FDS_ERR_NOT_FOUND;
+    }
+
+    p_flash_record->p_header = (fds_header_t const *)p_desc->p_record;
+    p_flash_record->p_data = p_desc->p_record + RECORD_HEADER_WORDS;
+    if (!p_desc->record_is_open)
+    {
+        p_desc->record_is_open = true;
+        m_open_record_cnt++;
+    }
+
+    return FDS_SUCCESS;
+}
+
+ret_code_t fds_record_close(fds_record_desc_t *p_desc)
+{
+    if (p_desc == NULL)
+    {
+        return FDS_ERR_NULL_ARG;
+    }
+    if (!p_desc->record_is_open)
+    {
+        return FDS_ERR_NO_OPEN_RECORDS;
+    }
+
+    p_desc->record_is_open = false;
+    m_open_record_cnt--;
+
+    return FDS_SUCCESS;
+}
+
+ret_code_t fds_stat(fds_stat_t *p_stat)
+{
+    if (!m_is_initialized)
+    {
+        return FDS_ERR_NOT_INITIALIZED;
+    }
+
+    memset(p_stat, 0, sizeof(*p_stat));
+    p_stat->open_records = m_open_record_cnt;
+    for (uint8_t i = 0; i < DATA_PAGE_CNT; i++)
+    {
+        const page_t *p_page = &m_pages[i];
+
+        p_stat->pages_available++;
+        p_stat->words_reserved += p_page->words_reserved;
+        p_stat->words_used += p_page->write_offset - PAGE_HEADER_WORDS;
+        p_stat->largest_contig = MAX(p_stat->largest_contig,
+                                     FDS_VIRTUAL_PAGE_SIZE - p_page->write_offset - p_page->words_reserved);
+        for (uint32_t *p_record = record_next(p_page, NULL); p_record != NULL; p_record = record_next(p_page, p_record))
+        {
+            if (record_key_get(p_record) == FDS_RECORD_KEY_DIRTY)
+            {
+                p_stat->dirty_records++;
+                p_stat->freeable_words += RECORD_HEADER_WORDS + (p_record[RECORD_TL_OFFSET] >> 16);
+            }
+            else
+            {
+                p_stat->valid_records++;
+            }
+        }
+    }
+
+    return FDS_SUCCESS;
+}
+
+void sim_fds_report(void)
+{
+    fds_stat_t stat;
+
+    printf("flash:\n");
+    printf("  operations %u, words %u, page erases %u\n",
+           sim_stats.flash_write_cnt, sim_stats.flash_word_cnt, sim_stats.flash_page_erase_cnt);
+    if (fds_stat(&stat) != FDS_SUCCESS)
+    {
+        printf("  FDS is not initialized\n");
+        return;
+    }
+
+    uint32_t data_words = DATA_PAGE_CNT * (FDS_VIRTUAL_PAGE_SIZE - PAGE_HEADER_WORDS);
+    printf("  FDS records valid %u, dirty %u, words used %u of %u (%u freeable by GC), GC runs %u\n",
+           stat.valid_records, stat.dirty_records, stat.words_used, data_words, stat.freeable_words, m_gc_cnt);
+    if (m_no_space_cnt > 0)
+    {
+        printf("  FDS_ERR_NO_SPACE_IN_FLASH %u times, first at %.1f days\n",
+               m_no_space_cnt, m_first_no_space_ns / (double)(86400 * SIM_NS_PER_S));
+    }
+    else if (stat.words_used > 0 && sim_now() > 0)
+    {
+        double days = sim_now() / (double)(86400 * SIM_NS_PER_S);
+        double words_per_day = stat.words_used / days;
+        printf("  flash full in %.1f days without GC at %.1f words/day\n",
+               (data_words - stat.words_used) / words_per_day, words_per_day);
+    }
+}
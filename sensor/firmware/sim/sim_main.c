@@ -0,0 +1,436 @@
+// Entry of the host simulation: options, the stimulus script, the bridge and the report at the end
+
+#include "sim.h"
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "app_util.h"
+#include "ble_gap.h"
+#include "nrf_log.h"
+#include "adv_sync.h"
+#include "charge.h"
+#include "trace.h"
+
+int firmware_main(void);
+
+#define SCRIPT_LINE_LEN_MAX 256
+#define SCRIPT_DATA_LEN_MAX 31
+#define UUID_TIME 0x0015
+#define BRIDGE_FIRST_CONNECT_S 60
+
+typedef enum
+{
+    STIMULUS_CONNECT,
+    STIMULUS_DISCONNECT,
+    STIMULUS_WRITE,
+    STIMULUS_WRITE_EPOCH,
+    STIMULUS_READ,
+    STIMULUS_BUTTON,
+    STIMULUS_ADV_REPORT,
+    STIMULUS_BATTERY,
+} stimulus_type_t;
+
+typedef struct
+{
+    sim_event_t event;
+    stimulus_type_t type;
+    uint32_t value; // interval, UUID, duration or voltage
+    int8_t rssi;
+    uint8_t len;
+    uint8_t data[SCRIPT_DATA_LEN_MAX];
+} stimulus_t;
+
+static const uint8_t m_bme280_cs_pins[] = {SENSOR_BME280_CS_PINS};
+static sim_event_t m_bridge_event;
+
+static void usage(const char *p_name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -d DAYS       simulated days (default 7)\n"
+            "  -t SECONDS    simulated seconds, instead of -d\n"
+            "  -s SEED       seed of the random numbers (default 1)\n"
+            "  -o FILE       CSV trace of radio events, wakeups and flash writes\n"
+            "  -p PPM        error of the 32.768 kHz clock (default 0)\n"
+            "  -a RATIO      probability of a scan request per advertising event (default 0)\n"
+            "  -b SECONDS    period of the bridge connecting to write the time, 0 for none (default 0)\n"
+            "  -c MS         connection interval of the central (default 30)\n"
+            "  -v MV         battery voltage (default 3000)\n"
+            "  -e            start on erased flash instead of formatted FDS pages\n"
+            "  -x            exit at the first APP_ERROR\n"
+            "  -l            print the NRF_LOG of all modules\n"
+            "  -S FILE       stimulus script, a line per stimulus:\n"
+            "                <time_s> connect [interval_ms] | disconnect | write <uuid16> <hex|epoch>\n"
+            "                | read <uuid16> | button <ms> | adv_report <hex> [rssi] | battery <mV>\n",
+            p_name);
+    exit(2);
+}
+
+static void stimulus_evt(sim_event_t *p_event)
+{
+    stimulus_t *p_stimulus = (stimulus_t *)p_event;
+
+    switch (p_stimulus->type)
+    {
+    case STIMULUS_CONNECT:
+        sim_ble_connect((uint16_t)p_stimulus->value);
+        break;
+
+    case STIMULUS_DISCONNECT:
+        sim_ble_disconnect();
+        break;
+
+    case STIMULUS_WRITE:
+        sim_ble_write((uint16_t)p_stimulus->value, p_stimulus->data, p_stimulus->len);
+        break;
+
+    case STIMULUS_WRITE_EPOCH:
+        sim_ble_write((uint16_t)p_stimulus->value, NULL, 0);
+        break;
+
+    case STIMULUS_READ:
+        sim_ble_read((uint16_t)p_stimulus->value);
+        break;
+
+    case STIMULUS_BUTTON:
+        sim_button_press(p_stimulus->value);
+        break;
+
+    case STIMULUS_ADV_REPORT:
+        sim_ble_adv_report(p_stimulus->data, p_stimulus->len, p_stimulus->rssi);
+        break;
+
+    case STIMULUS_BATTERY:
+        sim_battery_set((uint16_t)p_stimulus->value);
+        break;
+    }
+
+    free(p_stimulus);
+}
+
+static bool hex_parse(const char *p_hex, uint8_t *p_data, uint8_t *p_len)
+{
+    size_t len = strlen(p_hex);
+
+    if (len % 2 != 0 || len / 2 > SCRIPT_DATA_LEN_MAX)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < len / 2; i++)
+    {
+        char byte[3] = {p_hex[i * 2], p_hex[i * 2 + 1], '\0'};
+        char *p_end;
+
+        p_data[i] = (uint8_t)strtoul(byte, &p_end, 16);
+        if (*p_end != '\0')
+        {
+            return false;
+        }
+    }
+    *p_len = (uint8_t)(len / 2);
+
+    return true;
+}
+
+static bool script_line_parse(char *p_line, stimulus_t *p_stimulus)
+{
+    char *p_time = strtok(p_line, " \t");
+    char *p_command = strtok(NULL, " \t");
+    char *p_arg1 = strtok(NULL, " \t");
+    char *p_arg2 = strtok(NULL, " \t");
+
+    if (p_time == NULL || p_command == NULL)
+    {
+        return false;
+    }
+
+    p_stimulus->event.time_ns = (uint64_t)(strtod(p_time, NULL) * SIM_NS_PER_S);
+    if (strcmp(p_command, "connect") == 0)
+    {
+        p_stimulus->type = STIMULUS_CONNECT;
+        p_stimulus->value = (p_arg1 != NULL) ? strtoul(p_arg1, NULL, 0) : sim_config.central_interval_ms;
+    }
+    else if (strcmp(p_command, "disconnect") == 0)
+    {
+        p_stimulus->type = STIMULUS_DISCONNECT;
+    }
+    else if (strcmp(p_command, "write") == 0 && p_arg1 != NULL && p_arg2 != NULL)
+    {
+        p_stimulus->value = strtoul(p_arg1, NULL, 16);
+        if (strcmp(p_arg2, "epoch") == 0)
+        {
+            p_stimulus->type = STIMULUS_WRITE_EPOCH;
+        }
+        else
+        {
+            p_stimulus->type = STIMULUS_WRITE;
+            return hex_parse(p_arg2, p_stimulus->data, &p_stimulus->len);
+        }
+    }
+    else if (strcmp(p_command, "read") == 0 && p_arg1 != NULL)
+    {
+        p_stimulus->type = STIMULUS_READ;
+        p_stimulus->value = strtoul(p_arg1, NULL, 16);
+    }
+    else if (strcmp(p_command, "button") == 0 && p_arg1 != NULL)
+    {
+        p_stimulus->type = STIMULUS_BUTTON;
+        p_stimulus->value = strtoul(p_arg1, NULL, 0);
+    }
+    else if (strcmp(p_command, "adv_report") == 0 && p_arg1 != NULL)
+    {
+        p_stimulus->type = STIMULUS_ADV_REPORT;
+        p_stimulus->rssi = (p_arg2 != NULL) ? (int8_t)strtol(p_arg2, NULL, 0) : -70;
+        return hex_parse(p_arg1, p_stimulus->data, &p_stimulus->len);
+    }
+    else if (strcmp(p_command, "battery") == 0 && p_arg1 != NULL)
+    {
+        p_stimulus->type = STIMULUS_BATTERY;
+        p_stimulus->value = strtoul(p_arg1, NULL, 0);
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+static void script_load(const char *p_path)
+{
+    char line[SCRIPT_LINE_LEN_MAX];
+    uint32_t line_num = 0;
+    FILE *p_file = fopen(p_path, "r");
+
+    if (p_file == NULL)
+    {
+        perror(p_path);
+        exit(2);
+    }
+
+    while (fgets(line, sizeof(line), p_file) != NULL)
+    {
+        line_num++;
+        line[strcspn(line, "#\r\n")] = '\0';
+        if (strspn(line, " \t") == strlen(line))
+        {
+            continue;
+        }
+
+        stimulus_t *p_stimulus = calloc(1, sizeof(stimulus_t));
+        if (p_stimulus == NULL || !script_line_parse(line, p_stimulus))
+        {
+            fprintf(stderr, "%s:%u: invalid stimulus\n", p_path, line_num);
+            exit(2);
+        }
+        p_stimulus->event.handler = stimulus_evt;
+        sim_event_schedule(&p_stimulus->event, p_stimulus->event.time_ns);
+    }
+
+    fclose(p_file);
+}
+
+// The bridge connects, writes the current time and disconnects.
+static void bridge_evt(sim_event_t *p_event)
+{
+    sim_ble_connect(sim_config.central_interval_ms);
+    sim_ble_write(UUID_TIME, NULL, 0);
+    sim_ble_disconnect();
+
+    sim_event_schedule(&m_bridge_event, sim_now() + sim_config.bridge_period_s * SIM_NS_PER_S);
+}
+
+// Measurement in the manufacturer data of the last advertising data compared with the environment
+static void adv_report_print(void)
+{
+    uint8_t data[BLE_GAP_ADV_MAX_SIZE];
+    uint8_t len;
+
+    if (!sim_ble_adv_data_get(data, &len))
+    {
+        printf("advertising data: none\n");
+        return;
+    }
+
+    for (uint8_t i = 0; i + 1 < len && data[i] > 0; i += data[i] + 1)
+    {
+        if (data[i + 1] != 0xFF || data[i] < 12)
+        {
+            continue;
+        }
+
+        const uint8_t *p_manuf = &data[i + 2];
+        double temperature, humidity, pressure;
+        sim_env_get(&temperature, &humidity, &pressure);
+
+        printf("advertising data: device id %u, battery %u, status 0x%02x\n",
+               uint16_decode(&p_manuf[0]), uint16_decode(&p_manuf[2]), p_manuf[10]);
+        printf("  temperature %6.2f C   (true %6.2f at the last measurement)\n",
+               (int16_t)uint16_decode(&p_manuf[4]) / 100.0, temperature);
+        printf("  humidity    %6.1f %%   (true %6.2f)\n", uint16_decode(&p_manuf[6]) / 10.0, humidity);
+        printf("  pressure    %6.1f hPa (true %6.1f)\n", uint16_decode(&p_manuf[8]) / 10.0, pressure / 100.0);
+        return;
+    }
+
+    printf("advertising data: no manufacturer data\n");
+}
+
+void sim_report(const char *p_reason)
+{
+    double days = sim_now() / (double)(86400 * SIM_NS_PER_S);
+
+    sim_ble_report();
+
+    printf("end: %s at %.6f s (%.2f days)\n", p_reason, sim_now() / (double)SIM_NS_PER_S, days);
+    printf("errors: %u\n", sim_stats.error_cnt);
+    printf("wakeups: %u (%.1f per hour)", sim_stats.wakeup_cnt, days > 0 ? sim_stats.wakeup_cnt / (days * 24) : 0.0);
+    for (uint32_t i = 0; i < SIM_WAKE_CNT; i++)
+    {
+        printf(", %s %u", sim_wake_source_name((sim_wake_source_t)i), sim_stats.wakeup_source_cnt[i]);
+    }
+    printf("\n");
+    printf("scheduler queue peak: %u\n", sim_stats.sched_peak);
+
+    printf("advertising: %u starts, %u data updates", sim_stats.adv_start_cnt, sim_stats.adv_data_set_cnt);
+    if (sim_stats.adv_data_age_cnt > 0)
+    {
+        printf(", data age %.1f s on average",
+               sim_stats.adv_data_age_total_ns / (double)sim_stats.adv_data_age_cnt / SIM_NS_PER_S);
+    }
+    printf("\n");
+    for (uint32_t i = 0; i < SIM_ADV_INTERVAL_SLOTS && sim_stats.adv[i].cnt > 0; i++)
+    {
+        printf("  interval %7.2f ms: %u events\n", sim_stats.adv[i].interval * 0.625, sim_stats.adv[i].cnt);
+    }
+    printf("  scan responses %u, radio notifications %u, scan reports %u\n",
+           sim_stats.scan_response_cnt, sim_stats.radio_notification_cnt, sim_stats.scan_report_cnt);
+
+    const adv_sync_stats_t *p_adv_sync = adv_sync_stats_get();
+    if (p_adv_sync->data_age_cnt > 0)
+    {
+        printf("  data age at the first transmission %.1f ms on average, %u ms max (adv_sync), %u aligned, %u fallback\n",
+               p_adv_sync->data_age_total_ms / (double)p_adv_sync->data_age_cnt, p_adv_sync->data_age_max_ms,
+               p_adv_sync->sync_cnt, p_adv_sync->fallback_cnt);
+    }
+
+    printf("boot: initialized %u ms, first data %u ms, first advertising with the data %u ms after LFCLK start\n",
+           trace_boot_ms_get(TRACE_BOOT_INIT), trace_boot_ms_get(TRACE_BOOT_FIRST_DATA),
+           trace_boot_ms_get(TRACE_BOOT_FIRST_ADV));
+
+    printf("connections: %u, %u events, %.1f s connected\n",
+           sim_stats.connection_cnt, sim_stats.connection_event_cnt, sim_stats.connected_ns / (double)SIM_NS_PER_S);
+    printf("  GATT writes %u, reads %u", sim_stats.gatt_write_cnt, sim_stats.gatt_read_cnt);
+    if (sim_stats.gatt_read_cnt > 0)
+    {
+        printf(", read latency %.2f ms on average, %.2f ms max",
+               sim_stats.gatt_read_latency_total_ns / (double)sim_stats.gatt_read_cnt / SIM_NS_PER_MS,
+               sim_stats.gatt_read_latency_max_ns / (double)SIM_NS_PER_MS);
+    }
+    printf("\n");
+
+    printf("sensor: %u BME280 conversions (%u read before the end), %u SPI transfers, %u ADC samples\n",
+           sim_stats.bme280_conversion_cnt, sim_stats.bme280_early_read_cnt,
+           sim_stats.spi_transfer_cnt, sim_stats.adc_sample_cnt);
+
+    sim_fds_report();
+    sim_timer_report();
+    printf("  timer starts %u (%u restarts of a running timer ignored), RTC1 stops %u\n",
+           sim_stats.timer_start_cnt, sim_stats.timer_restart_ignored_cnt, sim_stats.rtc_stop_cnt);
+    sim_softdevice_report();
+
+    // The counters of the charge estimation against the events seen by the models
+    const charge_counters_t *p_counters = charge_counters_get();
+    uint32_t adv_cnt = 0;
+    for (uint32_t i = 0; i < SIM_ADV_INTERVAL_SLOTS; i++)
+    {
+        adv_cnt += sim_stats.adv[i].cnt;
+    }
+    printf("charge estimation: %u mC consumed, lifetime %u h\n", charge_consumed_mc_get(), charge_lifetime_hours_get());
+    printf("  advertising events %u (true %u), measurements %u (true %u BME280 conversions / %u channels)\n",
+           p_counters->adv_slow_cnt + p_counters->adv_fast_cnt, adv_cnt,
+           p_counters->measurement_cnt, sim_stats.bme280_conversion_cnt, (unsigned)ARRAY_SIZE(m_bme280_cs_pins));
+    printf("  connections %u (true %u), connection events %u (true %u), record writes %u (true %u)\n",
+           p_counters->connection_cnt, sim_stats.connection_cnt,
+           p_counters->connection_event_cnt, sim_stats.connection_event_cnt,
+           p_counters->flash_write_cnt, sim_stats.fds_record_write_cnt);
+
+    adv_report_print();
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    int opt;
+
+    sim_config.duration_ns = 7 * 86400 * SIM_NS_PER_S;
+    sim_config.seed = 1;
+    sim_config.epoch_start = 1704067200; // 2024-01-01
+    sim_config.central_interval_ms = 30;
+    sim_config.battery_mv = 3000;
+
+    while ((opt = getopt(argc, argv, "d:t:s:o:p:a:b:c:v:exlS:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'd':
+            sim_config.duration_ns = (uint64_t)(strtod(optarg, NULL) * 86400 * SIM_NS_PER_S);
+            break;
+        case 't':
+            sim_config.duration_ns = (uint64_t)(strtod(optarg, NULL) * SIM_NS_PER_S);
+            break;
+        case 's':
+            sim_config.seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'o':
+            sim_config.trace_path = optarg;
+            break;
+        case 'p':
+            sim_config.lfclk_ppm = strtod(optarg, NULL);
+            break;
+        case 'a':
+            sim_config.active_scan_ratio = strtod(optarg, NULL);
+            break;
+        case 'b':
+            sim_config.bridge_period_s = strtoul(optarg, NULL, 0);
+            break;
+        case 'c':
+            sim_config.central_interval_ms = (uint16_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'v':
+            sim_config.battery_mv = (uint16_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'e':
+            sim_config.is_flash_erased = true;
+            break;
+        case 'x':
+            sim_config.exit_on_error = true;
+            break;
+        case 'l':
+            sim_log_all = true;
+            break;
+        case 'S':
+            sim_config.script_path = optarg;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+
+    sim_memory_init();
+    sim_periph_init(m_bme280_cs_pins, ARRAY_SIZE(m_bme280_cs_pins));
+
+    if (sim_config.script_path != NULL)
+    {
+        script_load(sim_config.script_path);
+    }
+    if (sim_config.bridge_period_s > 0)
+    {
+        m_bridge_event.handler = bridge_evt;
+        sim_event_schedule(&m_bridge_event, BRIDGE_FIRST_CONNECT_S * SIM_NS_PER_S);
+    }
+
+    sim_run(firmware_main);
+}
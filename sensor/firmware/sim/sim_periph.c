@@ -0,0 +1,784 @@
+// Peripherals of the board: GPIO with the LED and the button, GPIOTE, SPI with BME280s on
+// their CS pins, ADC on the battery voltage and the PPI tasks. The environment is a daily cycle.
+
+#include "sim.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "nrf.h"
+#include "nrf_gpio.h"
+#include "nrf_drv_gpiote.h"
+#include "nrf_drv_spi.h"
+#include "nrf_drv_adc.h"
+
+#define GPIO_PIN_CNT 32
+#define LED_PIN 11
+#define BUTTON_PIN 12
+#define SPI_BYTE_NS (8 * SIM_NS_PER_US) // 1 MHz
+#define ADC_CONVERSION_NS (68 * SIM_NS_PER_US) // 10 bit
+#define BME280_CNT_MAX 8
+#define BME280_CHIP_ID 0x60
+#define BME280_RA_CALIB00 0x88
+#define BME280_RA_CALIB26 0xE1
+#define BME280_RA_CHIP_ID 0xD0
+#define BME280_RA_CTRL_HUM 0xF2
+#define BME280_RA_CTRL_MEAS 0xF4
+#define BME280_RA_DATA 0xF7
+
+#define ENV_TEMPERATURE_MEAN 22.0    // DegC
+#define ENV_TEMPERATURE_AMPLITUDE 4.0
+#define ENV_HUMIDITY_MEAN 50.0       // %
+#define ENV_HUMIDITY_AMPLITUDE 10.0
+#define ENV_PRESSURE_MEAN 101300.0   // Pa
+#define ENV_PRESSURE_AMPLITUDE 600.0
+#define ENV_PRESSURE_PERIOD_S (3 * 86400)
+#define ENV_PEAK_HOUR 15.0
+
+// Calibration of a BME280, as in the datasheet example
+typedef struct
+{
+    uint16_t T1;
+    int16_t T2, T3;
+    uint16_t P1;
+    int16_t P2, P3, P4, P5, P6, P7, P8, P9;
+    uint8_t H1;
+    int16_t H2;
+    uint8_t H3;
+    int16_t H4, H5;
+    int8_t H6;
+} bme280_calib_t;
+
+static const bme280_calib_t m_calib = {
+    .T1 = 27504, .T2 = 26435, .T3 = -1000,
+    .P1 = 36477, .P2 = -10685, .P3 = 3024, .P4 = 2855, .P5 = 140, .P6 = -7, .P7 = 15500, .P8 = -14600, .P9 = 6000,
+    .H1 = 75, .H2 = 362, .H3 = 0, .H4 = 313, .H5 = 50, .H6 = 30};
+
+typedef struct
+{
+    uint8_t cs_pin;
+    uint8_t regs[256];
+    uint8_t ctrl_hum_latched; // ctrl_hum takes effect at the write of ctrl_meas
+    uint64_t conversion_end_ns;
+    uint8_t pending_data[8];
+    bool is_converting;
+} bme280_t;
+
+static struct
+{
+    bool outputs[GPIO_PIN_CNT];
+    bool inputs[GPIO_PIN_CNT];
+} m_gpio;
+
+static struct
+{
+    bool is_init;
+    nrf_drv_gpiote_evt_handler_t handlers[GPIO_PIN_CNT];
+    bool is_enabled[GPIO_PIN_CNT];
+    sim_event_t release_event;
+} m_gpiote;
+
+static struct
+{
+    bool is_init;
+    nrf_drv_spi_handler_t handler;
+    sim_event_t done_event;
+    bool is_busy;
+} m_spi;
+
+static bme280_t m_bme280[BME280_CNT_MAX];
+static uint8_t m_bme280_cnt;
+
+static struct
+{
+    bool is_init;
+    nrf_drv_adc_event_handler_t handler;
+    nrf_adc_value_t *p_buffer;
+    uint16_t size;
+    uint16_t index;
+    bool is_armed;
+    sim_event_t done_event;
+    uint16_t battery_mv;
+} m_adc;
+
+static double m_env_last[3];
+
+// Environment
+static void env_at(uint64_t time_ns, double *p_temperature, double *p_humidity, double *p_pressure)
+{
+    double t_s = time_ns / (double)SIM_NS_PER_S;
+    double day_phase = 2.0 * M_PI * (fmod(t_s / 3600.0, 24.0) - ENV_PEAK_HOUR + 6.0) / 24.0;
+
+    *p_temperature = ENV_TEMPERATURE_MEAN + ENV_TEMPERATURE_AMPLITUDE * sin(day_phase);
+    *p_humidity = ENV_HUMIDITY_MEAN - ENV_HUMIDITY_AMPLITUDE * sin(day_phase);
+    *p_pressure = ENV_PRESSURE_MEAN + ENV_PRESSURE_AMPLITUDE * sin(2.0 * M_PI * t_s / ENV_PRESSURE_PERIOD_S);
+}
+
+// Environment at the last conversion of the first BME280
+void sim_env_get(double *p_temperature, double *p_humidity, double *p_pressure)
+{
+    *p_temperature = m_env_last[0];
+    *p_humidity = m_env_last[1];
+    *p_pressure = m_env_last[2];
+}
+
+// Compensation of the Bosch driver, the same integer arithmetic as the application
+static int32_t compensate_temperature(uint32_t adc, int32_t *p_t_fine)
+{
+    int32_t var1 = ((((int32_t)adc >> 3) - ((int32_t)m_calib.T1 << 1)) * (int32_t)m_calib.T2) >> 11;
+    int32_t var2 = ((int32_t)adc >> 4) - (int32_t)m_calib.T1;
+
+    var2 = (((var2 * var2) >> 12) * (int32_t)m_calib.T3) >> 14;
+    *p_t_fine = var1 + var2;
+
+    return (*p_t_fine * 5 + 128) >> 8;
+}
+
+static uint32_t compensate_pressure(uint32_t adc, int32_t t_fine)
+{
+    int32_t var1 = (t_fine >> 1) - 64000;
+    int32_t var2 = (((var1 >> 2) * (var1 >> 2)) / 11) * (int32_t)m_calib.P6;
+    var2 = var2 + ((var1 * (int32_t)m_calib.P5) << 1);
+    var2 = (var2 >> 2) + ((int32_t)m_calib.P4 << 16);
+    int32_t var3 = (m_calib.P3 * (((var1 >> 2) * (var1 >> 2)) >> 13)) >> 3;
+    int32_t var4 = ((int32_t)m_calib.P2 * var1) >> 1;
+    var1 = (var3 + var4) >> 18;
+    var1 = ((32768 + var1) * (int32_t)m_calib.P1) >> 15;
+    if (var1 == 0)
+    {
+        return 0;
+    }
+
+    uint32_t pressure = ((uint32_t)(1048576 - adc) - (uint32_t)(var2 >> 12)) * 3125;
+    pressure = (pressure < 0x80000000) ? (pressure << 1) / (uint32_t)var1 : (pressure / (uint32_t)var1) * 2;
+    var1 = ((int32_t)m_calib.P9 * (int32_t)(((pressure >> 3) * (pressure >> 3)) >> 13)) >> 12;
+    var2 = ((int32_t)(pressure >> 2) * (int32_t)m_calib.P8) >> 13;
+
+    return (uint32_t)((int32_t)pressure + ((var1 + var2 + m_calib.P7) >> 4));
+}
+
+static uint32_t compensate_humidity(uint32_t adc, int32_t t_fine)
+{
+    int32_t var1 = t_fine - 76800;
+    int32_t var5 = ((((int32_t)(adc << 14)) - ((int32_t)m_calib.H4 << 20) - ((int32_t)m_calib.H5 * var1)) + 16384) >> 15;
+    int32_t var2 = (var1 * (int32_t)m_calib.H6) >> 10;
+    int32_t var3 = (var1 * (int32_t)m_calib.H3) >> 11;
+    int32_t var4 = ((var2 * (var3 + 32768)) >> 10) + 2097152;
+    var2 = ((var4 * (int32_t)m_calib.H2) + 8192) >> 14;
+    var3 = var5 * var2;
+    var4 = ((var3 >> 15) * (var3 >> 15)) >> 7;
+    var5 = var3 - ((var4 * (int32_t)m_calib.H1) >> 4);
+    var5 = (var5 < 0) ? 0 : var5;
+    var5 = (var5 > 419430400) ? 419430400 : var5;
+
+    return (uint32_t)(var5 >> 12);
+}
+
+// Raw values which the compensation turns into the environment, by binary search over the monotonic compensation
+static void bme280_raw_get(double temperature, double humidity, double pressure, uint8_t *p_data)
+{
+    uint32_t lo, hi;
+    int32_t t_fine;
+
+    for (lo = 0, hi = 0xFFFFF; lo < hi;)
+    {
+        uint32_t mid = (lo + hi) / 2;
+        if (compensate_temperature(mid, &t_fine) < lround(temperature * 100))
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    uint32_t adc_t = lo;
+    compensate_temperature(adc_t, &t_fine);
+
+    // Pressure decreases with the raw value.
+    for (lo = 0, hi = 0xFFFFF; lo < hi;)
+    {
+        uint32_t mid = (lo + hi) / 2;
+        if (compensate_pressure(mid, t_fine) > (uint32_t)lround(pressure))
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    uint32_t adc_p = lo;
+
+    for (lo = 0, hi = 0xFFFF; lo < hi;)
+    {
+        uint32_t mid = (lo + hi) / 2;
+        if (compensate_humidity(mid, t_fine) < (uint32_t)lround(humidity * 1024))
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    uint32_t adc_h = lo;
+
+    p_data[0] = (uint8_t)(adc_p >> 12);
+    p_data[1] = (uint8_t)(adc_p >> 4);
+    p_data[2] = (uint8_t)(adc_p << 4);
+    p_data[3] = (uint8_t)(adc_t >> 12);
+    p_data[4] = (uint8_t)(adc_t >> 4);
+    p_data[5] = (uint8_t)(adc_t << 4);
+    p_data[6] = (uint8_t)(adc_h >> 8);
+    p_data[7] = (uint8_t)adc_h;
+}
+
+// BME280
+static void bme280_reset(bme280_t *p_bme280, uint8_t cs_pin)
+{
+    uint8_t *p_regs = p_bme280->regs;
+
+    memset(p_bme280, 0, sizeof(*p_bme280));
+    p_bme280->cs_pin = cs_pin;
+
+    p_regs[BME280_RA_CHIP_ID] = BME280_CHIP_ID;
+    p_regs[0x88] = (uint8_t)m_calib.T1;
+    p_regs[0x89] = (uint8_t)(m_calib.T1 >> 8);
+    const int16_t calib_s16[] = {m_calib.T2, m_calib.T3, (int16_t)m_calib.P1, m_calib.P2, m_calib.P3, m_calib.P4,
+                                 m_calib.P5, m_calib.P6, m_calib.P7, m_calib.P8, m_calib.P9};
+    for (uint8_t i = 0; i < ARRAY_SIZE(calib_s16); i++)
+    {
+        p_regs[0x8A + i * 2] = (uint8_t)calib_s16[i];
+        p_regs[0x8B + i * 2] = (uint8_t)((uint16_t)calib_s16[i] >> 8);
+    }
+    p_regs[0xA1] = m_calib.H1;
+    p_regs[0xE1] = (uint8_t)m_calib.H2;
+    p_regs[0xE2] = (uint8_t)((uint16_t)m_calib.H2 >> 8);
+    p_regs[0xE3] = m_calib.H3;
+    p_regs[0xE4] = (uint8_t)(m_calib.H4 >> 4);
+    p_regs[0xE5] = (uint8_t)((m_calib.H4 & 0x0F) | ((m_calib.H5 & 0x0F) << 4));
+    p_regs[0xE6] = (uint8_t)(m_calib.H5 >> 4);
+    p_regs[0xE7] = (uint8_t)m_calib.H6;
+
+    // Skipped measurements read as 0x80000 and 0x8000 after reset.
+    const uint8_t reset_data[8] = {0x80, 0x00, 0x00, 0x80, 0x00, 0x00, 0x80, 0x00};
+    memcpy(&p_regs[BME280_RA_DATA], reset_data, sizeof(reset_data));
+}
+
+static bme280_t *bme280_get(uint8_t cs_pin)
+{
+    for (uint8_t i = 0; i < m_bme280_cnt; i++)
+    {
+        if (m_bme280[i].cs_pin == cs_pin)
+        {
+            return &m_bme280[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Measurement time in the datasheet, 9.1
+static uint64_t bme280_conversion_ns(uint8_t ctrl_meas, uint8_t ctrl_hum)
+{
+    static const uint8_t oversampling[8] = {0, 1, 2, 4, 8, 16, 16, 16};
+    uint8_t osrs_t = oversampling[(ctrl_meas >> 5) & 0x07];
+    uint8_t osrs_p = oversampling[(ctrl_meas >> 2) & 0x07];
+    uint8_t osrs_h = oversampling[ctrl_hum & 0x07];
+    double time_ms = 1.25 + 2.3 * osrs_t;
+
+    if (osrs_p > 0)
+    {
+        time_ms += 2.3 * osrs_p + 0.575;
+    }
+    if (osrs_h > 0)
+    {
+        time_ms += 2.3 * osrs_h + 0.575;
+    }
+
+    return (uint64_t)(time_ms * SIM_NS_PER_MS);
+}
+
+static void bme280_update(bme280_t *p_bme280)
+{
+    if (p_bme280->is_converting && sim_now() >= p_bme280->conversion_end_ns)
+    {
+        p_bme280->is_converting = false;
+        memcpy(&p_bme280->regs[BME280_RA_DATA], p_bme280->pending_data, sizeof(p_bme280->pending_data));
+    }
+}
+
+static void bme280_conversion_start(bme280_t *p_bme280)
+{
+    uint8_t ctrl_meas = p_bme280->regs[BME280_RA_CTRL_MEAS];
+    double temperature, humidity, pressure;
+
+    env_at(sim_now(), &temperature, &humidity, &pressure);
+    if (p_bme280 == &m_bme280[0])
+    {
+        m_env_last[0] = temperature;
+        m_env_last[1] = humidity;
+        m_env_last[2] = pressure;
+    }
+
+    bme280_raw_get(temperature + 0.02 * sim_rand_normal(), humidity + 0.1 * sim_rand_normal(),
+                   pressure + 2.0 * sim_rand_normal(), p_bme280->pending_data);
+
+    // Skipped measurements keep the reset value.
+    if (((ctrl_meas >> 2) & 0x07) == 0)
+    {
+        memcpy(&p_bme280->pending_data[0], "\x80\x00\x00", 3);
+    }
+    if ((p_bme280->ctrl_hum_latched & 0x07) == 0)
+    {
+        memcpy(&p_bme280->pending_data[6], "\x80\x00", 2);
+    }
+
+    p_bme280->is_converting = true;
+    p_bme280->conversion_end_ns = sim_now() + bme280_conversion_ns(ctrl_meas, p_bme280->ctrl_hum_latched);
+    sim_stats.bme280_conversion_cnt++;
+}
+
+// Full duplex transfer of SPI mode 0. The first byte is the register address with the read bit.
+static void bme280_transfer(bme280_t *p_bme280, const uint8_t *p_tx, uint8_t tx_len, uint8_t *p_rx, uint8_t rx_len)
+{
+    uint8_t len = MAX(tx_len, rx_len);
+
+    if (p_rx != NULL)
+    {
+        memset(p_rx, 0xFF, rx_len);
+    }
+    if (len == 0)
+    {
+        return;
+    }
+
+    bme280_update(p_bme280);
+
+    if (p_tx[0] & 0x80)
+    {
+        uint8_t reg = p_tx[0];
+
+        if (p_bme280->is_converting && reg >= BME280_RA_DATA)
+        {
+            sim_stats.bme280_early_read_cnt++;
+            sim_trace("BME280_EARLY_READ", "cs %u %.3f ms before the end", p_bme280->cs_pin,
+                      (p_bme280->conversion_end_ns - sim_now()) / (double)SIM_NS_PER_MS);
+        }
+        for (uint8_t i = 1; i < len && p_rx != NULL && i < rx_len; i++)
+        {
+            p_rx[i] = p_bme280->regs[(uint8_t)(reg + i - 1)];
+        }
+        return;
+    }
+
+    // Writes are pairs of an address without the read bit and the data.
+    for (uint8_t i = 0; i + 1 < tx_len; i += 2)
+    {
+        uint8_t reg = p_tx[i] | 0x80;
+
+        p_bme280->regs[reg] = p_tx[i + 1];
+        if (reg == BME280_RA_CTRL_MEAS)
+        {
+            p_bme280->ctrl_hum_latched = p_bme280->regs[BME280_RA_CTRL_HUM];
+            if ((p_tx[i + 1] & 0x03) == 0x01 || (p_tx[i + 1] & 0x03) == 0x02)
+            {
+                bme280_conversion_start(p_bme280);
+            }
+        }
+    }
+}
+
+// GPIO
+static void gpio_output_set(uint32_t pin, bool value)
+{
+    if (pin >= GPIO_PIN_CNT)
+    {
+        return;
+    }
+    if (pin == LED_PIN && m_gpio.outputs[pin] != value)
+    {
+        sim_trace("LED", "%u", value);
+    }
+    m_gpio.outputs[pin] = value;
+}
+
+void nrf_gpio_cfg_output(uint32_t pin_number)
+{
+}
+
+void nrf_gpio_cfg_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config)
+{
+}
+
+void nrf_gpio_cfg_sense_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config, nrf_gpio_pin_sense_t sense_config)
+{
+}
+
+void nrf_gpio_cfg_default(uint32_t pin_number)
+{
+}
+
+void nrf_gpio_pin_set(uint32_t pin_number)
+{
+    gpio_output_set(pin_number, true);
+}
+
+void nrf_gpio_pin_clear(uint32_t pin_number)
+{
+    gpio_output_set(pin_number, false);
+}
+
+void nrf_gpio_pin_toggle(uint32_t pin_number)
+{
+    gpio_output_set(pin_number, !m_gpio.outputs[pin_number]);
+}
+
+uint32_t nrf_gpio_pin_read(uint32_t pin_number)
+{
+    return m_gpio.inputs[pin_number];
+}
+
+// GPIOTE
+ret_code_t nrf_drv_gpiote_init(void)
+{
+    if (m_gpiote.is_init)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_gpiote.is_init = true;
+
+    return NRF_SUCCESS;
+}
+
+bool nrf_drv_gpiote_is_init(void)
+{
+    return m_gpiote.is_init;
+}
+
+ret_code_t nrf_drv_gpiote_in_init(nrf_drv_gpiote_pin_t pin,
+                                  nrf_drv_gpiote_in_config_t const *p_config,
+                                  nrf_drv_gpiote_evt_handler_t evt_handler)
+{
+    if (!m_gpiote.is_init || pin >= GPIO_PIN_CNT)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (m_gpiote.handlers[pin] != NULL)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_gpiote.handlers[pin] = evt_handler;
+
+    return NRF_SUCCESS;
+}
+
+void nrf_drv_gpiote_in_uninit(nrf_drv_gpiote_pin_t pin)
+{
+    m_gpiote.handlers[pin] = NULL;
+    m_gpiote.is_enabled[pin] = false;
+}
+
+void nrf_drv_gpiote_in_event_enable(nrf_drv_gpiote_pin_t pin, bool int_enable)
+{
+    m_gpiote.is_enabled[pin] = int_enable;
+}
+
+void nrf_drv_gpiote_in_event_disable(nrf_drv_gpiote_pin_t pin)
+{
+    m_gpiote.is_enabled[pin] = false;
+}
+
+bool nrf_drv_gpiote_in_is_set(nrf_drv_gpiote_pin_t pin)
+{
+    return m_gpio.inputs[pin];
+}
+
+static void gpio_input_change(uint32_t pin, bool value)
+{
+    m_gpio.inputs[pin] = value;
+    if (m_gpiote.is_enabled[pin] && m_gpiote.handlers[pin] != NULL)
+    {
+        sim_irq(SIM_WAKE_GPIOTE);
+        m_gpiote.handlers[pin](pin, NRF_GPIOTE_POLARITY_TOGGLE);
+    }
+}
+
+static void button_release_evt(sim_event_t *p_event)
+{
+    sim_trace("BUTTON", "release");
+    gpio_input_change(BUTTON_PIN, true);
+}
+
+// The button pulls the pin low.
+void sim_button_press(uint32_t duration_ms)
+{
+    sim_trace("BUTTON", "press %u ms", duration_ms);
+    gpio_input_change(BUTTON_PIN, false);
+
+    m_gpiote.release_event.handler = button_release_evt;
+    sim_event_schedule(&m_gpiote.release_event, sim_now() + duration_ms * SIM_NS_PER_MS);
+}
+
+// SPI master
+static uint8_t spi_cs_selected(void)
+{
+    uint8_t selected = 0xFF;
+
+    for (uint8_t i = 0; i < m_bme280_cnt; i++)
+    {
+        if (!m_gpio.outputs[m_bme280[i].cs_pin])
+        {
+            if (selected != 0xFF)
+            {
+                sim_trace("SPI_CS_CONFLICT", "%u %u", selected, m_bme280[i].cs_pin);
+            }
+            selected = m_bme280[i].cs_pin;
+        }
+    }
+
+    return selected;
+}
+
+static void spi_done_evt(sim_event_t *p_event)
+{
+    nrf_drv_spi_evt_t evt = {.type = NRF_DRV_SPI_EVENT_DONE};
+
+    m_spi.is_busy = false;
+    sim_irq(SIM_WAKE_SPI);
+    m_spi.handler(&evt);
+}
+
+ret_code_t nrf_drv_spi_init(nrf_drv_spi_t const *const p_instance,
+                            nrf_drv_spi_config_t const *p_config,
+                            nrf_drv_spi_handler_t handler)
+{
+    if (m_spi.is_init)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_spi.is_init = true;
+    m_spi.handler = handler;
+
+    return NRF_SUCCESS;
+}
+
+void nrf_drv_spi_uninit(nrf_drv_spi_t const *const p_instance)
+{
+    m_spi.is_init = false;
+    m_spi.handler = NULL;
+    sim_event_cancel(&m_spi.done_event);
+    m_spi.is_busy = false;
+}
+
+// The bytes are exchanged at the start. The CS pin selects the BME280 and the time of the
+// transfer is spent in a busy wait without a handler, or until the done interrupt with one.
+ret_code_t nrf_drv_spi_transfer(nrf_drv_spi_t const *const p_instance,
+                                uint8_t const *p_tx_buffer,
+                                uint8_t tx_buffer_length,
+                                uint8_t *p_rx_buffer,
+                                uint8_t rx_buffer_length)
+{
+    if (!m_spi.is_init)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (m_spi.is_busy)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    bme280_t *p_bme280 = bme280_get(spi_cs_selected());
+    if (p_bme280 != NULL)
+    {
+        bme280_transfer(p_bme280, p_tx_buffer, tx_buffer_length, p_rx_buffer, rx_buffer_length);
+    }
+    else if (p_rx_buffer != NULL)
+    {
+        memset(p_rx_buffer, 0xFF, rx_buffer_length);
+    }
+
+    sim_stats.spi_transfer_cnt++;
+    uint64_t duration_ns = MAX(tx_buffer_length, rx_buffer_length) * SPI_BYTE_NS;
+    if (m_spi.handler == NULL)
+    {
+        sim_busy_wait(duration_ns);
+        return NRF_SUCCESS;
+    }
+
+    m_spi.is_busy = true;
+    m_spi.done_event.handler = spi_done_evt;
+    sim_event_schedule(&m_spi.done_event, sim_now() + duration_ns);
+
+    return NRF_SUCCESS;
+}
+
+// ADC
+static nrf_adc_value_t adc_result_get(void)
+{
+    int32_t result = (int32_t)lround(m_adc.battery_mv * 1024.0 / 3600.0 + 0.5 * sim_rand_normal());
+
+    sim_stats.adc_sample_cnt++;
+
+    return (nrf_adc_value_t)MIN(MAX(result, 0), 1023);
+}
+
+static void adc_done_evt(sim_event_t *p_event)
+{
+    nrf_drv_adc_evt_t evt;
+
+    NRF_ADC->BUSY = 0;
+    NRF_ADC->RESULT = (uint32_t)adc_result_get();
+    NRF_ADC->EVENTS_END = 1;
+    if (m_adc.p_buffer == NULL || m_adc.handler == NULL)
+    {
+        return;
+    }
+
+    m_adc.p_buffer[m_adc.index++] = (nrf_adc_value_t)NRF_ADC->RESULT;
+    if (m_adc.index < m_adc.size)
+    {
+        return;
+    }
+
+    m_adc.is_armed = false;
+    memset(&evt, 0, sizeof(evt));
+    evt.type = NRF_DRV_ADC_EVT_DONE;
+    evt.data.done.p_buffer = m_adc.p_buffer;
+    evt.data.done.size = m_adc.size;
+    m_adc.p_buffer = NULL;
+
+    sim_irq(SIM_WAKE_ADC);
+    m_adc.handler(&evt);
+}
+
+static void adc_start(void)
+{
+    if (!m_adc.is_init || NRF_ADC->BUSY)
+    {
+        return;
+    }
+
+    NRF_ADC->BUSY = 1;
+    m_adc.done_event.handler = adc_done_evt;
+    sim_event_schedule(&m_adc.done_event, sim_now() + ADC_CONVERSION_NS);
+}
+
+ret_code_t nrf_drv_adc_init(nrf_drv_adc_config_t const *p_config, nrf_drv_adc_event_handler_t event_handler)
+{
+    if (m_adc.is_init)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_adc.is_init = true;
+    m_adc.handler = event_handler;
+    m_adc.p_buffer = NULL;
+    m_adc.is_armed = false;
+
+    return NRF_SUCCESS;
+}
+
+void nrf_drv_adc_uninit(void)
+{
+    m_adc.is_init = false;
+    m_adc.handler = NULL;
+    m_adc.p_buffer = NULL;
+    m_adc.is_armed = false;
+    sim_event_cancel(&m_adc.done_event);
+    NRF_ADC->BUSY = 0;
+}
+
+void nrf_drv_adc_channel_enable(nrf_drv_adc_channel_t *const p_channel)
+{
+}
+
+void nrf_drv_adc_channel_disable(nrf_drv_adc_channel_t *const p_channel)
+{
+}
+
+// With a handler the conversion is started by nrf_drv_adc_sample() or by PPI.
+ret_code_t nrf_drv_adc_buffer_convert(nrf_adc_value_t *buffer, uint16_t size)
+{
+    if (m_adc.is_armed || NRF_ADC->BUSY)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    m_adc.p_buffer = buffer;
+    m_adc.size = size;
+    m_adc.index = 0;
+    m_adc.is_armed = true;
+
+    if (m_adc.handler == NULL)
+    {
+        for (uint16_t i = 0; i < size; i++)
+        {
+            sim_busy_wait(ADC_CONVERSION_NS);
+            buffer[i] = adc_result_get();
+        }
+        m_adc.is_armed = false;
+        m_adc.p_buffer = NULL;
+    }
+
+    return NRF_SUCCESS;
+}
+
+void nrf_drv_adc_sample(void)
+{
+    adc_start();
+}
+
+ret_code_t nrf_drv_adc_sample_convert(nrf_drv_adc_channel_t const *const p_channel, nrf_adc_value_t *p_value)
+{
+    if (m_adc.is_armed || NRF_ADC->BUSY)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    sim_busy_wait(ADC_CONVERSION_NS);
+    *p_value = adc_result_get();
+
+    return NRF_SUCCESS;
+}
+
+void sim_ppi_task(uint32_t task_address)
+{
+    if (task_address == (uint32_t)(uintptr_t)&NRF_ADC->TASKS_START)
+    {
+        adc_start();
+    }
+    else
+    {
+        sim_trace("PPI_TASK_UNKNOWN", "0x%08x", task_address);
+    }
+}
+
+void sim_battery_set(uint16_t mv)
+{
+    m_adc.battery_mv = mv;
+    sim_trace("BATTERY", "%u mV", mv);
+}
+
+// BME280s on the CS pins of the build, the button released
+void sim_periph_init(const uint8_t *p_cs_pins, uint8_t cs_pin_cnt)
+{
+    m_bme280_cnt = MIN(cs_pin_cnt, BME280_CNT_MAX);
+    for (uint8_t i = 0; i < m_bme280_cnt; i++)
+    {
+        bme280_reset(&m_bme280[i], p_cs_pins[i]);
+    }
+
+    for (uint32_t i = 0; i < GPIO_PIN_CNT; i++)
+    {
+        m_gpio.outputs[i] = true;
+        m_gpio.inputs[i] = true;
+    }
+    m_gpio.outputs[LED_PIN] = false;
+
+    m_adc.battery_mv = sim_config.battery_mv;
+}
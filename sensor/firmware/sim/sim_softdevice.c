@@ -0,0 +1,430 @@
+// SoftDevice: enable, event queues, the handler of SDK 12 with the scheduler (APPSH),
+// power, NVIC, PPI and radio notification
+
+#include "sim.h"
+
+#include "nrf.h"
+#include "nrf_soc.h"
+#include "nrf_sdm.h"
+#include "app_scheduler.h"
+#include "softdevice_handler.h"
+
+#define BLE_EVT_QUEUE_SIZE 16
+#define SOC_EVT_QUEUE_SIZE 16
+#define BLE_EVT_BUFFER_SIZE 128 // holds BLE_EVT_LEN_MAX
+
+STATIC_ASSERT(BLE_EVT_LEN_MAX <= BLE_EVT_BUFFER_SIZE);
+
+typedef struct
+{
+    uint16_t len;
+    uint32_t data[BLE_EVT_BUFFER_SIZE / 4]; // aligned as the buffer of the SoftDevice handler
+} ble_evt_entry_t;
+
+static bool m_is_enabled;
+static bool m_is_ble_enabled;
+static ble_evt_handler_t m_ble_evt_handler;
+static sys_evt_handler_t m_sys_evt_handler;
+
+static ble_evt_entry_t m_ble_evt_queue[BLE_EVT_QUEUE_SIZE];
+static uint8_t m_ble_evt_head;
+static uint8_t m_ble_evt_cnt;
+static uint32_t m_soc_evt_queue[SOC_EVT_QUEUE_SIZE];
+static uint8_t m_soc_evt_head;
+static uint8_t m_soc_evt_cnt;
+
+// SWI2 raised by the SoftDevice for its events, once per instant
+static bool m_is_swi2_pending;
+static uint64_t m_swi2_time_ns;
+
+static uint32_t m_nvic_enabled_mask;
+static uint8_t m_radio_notification_type;
+static uint32_t m_ramon = POWER_RAMON_ONRAM0_Msk | POWER_RAMON_ONRAM1_Msk; // reset value
+static bool m_is_dcdc_enabled;
+
+void SWI1_IRQHandler(void) __attribute__((weak));
+
+bool sim_sd_is_enabled(void)
+{
+    return m_is_enabled;
+}
+
+static void softdevice_evt_get(void *p_event_data, uint16_t event_size)
+{
+    uint32_t evt_id;
+    bool is_ble_done = false;
+    bool is_soc_done = false;
+
+    m_is_swi2_pending = false;
+
+    while (!is_ble_done || !is_soc_done)
+    {
+        if (!is_soc_done)
+        {
+            if (sd_evt_get(&evt_id) == NRF_SUCCESS)
+            {
+                if (m_sys_evt_handler != NULL)
+                {
+                    m_sys_evt_handler(evt_id);
+                }
+            }
+            else
+            {
+                is_soc_done = true;
+            }
+        }
+
+        if (!is_ble_done)
+        {
+            if (m_ble_evt_cnt > 0)
+            {
+                ble_evt_entry_t entry = m_ble_evt_queue[m_ble_evt_head];
+
+                m_ble_evt_head = (m_ble_evt_head + 1) % BLE_EVT_QUEUE_SIZE;
+                m_ble_evt_cnt--;
+                if (m_ble_evt_handler != NULL)
+                {
+                    m_ble_evt_handler((ble_evt_t *)entry.data);
+                }
+            }
+            else
+            {
+                is_ble_done = true;
+            }
+        }
+    }
+}
+
+static void swi2_raise(void)
+{
+    sim_irq(SIM_WAKE_SOFTDEVICE);
+
+    if (m_is_swi2_pending && m_swi2_time_ns == sim_now())
+    {
+        return;
+    }
+
+    m_is_swi2_pending = true;
+    m_swi2_time_ns = sim_now();
+
+    uint32_t err_code = app_sched_event_put(NULL, 0, softdevice_evt_get);
+    APP_ERROR_CHECK(err_code);
+}
+
+void sim_sd_ble_evt_put(const void *p_evt, uint16_t len)
+{
+    if (m_ble_evt_cnt == BLE_EVT_QUEUE_SIZE)
+    {
+        sim_trace("BLE_EVT_DROPPED", "0x%02x", ((const ble_evt_t *)p_evt)->header.evt_id);
+        return;
+    }
+
+    ble_evt_entry_t *p_entry = &m_ble_evt_queue[(m_ble_evt_head + m_ble_evt_cnt) % BLE_EVT_QUEUE_SIZE];
+    memset(p_entry->data, 0, sizeof(p_entry->data));
+    memcpy(p_entry->data, p_evt, MIN(len, sizeof(p_entry->data)));
+    ((ble_evt_t *)p_entry->data)->header.evt_len = len;
+    p_entry->len = len;
+    m_ble_evt_cnt++;
+
+    swi2_raise();
+}
+
+void sim_sd_soc_evt_put(uint32_t evt_id)
+{
+    if (m_soc_evt_cnt == SOC_EVT_QUEUE_SIZE)
+    {
+        sim_trace("SOC_EVT_DROPPED", "%u", evt_id);
+        return;
+    }
+
+    m_soc_evt_queue[(m_soc_evt_head + m_soc_evt_cnt) % SOC_EVT_QUEUE_SIZE] = evt_id;
+    m_soc_evt_cnt++;
+
+    swi2_raise();
+}
+
+// Called by the radio model 800 us before each radio event
+void sim_sd_radio_notification(void)
+{
+    if (m_radio_notification_type == NRF_RADIO_NOTIFICATION_TYPE_NONE ||
+        !(m_nvic_enabled_mask & (1UL << SWI1_IRQn)) ||
+        SWI1_IRQHandler == NULL)
+    {
+        return;
+    }
+
+    sim_stats.radio_notification_cnt++;
+    sim_irq(SIM_WAKE_RADIO_NOTIFICATION);
+    SWI1_IRQHandler();
+}
+
+uint32_t sd_evt_get(uint32_t *p_evt_id)
+{
+    if (m_soc_evt_cnt == 0)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    *p_evt_id = m_soc_evt_queue[m_soc_evt_head];
+    m_soc_evt_head = (m_soc_evt_head + 1) % SOC_EVT_QUEUE_SIZE;
+    m_soc_evt_cnt--;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t softdevice_handler_init(nrf_clock_lf_cfg_t const *p_clock_lf_cfg, bool use_scheduler)
+{
+    if (!use_scheduler)
+    {
+        // Only the scheduler variant is used by the application.
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+
+    m_is_enabled = true;
+    sim_trace("SOFTDEVICE_ENABLE", "lfclk source %u", p_clock_lf_cfg->source);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t softdevice_enable_get_default_config(uint8_t central_links_count,
+                                              uint8_t periph_links_count,
+                                              ble_enable_params_t *p_ble_enable_params)
+{
+    memset(p_ble_enable_params, 0, sizeof(ble_enable_params_t));
+    p_ble_enable_params->common_enable_params.vs_uuid_count = 1;
+    p_ble_enable_params->gatts_enable_params.attr_tab_size = 0x580;
+    p_ble_enable_params->gatts_enable_params.service_changed = 0;
+    p_ble_enable_params->gap_enable_params.periph_conn_count = periph_links_count;
+    p_ble_enable_params->gap_enable_params.central_conn_count = central_links_count;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t softdevice_enable(ble_enable_params_t *p_ble_enable_params)
+{
+    uint32_t app_ram_base = SIM_RAM_BASE + 0x1fe8;
+
+    return sd_ble_enable(p_ble_enable_params, &app_ram_base);
+}
+
+uint32_t sd_ble_enable(ble_enable_params_t *p_ble_enable_params, uint32_t *p_app_ram_base)
+{
+    if (!m_is_enabled)
+    {
+        return NRF_ERROR_SOFTDEVICE_NOT_ENABLED;
+    }
+    if (m_is_ble_enabled)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_ble_enable_params->gap_enable_params.periph_conn_count == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_is_ble_enabled = true;
+    sim_ble_init();
+
+    return NRF_SUCCESS;
+}
+
+uint32_t softdevice_ble_evt_handler_set(ble_evt_handler_t ble_evt_handler)
+{
+    if (ble_evt_handler == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    m_ble_evt_handler = ble_evt_handler;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t softdevice_sys_evt_handler_set(sys_evt_handler_t sys_evt_handler)
+{
+    if (sys_evt_handler == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    m_sys_evt_handler = sys_evt_handler;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_softdevice_is_enabled(uint8_t *p_softdevice_enabled)
+{
+    *p_softdevice_enabled = m_is_enabled ? 1 : 0;
+
+    return NRF_SUCCESS;
+}
+
+// The simulation always starts from a power-on reset.
+uint32_t sd_power_reset_reason_get(uint32_t *p_reset_reason)
+{
+    if (!m_is_enabled)
+    {
+        return NRF_ERROR_SOFTDEVICE_NOT_ENABLED;
+    }
+
+    *p_reset_reason = 0;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_power_reset_reason_clr(uint32_t reset_reason_clr_msk)
+{
+    return m_is_enabled ? NRF_SUCCESS : NRF_ERROR_SOFTDEVICE_NOT_ENABLED;
+}
+
+uint32_t sd_power_dcdc_mode_set(uint8_t dcdc_mode)
+{
+    if (!m_is_enabled)
+    {
+        return NRF_ERROR_SOFTDEVICE_NOT_ENABLED;
+    }
+    if (dcdc_mode > NRF_POWER_DCDC_ENABLE)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    if (m_is_dcdc_enabled != (dcdc_mode == NRF_POWER_DCDC_ENABLE))
+    {
+        m_is_dcdc_enabled = (dcdc_mode == NRF_POWER_DCDC_ENABLE);
+        sim_trace("DCDC", "%u", m_is_dcdc_enabled);
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_power_ramon_set(uint32_t ramon)
+{
+    if (!m_is_enabled)
+    {
+        return NRF_ERROR_SOFTDEVICE_NOT_ENABLED;
+    }
+
+    m_ramon |= ramon;
+    sim_trace("RAMON", "0x%08x", m_ramon);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_power_ramon_clr(uint32_t ramon)
+{
+    if (!m_is_enabled)
+    {
+        return NRF_ERROR_SOFTDEVICE_NOT_ENABLED;
+    }
+
+    m_ramon &= ~ramon;
+    sim_trace("RAMON", "0x%08x", m_ramon);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_nvic_EnableIRQ(IRQn_Type IRQn)
+{
+    m_nvic_enabled_mask |= 1UL << IRQn;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_nvic_DisableIRQ(IRQn_Type IRQn)
+{
+    m_nvic_enabled_mask &= ~(1UL << IRQn);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_nvic_ClearPendingIRQ(IRQn_Type IRQn)
+{
+    return NRF_SUCCESS;
+}
+
+// Priorities 0 and 2 are reserved for the SoftDevice on nRF51.
+uint32_t sd_nvic_SetPriority(IRQn_Type IRQn, uint32_t priority)
+{
+    if (priority != APP_IRQ_PRIORITY_HIGH && priority != APP_IRQ_PRIORITY_LOW)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    return NRF_SUCCESS;
+}
+
+// Channels 0 to 7 are available to the application on S130.
+uint32_t sd_ppi_channel_assign(uint8_t channel_num, const volatile void *evt_endpoint, const volatile void *task_endpoint)
+{
+    if (!m_is_enabled)
+    {
+        return NRF_ERROR_SOFTDEVICE_NOT_ENABLED;
+    }
+    if (channel_num > 7)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    NRF_PPI->CH[channel_num].EEP = (uint32_t)(uintptr_t)evt_endpoint;
+    NRF_PPI->CH[channel_num].TEP = (uint32_t)(uintptr_t)task_endpoint;
+    sim_hw_sync();
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ppi_channel_enable_set(uint32_t channel_enable_set_msk)
+{
+    if (!m_is_enabled)
+    {
+        return NRF_ERROR_SOFTDEVICE_NOT_ENABLED;
+    }
+    if (channel_enable_set_msk & ~0xFFUL)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    NRF_PPI->CHENSET = channel_enable_set_msk;
+    sim_hw_sync();
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ppi_channel_enable_clr(uint32_t channel_enable_clr_msk)
+{
+    if (!m_is_enabled)
+    {
+        return NRF_ERROR_SOFTDEVICE_NOT_ENABLED;
+    }
+    if (channel_enable_clr_msk & ~0xFFUL)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    NRF_PPI->CHENCLR = channel_enable_clr_msk;
+    sim_hw_sync();
+
+    return NRF_SUCCESS;
+}
+
+// Only the notification before the radio is active with the distance of 800 us is modelled.
+uint32_t sd_radio_notification_cfg_set(uint8_t type, uint8_t distance)
+{
+    if (!m_is_enabled)
+    {
+        return NRF_ERROR_SOFTDEVICE_NOT_ENABLED;
+    }
+    if (type != NRF_RADIO_NOTIFICATION_TYPE_NONE &&
+        (type != NRF_RADIO_NOTIFICATION_TYPE_INT_ON_ACTIVE || distance != NRF_RADIO_NOTIFICATION_DISTANCE_800US))
+    {
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+
+    m_radio_notification_type = type;
+
+    return NRF_SUCCESS;
+}
+
+void sim_softdevice_report(void)
+{
+    printf("softdevice: DC/DC %s, RAMON 0x%08x\n", m_is_dcdc_enabled ? "on" : "off", m_ramon);
+}
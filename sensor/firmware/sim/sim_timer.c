@@ -0,0 +1,398 @@
+// RTC1, app_timer and app_scheduler
+
+#include "sim.h"
+
+#include <stdlib.h>
+
+#include "nrf.h"
+#include "app_timer.h"
+#include "app_scheduler.h"
+
+#define RTC_FREQ 32768
+#define RTC_COUNTER_MASK 0x00FFFFFF
+#define RTC_CC_INDEX_PPI 1
+#define APP_TIMER_SLOT_CNT 32
+
+typedef struct
+{
+    app_timer_t *p_timer;
+    sim_event_t event;
+} timer_slot_t;
+
+static bool m_is_app_timer_initialized;
+static timer_slot_t m_timer_slots[APP_TIMER_SLOT_CNT];
+static uint8_t m_timer_slot_cnt;
+
+// RTC1 is stopped and cleared by app_timer while no timer runs (APP_TIMER_KEEPS_RTC_ACTIVE 0).
+static bool m_is_rtc_running;
+static uint64_t m_rtc_start_ticks;
+
+// Compare of CC[1] routed by PPI, set up by the application through the registers
+static sim_event_t m_rtc_compare_event;
+static uint32_t m_rtc_compare_cc;
+static uint64_t m_rtc_compare_start_ticks;
+
+static int64_t lfclk_ppb(void)
+{
+    return (int64_t)(sim_config.lfclk_ppm * 1000.0);
+}
+
+// Ticks of the 32.768 kHz clock since the start of the simulation
+uint64_t sim_rtc_ticks(uint64_t time_ns)
+{
+    unsigned __int128 num = (unsigned __int128)time_ns * RTC_FREQ * (uint64_t)(1000000000LL + lfclk_ppb());
+
+    return (uint64_t)(num / ((unsigned __int128)1000000000ULL * 1000000000ULL));
+}
+
+// First time at which the tick count has reached ticks
+uint64_t sim_rtc_time_ns(uint64_t ticks)
+{
+    unsigned __int128 den = (unsigned __int128)RTC_FREQ * (uint64_t)(1000000000LL + lfclk_ppb());
+    unsigned __int128 num = (unsigned __int128)ticks * 1000000000ULL * 1000000000ULL;
+
+    return (uint64_t)((num + den - 1) / den);
+}
+
+static uint32_t rtc_counter_get(void)
+{
+    if (!m_is_rtc_running)
+    {
+        return 0;
+    }
+
+    return (uint32_t)(sim_rtc_ticks(sim_now()) - m_rtc_start_ticks) & RTC_COUNTER_MASK;
+}
+
+static void rtc_start(void)
+{
+    if (m_is_rtc_running)
+    {
+        return;
+    }
+
+    m_is_rtc_running = true;
+    m_rtc_start_ticks = sim_rtc_ticks(sim_now());
+    sim_trace("RTC_START", "");
+}
+
+static void rtc_stop_if_idle(void)
+{
+    if (APP_TIMER_KEEPS_RTC_ACTIVE || !m_is_rtc_running)
+    {
+        return;
+    }
+
+    for (uint8_t i = 0; i < m_timer_slot_cnt; i++)
+    {
+        if (m_timer_slots[i].p_timer->is_running)
+        {
+            return;
+        }
+    }
+
+    m_is_rtc_running = false;
+    sim_stats.rtc_stop_cnt++;
+    sim_trace("RTC_STOP", "");
+    sim_hw_sync();
+}
+
+static void rtc_compare_evt(sim_event_t *p_event)
+{
+    uint32_t eep = (uint32_t)(uintptr_t)&NRF_RTC1->EVENTS_COMPARE[RTC_CC_INDEX_PPI];
+
+    NRF_RTC1->EVENTS_COMPARE[RTC_CC_INDEX_PPI] = 1;
+    sim_trace("RTC_COMPARE", "%u", m_rtc_compare_cc);
+
+    for (uint32_t ch = 0; ch < 16; ch++)
+    {
+        if ((NRF_PPI->CHEN & (1UL << ch)) && NRF_PPI->CH[ch].EEP == eep)
+        {
+            sim_ppi_task(NRF_PPI->CH[ch].TEP);
+        }
+    }
+}
+
+// Register writes of the application take effect here, at its next call into the SDK.
+void sim_hw_sync(void)
+{
+    NRF_RTC1->EVTEN = (NRF_RTC1->EVTEN | NRF_RTC1->EVTENSET) & ~NRF_RTC1->EVTENCLR;
+    NRF_RTC1->EVTENSET = 0;
+    NRF_RTC1->EVTENCLR = 0;
+    NRF_PPI->CHEN = (NRF_PPI->CHEN | NRF_PPI->CHENSET) & ~NRF_PPI->CHENCLR;
+    NRF_PPI->CHENSET = 0;
+    NRF_PPI->CHENCLR = 0;
+    NRF_RTC1->COUNTER = rtc_counter_get();
+
+    bool is_compare_enabled = m_is_rtc_running &&
+                              (NRF_RTC1->EVTEN & RTC_EVTEN_COMPARE1_Msk) &&
+                              NRF_RTC1->EVENTS_COMPARE[RTC_CC_INDEX_PPI] == 0;
+    if (!is_compare_enabled)
+    {
+        sim_event_cancel(&m_rtc_compare_event);
+        return;
+    }
+
+    uint32_t cc = NRF_RTC1->CC[RTC_CC_INDEX_PPI] & RTC_COUNTER_MASK;
+    if (sim_event_is_scheduled(&m_rtc_compare_event) &&
+        cc == m_rtc_compare_cc && m_rtc_start_ticks == m_rtc_compare_start_ticks)
+    {
+        return;
+    }
+
+    // A compare within 2 ticks of the counter is not guaranteed and comes at the next wrap.
+    uint64_t now_ticks = sim_rtc_ticks(sim_now());
+    uint32_t delta = (cc - rtc_counter_get()) & RTC_COUNTER_MASK;
+    if (delta < 2)
+    {
+        delta += RTC_COUNTER_MASK + 1;
+    }
+
+    m_rtc_compare_cc = cc;
+    m_rtc_compare_start_ticks = m_rtc_start_ticks;
+    m_rtc_compare_event.handler = rtc_compare_evt;
+    sim_event_schedule(&m_rtc_compare_event, sim_rtc_time_ns(now_ticks + delta));
+}
+
+static void timer_expire_evt(sim_event_t *p_event)
+{
+    timer_slot_t *p_slot = (timer_slot_t *)((uint8_t *)p_event - offsetof(timer_slot_t, event));
+    app_timer_t *p_timer = p_slot->p_timer;
+
+    if (p_timer->mode == APP_TIMER_MODE_REPEATED)
+    {
+        p_timer->expire_ticks += p_timer->interval;
+        sim_event_schedule(&p_slot->event, sim_rtc_time_ns(p_timer->expire_ticks));
+    }
+    else
+    {
+        p_timer->is_running = false;
+    }
+
+    p_timer->expire_cnt++;
+    sim_irq(SIM_WAKE_RTC);
+    p_timer->handler(p_timer->p_context);
+    rtc_stop_if_idle();
+}
+
+uint32_t app_timer_init(uint32_t prescaler, uint8_t op_queue_size)
+{
+    if (prescaler != 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_is_app_timer_initialized = true;
+    NRF_RTC1->PRESCALER = prescaler;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_create(app_timer_id_t const *p_timer_id, app_timer_mode_t mode, app_timer_timeout_handler_t timeout_handler)
+{
+    if (!m_is_app_timer_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (timeout_handler == NULL)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (p_timer_id == NULL || *p_timer_id == NULL)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    app_timer_t *p_timer = *p_timer_id;
+    if (p_timer->is_running)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (p_timer->slot == 0)
+    {
+        if (m_timer_slot_cnt == APP_TIMER_SLOT_CNT)
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+        m_timer_slots[m_timer_slot_cnt].p_timer = p_timer;
+        m_timer_slots[m_timer_slot_cnt].event.handler = timer_expire_evt;
+        p_timer->slot = ++m_timer_slot_cnt;
+    }
+
+    p_timer->mode = mode;
+    p_timer->handler = timeout_handler;
+
+    return NRF_SUCCESS;
+}
+
+// As app_timer of SDK 12, a start of a running timer is ignored and keeps the first expiry.
+uint32_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void *p_context)
+{
+    if (!m_is_app_timer_initialized || timer_id == NULL)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (timeout_ticks < APP_TIMER_MIN_TIMEOUT_TICKS || timeout_ticks > APP_TIMER_MAX_CNT_VAL)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (timer_id->handler == NULL)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    sim_stats.timer_start_cnt++;
+    if (timer_id->is_running)
+    {
+        sim_stats.timer_restart_ignored_cnt++;
+        sim_trace("TIMER_RESTART_IGNORED", "%s", timer_id->name);
+        return NRF_SUCCESS;
+    }
+
+    rtc_start();
+
+    timer_slot_t *p_slot = &m_timer_slots[timer_id->slot - 1];
+    timer_id->is_running = true;
+    timer_id->p_context = p_context;
+    timer_id->interval = timeout_ticks;
+    timer_id->expire_ticks = sim_rtc_ticks(sim_now()) + timeout_ticks;
+    sim_event_schedule(&p_slot->event, sim_rtc_time_ns(timer_id->expire_ticks));
+
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_stop(app_timer_id_t timer_id)
+{
+    if (!m_is_app_timer_initialized || timer_id == NULL || timer_id->handler == NULL)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (timer_id->is_running)
+    {
+        timer_id->is_running = false;
+        sim_event_cancel(&m_timer_slots[timer_id->slot - 1].event);
+        rtc_stop_if_idle();
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_stop_all(void)
+{
+    for (uint8_t i = 0; i < m_timer_slot_cnt; i++)
+    {
+        m_timer_slots[i].p_timer->is_running = false;
+        sim_event_cancel(&m_timer_slots[i].event);
+    }
+    rtc_stop_if_idle();
+
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_cnt_get(uint32_t *p_ticks)
+{
+    *p_ticks = rtc_counter_get();
+
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_cnt_diff_compute(uint32_t ticks_to, uint32_t ticks_from, uint32_t *p_ticks_diff)
+{
+    *p_ticks_diff = (ticks_to - ticks_from) & RTC_COUNTER_MASK;
+
+    return NRF_SUCCESS;
+}
+
+void sim_timer_report(void)
+{
+    printf("app_timer:\n");
+    for (uint8_t i = 0; i < m_timer_slot_cnt; i++)
+    {
+        const app_timer_t *p_timer = m_timer_slots[i].p_timer;
+
+        printf("  %-36s %10u expiries%s\n", p_timer->name, p_timer->expire_cnt, p_timer->is_running ? ", running" : "");
+    }
+}
+
+// app_scheduler: the events and their data are copied into a FIFO of fixed size.
+typedef struct
+{
+    app_sched_event_handler_t handler;
+    uint16_t event_size;
+    uint8_t *p_data;
+} sched_entry_t;
+
+static sched_entry_t *m_sched_queue;
+static uint8_t *m_sched_data;
+static uint16_t m_sched_max_event_size;
+static uint16_t m_sched_queue_size;
+static uint16_t m_sched_head;
+static uint16_t m_sched_cnt;
+
+uint32_t app_sched_init(uint16_t max_event_size, uint16_t queue_size, void *p_evt_buffer)
+{
+    m_sched_max_event_size = max_event_size;
+    m_sched_queue_size = queue_size;
+    m_sched_head = 0;
+    m_sched_cnt = 0;
+    m_sched_queue = calloc(queue_size, sizeof(sched_entry_t));
+    m_sched_data = calloc(queue_size, max_event_size ? max_event_size : 1);
+    for (uint16_t i = 0; i < queue_size; i++)
+    {
+        m_sched_queue[i].p_data = &m_sched_data[i * max_event_size];
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t app_sched_event_put(void const *p_event_data, uint16_t event_size, app_sched_event_handler_t handler)
+{
+    if (event_size > m_sched_max_event_size)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    if (m_sched_cnt == m_sched_queue_size)
+    {
+        sim_trace("SCHED_FULL", "%u", m_sched_cnt);
+        return NRF_ERROR_NO_MEM;
+    }
+
+    sched_entry_t *p_entry = &m_sched_queue[(m_sched_head + m_sched_cnt) % m_sched_queue_size];
+    p_entry->handler = handler;
+    p_entry->event_size = event_size;
+    if (p_event_data != NULL && event_size > 0)
+    {
+        memcpy(p_entry->p_data, p_event_data, event_size);
+    }
+
+    m_sched_cnt++;
+    if (m_sched_cnt > sim_stats.sched_peak)
+    {
+        sim_stats.sched_peak = m_sched_cnt;
+    }
+
+    return NRF_SUCCESS;
+}
+
+void app_sched_execute(void)
+{
+    sim_hw_sync();
+
+    while (m_sched_cnt > 0)
+    {
+        sched_entry_t *p_entry = &m_sched_queue[m_sched_head];
+        void *p_data = (p_entry->event_size > 0) ? p_entry->p_data : NULL;
+
+        // The entry stays in the queue while its handler runs, as in SDK 12.
+        p_entry->handler(p_data, p_entry->event_size);
+        m_sched_head = (m_sched_head + 1) % m_sched_queue_size;
+        m_sched_cnt--;
+    }
+}
+
+uint16_t app_sched_queue_utilization_get(void)
+{
+    return (uint16_t)sim_stats.sched_peak;
+}
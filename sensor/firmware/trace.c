@@ -0,0 +1,205 @@
+#include "trace.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "nrf.h"
+#include "app_timer.h"
+#include "app_util.h"
+#include "app_util_platform.h"
+
+#define NRF_LOG_MODULE_NAME "TRACE"
+// The dump is the output of this module, so it is printed whenever NRF_LOG is enabled.
+#define NRF_LOG_LEVEL 3
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+// TIMER2 keeps HFCLK running, so it is started when a short stage is begun and shut down
+// when none is begun. STOP does not release the resources of a TIMER on nRF51.
+#define TRACE_TIMER NRF_TIMER2
+#define TRACE_TIMER_PRESCALER 4      // 16 MHz / 2^4 = 1 MHz
+#define TRACE_TIMER_MASK 0xffff      // TIMER1 and TIMER2 of nRF51 have 16 bits at most, 65 ms
+#define TRACE_TIMER_CC_INDEX 0
+
+// Stages timed by TIMER2. The others span a sleep and are timed by RTC1.
+static const bool m_is_timer_stage[TRACE_STAGE_CNT] = {
+    [TRACE_STAGE_ADC] = true,
+    [TRACE_STAGE_SPI_TRIGGER] = true,
+    [TRACE_STAGE_SPI_READ] = true,
+    [TRACE_STAGE_COMPENSATION] = true,
+    [TRACE_STAGE_ADV_UPDATE] = true,
+    [TRACE_STAGE_GATT_UPDATE] = true,
+};
+
+static uint32_t m_begin_ticks[TRACE_STAGE_CNT];
+static bool m_is_begun[TRACE_STAGE_CNT];
+static uint8_t m_timer_stage_cnt; // stages timed by TIMER2 which are begun
+static trace_histogram_t m_histograms[TRACE_STAGE_CNT];
+static uint32_t m_boot_ms[TRACE_BOOT_CNT];
+
+// Index of the highest set bit + 1. Cortex-M0 has no CLZ instruction.
+static uint8_t bucket_index_get(uint32_t ticks)
+{
+    uint8_t index = 0;
+
+    while (ticks > 0 && index < TRACE_BUCKET_CNT - 1)
+    {
+        ticks >>= 1;
+        index++;
+    }
+
+    return index;
+}
+
+// Call this in a critical region, the capture and the read are not atomic.
+static uint32_t timer_ticks_get()
+{
+    TRACE_TIMER->TASKS_CAPTURE[TRACE_TIMER_CC_INDEX] = 1;
+    return TRACE_TIMER->CC[TRACE_TIMER_CC_INDEX];
+}
+
+static uint32_t stage_ticks_get(trace_stage_t stage)
+{
+    uint32_t ticks;
+
+    if (m_is_timer_stage[stage])
+    {
+        return timer_ticks_get();
+    }
+
+    app_timer_cnt_get(&ticks);
+    return ticks;
+}
+
+void trace_init()
+{
+    TRACE_TIMER->MODE = TIMER_MODE_MODE_Timer;
+    TRACE_TIMER->BITMODE = TIMER_BITMODE_BITMODE_16Bit;
+    TRACE_TIMER->PRESCALER = TRACE_TIMER_PRESCALER;
+
+    trace_reset();
+}
+
+void trace_reset()
+{
+    CRITICAL_REGION_ENTER();
+    memset(m_is_begun, 0, sizeof(m_is_begun));
+    memset(m_histograms, 0, sizeof(m_histograms));
+    m_timer_stage_cnt = 0;
+    TRACE_TIMER->TASKS_SHUTDOWN = 1;
+    CRITICAL_REGION_EXIT();
+}
+
+void trace_begin(trace_stage_t stage)
+{
+    CRITICAL_REGION_ENTER();
+    // A stage begun again after it is aborted holds TIMER2 only once.
+    if (m_is_timer_stage[stage] && !m_is_begun[stage] && m_timer_stage_cnt++ == 0)
+    {
+        TRACE_TIMER->TASKS_CLEAR = 1;
+        TRACE_TIMER->TASKS_START = 1;
+    }
+    m_begin_ticks[stage] = stage_ticks_get(stage);
+    m_is_begun[stage] = true;
+    CRITICAL_REGION_EXIT();
+}
+
+void trace_end(trace_stage_t stage)
+{
+    uint32_t end_ticks;
+    uint32_t ticks;
+
+    CRITICAL_REGION_ENTER();
+    // The stage was reset or aborted since it was begun.
+    if (m_is_begun[stage])
+    {
+        m_is_begun[stage] = false;
+        end_ticks = stage_ticks_get(stage);
+        if (m_is_timer_stage[stage])
+        {
+            ticks = (end_ticks - m_begin_ticks[stage]) & TRACE_TIMER_MASK;
+            if (--m_timer_stage_cnt == 0)
+            {
+                TRACE_TIMER->TASKS_SHUTDOWN = 1;
+            }
+        }
+        else
+        {
+            app_timer_cnt_diff_compute(end_ticks, m_begin_ticks[stage], &ticks);
+        }
+
+        trace_histogram_t *p_histogram = &m_histograms[stage];
+        p_histogram->cnt++;
+        p_histogram->max_ticks = MAX(p_histogram->max_ticks, ticks);
+
+        uint8_t index = bucket_index_get(ticks);
+        if (p_histogram->buckets[index] < UINT16_MAX)
+        {
+            p_histogram->buckets[index]++;
+        }
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+const trace_histogram_t *trace_histogram_get(trace_stage_t stage)
+{
+    return &m_histograms[stage];
+}
+
+void trace_histogram_serialize(trace_stage_t stage, uint8_t *p_data)
+{
+    const trace_histogram_t *p_histogram = &m_histograms[stage];
+
+    p_data[0] = (uint8_t)stage;
+    uint32_encode(p_histogram->cnt, &p_data[1]);
+    uint32_encode(p_histogram->max_ticks, &p_data[5]);
+    for (uint8_t i = 0; i < TRACE_BUCKET_CNT; i++)
+    {
+        uint16_encode(p_histogram->buckets[i], &p_data[9 + i * 2]);
+    }
+}
+
+void trace_dump()
+{
+    for (uint8_t stage = 0; stage < TRACE_STAGE_CNT; stage++)
+    {
+        NRF_LOG_INFO("stage %u: cnt %u, max %u ticks\n", stage, m_histograms[stage].cnt, m_histograms[stage].max_ticks);
+        for (uint8_t i = 0; i < TRACE_BUCKET_CNT; i += 4)
+        {
+            NRF_LOG_INFO(" %u %u %u %u\n",
+                         m_histograms[stage].buckets[i], m_histograms[stage].buckets[i + 1],
+                         m_histograms[stage].buckets[i + 2], m_histograms[stage].buckets[i + 3]);
+        }
+    }
+}
+
+void trace_boot_record(trace_boot_t milestone)
+{
+    uint32_t ticks;
+
+    if (m_boot_ms[milestone] != 0)
+    {
+        return;
+    }
+
+    // RTC1 is started with the LFCLK and wraps after 512 s, long after the boot.
+    app_timer_cnt_get(&ticks);
+    // 0 is kept for a milestone not recorded yet.
+    m_boot_ms[milestone] = MAX((uint32_t)(((uint64_t)ticks * 1000) / APP_TIMER_CLOCK_FREQ), 1);
+
+    NRF_LOG_INFO("boot milestone %u: %u ms after LFCLK start\n", milestone, m_boot_ms[milestone]);
+}
+
+uint32_t trace_boot_ms_get(trace_boot_t milestone)
+{
+    return m_boot_ms[milestone];
+}
+
+void trace_boot_serialize(uint8_t type, uint8_t *p_data)
+{
+    p_data[0] = type;
+    for (uint8_t i = 0; i < TRACE_BOOT_CNT; i++)
+    {
+        uint32_encode(m_boot_ms[i], &p_data[1 + i * 4]);
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <stdint.h>
+
+// Durations of the stages of a measurement cycle, recorded in a histogram per stage.
+// The stages which span a sleep are timed by RTC1 (30.5 us per tick), and the short ones by TIMER2 (1 us per tick),
+// which runs only while one of them is begun. Enabled by the Makefile: make TRACE=1
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0
+#endif
+
+typedef enum
+{
+    TRACE_STAGE_TIMER_WAKE,      // RTC1: RTC1 timeout to the measurement timer handler in the main loop
+    TRACE_STAGE_ADC,             // TIMER2: ADC start to ADC done
+    TRACE_STAGE_SPI_TRIGGER,     // TIMER2: forced mode command to all sensors
+    TRACE_STAGE_CONVERSION_WAIT, // RTC1: end of the forced mode command to the start of the read
+    TRACE_STAGE_SPI_READ,        // TIMER2: read of the measurement data of all sensors
+    TRACE_STAGE_COMPENSATION,    // TIMER2: compensation of the raw data of all sensors
+    TRACE_STAGE_ADV_UPDATE,      // TIMER2: rebuild of the advertising data
+    TRACE_STAGE_GATT_UPDATE,     // TIMER2: update of the characteristics
+    TRACE_STAGE_CYCLE,           // RTC1: start of the measurement to the end of the data handler
+    TRACE_STAGE_CNT
+} trace_stage_t;
+
+// Bucket 0 counts durations under a tick, bucket n (n >= 1) counts 2^(n-1) to 2^n - 1 ticks.
+// The last bucket counts 2^14 ticks (500 ms of RTC1, 16 ms of TIMER2) or longer.
+#define TRACE_BUCKET_CNT 16
+
+typedef struct
+{
+    uint32_t cnt;
+    uint32_t max_ticks;
+    uint16_t buckets[TRACE_BUCKET_CNT]; // saturated at 0xffff
+} trace_histogram_t;
+
+// stage (1) + cnt (4) + max ticks (4) + buckets (2 each), little endian
+#define TRACE_HISTOGRAM_DATA_LEN (9 + TRACE_BUCKET_CNT * 2)
+
+#if TRACE_ENABLED
+#define TRACE_BEGIN(stage) trace_begin(stage)
+#define TRACE_END(stage) trace_end(stage)
+#else
+#define TRACE_BEGIN(stage)
+#define TRACE_END(stage)
+#endif
+
+void trace_init();
+void trace_reset();
+
+// A stage is ended only once after it is begun, so a stage can be begun in one context and ended in another.
+void trace_begin(trace_stage_t stage);
+void trace_end(trace_stage_t stage);
+
+const trace_histogram_t *trace_histogram_get(trace_stage_t stage);
+void trace_histogram_serialize(trace_stage_t stage, uint8_t *p_data);
+
+// Print all histograms to RTT
+void trace_dump();
+
+// Milestones of the boot in ms from the LFCLK start, recorded and printed in all builds,
+// as the log level of main.c and app_enble.c is 0.
+typedef enum
+{
+    TRACE_BOOT_INIT,       // end of the initialization in main()
+    TRACE_BOOT_FIRST_DATA, // first measurement data in the advertising data
+    TRACE_BOOT_FIRST_ADV,  // first advertising event with the measurement data
+    TRACE_BOOT_CNT
+} trace_boot_t;
+
+// type (1) + milestones (4 each), little endian
+#define TRACE_BOOT_DATA_LEN (1 + TRACE_BOOT_CNT * 4)
+
+// Only the first call of each milestone is recorded, and trace_reset() does not clear them.
+void trace_boot_record(trace_boot_t milestone);
+// 0 until the milestone is recorded
+uint32_t trace_boot_ms_get(trace_boot_t milestone);
+void trace_boot_serialize(uint8_t type, uint8_t *p_data);
+
+#endif
@@ -0,0 +1,90 @@
+#include "txpower.h"
+
+#include "app_error.h"
+#include "app_timer.h"
+#include "ble.h"
+
+#include "period_timer.h"
+
+#define NRF_LOG_MODULE_NAME "TXPOWER"
+#define NRF_LOG_LEVEL 0
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+#define TXPOWER_WATCHDOG_TICKS ((uint64_t)TXPOWER_WATCHDOG_S * APP_TIMER_CLOCK_FREQ)
+
+// Levels accepted by sd_ble_gap_tx_power_set() of S130 in ascending order
+static const int8_t m_levels[] = {-40, -30, -20, -16, -12, -8, -4, 0, 4};
+
+static int8_t m_dbm;
+static uint64_t m_recommended_ticks; // time of the last recommendation
+
+// The lowest level not below dbm and the floor
+static int8_t level_get(int8_t dbm)
+{
+    if (dbm < TXPOWER_MIN_DBM)
+    {
+        dbm = TXPOWER_MIN_DBM;
+    }
+
+    for (uint8_t i = 0; i < sizeof(m_levels); i++)
+    {
+        if (m_levels[i] >= dbm)
+        {
+            return m_levels[i];
+        }
+    }
+
+    return TXPOWER_MAX_DBM;
+}
+
+static bool level_apply(int8_t dbm)
+{
+    uint32_t err_code;
+
+    dbm = level_get(dbm);
+    if (dbm == m_dbm)
+    {
+        return false;
+    }
+
+    err_code = sd_ble_gap_tx_power_set(dbm);
+    APP_ERROR_CHECK(err_code);
+
+    NRF_LOG_INFO("TX power %d dBm\n", dbm);
+
+    m_dbm = dbm;
+    return true;
+}
+
+uint32_t txpower_init(int8_t dbm)
+{
+    m_dbm = level_get(dbm);
+    m_recommended_ticks = period_timer_ticks_get();
+
+    return sd_ble_gap_tx_power_set(m_dbm);
+}
+
+bool txpower_recommend(int8_t dbm)
+{
+    m_recommended_ticks = period_timer_ticks_get();
+
+    return level_apply(dbm);
+}
+
+bool txpower_watchdog_check()
+{
+    if (m_dbm == TXPOWER_DEFAULT_DBM || period_timer_ticks_get() - m_recommended_ticks < TXPOWER_WATCHDOG_TICKS)
+    {
+        return false;
+    }
+
+    NRF_LOG_INFO("no TX power recommendation, restore the default\n");
+
+    return level_apply(TXPOWER_DEFAULT_DBM);
+}
+
+int8_t txpower_get()
+{
+    return m_dbm;
+}
@@ -0,0 +1,27 @@
+#ifndef _TXPOWER_H
+#define _TXPOWER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// TX power of advertising and connections, lowered by a bridge which sees a good link margin.
+// A recommendation is rounded up to a level of the radio and never goes below the floor.
+// If no recommendation comes for TXPOWER_WATCHDOG_S, the default is restored,
+// because the bridge may have lost the device by the low TX power.
+
+#define TXPOWER_DEFAULT_DBM 0
+// Floor of a recommendation. Can be set by the Makefile: make TX_POWER_MIN=-16
+#ifndef TXPOWER_MIN_DBM
+#define TXPOWER_MIN_DBM -20
+#endif
+#define TXPOWER_MAX_DBM 4
+#define TXPOWER_WATCHDOG_S (3 * 24 * 3600)
+
+uint32_t txpower_init(int8_t dbm);
+// Returns true if the applied level has changed
+bool txpower_recommend(int8_t dbm);
+// Called periodically. Returns true if the default has been restored.
+bool txpower_watchdog_check();
+int8_t txpower_get();
+
+#endif
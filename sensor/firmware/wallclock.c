@@ -0,0 +1,155 @@
+#include "wallclock.h"
+
+#include "app_timer.h"
+#include "app_util.h"
+
+#include "period_timer.h"
+
+#define NRF_LOG_MODULE_NAME "WALLCLOCK"
+#define NRF_LOG_LEVEL 0
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+// A sync is delayed by a connection interval or an advertising delay (up to tens of ms),
+// so the drift is estimated over 6 hours or more to keep its error within a few ppm.
+#define DRIFT_ESTIMATION_MIN_INTERVAL_MS (6ULL * 3600 * 1000)
+// LFXO is within +-20 ppm. A larger value comes from a wrong time given by a peer.
+#define DRIFT_MAX_PPM 100
+
+#define PPM 1000000
+
+static bool m_is_synced;
+static uint64_t m_sync_epoch_ms;  // wall clock at the last sync
+static uint64_t m_sync_ticks;     // local ticks at the last sync
+static uint64_t m_drift_ref_epoch_ms;
+static uint64_t m_drift_ref_ticks;
+static int32_t m_drift_ppm;       // positive when LFCLK is fast
+
+static uint64_t ticks_to_ms(uint64_t ticks)
+{
+    return (ticks * 1000) / APP_TIMER_CLOCK_FREQ;
+}
+
+// Elapsed time in wall clock ms, corrected by the estimated drift
+static uint64_t elapsed_ms_get(uint64_t now_ticks)
+{
+    return (ticks_to_ms(now_ticks - m_sync_ticks) * PPM) / (PPM + m_drift_ppm);
+}
+
+static uint64_t now_ms_get()
+{
+    return m_sync_epoch_ms + elapsed_ms_get(period_timer_ticks_get());
+}
+
+static void drift_update(uint64_t epoch_ms, uint64_t now_ticks)
+{
+    int64_t local_elapsed_ms = (int64_t)ticks_to_ms(now_ticks - m_drift_ref_ticks);
+    int64_t real_elapsed_ms = (int64_t)epoch_ms - (int64_t)m_drift_ref_epoch_ms;
+
+    // The clock of the peer has been set back. Start over.
+    if (real_elapsed_ms <= 0)
+    {
+        m_drift_ref_epoch_ms = epoch_ms;
+        m_drift_ref_ticks = now_ticks;
+        return;
+    }
+
+    if ((uint64_t)real_elapsed_ms < DRIFT_ESTIMATION_MIN_INTERVAL_MS)
+    {
+        return;
+    }
+
+    int64_t drift_ppm = ((local_elapsed_ms - real_elapsed_ms) * PPM) / real_elapsed_ms;
+    if (drift_ppm > DRIFT_MAX_PPM || drift_ppm < -DRIFT_MAX_PPM)
+    {
+        NRF_LOG_WARNING("drift %d ppm is ignored\n", (int32_t)drift_ppm);
+    }
+    else
+    {
+        m_drift_ppm = (int32_t)drift_ppm;
+        period_timer_drift_set(m_drift_ppm);
+        NRF_LOG_INFO("drift %d ppm\n", m_drift_ppm);
+    }
+
+    m_drift_ref_epoch_ms = epoch_ms;
+    m_drift_ref_ticks = now_ticks;
+}
+
+void wallclock_init()
+{
+    m_is_synced = false;
+    m_drift_ppm = 0;
+}
+
+void wallclock_sync(uint32_t epoch_s, uint16_t epoch_ms)
+{
+    uint64_t now_ticks = period_timer_ticks_get();
+    uint64_t sync_epoch_ms = (uint64_t)epoch_s * 1000 + epoch_ms;
+
+    if (m_is_synced)
+    {
+        drift_update(sync_epoch_ms, now_ticks);
+    }
+    else
+    {
+        m_drift_ref_epoch_ms = sync_epoch_ms;
+        m_drift_ref_ticks = now_ticks;
+    }
+
+    m_sync_epoch_ms = sync_epoch_ms;
+    m_sync_ticks = now_ticks;
+    m_is_synced = true;
+
+    NRF_LOG_INFO("synced to %u s\n", epoch_s);
+}
+
+bool wallclock_is_synced()
+{
+    return m_is_synced;
+}
+
+// Unix time in seconds. 0 until the first sync.
+uint32_t wallclock_now_get(uint16_t *p_ms)
+{
+    if (!m_is_synced)
+    {
+        *p_ms = 0;
+        return 0;
+    }
+
+    uint64_t now_ms = now_ms_get();
+
+    *p_ms = (uint16_t)(now_ms % 1000);
+    return (uint32_t)(now_ms / 1000);
+}
+
+// Time to the next multiple of the period counted from the epoch, e.g. the next :00 for 60 s.
+uint32_t wallclock_delay_to_boundary_get(uint32_t period_s)
+{
+    return wallclock_delay_to_phase_get(period_s * 1000, 0);
+}
+
+// Time to the next point at the phase in the period counted from the epoch, e.g. the next :20 for 60000 ms and 20000 ms.
+uint32_t wallclock_delay_to_phase_get(uint32_t period_ms, uint32_t phase_ms)
+{
+    if (!m_is_synced || period_ms == 0)
+    {
+        return period_ms;
+    }
+
+    uint32_t elapsed_ms = (uint32_t)((now_ms_get() + period_ms - phase_ms % period_ms) % period_ms);
+    uint32_t delay_ms = period_ms - elapsed_ms;
+
+    // Too close to the boundary to start the timer in time. Take the next one.
+    if (delay_ms < 10)
+    {
+        delay_ms += period_ms;
+    }
+
+    return delay_ms;
+}
+
+int32_t wallclock_drift_ppm_get()
+{
+    return m_drift_ppm;
+}
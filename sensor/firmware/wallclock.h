@@ -0,0 +1,19 @@
+#ifndef _WALLCLOCK_H
+#define _WALLCLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Wall clock derived from RTC1 and the time given by a peer.
+// The frequency error of LFCLK is estimated from two syncs far enough apart
+// and given to the period timer, so measurements stay on wall clock boundaries.
+
+void wallclock_init();
+void wallclock_sync(uint32_t epoch_s, uint16_t epoch_ms);
+bool wallclock_is_synced();
+uint32_t wallclock_now_get(uint16_t *p_ms);
+uint32_t wallclock_delay_to_boundary_get(uint32_t period_s);
+uint32_t wallclock_delay_to_phase_get(uint32_t period_ms, uint32_t phase_ms);
+int32_t wallclock_drift_ppm_get();
+
+#endif